@@ -2,14 +2,21 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <set>
+#include <tuple>
 #include <limits>
 #include <algorithm>
 #include <mutex>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <utility>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wshadow"
 #include <yaml-cpp/yaml.h>
 #pragma GCC diagnostic pop
 #include "apidb.hpp"
+#include "compiled_apidb.hpp"
 #include "demangle.hpp"
 #include "threads.hpp"
 #include <sqlite3.h>
@@ -154,6 +161,16 @@ APIDefinitionList MultiApiDictionary::get_api_definition(rose_addr_t addr) const
   return _get_api_definition(addr);
 }
 
+APIDefinitionList MultiApiDictionary::get_all_definitions() const
+{
+  APIDefinitionList list;
+  for (auto & dict : dicts) {
+    auto results = dict->get_all_definitions();
+    std::move(results.begin(), results.end(), std::back_inserter(list));
+  }
+  return list;
+}
+
 bool MultiApiDictionary::handles_dll(std::string const & dll_name) const
 {
   for (auto & dict : dicts) {
@@ -252,14 +269,20 @@ bool APIDictionary::handle_node(MultiApiDictionary & db, const YAML::Node & node
           throw std::runtime_error("Could not open for read");
         }
 
-        // Read the first few bytes to see of the file match the SQLite magic prologue
+        // Read the first few bytes to see of the file match the SQLite magic prologue, or that
+        // of a compiled API database.
         static constexpr char sqlite_magic[] = "SQLite";
         constexpr auto len = sizeof(sqlite_magic) - 1;
-        char prologue[len];
-        file.read(prologue, len);
-        bool correct_size = file.gcount() == len;
+        static_assert(CompiledApiDictionary::magic_size >= len, "prologue is too short");
+        char prologue[CompiledApiDictionary::magic_size];
+        file.read(prologue, sizeof(prologue));
+        auto got = size_t(file.gcount());
         file.close();
-        if (!(correct_size && std::equal(prologue, prologue + len, sqlite_magic))) {
+        if (CompiledApiDictionary::has_magic(prologue, got)) {
+          auto compiled = make_unique<CompiledApiDictionary>(path.native());
+          assert(compiled);
+          add(std::move(compiled));
+        } else if (!(got >= len && std::equal(prologue, prologue + len, sqlite_magic))) {
           // Assume json
           auto jsondb = make_unique<JSONApiDictionary>(path.native());
           assert(jsondb);
@@ -682,10 +705,24 @@ JSONApiDictionary::get_api_definition(rose_addr_t addr) const
   return APIDefinitionList(begin(found), end(found));
 }
 
-struct SQLLiteApiDictionary::Data {
-  mutable std::recursive_mutex mutex;
-  using lock_guard = std::lock_guard<decltype(mutex)>;
+APIDefinitionList
+JSONApiDictionary::get_all_definitions() const
+{
+  if (data->load_on_demand) {
+    // Load every DLL in the directory
+    boost::system::error_code ec;
+    for (bf::directory_iterator i(path, ec), end; !ec && i != end; i.increment(ec)) {
+      if (i->path().extension() == ".json") {
+        known_dll(normalize_dll(i->path().stem().string()));
+      }
+    }
+  }
+  // Every definition is in the defmap, under its name (which may be empty).
+  auto found = values(data->defmap);
+  return APIDefinitionList(begin(found), end(found));
+}
 
+struct SQLLiteApiDictionary::Data {
   static Sawyer::Message::Facility mlog;
   static Sawyer::Message::Facility & initDiagnostics();
 #if SQLITE_TRACE_V2_EXISTS
@@ -708,19 +745,6 @@ struct SQLLiteApiDictionary::Data {
   }
 #endif
 
-  void enable_trace() {
-    if (mlog[Sawyer::Message::DEBUG]) {
-#if SQLITE_TRACE_V2_EXISTS
-      sqlite3_trace_v2(db, SQLITE_TRACE_STMT, log_sql, nullptr);
-#else
-      sqlite3_trace(db, log_sql, nullptr);
-#endif
-    }
-  }
-
-  static std::int64_t next_regex_index;
-  static std_mutex regex_mutex;
-  static std::map<int, regex const *> regex_map;
   static void regexp(sqlite3_context * ctx, int, sqlite3_value **args);
 
   enum version_t {
@@ -862,15 +886,13 @@ struct SQLLiteApiDictionary::Data {
 
   // Throw an error based on an error code
   [[noreturn]] static void throw_error(int code);
-  // Throw an error based on the state of the db
-  [[noreturn]] void throw_error() const;
 
-  std::string build_function_query(query_type_t qt, char const * const * condition) {
+  std::string build_function_query(query_type_t qt, char const * const * condition) const {
     int idx = static_cast<int>(version);
     return build_function_query(qt, condition[idx]);
   }
 
-  std::string build_function_query(query_type_t qt, char const * condition) {
+  std::string build_function_query(query_type_t qt, char const * condition) const {
     int v_idx = static_cast<int>(version);
     int t_idx = static_cast<int>(qt);
     return (std::string("SELECT ") + select_function_columns[v_idx] + " "
@@ -879,8 +901,102 @@ struct SQLLiteApiDictionary::Data {
 
   // Throw an error based on the code if the code isn't OK
   static void maybe_throw_code(int code);
-  // Throw an error based on the db if the code isn't OK
-  void maybe_throw(int code) const;
+
+  // A connection to the database, and its prepared statements.  A connection is only used by
+  // one thread at a time, so there's no locking at all once a thread has one.
+  struct Connection {
+    Connection(Data const & data);
+    ~Connection();
+    Connection(Connection const &) = delete;
+    Connection & operator=(Connection const &) = delete;
+
+    // Throw an error based on the state of the db
+    [[noreturn]] void throw_error() const;
+    // Throw an error based on the db if the code isn't OK
+    void maybe_throw(int code) const;
+
+    void prepare(std::string const & query, sqlite3_stmt *& stmt) const;
+    // Read the version of the db
+    version_t read_version() const;
+    // Prepare the lookup statements for the version of the db
+    void prepare_lookups();
+
+    APIDefinitionList
+    get_db_function(
+      sqlite3_stmt * lookup) const;
+
+    Data const & data;
+    sqlite3 * db = nullptr;
+    sqlite3_stmt * lookup_by_id = nullptr;
+    sqlite3_stmt * lookup_by_name = nullptr;
+    sqlite3_stmt * lookup_by_name_only = nullptr;
+    sqlite3_stmt * lookup_all_names = nullptr;
+    sqlite3_stmt * lookup_by_row = nullptr;
+    sqlite3_stmt * lookup_params = nullptr;
+    sqlite3_stmt * lookup_dll_exists = nullptr;
+    // The pattern used by the match() function during a regex lookup.
+    regex const * pattern = nullptr;
+  };
+
+  // A connection borrowed from the pool for the duration of a lookup.
+  class Lease {
+   public:
+    Lease(Data const & d) : data(d), conn(d.acquire()) {}
+    ~Lease() { data.release(std::move(conn)); }
+    Connection * operator->() const { return conn.get(); }
+    Connection & operator*() const { return *conn; }
+   private:
+    Data const & data;
+    std::unique_ptr<Connection> conn;
+  };
+
+  // Get an idle connection from the pool, opening a new one if there aren't any.
+  std::unique_ptr<Connection> acquire() const;
+  void release(std::unique_ptr<Connection> conn) const;
+
+  // A memo of the results of earlier lookups (including the ones that found nothing), shared
+  // by all of the threads.  The database is read-only, so the results never change.  The memo
+  // is split into shards, each with its own lock, so that threads looking up different
+  // functions rarely wait for each other.
+  template <typename Key, typename Hash>
+  class Memo {
+   public:
+    bool find(Key const & key, APIDefinitionList & result) const {
+      Shard const & shard = get_shard(key);
+      write_guard<decltype(shard.mutex)> guard{shard.mutex};
+      auto found = shard.map.find(key);
+      if (found == shard.map.end()) {
+        return false;
+      }
+      result = found->second;
+      return true;
+    }
+    void insert(Key key, APIDefinitionList const & result) {
+      Shard & shard = get_shard(key);
+      write_guard<decltype(shard.mutex)> guard{shard.mutex};
+      shard.map.emplace(std::move(key), result);
+    }
+   private:
+    static constexpr size_t num_shards = 16;
+    struct Shard {
+      mutable std_mutex mutex;
+      std::unordered_map<Key, APIDefinitionList, Hash> map;
+    };
+    Shard const & get_shard(Key const & key) const {
+      return shards[Hash()(key) % num_shards];
+    }
+    Shard & get_shard(Key const & key) {
+      return shards[Hash()(key) % num_shards];
+    }
+    std::array<Shard, num_shards> shards;
+  };
+
+  // Look something up, first in the memo and then (using a pooled connection) in the db.
+  template <typename Key, typename Hash, typename Query>
+  APIDefinitionList memoized(Memo<Key, Hash> & memo, Key key, Query && query) const;
+  // Run a query on a pooled connection, and record how long it took.
+  template <typename Query>
+  auto timed(Query && query) const -> decltype(query(std::declval<Connection &>()));
 
   // Load the db at filename
   Data(APIDictionary const & parent, const std::string & filename);
@@ -902,25 +1018,30 @@ struct SQLLiteApiDictionary::Data {
   get_api_definition(
     const std::string & dll_name, size_t ordinal) const;
 
-  APIDefinitionList
-  get_db_function(
-    sqlite3_stmt * lookup) const;
+  APIDefinitionList get_all_definitions() const;
 
   bool handles_dll(std::string const & dll_name) const;
 
+  Stats get_stats() const;
+  void report() const;
 
-  sqlite3 * db = nullptr;
-  sqlite3_stmt * lookup_by_id = nullptr;
-  sqlite3_stmt * lookup_by_name = nullptr;
-  sqlite3_stmt * lookup_by_name_only = nullptr;
-  sqlite3_stmt * lookup_all_names = nullptr;
-  sqlite3_stmt * lookup_by_row = nullptr;
-  sqlite3_stmt * lookup_params = nullptr;
-  sqlite3_stmt * lookup_dll_exists = nullptr;
-  mutable defmap_t defmap;
-  mutable ordmap_t ordmap;
-  version_t version;
+  std::string filename;
+  version_t version = V0;
   APIDictionary const & parent;
+
+  mutable std_mutex pool_mutex;
+  mutable std::vector<std::unique_ptr<Connection>> idle;
+
+  mutable Memo<defkey_t, defhash> defmemo;
+  mutable Memo<ordkey_t, ordhash> ordmemo;
+  mutable Memo<std::string, std::hash<std::string>> namememo;
+
+  mutable std::atomic<uint64_t> memo_hits{0};
+  mutable std::atomic<uint64_t> queries{0};
+  mutable std::atomic<uint64_t> query_nanoseconds{0};
+  mutable std::atomic<uint64_t> max_query_nanoseconds{0};
+  mutable std::atomic<uint64_t> connections{0};
+  mutable std::atomic<uint64_t> pool_lock_contention{0};
 };
 
 Sawyer::Message::Facility SQLLiteApiDictionary::Data::mlog;
@@ -939,16 +1060,13 @@ Sawyer::Message::Facility & SQLLiteApiDictionary::Data::initDiagnostics()
 
 void SQLLiteApiDictionary::Data::regexp(sqlite3_context * ctx, int, sqlite3_value **args)
 {
-  assert(sqlite3_value_type(args[0]) == SQLITE_INTEGER);
   assert(sqlite3_value_type(args[1]) == SQLITE3_TEXT);
   auto str = reinterpret_cast<const char *>(sqlite3_value_text(args[1]));
-  auto pattern_idx = sqlite3_value_int64(args[0]);
-  regex const *pattern;
-  {
-    write_guard<decltype(regex_mutex)> guard(regex_mutex);
-    pattern = regex_map.at(pattern_idx);
-  }
-  int result = std::regex_search(str, *pattern);
+  // The connection is only used by the thread running the query, so the pattern can't change
+  // underneath us.
+  auto conn = static_cast<Connection const *>(sqlite3_user_data(ctx));
+  assert(conn->pattern);
+  int result = std::regex_search(str, *conn->pattern);
   sqlite3_result_int(ctx, result);
 }
 
@@ -963,9 +1081,6 @@ constexpr char const * SQLLiteApiDictionary::Data::select_by_row_condition[];
 constexpr char const * SQLLiteApiDictionary::Data::select_dll_exists[];
 constexpr char const * SQLLiteApiDictionary::Data::select_params[];
 constexpr char const SQLLiteApiDictionary::Data::select_version[];
-std::int64_t SQLLiteApiDictionary::Data::next_regex_index = 0;
-std_mutex SQLLiteApiDictionary::Data::regex_mutex;
-std::map<int, regex const *> SQLLiteApiDictionary::Data::regex_map;
 
 
 inline void SQLLiteApiDictionary::Data::throw_error(int code)
@@ -973,7 +1088,7 @@ inline void SQLLiteApiDictionary::Data::throw_error(int code)
   throw SQLError(sqlite3_errstr(code));
 }
 
-inline void SQLLiteApiDictionary::Data::throw_error() const
+inline void SQLLiteApiDictionary::Data::Connection::throw_error() const
 {
   throw SQLError(sqlite3_errmsg(db));
 }
@@ -985,48 +1100,87 @@ inline void SQLLiteApiDictionary::Data::maybe_throw_code(int code)
   }
 }
 
-inline void SQLLiteApiDictionary::Data::maybe_throw(int code) const
+inline void SQLLiteApiDictionary::Data::Connection::maybe_throw(int code) const
 {
   switch (code) {
    case SQLITE_OK:
     break;
    case SQLITE_MISUSE:
     // If the call was misused, we can't count on the db.  Use only the code.
-    throw_error(code);
+    Data::throw_error(code);
     break;
    default:
     throw_error();
   }
 }
 
-SQLLiteApiDictionary::Data::Data(APIDictionary const & p, const std::string & filename) :
-  parent(p)
+SQLLiteApiDictionary::Data::Connection::Connection(Data const & d) : data(d)
 {
-  // Open the db
-  try {
-    constexpr auto flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX;
-    maybe_throw_code(sqlite3_open_v2(filename.c_str(), &db, flags, nullptr));
-    enable_trace();
-  } catch (const SQLError &) {
-    GERROR << "Unable to read API Database \"" << filename << '\"' << LEND;
-    throw;
+  // Open the db.  Each connection is only used by one thread at a time, so it doesn't need
+  // SQLite's own locking.
+  constexpr auto flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+  int rv = sqlite3_open_v2(data.filename.c_str(), &db, flags, nullptr);
+  if (rv != SQLITE_OK) {
+    // Even on failure there's a handle that needs to be closed.
+    sqlite3_close_v2(db);
+    db = nullptr;
+    maybe_throw_code(rv);
+  }
+  if (mlog[Sawyer::Message::DEBUG]) {
+#if SQLITE_TRACE_V2_EXISTS
+    sqlite3_trace_v2(db, SQLITE_TRACE_STMT, log_sql, nullptr);
+#else
+    sqlite3_trace(db, log_sql, nullptr);
+#endif
   }
 
   // Install the regexp routine
-  maybe_throw(sqlite3_create_function_v2(db, "match", 2, SQLITE_UTF8, nullptr,
-                                         regexp, nullptr, nullptr, nullptr));
+  try {
+    maybe_throw(sqlite3_create_function_v2(db, "match", 2, SQLITE_UTF8, this,
+                                           regexp, nullptr, nullptr, nullptr));
+  } catch (...) {
+    sqlite3_close_v2(db);
+    throw;
+  }
+}
 
-  // query preparation helper
-  auto prepare = [this](std::string const & query, sqlite3_stmt *& stmt) {
-    MDEBUG << "Preparing query: " << query << std::endl;
-    maybe_throw(sqlite3_prepare_v2(db, query.c_str(), query.size(), &stmt, nullptr));
+SQLLiteApiDictionary::Data::Connection::~Connection()
+{
+  // All statments must be finalized before closing the db
+  auto cleanup = [](sqlite3_stmt * & stmt) {
+    UNUSED int rv = sqlite3_finalize(stmt);
+    assert(rv == SQLITE_OK);
+    stmt = nullptr;
   };
+  cleanup(lookup_by_id);
+  cleanup(lookup_by_name);
+  cleanup(lookup_by_name_only);
+  cleanup(lookup_all_names);
+  cleanup(lookup_by_row);
+  cleanup(lookup_params);
+  cleanup(lookup_dll_exists);
 
-  // Determine the version
+  // Close the db
+  UNUSED int rv = sqlite3_close_v2(db);
+  assert(rv == SQLITE_OK);
+  db = nullptr;
+}
+
+void SQLLiteApiDictionary::Data::Connection::prepare(
+  std::string const & query, sqlite3_stmt *& stmt) const
+{
+  MDEBUG << "Preparing query: " << query << std::endl;
+  maybe_throw(sqlite3_prepare_v2(db, query.c_str(), query.size(), &stmt, nullptr));
+}
+
+SQLLiteApiDictionary::Data::version_t
+SQLLiteApiDictionary::Data::Connection::read_version() const
+{
   sqlite3_stmt * lookup_version = nullptr;
   prepare(select_version, lookup_version);
   auto deleter = [](sqlite3_stmt *s) { sqlite3_finalize(s); };
   std::unique_ptr<sqlite3_stmt, decltype(deleter)> version_guard(lookup_version, deleter);
+  version_t db_version = V0;
   int rv;
   do {
     rv = sqlite3_step(lookup_version);
@@ -1044,40 +1198,45 @@ SQLLiteApiDictionary::Data::Data(APIDictionary const & p, const std::string & fi
         if (v < Version{1}) {
           throw SQLError("Database does not contain known version");
         } else if (v < Version{1,1}) {
-          version = V0;
+          db_version = V0;
         } else if (v < Version{2}) {
           // Version 1.1 added the paramsKnown field
-          version = V1;
+          db_version = V1;
         } else if (v < Version{4}) {
           // Version 2.0 added the aliasId field and renamed the canonical and name fields
-          version = V2;
+          db_version = V2;
         } else if (v < Version{5}) {
           // Version 4.0 changed the way aliases are handled and added source tables
-          version = V4;
+          db_version = V4;
         } else {
           // Version 5.0 added dll version information
-          version = V5;
+          db_version = V5;
         }
       }
       break;
      case SQLITE_DONE:
       // Original database was often missing the version information
-      version = V0;
+      db_version = V0;
       break;
      default:
       throw_error();
     }
   } while (rv == SQLITE_BUSY);
+  return db_version;
+}
 
-  // Prepare the select statements
-  std::string name_query = build_function_query(NAME_TYPE, select_by_name_condition);
-  std::string name_only_query = build_function_query(NAME_TYPE, select_by_name_only_condition);
-  std::string all_names_query = build_function_query(
+void SQLLiteApiDictionary::Data::Connection::prepare_lookups()
+{
+  std::string name_query = data.build_function_query(NAME_TYPE, select_by_name_condition);
+  std::string name_only_query = data.build_function_query(
+    NAME_TYPE, select_by_name_only_condition);
+  std::string all_names_query = data.build_function_query(
     NAME_TYPE, select_by_name_regexp_condition);
-  std::string ordinal_query = build_function_query(ORDINAL_TYPE, select_by_ordinal_condition);
-  std::string dll_exists_query = select_dll_exists[static_cast<int>(version)];
-  std::string row_query = build_function_query(NAME_TYPE, select_by_row_condition);
-  std::string params_query = select_params[static_cast<int>(version)];
+  std::string ordinal_query = data.build_function_query(
+    ORDINAL_TYPE, select_by_ordinal_condition);
+  std::string dll_exists_query = select_dll_exists[static_cast<int>(data.version)];
+  std::string row_query = data.build_function_query(NAME_TYPE, select_by_row_condition);
+  std::string params_query = select_params[static_cast<int>(data.version)];
   prepare(name_query, lookup_by_name);
   prepare(name_only_query, lookup_by_name_only);
   prepare(all_names_query, lookup_all_names);
@@ -1087,30 +1246,91 @@ SQLLiteApiDictionary::Data::Data(APIDictionary const & p, const std::string & fi
   prepare(dll_exists_query, lookup_dll_exists);
 }
 
+SQLLiteApiDictionary::Data::Data(APIDictionary const & p, const std::string & filename_) :
+  filename(filename_), parent(p)
+{
+  // Open the first connection, which also determines the version of the db.  More
+  // connections are opened as they're needed by other threads.
+  std::unique_ptr<Connection> conn;
+  try {
+    conn.reset(new Connection(*this));
+  } catch (const SQLError &) {
+    GERROR << "Unable to read API Database \"" << filename << '\"' << LEND;
+    throw;
+  }
+  version = conn->read_version();
+  conn->prepare_lookups();
+  idle.push_back(std::move(conn));
+  connections = 1;
+}
+
 SQLLiteApiDictionary::Data::~Data()
 {
-  // All statments must be finalized before closing the db
-  auto cleanup = [](sqlite3_stmt * & stmt) {
-    UNUSED int rv = sqlite3_finalize(stmt);
-    assert(rv == SQLITE_OK);
-    stmt = nullptr;
-  };
-  cleanup(lookup_by_id);
-  cleanup(lookup_by_name);
-  cleanup(lookup_by_name_only);
-  cleanup(lookup_all_names);
-  cleanup(lookup_by_row);
-  cleanup(lookup_params);
-  cleanup(lookup_dll_exists);
+  report();
+}
 
-  // Close the db
-  UNUSED int rv = sqlite3_close_v2(db);
-  assert(rv == SQLITE_OK);
-  db = nullptr;
+std::unique_ptr<SQLLiteApiDictionary::Data::Connection>
+SQLLiteApiDictionary::Data::acquire() const
+{
+  {
+    std::unique_lock<decltype(pool_mutex)> lock{pool_mutex, std::try_to_lock};
+    if (!lock.owns_lock()) {
+      ++pool_lock_contention;
+      lock.lock();
+    }
+    if (!idle.empty()) {
+      std::unique_ptr<Connection> conn = std::move(idle.back());
+      idle.pop_back();
+      return conn;
+    }
+  }
+  // Every connection is busy, so this thread gets one of its own.
+  std::unique_ptr<Connection> conn(new Connection(*this));
+  conn->prepare_lookups();
+  ++connections;
+  return conn;
+}
+
+void SQLLiteApiDictionary::Data::release(std::unique_ptr<Connection> conn) const
+{
+  write_guard<decltype(pool_mutex)> guard{pool_mutex};
+  idle.push_back(std::move(conn));
+}
+
+template <typename Query>
+auto SQLLiteApiDictionary::Data::timed(Query && query) const
+  -> decltype(query(std::declval<Connection &>()))
+{
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  auto finally = make_finalizer([this, start]() {
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      clock::now() - start).count();
+    ++queries;
+    query_nanoseconds += ns;
+    uint64_t max = max_query_nanoseconds;
+    while (ns > max && !max_query_nanoseconds.compare_exchange_weak(max, ns)) {}
+  });
+  Lease conn{*this};
+  return query(*conn);
+}
+
+template <typename Key, typename Hash, typename Query>
+APIDefinitionList SQLLiteApiDictionary::Data::memoized(
+  Memo<Key, Hash> & memo, Key key, Query && query) const
+{
+  APIDefinitionList result;
+  if (memo.find(key, result)) {
+    ++memo_hits;
+    return result;
+  }
+  result = timed(std::forward<Query>(query));
+  memo.insert(std::move(key), result);
+  return result;
 }
 
 APIDefinitionList
-SQLLiteApiDictionary::Data::get_db_function(
+SQLLiteApiDictionary::Data::Connection::get_db_function(
   sqlite3_stmt * lookup) const
 {
   int rv;
@@ -1177,7 +1397,7 @@ SQLLiteApiDictionary::Data::get_db_function(
       // Don't return a definition if we don't have useful parameter information
       if (sqlite3_column_int(lookup, PARAMS_KNOWN)) {
         // Create a definition
-        auto fd = std::make_shared<APIDefinition>(parent);
+        auto fd = std::make_shared<APIDefinition>(data.parent);
         auto &def = *fd;
         auto textval = create_textval(current_lookup);
         auto rowid = sqlite3_column_int64(current_lookup, ROWID);
@@ -1248,12 +1468,6 @@ SQLLiteApiDictionary::Data::get_db_function(
           def.stackdelta = def.parameters.size() * 4;
         }
 
-        auto defkey = defkey_t(def.dll_name, def.export_name);
-        defmap.emplace(std::move(defkey), fd);
-        if (fd->ordinal) {
-          auto ordkey = ordkey_t(def.dll_name, fd->ordinal);
-          ordmap.emplace(std::move(ordkey), fd);
-        }
         list.push_back(fd);
       } // if (sqlite3_column_int(lookup, PARAMS_KNOWN))
       current_lookup = lookup;
@@ -1273,86 +1487,101 @@ APIDefinitionList
 SQLLiteApiDictionary::Data::get_api_definition(
   const std::string & dll_name, size_t ordinal) const
 {
-  lock_guard lock{mutex};
   auto key = ordkey_t(normalize_dll(dll_name), ordinal);
-  auto loc = values(ordmap.equal_range(key));
-  if (begin(loc) != end(loc)) {
-    return APIDefinitionList(begin(loc), end(loc));
-  }
-
-  // Not cached.  Look it up in the db
   auto name = key.first + ".dll";
-  maybe_throw(sqlite3_reset(lookup_by_id));
-  maybe_throw(sqlite3_bind_text(lookup_by_id, 1, name.c_str(), name.size(), SQLITE_TRANSIENT));
-  maybe_throw(sqlite3_bind_int64(lookup_by_id, 2, sqlite3_int64(ordinal)));
-
-  return get_db_function(lookup_by_id);
+  return memoized(ordmemo, std::move(key), [&name, ordinal](Connection & conn) {
+    auto lookup = conn.lookup_by_id;
+    conn.maybe_throw(sqlite3_reset(lookup));
+    conn.maybe_throw(sqlite3_bind_text(lookup, 1, name.c_str(), name.size(),
+                                       SQLITE_TRANSIENT));
+    conn.maybe_throw(sqlite3_bind_int64(lookup, 2, sqlite3_int64(ordinal)));
+    return conn.get_db_function(lookup);
+  });
 }
 
 APIDefinitionList
 SQLLiteApiDictionary::Data::get_api_definition(
   const std::string & dll_name, const std::string & func_name) const
 {
-  lock_guard lock{mutex};
   auto key = defkey_t(normalize_dll(dll_name), func_name);
-  auto loc = values(defmap.equal_range(key));
-  if (begin(loc) != end(loc)) {
-    return APIDefinitionList(begin(loc), end(loc));
-  }
-
-  // Not cached.  Look it up in the db
   auto name = key.first + ".dll";
-  maybe_throw(sqlite3_reset(lookup_by_name));
-  maybe_throw(sqlite3_bind_text(lookup_by_name, 1, name.c_str(), name.size(),
-                                SQLITE_TRANSIENT));
-  maybe_throw(sqlite3_bind_text(lookup_by_name, 2, key.second.c_str(), key.second.size(),
-                                SQLITE_TRANSIENT));
-
-  return get_db_function(lookup_by_name);
+  return memoized(defmemo, std::move(key), [&name, &func_name](Connection & conn) {
+    auto lookup = conn.lookup_by_name;
+    conn.maybe_throw(sqlite3_reset(lookup));
+    conn.maybe_throw(sqlite3_bind_text(lookup, 1, name.c_str(), name.size(),
+                                       SQLITE_TRANSIENT));
+    conn.maybe_throw(sqlite3_bind_text(lookup, 2, func_name.c_str(), func_name.size(),
+                                       SQLITE_TRANSIENT));
+    return conn.get_db_function(lookup);
+  });
 }
 
 APIDefinitionList
 SQLLiteApiDictionary::Data::get_api_definition(
   const std::string & func_name) const
 {
-  lock_guard lock{mutex};
-  maybe_throw(sqlite3_reset(lookup_by_name_only));
-  maybe_throw(sqlite3_bind_text(lookup_by_name_only, 1, func_name.c_str(), func_name.size(),
-                                SQLITE_TRANSIENT));
-  return get_db_function(lookup_by_name_only);
+  return memoized(namememo, func_name, [&func_name](Connection & conn) {
+    auto lookup = conn.lookup_by_name_only;
+    conn.maybe_throw(sqlite3_reset(lookup));
+    conn.maybe_throw(sqlite3_bind_text(lookup, 1, func_name.c_str(), func_name.size(),
+                                       SQLITE_TRANSIENT));
+    return conn.get_db_function(lookup);
+  });
 }
 
 APIDefinitionList
 SQLLiteApiDictionary::Data::get_api_definition(
   const regex & func_name) const
 {
-  lock_guard lock{mutex};
-  std::int64_t idx;
-  {
-    write_guard<decltype(regex_mutex)> guard(regex_mutex);
-    idx = next_regex_index++;
-    regex_map[idx] = &func_name;
-  }
-  auto cleanup = make_finalizer([idx]() {
-    write_guard<decltype(regex_mutex)> guard(regex_mutex);
-    regex_map.erase(idx);
+  // Regular expressions can't be compared, so these lookups aren't memoized.
+  return timed([&func_name](Connection & conn) {
+    conn.pattern = &func_name;
+    auto cleanup = make_finalizer([&conn]() { conn.pattern = nullptr; });
+    auto lookup = conn.lookup_all_names;
+    conn.maybe_throw(sqlite3_reset(lookup));
+    // The pattern is found through the connection, so the parameter is unused.
+    conn.maybe_throw(sqlite3_bind_int64(lookup, 1, 0));
+    return conn.get_db_function(lookup);
+  });
+}
+
+APIDefinitionList
+SQLLiteApiDictionary::Data::get_all_definitions() const
+{
+  return timed([this](Connection & conn) {
+    // Functions with names are found by the name query, and functions with only ordinals by
+    // the ordinal query.  Most functions are found by both.
+    APIDefinitionList list;
+    std::set<std::tuple<std::string, std::string, size_t, std::string>> seen;
+    for (query_type_t qt : {NAME_TYPE, ORDINAL_TYPE}) {
+      sqlite3_stmt * lookup = nullptr;
+      conn.prepare(build_function_query(qt, "1"), lookup);
+      auto deleter = [](sqlite3_stmt *st) { sqlite3_finalize(st); };
+      std::unique_ptr<sqlite3_stmt, decltype(deleter)> lookup_guard(lookup, deleter);
+      for (auto & def : conn.get_db_function(lookup)) {
+        if (seen.emplace(def->dll_name, def->export_name, def->ordinal,
+                         def->dll_version).second)
+        {
+          list.push_back(def);
+        }
+      }
+    }
+    return list;
   });
-  maybe_throw(sqlite3_reset(lookup_all_names));
-  maybe_throw(sqlite3_bind_int64(lookup_all_names, 1, idx));
-  return get_db_function(lookup_all_names);
 }
 
 bool
 SQLLiteApiDictionary::Data::handles_dll(std::string const & dll_name_) const
 {
-  lock_guard lock{mutex};
   auto dll_name = normalize_dll(dll_name_) + ".dll";
-  maybe_throw(sqlite3_reset(lookup_dll_exists));
-  maybe_throw(sqlite3_bind_text(lookup_dll_exists, 1, dll_name.c_str(),
-                                dll_name.size(), SQLITE_TRANSIENT));
+  Lease conn{*this};
+  auto lookup = conn->lookup_dll_exists;
+  conn->maybe_throw(sqlite3_reset(lookup));
+  conn->maybe_throw(sqlite3_bind_text(lookup, 1, dll_name.c_str(),
+                                      dll_name.size(), SQLITE_TRANSIENT));
   int rv;
   while (true) {
-    rv = sqlite3_step(lookup_dll_exists);
+    rv = sqlite3_step(lookup);
     switch (rv) {
      case SQLITE_DONE:
       return false;
@@ -1361,11 +1590,36 @@ SQLLiteApiDictionary::Data::handles_dll(std::string const & dll_name_) const
      case SQLITE_ROW:
       return true;
      default:
-      throw_error();
+      conn->throw_error();
     }
   }
 }
 
+SQLLiteApiDictionary::Stats
+SQLLiteApiDictionary::Data::get_stats() const
+{
+  Stats stats;
+  stats.memo_hits = memo_hits;
+  stats.queries = queries;
+  stats.query_seconds = double(query_nanoseconds) / 1e9;
+  stats.max_query_seconds = double(max_query_nanoseconds) / 1e9;
+  stats.connections = connections;
+  stats.pool_lock_contention = pool_lock_contention;
+  return stats;
+}
+
+void SQLLiteApiDictionary::Data::report() const
+{
+  Stats stats = get_stats();
+  if (stats.queries + stats.memo_hits == 0) return;
+  MINFO << "API database " << filename << ": " << stats.memo_hits << " memoized lookups, "
+        << stats.queries << " queries (average "
+        << (stats.queries ? (1000.0 * stats.query_seconds / double(stats.queries)) : 0.0)
+        << " ms, maximum " << (1000.0 * stats.max_query_seconds) << " ms), "
+        << stats.connections << " connections, " << stats.pool_lock_contention
+        << " contended locks of the connection pool." << LEND;
+}
+
 SQLLiteApiDictionary::SQLLiteApiDictionary(const std::string & file) :
   data(new Data(*this, file)), path(file) {}
 SQLLiteApiDictionary::~SQLLiteApiDictionary() = default;
@@ -1406,6 +1660,18 @@ SQLLiteApiDictionary::get_api_definition(rose_addr_t) const
   return APIDefinitionList();
 }
 
+APIDefinitionList
+SQLLiteApiDictionary::get_all_definitions() const
+{
+  return data->get_all_definitions();
+}
+
+SQLLiteApiDictionary::Stats
+SQLLiteApiDictionary::get_stats() const
+{
+  return data->get_stats();
+}
+
 bool
 SQLLiteApiDictionary::handles_dll(std::string const & dll_name) const
 {
@@ -94,6 +94,12 @@ class APIDictionary {
   virtual APIDefinitionList
   get_api_definition(rose_addr_t addr) const = 0;
 
+  // Return every definition in the dictionary, for compiling API databases (see
+  // compiled_apidb.hpp).  Dictionaries that can't enumerate their definitions return nothing.
+  virtual APIDefinitionList get_all_definitions() const {
+    return APIDefinitionList();
+  }
+
   virtual ~APIDictionary() = default;
 
   virtual bool handles_dll(std::string const & dll_name) const = 0;
@@ -144,6 +150,10 @@ class PassThroughDictionary : public APIDictionary {
     return subdict().get_api_definition(addr);
   }
 
+  APIDefinitionList get_all_definitions() const override {
+    return subdict().get_all_definitions();
+  }
+
   bool handles_dll(std::string const & dll_name) const override {
     return subdict().handles_dll(dll_name);
   }
@@ -181,6 +191,8 @@ class MultiApiDictionary : public APIDictionary {
   APIDefinitionList
   get_api_definition(rose_addr_t addr) const override;
 
+  APIDefinitionList get_all_definitions() const override;
+
   void add(std::unique_ptr<APIDictionary> dict) {
     dicts.push_back(std::move(dict));
   }
@@ -222,6 +234,8 @@ class JSONApiDictionary : public APIDictionary {
   APIDefinitionList
   get_api_definition(rose_addr_t addr) const override;
 
+  APIDefinitionList get_all_definitions() const override;
+
   bool handles_dll(std::string const & dll_name) const override;
 
   std::string describe() const override;
@@ -243,6 +257,21 @@ class SQLLiteApiDictionary : public APIDictionary {
     using std::runtime_error::runtime_error;
   };
 
+  struct Stats {
+    // Lookups answered from the memo of earlier lookups.
+    uint64_t memo_hits = 0;
+    // Lookups that queried the database, and the total and longest time they took.
+    uint64_t queries = 0;
+    double query_seconds = 0.0;
+    double max_query_seconds = 0.0;
+    // Connections opened.  Each thread that queries the database while every other
+    // connection is in use opens a new connection rather than waiting for one.
+    uint64_t connections = 0;
+    // Times a thread found the lock on the pool held by another thread taking or returning a
+    // connection.  This measures contention for the lock, not a shortage of connections.
+    uint64_t pool_lock_contention = 0;
+  };
+
   SQLLiteApiDictionary(const std::string & sqlite_file);
   ~SQLLiteApiDictionary() override;
   SQLLiteApiDictionary(SQLLiteApiDictionary &&) noexcept;
@@ -271,10 +300,14 @@ class SQLLiteApiDictionary : public APIDictionary {
   APIDefinitionList
   get_api_definition(rose_addr_t addr) const override;
 
+  APIDefinitionList get_all_definitions() const override;
+
   bool handles_dll(std::string const & dll_name) const override;
 
   std::string describe() const override;
 
+  Stats get_stats() const;
+
  private:
   friend Sawyer::Message::Facility & APIDictionary::initDiagnostics();
   struct Data;
@@ -5,6 +5,7 @@
 // Version: 2.0
 
 #include <stdio.h>
+#include <numeric>
 #include <iostream>
 #include <fstream>
 #include <boost/graph/adjacency_list.hpp>
@@ -112,6 +113,28 @@ SgAsmX86Instruction* GetFirstBlkInsn(const SgAsmBlock *blk) {
   return isSgAsmX86Instruction(isSgAsmInstruction(ins_list[0]));
 }
 
+// ********************************************************************************************
+// * Start of ApiNameTable methods
+// ********************************************************************************************
+
+ApiNameId ApiNameTable::Intern(const std::string & name) {
+
+  auto result = ids_.emplace(name, ApiNameId(names_.size()));
+  if (result.second) {
+    names_.push_back(name);
+  }
+  return result.first->second;
+}
+
+boost::optional<ApiNameId> ApiNameTable::Find(const std::string & name) const {
+
+  auto found = ids_.find(name);
+  if (found == ids_.end()) {
+    return boost::none;
+  }
+  return found->second;
+}
+
 // ********************************************************************************************
 // * Start of ApiSearchState methods
 // ********************************************************************************************
@@ -657,6 +680,20 @@ void ApiSearchExecutor::AddDeadends(ApiWaypointDescriptor &next_to_last, ApiWayp
 }
 
 
+template <typename Graph>
+void ApiSearchExecutor::SearchSegment(const Graph & g, PredecessorMap & predecessors) {
+
+  boost::depth_first_visit(
+    g,
+    state_.start_point.vertex,
+    boost::make_dfs_visitor(
+      boost::make_list(
+        boost::record_predecessors(predecessors, boost::on_tree_edge()),
+        ApiTreeEdgeVisitor(this),
+        ApiBackEdgeVisitor(this))),
+    boost::make_iterator_property_map(colors_.begin(), boost::get(boost::vertex_index, g)));
+}
+
 // Run the depth-first for the current segment
 bool ApiSearchExecutor::RunSearch() {
 
@@ -693,23 +730,22 @@ bool ApiSearchExecutor::RunSearch() {
     throw AbortSearchException();
   }
 
-  std::vector<boost::default_color_type> colors(boost::num_vertices(*cfg));
+  // The buffers are reused from segment to segment, so that searching doesn't allocate.
+  colors_.assign(boost::num_vertices(*cfg), boost::white_color);
+  predecessors_.assign(boost::num_vertices(*cfg), ApiCfgVertex());
   IndexMap indexMap = boost::get(boost::vertex_index, *cfg);
-  std::vector<ApiCfgVertex> pv(boost::num_vertices(*cfg));
-  PredecessorMap predecessors(&pv[0], indexMap);
+  PredecessorMap predecessors(predecessors_.data(), indexMap);
 
   try {
 
-    boost::depth_first_visit(
-      *cfg,
-      state_.start_point.vertex,
-      boost::make_dfs_visitor(
-        boost::make_list(
-          boost::record_predecessors(predecessors, boost::on_tree_edge()),
-          ApiTreeEdgeVisitor(this),
-          ApiBackEdgeVisitor(this))),
-      boost::make_iterator_property_map(colors.begin(),
-                                        boost::get(boost::vertex_index, *cfg)));
+    // Search the frozen form of the component when it hasn't been modified by merging.
+    const ApiCsrPtr & csr = comp->GetFrozenCfg();
+    if (csr) {
+      SearchSegment(*csr, predecessors);
+    }
+    else {
+      SearchSegment(*cfg, predecessors);
+    }
   }
   catch (MergeAndRestartSearchException mrse) {
 
@@ -1058,7 +1094,8 @@ ApiSearchExecutor::DereferenceParameter(const ParameterDefinition &pd) {
   return apip;
 }
 
-bool ApiSearchExecutor::Search(ApiSig sig, ApiSearchResultVector *result_list ) {
+bool ApiSearchExecutor::Search(ApiSig sig, ApiSearchResultVector *result_list,
+                               const std::vector<rose_addr_t> *start_components) {
 
   GDEBUG << "Searching for signature: " << sig.name << LEND;
 
@@ -1071,12 +1108,22 @@ bool ApiSearchExecutor::Search(ApiSig sig, ApiSearchResultVector *result_list )
 
     // Create the initial worklist with the set of components to process
     WorkList worklist;
-    ApiCfgComponentMap components = graph_->GetComponents();
-    for (ApiCfgComponentMap::value_type & comp : components) {
-      worklist.push_back(comp.first);
+    const ApiCfgComponentMap & components = graph_->GetComponents();
+    if (start_components) {
+      for (rose_addr_t addr : *start_components) {
+        if (components.find(addr) != components.end()) {
+          worklist.push_back(addr);
+        }
+      }
+    }
+    else {
+      for (const ApiCfgComponentMap::value_type & comp : components) {
+        worklist.push_back(comp.first);
+      }
     }
 
     const ApiSigFunc& start_api = sig.api_calls.at(0);
+    boost::optional<ApiNameId> start_api_id = graph_->GetApiNames().Find(start_api.name);
 
     while (!worklist.empty()) {
 
@@ -1093,7 +1140,7 @@ bool ApiSearchExecutor::Search(ApiSig sig, ApiSearchResultVector *result_list )
       GDEBUG << "Working on function " << addr_str(start_comp_addr)
              << ". Looking for starting API function: " << start_api.name << LEND;
 
-      if (start_comp->ContainsApi(start_api.name)) {
+      if (start_api_id && start_comp->ContainsApi(*start_api_id)) {
         GDEBUG << "Found search start in function " << addr_str(start_comp_addr) << LEND;
 
         ApiCfgPtr cfg = start_comp->GetCfg();
@@ -1199,6 +1246,10 @@ bool ApiSearchExecutor::Search(ApiSig sig, ApiSearchResultVector *result_list )
 
       if (state_.progress >= 1 && false == state_.IsSearchComplete() && !aborted) {
 
+        // Merging replaces components, so fetch the current version of the start component.
+        start_comp = graph_->GetComponent(start_comp_addr);
+        assert(start_comp);
+
         GDEBUG << "Partial match on " << addr_str(start_comp->GetEntryAddr()) << LEND;
 
         // Find calls to comp
@@ -1288,7 +1339,7 @@ bool ApiSearchExecutor::Search(ApiSig sig, ApiSearchResultVector *result_list )
 }
 void ApiSearchExecutor::GetXrefsTo(ApiCfgComponentPtr comp, XrefMap &candidates) {
 
-  XrefMap xrefs = graph_->GetXrefs();
+  const XrefMap & xrefs = graph_->GetXrefs();
 
   //from address -> to address
   for (const XrefMapEntry & x : xrefs) {
@@ -1696,8 +1747,10 @@ void ApiCfgComponent::Initialize(const FunctionDescriptor &fd, AddrSet &api_call
         info.type = ApiVertexInfo::API;
 
         // add this to the set of API names in this component
-        if (apis_.find(info.api_name) == apis_.end()) {
-          apis_.insert(info.api_name);
+        ApiNameId api_id = names_->Intern(info.api_name);
+        auto api_pos = std::lower_bound(apis_.begin(), apis_.end(), api_id);
+        if (api_pos == apis_.end() || *api_pos != api_id) {
+          apis_.insert(api_pos, api_id);
         }
 
         // save the function descriptor for this import
@@ -1845,15 +1898,22 @@ ApiCfgComponent & ApiCfgComponent::operator=(const ApiCfgComponent & other) {
   entry_ = other.entry_;
   exit_ = other.exit_;
   cfg_ = CloneApiCfg(other.cfg_);
+  csr_.reset();
+  names_ = other.names_;
+  apis_ = other.apis_;
 
   return *this;
 }
 
 // Copy constructor creates a deep, distinct copy of the ApiCfgComponent
-ApiCfgComponent::ApiCfgComponent(const ApiCfgComponent &copy) : ds(copy.ds) {
+// The copy is not frozen, since it is usually copied in order to be modified.
+ApiCfgComponent::ApiCfgComponent(const ApiCfgComponent &copy) :
+  ds(copy.ds), names_(copy.names_)
+{
   entry_ = copy.entry_;
   exit_ = copy.exit_;
   cfg_ = CloneApiCfg(copy.cfg_);
+  apis_ = copy.apis_;
 }
 
 ApiCfgComponent::~ApiCfgComponent() {
@@ -1864,9 +1924,15 @@ ApiCfgComponent::~ApiCfgComponent() {
   exit_ = INVALID_ADDRESS;
 }
 
-bool ApiCfgComponent::ContainsApi(std::string api) const {
+bool ApiCfgComponent::ContainsApi(const std::string & api) const {
 
-  return apis_.find(api) != apis_.end();
+  boost::optional<ApiNameId> id = names_->Find(api);
+  return id && ContainsApi(*id);
+}
+
+bool ApiCfgComponent::ContainsApi(ApiNameId api) const {
+
+  return std::binary_search(apis_.begin(), apis_.end(), api);
 }
 
 // returns true if there are ANY api calls in this CFG
@@ -1904,6 +1970,7 @@ bool ApiCfgComponent::ContainsCalls() const {
 
 void ApiCfgComponent::DisconnectVertex(ApiCfgVertex &v) {
 
+  csr_.reset();
   rose_addr_t vaddr = (*cfg_)[v].block->get_address();
 
   GDEBUG << "Disconnecting vertex: " << addr_str(vaddr) << LEND;
@@ -1940,6 +2007,7 @@ void ApiCfgComponent::DisconnectVertex(ApiCfgVertex &v) {
 // remove every vertex that is not the entry, exit, of contains a function call
 void ApiCfgComponent::Simplify() {
 
+  csr_.reset();
   std::set<ApiCfgVertex> kill_list;
 
   BGL_FORALL_VERTICES(vtx, *cfg_, ApiCfg) {
@@ -1953,6 +2021,7 @@ void ApiCfgComponent::Simplify() {
 
 void ApiCfgComponent::RemoveVertices(const std::set<ApiCfgVertex> &kill_list) {
 
+  csr_.reset();
   struct IgnoreVertices {
     const std::set<ApiCfgVertex> *kset;
     IgnoreVertices() {}  // has to have a default constructor!
@@ -1973,6 +2042,7 @@ void ApiCfgComponent::RemoveVertices(const std::set<ApiCfgVertex> &kill_list) {
 
 void ApiCfgComponent::RemoveVertex(ApiCfgVertex target) {
 
+  csr_.reset();
   if (boost::in_degree(target, *cfg_)>0 || boost::out_degree(target, *cfg_)>0) {
     boost::clear_vertex(target, *cfg_);
   }
@@ -1994,6 +2064,7 @@ void ApiCfgComponent::RemoveVertex(ApiCfgVertex target) {
 // disconnect and delete a list of vertices
 void ApiCfgComponent::KillVertices(std::set<ApiCfgVertex> &kill_list) {
 
+  csr_.reset();
   if (kill_list.empty() == true) {
     return;
   }
@@ -2028,6 +2099,28 @@ ApiCfgPtr ApiCfgComponent::GetCfg() const {
 void ApiCfgComponent::SetCfg(ApiCfgPtr cfg) {
   assert(cfg);
   this->cfg_ = cfg;
+  csr_.reset();
+}
+
+void ApiCfgComponent::Freeze() {
+  assert(cfg_);
+
+  // The vertices are visited in order, and each vertex's out edges are visited in order of
+  // their targets, so the edges are already sorted the way the CSR graph needs them.
+  std::vector<std::pair<ApiCfgVertex, ApiCfgVertex>> edges;
+  edges.reserve(boost::num_edges(*cfg_));
+  BGL_FORALL_VERTICES(vtx, *cfg_, ApiCfg) {
+    BGL_FORALL_OUTEDGES(vtx, edge, *cfg_, ApiCfg) {
+      edges.emplace_back(vtx, boost::target(edge, *cfg_));
+    }
+  }
+
+  auto csr = std::make_shared<ApiCsr>(boost::edges_are_sorted, edges.begin(), edges.end(),
+                                      boost::num_vertices(*cfg_));
+  BGL_FORALL_VERTICES(vtx, *cfg_, ApiCfg) {
+    (*csr)[vtx] = (*cfg_)[vtx];
+  }
+  csr_ = std::move(csr);
 }
 
 rose_addr_t ApiCfgComponent::GetEntryAddr() const {
@@ -2081,6 +2174,8 @@ bool ApiCfgComponent::Merge(ApiCfgComponentPtr to_insert, rose_addr_t merge_addr
 
   ApiCfgVertex merge_vertex = GetVertexByAddr(merge_addr);
 
+  csr_.reset();
+
   // the call address should be unique in the CFG
   if (merge_vertex == NULL_VERTEX) {
 
@@ -2179,7 +2274,11 @@ bool ApiCfgComponent::Merge(ApiCfgComponentPtr to_insert, rose_addr_t merge_addr
   }
 
   // when merging two components, the APIs must also be merged
-  apis_.insert(to_insert->apis_.begin(), to_insert->apis_.end());
+  assert(names_ == to_insert->names_);
+  ApiNameIdSet merged_apis;
+  std::set_union(apis_.begin(), apis_.end(), to_insert->apis_.begin(), to_insert->apis_.end(),
+                 std::back_inserter(merged_apis));
+  apis_ = std::move(merged_apis);
 
   return true;
 }
@@ -2417,6 +2516,8 @@ void ApiGraph::Reset() {
   components_.clear();
   xrefs_.clear();
   api_calls_.clear();
+  api_names_ = std::make_shared<ApiNameTable>();
+  api_ids_.clear();
   graph_constructed_ = false;
 }
 
@@ -2679,11 +2780,15 @@ bool ApiGraph::MergeComponents(ApiMergeInfo &merge_info, bool preserve_entry) {
 
   if (src_cmp!=NULL && tgt_cmp!=NULL) {
 
-    merge_result = src_cmp->Merge(tgt_cmp, merge_info.from_addr, preserve_entry);
+    // The component may be shared with copies of this graph, so merge into a copy of it and
+    // replace it with the copy.
+    ApiCfgComponentPtr merged_cmp = std::make_shared<ApiCfgComponent>(*src_cmp);
+    merge_result = merged_cmp->Merge(tgt_cmp, merge_info.from_addr, preserve_entry);
     if (merge_result == true) {
 
       // re-simplify the merged graph to remove extraneous nodes
-      src_cmp->Simplify();
+      merged_cmp->Simplify();
+      components_[merge_info.src_cmp_addr] = merged_cmp;
 
       // remove the xref for this specific merge because it no longer exists
       RemoveXref(merge_info.from_addr, merge_info.to_addr);
@@ -2713,7 +2818,7 @@ size_t ApiGraph::Build() {
   const FunctionDescriptorMap& fdmap = ds.get_func_map();
   for (const FunctionDescriptor& fd : boost::adaptors::values(fdmap)) {
     // At this point the true exit is not known
-    ApiCfgComponentPtr cfg_comp = std::make_shared<ApiCfgComponent>(ds);
+    ApiCfgComponentPtr cfg_comp = std::make_shared<ApiCfgComponent>(ds, api_names_);
 
     cfg_comp->Initialize(fd, api_calls_, xrefs_);
 
@@ -2729,6 +2834,16 @@ size_t ApiGraph::Build() {
 
   ConsolidateEmptyFunctions();
 
+  // The components won't change again until they are merged during a search, so freeze them
+  // for searching.
+  for (const ApiCfgComponentMap::value_type & ci : components_) {
+    ci.second->Freeze();
+    const ApiNameIdSet & apis = ci.second->GetApis();
+    api_ids_.insert(api_ids_.end(), apis.begin(), apis.end());
+  }
+  std::sort(api_ids_.begin(), api_ids_.end());
+  api_ids_.erase(std::unique(api_ids_.begin(), api_ids_.end()), api_ids_.end());
+
   graph_constructed_ = true;
 
   return components_.size();
@@ -2768,7 +2883,8 @@ void ApiGraph::GenerateGraphViz(std::ostream & o) {
 }
 
 // The current search algorithm starts by using the connected_components function to determine
-bool ApiGraph::Search(ApiSig sig, ApiSearchResultVector * results) {
+bool ApiGraph::Search(ApiSig sig, ApiSearchResultVector * results,
+                      const std::vector<rose_addr_t> *start_components) {
 
   if (graph_constructed_ == false || sig.api_calls.empty() == true) {
     GWARN << "Invalid signature for " << sig.name << LEND;
@@ -2778,7 +2894,7 @@ bool ApiGraph::Search(ApiSig sig, ApiSearchResultVector * results) {
   // Initialize the Search Executor with the necessary elements needed for a search
   search_executor_.Initialize(this);
 
-  return search_executor_.Search(sig, results);
+  return search_executor_.Search(sig, results, start_components);
 
 }
 
@@ -2796,6 +2912,109 @@ void ApiGraph::Print() {
   }
 }
 
+bool ApiGraph::CallsApi(const std::string & api_name) const {
+
+  boost::optional<ApiNameId> id = api_names_->Find(api_name);
+  return id && std::binary_search(api_ids_.begin(), api_ids_.end(), *id);
+}
+
+std::vector<ApiCallCluster> ApiGraph::GetCallClusters() const {
+
+  // Number the components in address order
+  std::map<rose_addr_t, size_t> index;
+  std::vector<rose_addr_t> addrs;
+  std::vector<const ApiCfgComponent *> comps;
+  for (const ApiCfgComponentMap::value_type & ci : components_) {
+    index.emplace(ci.first, comps.size());
+    addrs.push_back(ci.first);
+    comps.push_back(ci.second.get());
+  }
+
+  // Union-find over the component numbers
+  std::vector<size_t> parent(comps.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  auto find = [&parent](size_t i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  };
+  auto join = [&parent, &find](size_t a, size_t b) {
+    a = find(a);
+    b = find(b);
+    if (a != b) {
+      parent[std::max(a, b)] = std::min(a, b);
+    }
+  };
+
+  // Join each component with the components that it calls, and record which components
+  // contain each instruction, so that the callers in the xrefs can be found.
+  std::vector<std::pair<rose_addr_t, size_t>> insns;
+  for (size_t i = 0; i < comps.size(); ++i) {
+    const ApiCfg & cfg = *comps[i]->GetCfg();
+    BGL_FORALL_VERTICES(vtx, cfg, ApiCfg) {
+      const ApiVertexInfo & info = cfg[vtx];
+      if (info.target_address != INVALID_ADDRESS) {
+        auto target = index.find(info.target_address);
+        if (target != index.end()) {
+          join(i, target->second);
+        }
+      }
+      if (info.block) {
+        for (SgAsmStatement * stmt : info.block->get_statementList()) {
+          const SgAsmX86Instruction *insn = isSgAsmX86Instruction(stmt);
+          if (insn) {
+            insns.emplace_back(insn->get_address(), i);
+          }
+        }
+      }
+    }
+  }
+  std::sort(insns.begin(), insns.end());
+
+  // Join each component with its callers.  A caller is any component that contains the call,
+  // or whose entry is the call address (see GetContainingComponent()).
+  for (const XrefMapEntry & x : xrefs_) {
+    auto callee = index.find(x.second);
+    if (callee == index.end()) {
+      continue;
+    }
+    auto caller = index.find(x.first);
+    if (caller != index.end()) {
+      join(caller->second, callee->second);
+    }
+    auto range = std::equal_range(
+      insns.begin(), insns.end(), std::make_pair(x.first, size_t(0)),
+      [](const std::pair<rose_addr_t, size_t> & a, const std::pair<rose_addr_t, size_t> & b) {
+        return a.first < b.first;
+      });
+    for (auto i = range.first; i != range.second; ++i) {
+      join(i->second, callee->second);
+    }
+  }
+
+  // Gather the clusters, in order of their lowest component address
+  std::vector<ApiCallCluster> clusters;
+  std::map<size_t, size_t> cluster_of;
+  for (size_t i = 0; i < comps.size(); ++i) {
+    auto result = cluster_of.emplace(find(i), clusters.size());
+    if (result.second) {
+      clusters.emplace_back();
+    }
+    ApiCallCluster & cluster = clusters[result.first->second];
+    cluster.components.push_back(addrs[i]);
+    const ApiNameIdSet & apis = comps[i]->GetApis();
+    cluster.apis.insert(cluster.apis.end(), apis.begin(), apis.end());
+  }
+  for (ApiCallCluster & cluster : clusters) {
+    std::sort(cluster.apis.begin(), cluster.apis.end());
+    cluster.apis.erase(std::unique(cluster.apis.begin(), cluster.apis.end()),
+                       cluster.apis.end());
+  }
+  return clusters;
+}
+
 ApiCfgComponentPtr ApiGraph::GetContainingComponent(const rose_addr_t addr) const {
 
   for (const ApiCfgComponentMap::value_type & ci : components_) {
@@ -2823,6 +3042,53 @@ void ApiGraph::RemoveXref(rose_addr_t from, rose_addr_t to) {
   }
 }
 
+// ********************************************************************************************
+// * Start of ApiSigPrefilter methods
+// ********************************************************************************************
+
+ApiSigPrefilter::ApiSigPrefilter(const ApiSigVector &sigs, const ApiNameTable &names)
+  : nodes_(1)
+{
+  std::vector<ApiNameId> ids;
+  for (size_t s = 0; s < sigs.size(); ++s) {
+    const ApiSig &sig = sigs[s];
+    if (sig.api_calls.empty()) {
+      continue;
+    }
+
+    ids.clear();
+    for (const ApiSigFunc &api : sig.api_calls) {
+      boost::optional<ApiNameId> id = names.Find(boost::to_upper_copy(api.name));
+      if (!id) {
+        break;
+      }
+      ids.push_back(*id);
+    }
+    if (ids.size() != sig.api_calls.size()) {
+      GDEBUG << "Signature " << sig.name << " calls APIs that are never called" << LEND;
+      continue;
+    }
+
+    uint32_t node = 0;
+    for (ApiNameId id : ids) {
+      std::vector<std::pair<ApiNameId, uint32_t>> &children = nodes_[node].children;
+      auto child = std::lower_bound(children.begin(), children.end(),
+                                    std::make_pair(id, uint32_t(0)));
+      if (child != children.end() && child->first == id) {
+        node = child->second;
+      }
+      else {
+        uint32_t next = uint32_t(nodes_.size());
+        children.emplace(child, id, next);
+        // This invalidates children
+        nodes_.emplace_back();
+        node = next;
+      }
+    }
+    nodes_[node].accepts.push_back(s);
+  }
+}
+
 // ********************************************************************************************
 // * Start of ApiSearchManager methods
 // ********************************************************************************************
@@ -2850,18 +3116,73 @@ std::ostream& operator<<(std::ostream &o, const ApiSearchProgressSuffix &suffix)
 
 bool ApiSearchManager::Search(const ApiSigVector &sigs, ApiSearchResultVector &results) {
 
-  sig_count_ = sigs.size();
+  // Find the clusters that each signature could match in.
+  ApiSigPrefilter prefilter(sigs, graph_.GetApiNames());
+  std::vector<ApiCallCluster> clusters = graph_.GetCallClusters();
+  std::vector<std::vector<size_t>> sig_clusters(sigs.size());
+  for (size_t c = 0; c < clusters.size(); ++c) {
+    prefilter.Match(clusters[c].apis, [&sig_clusters, c](size_t sig) {
+      sig_clusters[sig].push_back(c);
+    });
+  }
+
+  // Skip the signatures that can't match in any cluster, and search for the others starting
+  // only from the components in the clusters that they can match in.  Empty signatures are
+  // still searched so that they are reported as invalid.
+  struct SigSearch {
+    const ApiSig * sig;
+    std::vector<rose_addr_t> start_components;
+  };
+  std::vector<SigSearch> searched;
+  for (size_t s = 0; s < sigs.size(); ++s) {
+    if (sigs[s].api_calls.empty()) {
+      searched.push_back(SigSearch{&sigs[s], {}});
+    }
+    else if (!sig_clusters[s].empty()) {
+      SigSearch search{&sigs[s], {}};
+      for (size_t c : sig_clusters[s]) {
+        const std::vector<rose_addr_t> & comps = clusters[c].components;
+        search.start_components.insert(search.start_components.end(),
+                                       comps.begin(), comps.end());
+      }
+      std::sort(search.start_components.begin(), search.start_components.end());
+      searched.push_back(std::move(search));
+    }
+  }
+  GDEBUG << "Searching for " << searched.size() << " of " << sigs.size() << " signatures in "
+         << clusters.size() << " call clusters, using " << prefilter.GetNodeCount()
+         << " prefilter nodes" << LEND;
+
+  sig_count_ = searched.size();
   sig_progress_ = 0;
 
-  for (const ApiSig & sig : sigs) {
-    GDEBUG << "Processing signature: " << sig.name << LEND;
+  // Each signature is searched in its own copy of the graph, with its own executor, and its
+  // results are stored in its own slot so that they can be reported in signature order.
+  std::vector<ApiSearchResultVector> sig_results(searched.size());
+  std::vector<size_t> indexes(searched.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+  parallel_for_each(
+    indexes, graph_.GetDescriptorSet().get_concurrency_level(),
+    [this, &searched, &sig_results](size_t i) {
+      const ApiSig & sig = *searched[i].sig;
+      GDEBUG << "Processing signature: " << sig.name << LEND;
+
+      {
+        write_guard<decltype(progress_mutex_)> guard{progress_mutex_};
+        UpdateProgress(sig);
+      }
 
-    UpdateProgress(sig);
+      ApiGraph graph(graph_);
+      if (sig.api_calls.empty()) {
+        graph.Search(sig, &sig_results[i]);
+      }
+      else {
+        graph.Search(sig, &sig_results[i], &searched[i].start_components);
+      }
+    });
 
-    ApiSearchResultVector search_result;
-    if (graph_.Search(sig, &search_result) == true) {
-      results.insert(results.end(), search_result.begin(), search_result.end());
-    }
+  for (ApiSearchResultVector & search_result : sig_results) {
+    results.transfer(results.end(), search_result);
   }
   return true;
 }
@@ -10,16 +10,21 @@
 #include "rose.hpp"
 #include <Rose/BinaryAnalysis/ControlFlow.h>
 
+#include <unordered_map>
+
 #include <Sawyer/Message.h>
 #include <Sawyer/ProgressBar.h>
 
 #include <boost/graph/depth_first_search.hpp>
 #include <boost/property_map/property_map.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <boost/optional.hpp>
 
 #include "descriptors.hpp"
 #include "apisig.hpp"
 #include "json.hpp"
+#include "threads.hpp"
 
 namespace pharos {
 
@@ -86,6 +91,40 @@ using ApiCfgEdge = boost::graph_traits<ApiCfg>::edge_descriptor;
 using ApiCfgEdgeIter = boost::graph_traits<ApiCfg>::edge_iterator;
 using ApiCfgVertexVector = std::vector<ApiCfgVertex>;
 
+// The frozen form of an ApiCfg, in compressed sparse row form.  The vertices are numbered and
+// ordered exactly as they are in the ApiCfg that it was made from, and each vertex's out edges
+// are in the same order, so vertex descriptors can be used interchangeably between the two
+// forms, and a depth first search visits the vertices in the same order in either form.
+using ApiCsr = boost::compressed_sparse_row_graph<boost::directedS, ApiVertexInfo>;
+using ApiCsrPtr = std::shared_ptr<const ApiCsr>;
+
+// API names are interned so that components can record the APIs that they call as small
+// integers.  A table is filled in while an ApiGraph is built, and is read-only afterwards, so
+// it can be shared by every copy of the graph.
+using ApiNameId = uint32_t;
+
+class ApiNameTable {
+ public:
+  // Return the ID for name, adding it to the table if needed.
+  ApiNameId Intern(const std::string & name);
+
+  // Return the ID for name, if it is in the table.
+  boost::optional<ApiNameId> Find(const std::string & name) const;
+
+  const std::string & GetName(ApiNameId id) const { return names_.at(id); }
+
+  size_t size() const { return names_.size(); }
+
+ private:
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, ApiNameId> ids_;
+};
+
+using ApiNameTablePtr = std::shared_ptr<ApiNameTable>;
+
+// A set of API names, as a sorted vector of IDs.
+using ApiNameIdSet = std::vector<ApiNameId>;
+
 
 // XREF typedefs
 // call site (from) -> call target (to)
@@ -605,6 +644,11 @@ class ApiSearchExecutor {
 
   void UpdateSearchTree(PredecessorMap predecessorMap);
 
+  // Run the depth first search for the current segment over g, which is either the ApiCfg of
+  // the component or its frozen form.
+  template <typename Graph>
+  void SearchSegment(const Graph & g, PredecessorMap & predecessors);
+
   void FindSearchStart(ApiSigFunc &start_api,
                        ApiCfgComponentPtr comp,
                        ApiCfgVertexVector &starts);
@@ -636,13 +680,20 @@ class ApiSearchExecutor {
 
   ApiGraph *graph_;
 
+  // Buffers for the depth first search, which are reused from segment to segment
+  std::vector<boost::default_color_type> colors_;
+  std::vector<ApiCfgVertex> predecessors_;
+
  public:
 
   ApiSearchExecutor(const DescriptorSet& ds_) : ds(ds_), graph_(NULL) { }
 
   void Initialize(ApiGraph *g);
 
-  bool Search(ApiSig sig, ApiSearchResultVector *result_list);
+  // Search for the signature.  If start_components is not null, only the components at those
+  // addresses (in ascending order) are used as starting points for the search.
+  bool Search(ApiSig sig, ApiSearchResultVector *result_list,
+              const std::vector<rose_addr_t> *start_components = nullptr);
 
   bool CheckConnected (const ApiWaypointDescriptor &src, const ApiWaypointDescriptor &dst);
 
@@ -691,13 +742,21 @@ class ApiCfgComponent {
 
   ApiCfgPtr cfg_;
 
+  // The frozen form of cfg_, if the component has been frozen and not modified since
+  ApiCsrPtr csr_;
+
+  // The table of API names, shared with the rest of the graph
+  ApiNameTablePtr names_;
+
   // the set of API calls in this component
-  std::set<std::string> apis_;
+  ApiNameIdSet apis_;
 
  public:
 
-  ApiCfgComponent(const DescriptorSet& ds_) :
-    ds(ds_), entry_(INVALID_ADDRESS), exit_(INVALID_ADDRESS), cfg_(nullptr) { }
+  ApiCfgComponent(const DescriptorSet& ds_,
+                  ApiNameTablePtr names = std::make_shared<ApiNameTable>()) :
+    ds(ds_), entry_(INVALID_ADDRESS), exit_(INVALID_ADDRESS), cfg_(nullptr),
+    names_(std::move(names)) { }
 
   ApiCfgComponent(const ApiCfgComponent &src);
 
@@ -713,7 +772,12 @@ class ApiCfgComponent {
 
   bool ContainsApiCalls() const;
 
-  bool ContainsApi(std::string api_call) const;
+  bool ContainsApi(const std::string & api_call) const;
+
+  bool ContainsApi(ApiNameId api_call) const;
+
+  // The API calls in this component
+  const ApiNameIdSet & GetApis() const { return apis_; }
 
   bool ContainsCalls() const;
 
@@ -748,6 +812,14 @@ class ApiCfgComponent {
 
   ApiCfgPtr GetCfg() const;
 
+  // Build the frozen form of the CFG.  The frozen form is discarded when the component is
+  // modified through its own methods, but not when the CFG returned by GetCfg() is modified
+  // directly, so components should only be frozen once they are complete.
+  void Freeze();
+
+  // The frozen form of the CFG, or null if the component isn't frozen.
+  const ApiCsrPtr & GetFrozenCfg() const { return csr_; }
+
   size_t GetSize() const;
 
   void SetCfg(ApiCfgPtr cfg);
@@ -791,6 +863,67 @@ struct ApiSearchProgressSuffix {
   }
 };
 
+// A set of components that are connected to each other by calls, along with every API that
+// they call.  Searches only merge a component with the components that it calls or that call
+// it, so a search never leaves the cluster that it started in, and a signature can only match
+// in a cluster that calls every API in the signature.
+struct ApiCallCluster {
+  // The entry addresses of the components, in ascending order
+  std::vector<rose_addr_t> components;
+  ApiNameIdSet apis;
+};
+
+// A prefilter that finds the signatures that could possibly match in a cluster, so that the
+// search for each signature can skip the clusters where it can't.  It only tests whether a
+// cluster calls every API in a signature; it doesn't match the signatures itself.  The order
+// of the calls, the parameter and return value constraints, and the merging of components are
+// all checked by ApiSearchExecutor, which still searches separately for each signature that
+// survives the prefilter.  The signatures are compiled into one trie over the APIs that they
+// call, so that signatures with common prefixes share nodes, and testing a cluster visits only
+// the part of the trie whose APIs the cluster calls rather than every signature.
+class ApiSigPrefilter {
+ public:
+
+  // Signatures that call APIs that aren't in the name table can never match, and are left
+  // out.
+  ApiSigPrefilter(const ApiSigVector &sigs, const ApiNameTable &names);
+
+  // Call fn(index) with the index of every signature whose APIs are all in apis.
+  template <typename Fn>
+  void Match(const ApiNameIdSet &apis, Fn fn) const;
+
+  size_t GetNodeCount() const { return nodes_.size(); }
+
+ private:
+
+  struct Node {
+    // The next API in the sequence, and the node for it, sorted by API
+    std::vector<std::pair<ApiNameId, uint32_t>> children;
+    // The signatures that end at this node
+    std::vector<size_t> accepts;
+  };
+
+  std::vector<Node> nodes_;
+};
+
+template <typename Fn>
+void ApiSigPrefilter::Match(const ApiNameIdSet &apis, Fn fn) const {
+
+  std::vector<uint32_t> stack(1, 0);
+  while (!stack.empty()) {
+    const Node &node = nodes_[stack.back()];
+    stack.pop_back();
+    for (size_t sig : node.accepts) {
+      fn(sig);
+    }
+    for (const std::pair<ApiNameId, uint32_t> &child : node.children) {
+      if (std::binary_search(apis.begin(), apis.end(), child.first)) {
+        stack.push_back(child.second);
+      }
+    }
+  }
+}
+
 // This is the main graph on which all searches are conducted.
 
 class ApiGraph {
@@ -805,6 +938,13 @@ class ApiGraph {
   // A set of API call addresses
   AddrSet api_calls_;
 
+  // The names of the APIs called in the graph, shared by every copy of the graph
+  ApiNameTablePtr api_names_;
+
+  // The APIs called in all of the components.  Merging components never adds an API that
+  // isn't already in some component, so this doesn't change during searches.
+  ApiNameIdSet api_ids_;
+
   // the independent graph components for this program.
   ApiCfgComponentMap components_;
 
@@ -823,19 +963,24 @@ class ApiGraph {
  public:
 
   // This is the public interface for the ApiGraph. The graph is self-searching meaning that
-  // given a signature, the graph knows how to conduct a search
+  // given a signature, the graph knows how to conduct a search.  Searching merges components,
+  // but merging replaces a component rather than modifying it, so a copy of the graph can be
+  // searched without changing the graph that it was copied from, and copies can be searched
+  // concurrently.
 
-  ApiGraph(const DescriptorSet& _ds) : ds(_ds), search_executor_(_ds), graph_constructed_(false) { }
+  ApiGraph(const DescriptorSet& _ds) :
+    ds(_ds), api_names_(std::make_shared<ApiNameTable>()), search_executor_(_ds),
+    graph_constructed_(false) { }
 
   ~ApiGraph();
 
   ApiCfgComponentPtr GetComponent(rose_addr_t addr);
 
-  ApiCfgComponentMap GetComponents() const { return components_; }
+  const ApiCfgComponentMap & GetComponents() const { return components_; }
 
   ApiCfgComponentPtr GetContainingComponent(const rose_addr_t addr) const;
 
-  XrefMap GetXrefs() const { return xrefs_; }
+  const XrefMap & GetXrefs() const { return xrefs_; }
 
   void RemoveXref(rose_addr_t from, rose_addr_t to);
 
@@ -843,7 +988,14 @@ class ApiGraph {
 
   bool MergeComponents(ApiMergeInfo &merge_info, bool preserve_entry);
 
-  AddrSet GetApiCalls() const { return api_calls_; }
+  const AddrSet & GetApiCalls() const { return api_calls_; }
+
+  const ApiNameTable & GetApiNames() const { return *api_names_; }
+
+  // Is the API called anywhere in the graph?
+  bool CallsApi(const std::string & api_name) const;
+
+  const DescriptorSet & GetDescriptorSet() const { return ds; }
 
   size_t Build();
 
@@ -852,26 +1004,37 @@ class ApiGraph {
   // Generate a graphviz file (.dot) for a constructed graph
   void GenerateGraphViz(std::ostream &o);
 
-  bool Search(ApiSig sig, ApiSearchResultVector *results);
+  bool Search(ApiSig sig, ApiSearchResultVector *results,
+              const std::vector<rose_addr_t> *start_components = nullptr);
+
+  // Divide the components into clusters that are connected by calls.
+  std::vector<ApiCallCluster> GetCallClusters() const;
 
   void Print();
 
   void UpdateProgress(const ApiSig& sig);
 };
 
+// Searches a graph for many signatures.  The call clusters of the graph are first tested with
+// an ApiSigPrefilter, and each signature is only searched for in the clusters that call all of
+// its APIs.  The signatures are searched concurrently, each in
+// its own copy of the graph, so the results for a signature don't depend on which signatures
+// were searched before it.  The results are reported in signature order.
 class ApiSearchManager {
 
  private:
 
-  ApiGraph graph_;
+  const ApiGraph & graph_;
 
   size_t sig_count_, sig_progress_;
 
+  std_mutex progress_mutex_;
+
   void UpdateProgress(const ApiSig& sig);
 
  public:
 
-  ApiSearchManager(ApiGraph &g) : graph_(g), sig_count_(0), sig_progress_(0) { }
+  ApiSearchManager(const ApiGraph &g) : graph_(g), sig_count_(0), sig_progress_(0) { }
 
   bool Search(const ApiSigVector &sigs, ApiSearchResultVector &results);
 
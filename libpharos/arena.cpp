@@ -0,0 +1,82 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <algorithm>
+#include <new>
+
+#include "arena.hpp"
+
+namespace pharos {
+
+constexpr size_t Arena::alignment;
+constexpr size_t Arena::max_pooled_size;
+
+Arena::Arena(size_t block_size_)
+  : block_size(std::max(block_size_, max_pooled_size)),
+    free_lists(size_class(max_pooled_size) + 1, nullptr)
+{}
+
+Arena::~Arena()
+{
+  for (char * block : blocks) {
+    ::operator delete(block);
+  }
+}
+
+void * Arena::allocate(size_t bytes)
+{
+  ++stats.allocations;
+  if (bytes > max_pooled_size) {
+    ++stats.large;
+    stats.live_bytes += bytes;
+    stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+    return ::operator new(bytes);
+  }
+
+  size_t sc = size_class(bytes);
+  size_t rounded = sc * alignment;
+  stats.live_bytes += rounded;
+  stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+
+  // Reuse a freed block of the same size if there is one.  The first word of a freed block
+  // links to the next freed block of the same size.
+  void * p = free_lists[sc];
+  if (p) {
+    ++stats.reused;
+    free_lists[sc] = *static_cast<void **>(p);
+    return p;
+  }
+
+  if (size_t(end - next) < rounded) {
+    // The remainder of the current block is abandoned.  It is at most max_pooled_size bytes.
+    next = static_cast<char *>(::operator new(block_size));
+    end = next + block_size;
+    blocks.push_back(next);
+    stats.reserved_bytes += block_size;
+  }
+  p = next;
+  next += rounded;
+  return p;
+}
+
+void Arena::deallocate(void * p, size_t bytes)
+{
+  if (p == nullptr) return;
+  if (bytes > max_pooled_size) {
+    stats.live_bytes -= bytes;
+    ::operator delete(p);
+    return;
+  }
+
+  size_t sc = size_class(bytes);
+  stats.live_bytes -= sc * alignment;
+  *static_cast<void **>(p) = free_lists[sc];
+  free_lists[sc] = p;
+}
+
+} // namespace pharos
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
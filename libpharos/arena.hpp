@@ -0,0 +1,127 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#ifndef Pharos_Arena_H
+#define Pharos_Arena_H
+
+// This header provides a simple region allocator for data structures that are built up in
+// many small pieces during the analysis of a single function, and that all die together.  The
+// def-use analysis allocates its abstract access records from an arena owned by the
+// DUAnalysis, so that the many small vectors it creates and discards during the fixpoint
+// iterations are recycled within the function, and so that the memory for all of them is
+// released in a few large blocks when the DUAnalysis is destroyed.
+//
+// Arenas are not thread safe.  Each arena should only be used by the thread analyzing its
+// function.
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace pharos {
+
+// Counters describing the use of an arena.
+struct ArenaStats {
+  // The number of allocations requested from the arena.
+  size_t allocations = 0;
+  // The number of allocations satisfied by recycling a previously freed block.
+  size_t reused = 0;
+  // The number of allocations that were too large for the arena, and went to the heap.
+  size_t large = 0;
+  // The bytes currently allocated, and the most bytes allocated at any one time.
+  size_t live_bytes = 0;
+  size_t peak_bytes = 0;
+  // The bytes obtained from the heap in blocks for the arena.
+  size_t reserved_bytes = 0;
+};
+
+class Arena {
+ public:
+  // The alignment of every allocation.
+  static constexpr size_t alignment = alignof(std::max_align_t);
+  // Allocations larger than this are passed through to the heap.
+  static constexpr size_t max_pooled_size = 4096;
+
+  explicit Arena(size_t block_size = 64 * 1024);
+  Arena(const Arena &) = delete;
+  Arena & operator=(const Arena &) = delete;
+  ~Arena();
+
+  void * allocate(size_t bytes);
+  // Return memory to the arena, where it will be reused for allocations of the same size.
+  void deallocate(void * p, size_t bytes);
+
+  const ArenaStats & get_stats() const { return stats; }
+
+ private:
+  size_t block_size;
+  std::vector<char *> blocks;
+  char * next = nullptr;
+  char * end = nullptr;
+  // Freed blocks, indexed by size class.
+  std::vector<void *> free_lists;
+  ArenaStats stats;
+
+  static size_t size_class(size_t bytes) {
+    return bytes ? (bytes + alignment - 1) / alignment : 1;
+  }
+};
+
+// A standard allocator for arena allocated containers.  A default constructed allocator
+// allocates from the heap.  Copying a container (unlike moving it) allocates the copy from the
+// heap, so copies can safely outlive the arena.
+template <typename T>
+class ArenaAllocator {
+  static_assert(alignof(T) <= Arena::alignment, "Type is over-aligned for an arena");
+
+  template <typename U> friend class ArenaAllocator;
+
+  Arena * arena = nullptr;
+
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() = default;
+  ArenaAllocator(Arena * a) : arena(a) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> & other) : arena(other.arena) {}
+
+  T * allocate(size_t n) {
+    if (arena) {
+      return static_cast<T *>(arena->allocate(n * sizeof(T)));
+    }
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T * p, size_t n) {
+    if (arena) {
+      arena->deallocate(p, n * sizeof(T));
+    }
+    else {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  Arena * get_arena() const { return arena; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U> & other) const { return arena == other.arena; }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U> & other) const { return arena != other.arena; }
+};
+
+} // namespace pharos
+
+#endif // Pharos_Arena_H
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
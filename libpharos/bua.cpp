@@ -2,16 +2,22 @@
 
 #include "bua.hpp"
 #include "descriptors.hpp"
+#include "intern.hpp"
 #include "options.hpp"
+#include "pdg.hpp"
 
 #include <Sawyer/ProgressBar.h>
-#include <Sawyer/ThreadWorkers.h>
 #include <Sawyer/GraphTraversal.h>
 #include <Sawyer/GraphAlgorithm.h>
 #include <Sawyer/GraphIteratorSet.h>
 #include <boost/range/adaptor/map.hpp>
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <queue>
+#include <thread>
 
 #define PHAROS_BUA_TESTING 0
 
@@ -35,17 +41,279 @@ std::ostream& operator<<(std::ostream &o, const ProgressSuffix &suffix) {
   return o;
 }
 
+// A dependency-aware, work-stealing scheduler for the function dependency graph.  A function
+// becomes ready as soon as every function that it depends on (its callees) has been processed.
+// Each worker has its own queue of ready functions, and the functions made ready by a worker
+// are added to that worker's queue, since they're the callers of the function it just
+// finished.  A worker with an empty queue steals from the other workers.
+//
+// Within a queue, functions are ordered by the length of the longest chain of callers above
+// them in the graph, so that the functions on the critical path are started first.  Ties are
+// broken by vertex id (which is address order), so for a given graph the priorities are
+// deterministic.  The FDG constructor has already broken the cycles (in the same vertex
+// order), so every vertex eventually becomes ready.
+class FDGScheduler {
+ public:
+  using Graph = FDG::Graph;
+
+  struct ThreadStats {
+    size_t processed = 0;
+    size_t stolen = 0;
+    double busy = 0.0;
+  };
+
+  FDGScheduler(Graph const & g, size_t nthreads);
+
+  // Call func(worker, vertex value) for every vertex in the graph.  Exceptions thrown by func
+  // stop the scheduling of more work, and the first one is rethrown once the workers are done.
+  template <typename Func>
+  void run(Func func);
+
+  // Report the per-thread utilization of the last call to run().
+  void report(Sawyer::Message::Facility & mlog, std::string const & title) const;
+
+ private:
+  struct Ready {
+    size_t priority;
+    size_t id;
+    bool operator<(Ready const & other) const {
+      if (priority != other.priority) return priority < other.priority;
+      return id > other.id;
+    }
+  };
+
+  struct Worker {
+    std_mutex mutex;
+    std::priority_queue<Ready> queue;
+    ThreadStats stats;
+  };
+
+  Graph const & graph;
+  // The length of the longest chain of callers of each vertex.
+  std::vector<size_t> priority;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::unique_ptr<std::atomic<size_t>[]> pending;
+
+  // Functions that are queued but not yet being processed, and functions that have not yet
+  // been processed.  Idle workers sleep on the condition variable until there is work.
+  std::atomic<size_t> available{0};
+  std::atomic<size_t> remaining{0};
+  std::atomic<bool> failed{false};
+  std_mutex idle_mutex;
+  std::condition_variable_any idle_cond;
+  std::exception_ptr error;
+
+  double elapsed = 0.0;
+
+  void push(size_t worker, size_t id);
+  bool pop(size_t worker, size_t & id);
+  bool wait_for_work();
+};
+
+FDGScheduler::FDGScheduler(Graph const & g, size_t nthreads)
+  : graph(g), priority(g.nVertices(), 0), pending(new std::atomic<size_t>[g.nVertices()])
+{
+  for (size_t i = 0; i < std::max(nthreads, size_t(1)); ++i) {
+    workers.push_back(make_unique<Worker>());
+  }
+
+  // Order the vertices bottom-up (callees before callers).
+  size_t nverts = graph.nVertices();
+  std::vector<size_t> outstanding(nverts);
+  std::vector<size_t> order;
+  order.reserve(nverts);
+  for (auto & v : graph.vertices()) {
+    outstanding[v.id()] = v.nOutEdges();
+    if (v.nOutEdges() == 0) {
+      order.push_back(v.id());
+    }
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    for (auto & e : graph.findVertex(order[i])->inEdges()) {
+      if (--outstanding[e.source()->id()] == 0) {
+        order.push_back(e.source()->id());
+      }
+    }
+  }
+  assert(order.size() == nverts);
+
+  // Then compute the priorities top-down.
+  for (auto i = order.rbegin(); i != order.rend(); ++i) {
+    for (auto & e : graph.findVertex(*i)->inEdges()) {
+      priority[*i] = std::max(priority[*i], priority[e.source()->id()] + 1);
+    }
+  }
+}
+
+void FDGScheduler::push(size_t worker, size_t id) {
+  {
+    Worker & w = *workers[worker];
+    write_guard<decltype(w.mutex)> guard{w.mutex};
+    w.queue.push(Ready{priority[id], id});
+  }
+  {
+    write_guard<decltype(idle_mutex)> guard{idle_mutex};
+    ++available;
+  }
+  idle_cond.notify_one();
+}
+
+bool FDGScheduler::pop(size_t worker, size_t & id) {
+  // Take the best function from our own queue, and otherwise steal from the other workers.
+  for (size_t i = 0; i < workers.size(); ++i) {
+    Worker & w = *workers[(worker + i) % workers.size()];
+    write_guard<decltype(w.mutex)> guard{w.mutex};
+    if (!w.queue.empty()) {
+      id = w.queue.top().id;
+      w.queue.pop();
+      --available;
+      if (i != 0) {
+        ++workers[worker]->stats.stolen;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Wait until there might be work available.  Returns false when there's nothing left to do.
+bool FDGScheduler::wait_for_work() {
+  std::unique_lock<decltype(idle_mutex)> lock{idle_mutex};
+  idle_cond.wait(lock, [this] { return available > 0 || remaining == 0 || failed; });
+  return remaining != 0 && !failed;
+}
+
+template <typename Func>
+void FDGScheduler::run(Func func) {
+  size_t nverts = graph.nVertices();
+  remaining = nverts;
+  available = 0;
+  failed = false;
+  error = nullptr;
+  for (auto & w : workers) {
+    w->stats = ThreadStats();
+  }
+
+  // Distribute the initially ready vertices round-robin in priority order.
+  std::vector<Ready> leaves;
+  for (auto & v : graph.vertices()) {
+    pending[v.id()] = v.nOutEdges();
+    if (v.nOutEdges() == 0) {
+      leaves.push_back(Ready{priority[v.id()], v.id()});
+    }
+  }
+  std::sort(leaves.begin(), leaves.end(),
+            [](Ready const & a, Ready const & b) { return b < a; });
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    push(i % workers.size(), leaves[i].id);
+  }
+
+  auto work = [this, &func](size_t worker) {
+    Worker & self = *workers[worker];
+    while (true) {
+      size_t id;
+      if (!pop(worker, id)) {
+        if (!wait_for_work()) {
+          return;
+        }
+        continue;
+      }
+
+      auto vertex = graph.findVertex(id);
+      if (!failed) {
+        auto timer = make_timer();
+        try {
+          func(worker, vertex->value());
+        }
+        catch (...) {
+          write_guard<decltype(idle_mutex)> guard{idle_mutex};
+          if (!error) {
+            error = std::current_exception();
+          }
+          failed = true;
+        }
+        self.stats.busy += timer.stop().count();
+        ++self.stats.processed;
+      }
+
+      // Release our callers, keeping them on this worker.
+      for (auto & e : vertex->inEdges()) {
+        if (--pending[e.source()->id()] == 0) {
+          push(worker, e.source()->id());
+        }
+      }
+      if (--remaining == 0 || failed) {
+        write_guard<decltype(idle_mutex)> guard{idle_mutex};
+        idle_cond.notify_all();
+      }
+    }
+  };
+
+  auto timer = make_timer();
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < workers.size(); ++i) {
+    threads.emplace_back(work, i);
+  }
+  work(0);
+  for (auto & t : threads) {
+    t.join();
+  }
+  elapsed = timer.stop().count();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void FDGScheduler::report(Sawyer::Message::Facility & mlog, std::string const & title) const {
+  if (!(mlog[Sawyer::Message::INFO])) return;
+  double busy = 0.0;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    ThreadStats const & stats = workers[i]->stats;
+    busy += stats.busy;
+    MINFO << title << ": thread " << i << " processed " << stats.processed << " functions ("
+          << stats.stolen << " stolen), busy " << stats.busy << " of " << elapsed
+          << " seconds (" << (elapsed > 0 ? 100.0 * stats.busy / elapsed : 0.0) << "%)."
+          << LEND;
+  }
+  double capacity = elapsed * workers.size();
+  MINFO << title << ": " << workers.size() << " threads, " << elapsed << " seconds, "
+        << (capacity > 0 ? 100.0 * busy / capacity : 0.0) << "% utilization." << LEND;
+}
+
 } // unnamed namespace
 
 Sawyer::Message::Facility BottomUpAnalyzer::mlog;
 
 BottomUpAnalyzer::BottomUpAnalyzer(DescriptorSet & ds_, ProgOptVarMap const & vm_)
   : ds(ds_), vm(vm_)
-{}
+{
+  if (vm.count("function-cache")) {
+    cache = make_unique<FunctionSummaryCache>(ds, vm);
+  }
+}
 
-// The default visitor simply computes the PDG and returns.
+// The default visitor simply computes the PDG and returns.  If the function was summarized
+// from the cache, there's nothing to compute.
 void BottomUpAnalyzer::visit(FunctionDescriptor *fd) {
-  fd->get_pdg();
+  if (!fd->is_summarized()) {
+    fd->get_pdg();
+  }
+}
+
+void BottomUpAnalyzer::prepare(FunctionDescriptor *fd) {
+  if (!cache) {
+    fd->get_pdg();
+    return;
+  }
+  if (fd->is_summarized() || fd->has_pdg()) return;
+  if (cache->restore(*fd)) return;
+  const PDG * pdg = fd->get_pdg();
+  // A summary of an analysis that was stopped by a resource limit is incomplete, and would be
+  // served from the cache even when the limit is later raised.
+  if (pdg && pdg->get_usedef().get_status() == LimitSuccess) {
+    cache->store(*fd);
+  }
 }
 
 // The default start is a NOP.
@@ -98,11 +366,11 @@ void BottomUpAnalyzer::analyze() {
   };
 
   // Function to create the PDG for a function
-  auto get_pdg = [&mlog = this->mlog, &included](size_t, FunctionDescriptor const *fd) {
+  auto get_pdg = [this, &mlog = this->mlog, &included](size_t, FunctionDescriptor *fd) {
     if (included(fd)) {
       MDEBUG << "Starting PDG generation for function " << fd->address_string() << LEND;
       auto timer = make_timer();
-      fd->get_pdg();
+      prepare(fd);
       timer.stop();
       MDEBUG << "Finished PDG generation for function " << fd->address_string()
              << " in " << timer << " seconds." << LEND;
@@ -116,6 +384,11 @@ void BottomUpAnalyzer::analyze() {
       GDEBUG << "Visiting function " << fd->address_string() << LEND;
       // Visit the function.
       auto timer = make_timer();
+      // Make sure the function was looked up in the cache (and added to it) before visiting
+      // it, even in the modes that don't compute the PDGs in advance.
+      if (cache) {
+        prepare(fd);
+      }
       visit(fd);
       timer.stop();
       ++processed_funcs;
@@ -124,8 +397,9 @@ void BottomUpAnalyzer::analyze() {
     }
   };
 
-  // Fun function across function descriptors in parallel, with progress bar
-  auto run_in_parallel = [&fdg, level, total_funcs](
+  // Run function across function descriptors in parallel, with progress bar
+  FDGScheduler scheduler{fdg.graph(), level};
+  auto run_in_parallel = [&mlog = this->mlog, &scheduler, total_funcs](
     auto func, std::string const & title)
   {
     Sawyer::ProgressBar<size_t, ProgressSuffix> progress(
@@ -134,7 +408,8 @@ void BottomUpAnalyzer::analyze() {
       func(s, fd);
       ++progress;
     };
-    Sawyer::workInParallel(fdg.graph(), level, process);
+    scheduler.run(process);
+    scheduler.report(mlog, title);
   };
 
   switch (mode) {
@@ -159,6 +434,11 @@ void BottomUpAnalyzer::analyze() {
     run_in_parallel(visit_func, "Function analysis");
     break;
   }
+  report_interner_stats();
+  if (cache) {
+    cache->report();
+  }
+
   if (total_funcs != processed_funcs) {
     GERROR << "Found only " << processed_funcs << " functions of "
            << total_funcs << " specifically requested for analysis." << LEND;
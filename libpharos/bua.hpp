@@ -4,7 +4,9 @@
 #define Pharos_Bua_H
 
 #include "options.hpp"
+#include "summary.hpp"
 #include <atomic>
+#include <memory>
 
 namespace pharos {
 
@@ -38,6 +40,9 @@ class BottomUpAnalyzer {
 
   size_t processed_funcs = 0;
 
+  // The persistent function summary cache, or null if --function-cache wasn't specified.
+  FunctionSummaryCache * get_summary_cache() { return cache.get(); }
+
  protected:
   // Override this method which is called at the beginning of analyze()
   virtual void start();
@@ -52,6 +57,12 @@ class BottomUpAnalyzer {
  private:
   static Sawyer::Message::Facility mlog;
 
+  std::unique_ptr<FunctionSummaryCache> cache;
+
+  // Restore the summary for the function from the cache if possible, and compute its PDG (and
+  // add it to the cache) otherwise.
+  void prepare(FunctionDescriptor *fd);
+
   mode_t mode = PDG_THREADED_VISIT_SINGLE;
 
 };
@@ -0,0 +1,735 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "compiled_apidb.hpp"
+#include "threads.hpp"
+
+namespace pharos {
+
+namespace {
+
+// The layout of the file.  Every section is 8-byte aligned, and every record is a multiple of
+// its alignment in size, so the records can be used directly from the mapped file.
+
+constexpr char compiled_magic[CompiledApiDictionary::magic_size] = {
+  'P', 'H', 'A', 'P', 'I', 'D', 'B', '\0'};
+constexpr uint32_t compiled_version = 1;
+constexpr uint32_t byte_order_mark = 0x01020304;
+constexpr uint32_t no_entry = std::numeric_limits<uint32_t>::max();
+
+constexpr auto RELATIVE_ADDRESS_MAX =
+  std::numeric_limits<decltype(APIDefinition::relative_address)>::max();
+
+// A string in the string section.
+struct StrRef {
+  uint32_t offset;
+  uint32_t size;
+};
+
+// A section of the file: the offset of its first record, and the number of records.
+struct Section {
+  uint64_t offset;
+  uint64_t count;
+};
+
+// A perfect hash table.  The key is hashed to choose a seed, and the key is hashed again with
+// that seed to choose a slot.  The slot holds the index of the group with the key, or
+// no_entry.  Keys that aren't in the table land in arbitrary slots, so the group's key is
+// always checked.
+struct HashTable {
+  Section seeds;                // uint32_t
+  Section slots;                // uint32_t
+  Section groups;               // GroupRecord
+};
+
+// The definitions with a key are members[first] through members[first + count - 1].
+struct GroupRecord {
+  StrRef key;
+  uint32_t first;
+  uint32_t count;
+};
+
+struct DefRecord {
+  StrRef export_name;
+  StrRef display_name;
+  StrRef dll_name;
+  StrRef dll_version;
+  StrRef dll_stamp;
+  StrRef calling_convention;
+  StrRef return_type;
+  uint32_t source;
+  uint32_t first_param;
+  uint32_t param_count;
+  uint32_t unused;
+  uint64_t relative_address;
+  uint64_t stackdelta;
+  uint64_t ordinal;
+};
+
+struct ParamRecord {
+  StrRef name;
+  StrRef type;
+  uint32_t direction;
+};
+
+struct AddrRecord {
+  uint64_t address;
+  uint32_t def;
+  uint32_t unused;
+};
+
+struct FileHeader {
+  char magic[CompiledApiDictionary::magic_size];
+  uint32_t version;
+  uint32_t byte_order;
+  Section strings;              // char
+  Section sources;              // StrRef, the description of each source dictionary
+  Section definitions;          // DefRecord
+  Section parameters;           // ParamRecord
+  Section members;              // uint32_t, definition indexes
+  Section addresses;            // AddrRecord, sorted by address
+  HashTable names;              // key: dll '\0' name
+  HashTable ordinals;           // key: dll '\0' ordinal (decimal)
+  HashTable name_only;          // key: name
+  HashTable dlls;               // key: dll
+};
+
+inline std::string normalize_dll(const std::string &dll) {
+  std::string name = to_lower(dll);
+  if (dll.size() >= 4 && name.compare(dll.size() - 4, 4, ".dll") == 0) {
+    name.erase(dll.size() - 4);
+  }
+  return name;
+}
+
+std::string name_key(const std::string & dll, const std::string & name) {
+  std::string key = dll;
+  key += '\0';
+  key += name;
+  return key;
+}
+
+std::string ordinal_key(const std::string & dll, size_t ordinal) {
+  std::string key = dll;
+  key += '\0';
+  key += std::to_string(ordinal);
+  return key;
+}
+
+// FNV-1a
+uint64_t key_hash(char const * data, size_t size) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// The splitmix64 finalizer, used to derive the slot hash from the key hash and a seed.
+uint64_t slot_hash(uint64_t h, uint32_t seed) {
+  uint64_t z = h + (uint64_t(seed) + 1) * 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// A read-only mapping of a file, which is unmapped when it is destroyed.
+struct FileMapping {
+  FileMapping() = default;
+  FileMapping(const FileMapping &) = delete;
+  FileMapping & operator=(const FileMapping &) = delete;
+  ~FileMapping() {
+    if (base != MAP_FAILED) {
+      munmap(base, size);
+    }
+  }
+
+  void * base = MAP_FAILED;
+  size_t size = 0;
+};
+
+} // unnamed namespace
+
+// ===========================================================================================
+// Reading
+// ===========================================================================================
+
+struct CompiledApiDictionary::Data {
+  Data(CompiledApiDictionary const & parent, const std::string & path);
+
+  CompiledApiDictionary const & parent;
+  // The mapping is a member so that it is released when the file is rejected by the
+  // constructor.
+  FileMapping mapping;
+  FileHeader const * header = nullptr;
+
+  // The definitions that have been returned so far, so that each definition is only built
+  // once and callers always get the same APIDefinition for a function.
+  mutable std_mutex mutex;
+  mutable std::unordered_map<uint32_t, APIDefinitionPtr> cache;
+
+  [[noreturn]] void corrupt() const {
+    throw std::runtime_error("Corrupt compiled API database");
+  }
+
+  template <typename T>
+  T const * section(Section const & s) const {
+    if (s.offset % alignof(T) != 0 || s.offset > mapping.size
+        || s.count > (mapping.size - s.offset) / sizeof(T))
+    {
+      corrupt();
+    }
+    return reinterpret_cast<T const *>(static_cast<char const *>(mapping.base) + s.offset);
+  }
+
+  template <typename T>
+  T const & at(Section const & s, uint64_t index) const {
+    if (index >= s.count) {
+      corrupt();
+    }
+    return section<T>(s)[index];
+  }
+
+  // The sections were checked when the file was opened, so only the string needs checking.
+  std::pair<char const *, size_t> view(StrRef const & ref) const {
+    if (uint64_t(ref.offset) + ref.size > header->strings.count) {
+      corrupt();
+    }
+    return std::make_pair(section<char>(header->strings) + ref.offset, size_t(ref.size));
+  }
+
+  std::string str(StrRef const & ref) const {
+    auto v = view(ref);
+    return std::string(v.first, v.second);
+  }
+
+  GroupRecord const * find(HashTable const & table, std::string const & key) const;
+  APIDefinitionPtr definition(uint32_t index) const;
+  APIDefinitionList group_definitions(GroupRecord const * group) const;
+};
+
+CompiledApiDictionary::Data::Data(CompiledApiDictionary const & p, const std::string & path)
+  : parent(p)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open for read");
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(FileHeader)) {
+    close(fd);
+    throw std::runtime_error("Not a compiled API database");
+  }
+  mapping.size = size_t(st.st_size);
+  mapping.base = mmap(nullptr, mapping.size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping remains valid after the file is closed.
+  close(fd);
+  if (mapping.base == MAP_FAILED) {
+    throw std::runtime_error("Could not map the compiled API database");
+  }
+
+  header = static_cast<FileHeader const *>(mapping.base);
+  if (!has_magic(header->magic, sizeof(header->magic))) {
+    throw std::runtime_error("Not a compiled API database");
+  }
+  if (header->byte_order != byte_order_mark) {
+    throw std::runtime_error("Compiled API database has the wrong byte order");
+  }
+  if (header->version != compiled_version) {
+    throw std::runtime_error("Compiled API database has an unsupported version");
+  }
+
+  // Check the bounds of every section now, so that lookups only need to check indexes.
+  section<char>(header->strings);
+  section<StrRef>(header->sources);
+  section<DefRecord>(header->definitions);
+  section<ParamRecord>(header->parameters);
+  section<uint32_t>(header->members);
+  section<AddrRecord>(header->addresses);
+  for (HashTable const * table : {&header->names, &header->ordinals, &header->name_only,
+                                  &header->dlls})
+  {
+    section<uint32_t>(table->seeds);
+    section<uint32_t>(table->slots);
+    section<GroupRecord>(table->groups);
+  }
+}
+
+GroupRecord const *
+CompiledApiDictionary::Data::find(HashTable const & table, std::string const & key) const
+{
+  if (table.seeds.count == 0 || table.slots.count == 0) {
+    return nullptr;
+  }
+  uint64_t h = key_hash(key.data(), key.size());
+  uint32_t seed = at<uint32_t>(table.seeds, h % table.seeds.count);
+  uint32_t slot = at<uint32_t>(table.slots, slot_hash(h, seed) % table.slots.count);
+  if (slot == no_entry) {
+    return nullptr;
+  }
+  GroupRecord const & group = at<GroupRecord>(table.groups, slot);
+  auto v = view(group.key);
+  if (v.second != key.size() || std::memcmp(v.first, key.data(), v.second) != 0) {
+    return nullptr;
+  }
+  return &group;
+}
+
+APIDefinitionPtr
+CompiledApiDictionary::Data::definition(uint32_t index) const
+{
+  {
+    write_guard<decltype(mutex)> guard{mutex};
+    auto found = cache.find(index);
+    if (found != cache.end()) {
+      return found->second;
+    }
+  }
+
+  DefRecord const & rec = at<DefRecord>(header->definitions, index);
+  auto fd = std::make_shared<APIDefinition>(parent);
+  fd->export_name = str(rec.export_name);
+  fd->display_name = str(rec.display_name);
+  fd->dll_name = str(rec.dll_name);
+  fd->dll_version = str(rec.dll_version);
+  fd->dll_stamp = str(rec.dll_stamp);
+  fd->calling_convention = str(rec.calling_convention);
+  fd->return_type = str(rec.return_type);
+  fd->relative_address = rec.relative_address;
+  fd->stackdelta = rec.stackdelta;
+  fd->ordinal = rec.ordinal;
+  fd->parameters.reserve(rec.param_count);
+  for (uint32_t i = 0; i < rec.param_count; ++i) {
+    ParamRecord const & prec = at<ParamRecord>(header->parameters,
+                                               uint64_t(rec.first_param) + i);
+    APIParam param;
+    param.name = str(prec.name);
+    param.type = str(prec.type);
+    param.direction = static_cast<APIParam::inout_t>(prec.direction);
+    fd->parameters.push_back(std::move(param));
+  }
+
+  // Another thread may have built the same definition in the meantime, in which case that
+  // one is used.
+  write_guard<decltype(mutex)> guard{mutex};
+  return cache.emplace(index, std::move(fd)).first->second;
+}
+
+APIDefinitionList
+CompiledApiDictionary::Data::group_definitions(GroupRecord const * group) const
+{
+  APIDefinitionList list;
+  if (group) {
+    list.reserve(group->count);
+    for (uint32_t i = 0; i < group->count; ++i) {
+      list.push_back(definition(at<uint32_t>(header->members, uint64_t(group->first) + i)));
+    }
+  }
+  return list;
+}
+
+bool CompiledApiDictionary::has_magic(char const * d, size_t size)
+{
+  return size >= magic_size && std::equal(d, d + magic_size, compiled_magic);
+}
+
+CompiledApiDictionary::CompiledApiDictionary(const std::string & path_)
+  : data(new Data(*this, path_)), path(path_)
+{}
+
+CompiledApiDictionary::~CompiledApiDictionary() = default;
+
+APIDefinitionList
+CompiledApiDictionary::get_api_definition(
+  const std::string & dll_name, const std::string & func_name) const
+{
+  auto key = name_key(normalize_dll(dll_name), func_name);
+  return data->group_definitions(data->find(data->header->names, key));
+}
+
+APIDefinitionList
+CompiledApiDictionary::get_api_definition(
+  const std::string & dll_name, size_t ordinal) const
+{
+  auto key = ordinal_key(normalize_dll(dll_name), ordinal);
+  return data->group_definitions(data->find(data->header->ordinals, key));
+}
+
+APIDefinitionList
+CompiledApiDictionary::get_api_definition(
+  const std::string & func_name) const
+{
+  return data->group_definitions(data->find(data->header->name_only, func_name));
+}
+
+APIDefinitionList
+CompiledApiDictionary::get_api_definition(
+  const regex & func_name) const
+{
+  APIDefinitionList list;
+  Section const & defs = data->header->definitions;
+  for (uint64_t i = 0; i < defs.count; ++i) {
+    DefRecord const & rec = data->at<DefRecord>(defs, i);
+    auto name = data->view(rec.export_name.size ? rec.export_name : rec.display_name);
+    if (std::regex_search(name.first, name.first + name.second, func_name,
+                          std::regex_constants::match_any))
+    {
+      list.push_back(data->definition(uint32_t(i)));
+    }
+  }
+  return list;
+}
+
+APIDefinitionList
+CompiledApiDictionary::get_api_definition(rose_addr_t addr) const
+{
+  Section const & addrs = data->header->addresses;
+  AddrRecord const * first = data->section<AddrRecord>(addrs);
+  AddrRecord const * last = first + addrs.count;
+  auto range = std::equal_range(
+    first, last, AddrRecord{addr, 0, 0},
+    [](AddrRecord const & a, AddrRecord const & b) { return a.address < b.address; });
+  APIDefinitionList list;
+  for (auto i = range.first; i != range.second; ++i) {
+    list.push_back(data->definition(i->def));
+  }
+  return list;
+}
+
+APIDefinitionList
+CompiledApiDictionary::get_all_definitions() const
+{
+  APIDefinitionList list;
+  uint64_t count = data->header->definitions.count;
+  list.reserve(count);
+  for (uint64_t i = 0; i < count; ++i) {
+    list.push_back(data->definition(uint32_t(i)));
+  }
+  return list;
+}
+
+bool
+CompiledApiDictionary::handles_dll(std::string const & dll_name) const
+{
+  return data->find(data->header->dlls, normalize_dll(dll_name)) != nullptr;
+}
+
+std::string CompiledApiDictionary::describe() const
+{
+  std::string result = "Compiled API database " + path;
+  Section const & sources = data->header->sources;
+  if (sources.count) {
+    result += " (from ";
+    for (uint64_t i = 0; i < sources.count; ++i) {
+      if (i) result += ", ";
+      result += data->str(data->at<StrRef>(sources, i));
+    }
+    result += ')';
+  }
+  return result;
+}
+
+// ===========================================================================================
+// Writing
+// ===========================================================================================
+
+struct CompiledApiWriter::Data {
+  // The definitions, with the index of the source dictionary of each.
+  std::vector<std::pair<uint32_t, APIDefinitionPtr>> defs;
+  std::vector<std::string> sources;
+  std::map<APIDictionary const *, uint32_t> source_index;
+};
+
+namespace {
+
+// Interns the strings written to the file.
+class StringPool {
+ public:
+  StrRef add(std::string const & str) {
+    auto found = index.find(str);
+    if (found != index.end()) {
+      return found->second;
+    }
+    if (blob.size() + str.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::runtime_error("Too much string data for a compiled API database");
+    }
+    StrRef ref{uint32_t(blob.size()), uint32_t(str.size())};
+    blob += str;
+    index.emplace(str, ref);
+    return ref;
+  }
+  std::string const & data() const { return blob; }
+
+ private:
+  std::string blob;
+  std::unordered_map<std::string, StrRef> index;
+};
+
+// The keys of a hash table, and the definitions with each key.
+using KeyGroups = std::map<std::string, std::vector<uint32_t>>;
+
+struct BuiltTable {
+  std::vector<uint32_t> seeds;
+  std::vector<uint32_t> slots;
+  std::vector<GroupRecord> groups;
+};
+
+// Build a perfect hash table using hash and displace: the keys are divided into buckets, and
+// starting with the largest bucket, a seed is found for each bucket that places all of its
+// keys in unused slots.
+BuiltTable build_table(KeyGroups const & keys, StringPool & strings,
+                       std::vector<uint32_t> & members)
+{
+  BuiltTable table;
+  size_t n = keys.size();
+  if (n == 0) {
+    return table;
+  }
+
+  for (auto & kv : keys) {
+    GroupRecord group;
+    group.key = strings.add(kv.first);
+    group.first = uint32_t(members.size());
+    group.count = uint32_t(kv.second.size());
+    members.insert(members.end(), kv.second.begin(), kv.second.end());
+    table.groups.push_back(group);
+  }
+
+  std::vector<uint64_t> hashes;
+  hashes.reserve(n);
+  for (auto & kv : keys) {
+    hashes.push_back(key_hash(kv.first.data(), kv.first.size()));
+  }
+
+  constexpr uint32_t max_seed = 1 << 20;
+  size_t nbuckets = std::max(size_t(1), n / 4);
+  size_t nslots = n + n / 4 + 1;
+  for (int attempt = 0; attempt < 8; ++attempt, nslots += nslots / 4) {
+    std::vector<std::vector<uint32_t>> buckets(nbuckets);
+    for (size_t i = 0; i < n; ++i) {
+      buckets[hashes[i] % nbuckets].push_back(uint32_t(i));
+    }
+    std::vector<uint32_t> order(nbuckets);
+    for (size_t b = 0; b < nbuckets; ++b) order[b] = uint32_t(b);
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+    table.seeds.assign(nbuckets, 0);
+    table.slots.assign(nslots, no_entry);
+    bool failed = false;
+    std::vector<size_t> placed;
+    for (uint32_t b : order) {
+      auto const & bucket = buckets[b];
+      if (bucket.empty()) break;
+      uint32_t seed = 0;
+      for (; seed < max_seed; ++seed) {
+        placed.clear();
+        bool ok = true;
+        for (uint32_t k : bucket) {
+          size_t slot = slot_hash(hashes[k], seed) % nslots;
+          if (table.slots[slot] != no_entry
+              || std::find(placed.begin(), placed.end(), slot) != placed.end())
+          {
+            ok = false;
+            break;
+          }
+          placed.push_back(slot);
+        }
+        if (ok) break;
+      }
+      if (seed == max_seed) {
+        failed = true;
+        break;
+      }
+      table.seeds[b] = seed;
+      for (size_t i = 0; i < bucket.size(); ++i) {
+        table.slots[placed[i]] = bucket[i];
+      }
+    }
+    if (!failed) {
+      return table;
+    }
+  }
+  throw std::runtime_error("Unable to build a perfect hash table for the API database");
+}
+
+template <typename T>
+Section append_section(std::string & out, std::vector<T> const & records) {
+  // Align each section to 8 bytes.
+  out.resize((out.size() + 7) & ~size_t(7), '\0');
+  Section s{out.size(), records.size()};
+  if (!records.empty()) {
+    out.append(reinterpret_cast<char const *>(records.data()), records.size() * sizeof(T));
+  }
+  return s;
+}
+
+HashTable append_table(std::string & out, BuiltTable const & table) {
+  HashTable h;
+  h.seeds = append_section(out, table.seeds);
+  h.slots = append_section(out, table.slots);
+  h.groups = append_section(out, table.groups);
+  return h;
+}
+
+} // unnamed namespace
+
+CompiledApiWriter::CompiledApiWriter() : data(new Data()) {}
+CompiledApiWriter::~CompiledApiWriter() = default;
+
+void CompiledApiWriter::add(APIDictionary const & dict)
+{
+  for (auto & def : dict.get_all_definitions()) {
+    // Each definition knows which dictionary it came from, which preserves the order of the
+    // dictionaries inside of dict.
+    auto result = data->source_index.emplace(&def->source, uint32_t(data->sources.size()));
+    if (result.second) {
+      data->sources.push_back(def->source.describe());
+    }
+    data->defs.emplace_back(result.first->second, def);
+  }
+}
+
+size_t CompiledApiWriter::size() const
+{
+  return data->defs.size();
+}
+
+void CompiledApiWriter::write(const std::string & path) const
+{
+  auto const & defs = data->defs;
+  if (defs.size() >= no_entry) {
+    throw std::runtime_error("Too many definitions for a compiled API database");
+  }
+
+  StringPool strings;
+  std::vector<StrRef> sources;
+  std::vector<DefRecord> def_records;
+  std::vector<ParamRecord> param_records;
+  std::vector<AddrRecord> addr_records;
+  KeyGroups names, ordinals, name_only, dlls;
+  std::map<std::string, std::set<std::pair<std::string, size_t>>> name_only_seen;
+  std::map<rose_addr_t, uint32_t> addr_source;
+
+  for (auto & source : data->sources) {
+    sources.push_back(strings.add(source));
+  }
+
+  // A key's definitions all come from the first source that defines the key, which is how
+  // MultiApiDictionary answers these lookups.
+  auto add_member = [&defs](std::vector<uint32_t> & group, uint32_t index) {
+    if (group.empty() || defs[group.front()].first == defs[index].first) {
+      group.push_back(index);
+    }
+  };
+
+  for (uint32_t i = 0; i < defs.size(); ++i) {
+    APIDefinition const & def = *defs[i].second;
+    DefRecord rec;
+    std::memset(&rec, 0, sizeof(rec));
+    rec.export_name = strings.add(def.export_name);
+    rec.display_name = strings.add(def.display_name);
+    rec.dll_name = strings.add(def.dll_name);
+    rec.dll_version = strings.add(def.dll_version);
+    rec.dll_stamp = strings.add(def.dll_stamp);
+    rec.calling_convention = strings.add(def.calling_convention);
+    rec.return_type = strings.add(def.return_type);
+    rec.source = defs[i].first;
+    rec.first_param = uint32_t(param_records.size());
+    rec.param_count = uint32_t(def.parameters.size());
+    rec.relative_address = def.relative_address;
+    rec.stackdelta = def.stackdelta;
+    rec.ordinal = def.ordinal;
+    def_records.push_back(rec);
+    for (auto & param : def.parameters) {
+      ParamRecord prec;
+      std::memset(&prec, 0, sizeof(prec));
+      prec.name = strings.add(param.name);
+      prec.type = strings.add(param.type);
+      prec.direction = uint32_t(param.direction);
+      param_records.push_back(prec);
+    }
+
+    std::string dll = normalize_dll(def.dll_name);
+    const std::string & name = def.get_name();
+    if (!dll.empty()) {
+      dlls[dll];
+    }
+    if (!name.empty()) {
+      add_member(names[name_key(dll, name)], i);
+      // Name-only lookups return the definitions from every source, without duplicates.
+      if (name_only_seen[name].emplace(def.dll_name, def.ordinal).second) {
+        name_only[name].push_back(i);
+      }
+    }
+    if (def.ordinal) {
+      add_member(ordinals[ordinal_key(dll, def.ordinal)], i);
+    }
+    if (def.relative_address != RELATIVE_ADDRESS_MAX) {
+      auto result = addr_source.emplace(def.relative_address, defs[i].first);
+      if (result.first->second == defs[i].first) {
+        addr_records.push_back(AddrRecord{def.relative_address, i, 0});
+      }
+    }
+  }
+  std::stable_sort(addr_records.begin(), addr_records.end(),
+                   [](AddrRecord const & a, AddrRecord const & b) {
+                     return a.address < b.address;
+                   });
+
+  std::vector<uint32_t> members;
+  BuiltTable names_table = build_table(names, strings, members);
+  BuiltTable ordinals_table = build_table(ordinals, strings, members);
+  BuiltTable name_only_table = build_table(name_only, strings, members);
+  BuiltTable dlls_table = build_table(dlls, strings, members);
+
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::copy(compiled_magic, compiled_magic + sizeof(compiled_magic), header.magic);
+  header.version = compiled_version;
+  header.byte_order = byte_order_mark;
+
+  std::string out(sizeof(header), '\0');
+  std::vector<char> string_data(strings.data().begin(), strings.data().end());
+  header.strings = append_section(out, string_data);
+  header.sources = append_section(out, sources);
+  header.definitions = append_section(out, def_records);
+  header.parameters = append_section(out, param_records);
+  header.members = append_section(out, members);
+  header.addresses = append_section(out, addr_records);
+  header.names = append_table(out, names_table);
+  header.ordinals = append_table(out, ordinals_table);
+  header.name_only = append_table(out, name_only_table);
+  header.dlls = append_table(out, dlls_table);
+  std::memcpy(&out[0], &header, sizeof(header));
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(out.data(), out.size());
+  file.close();
+  if (!file) {
+    throw std::runtime_error("Unable to write compiled API database " + path);
+  }
+}
+
+} // namespace pharos
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
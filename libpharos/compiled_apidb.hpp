@@ -0,0 +1,103 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#ifndef Pharos_Compiled_Apidb_H
+#define Pharos_Compiled_Apidb_H
+
+// This header provides a compiled form of the API database.  The apicompile tool collects
+// every definition from the configured API databases (SQLite and JSON) and writes them to a
+// single immutable file, which contains the definitions, a table of interned strings, and
+// perfect hash tables for looking definitions up by DLL and name, by DLL and ordinal, and by
+// name alone.  CompiledApiDictionary memory maps that file, so opening it requires no parsing
+// at all, and lookups only touch the pages they need.  Compiled databases are used anywhere
+// that an API database can be configured (e.g. --apidb), and are recognized by their magic
+// number.
+//
+// The file is written in the byte order of the machine that compiled it, and is rejected on
+// machines with a different byte order.
+
+#include <memory>
+#include <string>
+
+#include "apidb.hpp"
+
+namespace pharos {
+
+class CompiledApiDictionary : public APIDictionary {
+ public:
+  // The number of bytes needed to recognize a compiled API database.
+  static constexpr size_t magic_size = 8;
+  // Does data (the start of a file) have the magic number of a compiled API database?
+  static bool has_magic(char const * data, size_t size);
+
+  // Open and map the compiled API database.  Throws std::runtime_error if the file can't be
+  // mapped or isn't a valid compiled API database.
+  CompiledApiDictionary(const std::string & path);
+  ~CompiledApiDictionary() override;
+
+  APIDefinitionList
+  get_api_definition(
+    const std::string & dll_name, const std::string & func_name)
+    const override;
+
+  APIDefinitionList
+  get_api_definition(
+    const regex & func_name)
+    const override;
+
+  APIDefinitionList
+  get_api_definition(
+    const std::string & func_name)
+    const override;
+
+  APIDefinitionList
+  get_api_definition(
+    const std::string & dll_name, size_t ordinal)
+    const override;
+
+  APIDefinitionList
+  get_api_definition(rose_addr_t addr) const override;
+
+  APIDefinitionList get_all_definitions() const override;
+
+  bool handles_dll(std::string const & dll_name) const override;
+
+  std::string describe() const override;
+
+ private:
+  struct Data;
+  std::unique_ptr<Data> data;
+  std::string path;
+};
+
+// Writes a compiled API database.
+class CompiledApiWriter {
+ public:
+  CompiledApiWriter();
+  ~CompiledApiWriter();
+
+  // Add every definition in the dictionary.  When several dictionaries define the same
+  // function, the definitions from the dictionary that was added first take precedence, just
+  // as they do in the apidb configuration.  Dictionaries nested inside the given dictionary
+  // (e.g. in a MultiApiDictionary) are kept in order.
+  void add(APIDictionary const & dict);
+
+  // The number of definitions added.
+  size_t size() const;
+
+  // Write the compiled database.  Throws std::runtime_error on failure.
+  void write(const std::string & path) const;
+
+ private:
+  struct Data;
+  std::unique_ptr<Data> data;
+};
+
+} // namespace pharos
+
+#endif // Pharos_Compiled_Apidb_H
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
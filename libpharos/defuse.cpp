@@ -17,6 +17,8 @@
 #include "options.hpp"
 #include "cdg.hpp"
 #include "masm.hpp"
+#include "profile.hpp"
+#include "memtrack.hpp"
 
 namespace pharos {
 
@@ -434,6 +436,9 @@ BlockAnalysis::analyze(bool with_context)
       if (rstatus != LimitSuccess) {
         SERROR << "Basic block " << addr_str(address)
                << " " << block_limit.get_message() << LEND;
+        if (Profiler * profiler = get_global_profiler()) {
+          profiler->note_limit(du.current_function->get_address(), block_limit.get_message());
+        }
         break;
       }
     }
@@ -677,9 +682,17 @@ DUAnalysis::DUAnalysis(DescriptorSet& ds_, FunctionDescriptor & f)
 {
   // We've always got a real function to analyze.
 
+  // Charge the memory allocated by this thread during the analysis to the function, so that
+  // the per-function memory limit works even when other functions are being analyzed by other
+  // threads.  The resource limits created during the analysis use this tracker as well.
+  AllocationTracker allocations;
+  func_limit.track_allocations(&allocations);
+
   const ProgOptVarMap& vm = ds.get_arguments();
 
   propagate_conditions = (vm.count("propagate-conditions") > 0);
+  legacy_scheduler = (vm.count("legacy-flow-scheduler") > 0);
+  incremental_compare = !propagate_conditions && (vm.count("full-state-compare") == 0);
 
   current_function = &f;
   output_valid = false;
@@ -708,24 +721,58 @@ DUAnalysis::DUAnalysis(DescriptorSet& ds_, FunctionDescriptor & f)
   }
 
   dispatcher = RoseDispatcherX86::instance(ds.get_architecture(), rops);
+  rops->set_access_arena(&access_arena);
 
   // Configure the limit analysis.  The func_limit instance is local, but we still need to
   // configure the global limits of the analysis of all functions as well.
   get_global_limits().set_limits(func_limit, PharosLimits::limit_type::FUNC);
 
   // Now go do the analysis.
-  if (rigor) {
-    status = analyze_basic_blocks_independently();
-  }
-  else {
-    status = solve_flow_equation_iteratively();
+  {
+    ProfileTimer defuse_timer{current_function->get_address(), ProfilePhase::DefUse};
+    if (rigor) {
+      status = analyze_basic_blocks_independently();
+    }
+    else {
+      status = solve_flow_equation_iteratively();
+    }
   }
 
+  // The dispatcher outlives the analysis, so it should no longer allocate from the arena, and
+  // the function limit outlives the allocation tracker.
+  rops->set_access_arena(nullptr);
+  func_limit.track_allocations(nullptr);
+
+  const ArenaStats & arena_stats = access_arena.get_stats();
   GDEBUG << "Analysis of function " << current_function->address_string() << " took "
-         << func_limit.get_relative_clock().count() << " seconds." << LEND;
+         << func_limit.get_relative_clock().count() << " seconds ("
+         << func_limit.get_relative_cpu() << " seconds CPU), made "
+         << arena_stats.allocations << " access allocations (" << arena_stats.reused
+         << " reused), and reserved " << arena_stats.reserved_bytes << " bytes for accesses."
+         << LEND;
+  if (AllocationTracker::is_enabled()) {
+    GDEBUG << "Analysis of function " << current_function->address_string() << " made "
+           << allocations.get_allocations() << " allocations, with at most "
+           << allocations.get_peak_bytes() << " bytes allocated at once." << LEND;
+  }
+
+  Profiler * profiler = get_global_profiler();
+  if (profiler) {
+    profiler->add_iterations(current_function->get_address(), func_limit.get_counter(),
+                             flow_stats.blocks_processed);
+    profiler->note_accesses(current_function->get_address(), arena_stats.allocations,
+                            arena_stats.peak_bytes, func_limit.get_absolute_memory());
+    if (AllocationTracker::is_enabled()) {
+      profiler->note_allocations(current_function->get_address(),
+                                 allocations.get_peak_bytes());
+    }
+  }
 
   if (status != LimitSuccess) {
     SERROR << "Analysis of function " << current_function->address_string () << " failed: " << func_limit.get_message() << LEND;
+    if (profiler) {
+      profiler->note_limit(current_function->get_address(), func_limit.get_message());
+    }
   }
 
 }
@@ -1857,6 +1904,7 @@ DUAnalysis::merge_predecessors(CFGVertex vertex)
     ++edge_cnt;
   }
 
+  flow_stats.merges += merge_cnt;
   DSTREAM << "Merging " << merge_cnt << " predecessors for block " << addr_str(baddr)
           << " in function " << current_function->address_string()
           << " (loop #" << func_limit.get_counter() << ") took "
@@ -1949,6 +1997,7 @@ DUAnalysis::merge_predecessors_with_conditions(CFGVertex vertex)
     analysis.entry_condition = SymbolicValue::treenode_instance(entry_cond_tnp);
   }
 
+  flow_stats.merges += merge_cnt;
   DSTREAM << "Merging " << merge_cnt << " predecessors for block " << addr_str(baddr)
           << " in function " << current_function->address_string()
           << " (loop #" << func_limit.get_counter() << ") took "
@@ -1991,31 +2040,74 @@ DUAnalysis::process_block_with_limit(CFGVertex vertex)
   // preserved and propogated when merging predecessors. Real conditions are needed for certain
   // classes of analysis, such as path finding where program state
   SymbolicStatePtr cstate = nullptr;
-  if (propagate_conditions) {
-    cstate = merge_predecessors_with_conditions(vertex);
-  }
-  else {
-    cstate = merge_predecessors(vertex);
+  {
+    ProfileTimer merge_timer{current_function->get_address(), ProfilePhase::Merge};
+    if (propagate_conditions) {
+      cstate = merge_predecessors_with_conditions(vertex);
+    }
+    else {
+      cstate = merge_predecessors(vertex);
+    }
   }
   analysis.input_state = cstate->sclone();
   rops->currentState(cstate);
 
+  // The merge of the predecessors is made location by location, so if the same predecessors
+  // were merged last time, the input state can only differ from the previous input state at
+  // the locations where the predecessors' output states changed.
+  size_t merged_predecessors = 0;
+  for (SgAsmBlock *pblock : cfg_in_bblocks(cfg, vertex)) {
+    if (blocks.at(pblock->get_address()).output_state) merged_predecessors++;
+  }
+  bool incremental = (incremental_compare && analysis.output_state
+                      && merged_predecessors == analysis.merged_predecessors);
 
+  cstate->track_writes();
   analysis.analyze(true);
+  cstate->stop_tracking_writes();
+
+  // The new output state can only differ from the previous output state at the locations that
+  // changed in the input since the previous output state was computed, or that were written by
+  // this evaluation or by any evaluation since then.
+  StateWrites changes = cstate->get_writes();
+  if (incremental) {
+    changes = analysis.output_changes.locations(changes, analysis.output_state->get_writes());
+  }
+  else {
+    changes.all = true;
+  }
+  analysis.merged_predecessors = merged_predecessors;
+
+  if (analysis.output_state) {
+    if (changes.all) {
+      flow_stats.full_compares++;
+    }
+    else {
+      flow_stats.incremental_compares++;
+      flow_stats.locations_compared += changes.size();
+    }
+  }
 
   // If output of this block changed from what we previously calculated, then mark all its
   // children as pending.
-  if (!(analysis.output_state && cstate->equals(analysis.output_state))) {
-    changed = true;
+  changed = !(analysis.output_state && cstate->equals(analysis.output_state, changes));
+  analysis.output_changes.evaluated(changes, changed);
+  if (changed) {
 
     debug_state_merge(cstate, "STATE AFTER EXECUTION");
     debug_state_replaced(baddr);
     analysis.output_state = cstate;
     debug_state_merge(analysis.output_state, "STATE AFTER UPDATE");
+    if (Profiler * profiler = get_global_profiler()) {
+      profiler->note_state_size(current_function->get_address(), cstate->size());
+    }
 
-    for (SgAsmBlock *sblock : cfg_out_bblocks(cfg, vertex)) {
-      rose_addr_t saddr = sblock->get_address();
-      blocks.at(saddr).pending = true;
+    for (CFGVertex svertex : cfg_out_vertices(cfg, vertex)) {
+      rose_addr_t saddr = convert_vertex_to_bblock(cfg, svertex)->get_address();
+      BlockAnalysis& sanalysis = blocks.at(saddr);
+      sanalysis.pending = true;
+      sanalysis.output_changes.input_changed(changes);
+      schedule_block(svertex);
       DSTREAM << "Marking successor block " << addr_str(saddr) << " for revisting." << LEND;
     }
   }
@@ -2086,9 +2178,59 @@ DUAnalysis::get_block_analysis() const {
   return blocks;
 }
 
-// Loop over the control flow graph several times, processing each basic block and keeping a
-// list of which blocks need to bew revisited.  This code need to be rewritten so that is uses
-// a proper worklist.
+// Add a block to the worklist of blocks needing to be (re)visited.  The legacy scheduler finds
+// pending blocks by sweeping the flow order list, so there's nothing to do in that case.
+void
+DUAnalysis::schedule_block(CFGVertex vertex)
+{
+  if (legacy_scheduler) return;
+  assert(vertex < flow_rank.size());
+  size_t rank = flow_rank[vertex];
+  // Vertices that aren't reachable from the entry point have no rank, and are never analyzed.
+  if (rank == BlockWorklist::npos) return;
+  worklist.push(rank);
+}
+
+// Decide whether a block that is pending should be processed, and update its pending status and
+// iteration count if so.  This logic is shared by both schedulers.
+bool
+DUAnalysis::prepare_block(BlockAnalysis& analysis)
+{
+  flow_stats.blocks_scanned++;
+
+  // If the block is a "bad" block, then skip it.
+  if (analysis.bad) return false;
+
+  // If this block is in the processed list (meaning we've processed it before) and it it is no
+  // longer pending then continue with the next basic block.
+  if (analysis.pending == false) return false;
+
+  // If we're really pending, but we've visited this block more than max iteration times, then
+  // we should give up even though it produces incorrect answers.  Report the condition as an
+  // error so that the user knows something went wrong.
+  if (analysis.iterations >= MAX_LOOP) {
+    // Cory thinks that this should really be an error, but it's still too common to be
+    // considered a true error, and so he moved it to warning importance.
+    SWARN << "Maximum iterations (" << MAX_LOOP << ") exceeded for block "
+          << analysis.address_string() << " in function "
+          << current_function->address_string() << LEND;
+    // Setting the block so that it is not pending should help prevent the error message from
+    // being generated repeatedly for the same block.
+    analysis.pending = false;
+    return false;
+  }
+
+  // We're processing the block now, so it's no longer pending (and we've interated once more).
+  analysis.pending = false;
+  if (analysis.iterations) flow_stats.revisits++;
+  analysis.iterations++;
+  flow_stats.blocks_processed++;
+  return true;
+}
+
+// Loop over the control flow graph several times, processing each basic block in flow order
+// and revisiting the blocks whose predecessors' output states changed until we reach a fixed
+// point.
 LimitCode
 DUAnalysis::loop_over_cfg()
 {
@@ -2115,46 +2257,57 @@ DUAnalysis::loop_over_cfg()
 
   // Solve the flow equation iteratively to find out what's defined at the end of every basic
   // block.  The policies[] stores this info for each vertex.
+  flow_stats = FlowSolverStats();
+  LimitCode rstatus;
+  if (legacy_scheduler) {
+    rstatus = sweep_over_cfg(flowlist);
+  }
+  else {
+    rstatus = worklist_over_cfg(flowlist);
+  }
+
+  if (GTRACE) {
+    for (auto& bpair : blocks) {
+      const BlockAnalysis& block = bpair.second;
+      GTRACE << " Basic block: " << block.address_string() << " in function " << fd->address_string()
+             << " took " << block.iterations << " iterations." << LEND;
+    }
+  }
+
+  GDEBUG << "Flow equation for " << fd->address_string()
+         << (legacy_scheduler ? " (sweep)" : " (worklist)")
+         << ": passes=" << flow_stats.passes
+         << " scanned=" << flow_stats.blocks_scanned
+         << " processed=" << flow_stats.blocks_processed
+         << " revisits=" << flow_stats.revisits
+         << " merges=" << flow_stats.merges
+         << " full_compares=" << flow_stats.full_compares
+         << " incremental_compares=" << flow_stats.incremental_compares
+         << " locations_compared=" << flow_stats.locations_compared << LEND;
+
+  return rstatus;
+}
+
+// The legacy scheduler.  Sweep the entire flow order list on each pass, skipping the blocks
+// that are not pending, until a pass makes no changes.
+LimitCode
+DUAnalysis::sweep_over_cfg(const std::vector<CFGVertex>& flowlist)
+{
   bool changed = true;
   LimitCode rstatus = func_limit.check();
   while (changed && rstatus == LimitSuccess) {
     changed = false;
     func_limit.increment_counter();
+    flow_stats.passes++;
 
     SDEBUG << "loop try #" << func_limit.get_counter() << LEND;
     for (auto vertex : flowlist) {
       SgAsmBlock *bblock = convert_vertex_to_bblock(cfg, vertex);
       assert(bblock!=NULL);
-      rose_addr_t baddr = bblock->get_address();
       // The call to at() should not throw unless our code is using the wrong CFG.
-      BlockAnalysis& analysis = blocks.at(baddr);
-
-      // If the block is a "bad" block, then skip it.
-      if (analysis.bad) continue;
-
-      // If this block is in the processed list (meaning we've processed it before) and it it
-      // is no longer pending then continue with the next basic block.  This is a very common
-      // case and we could probably simplify the logic some by adding and removing entries
-      // from a worklist that would prevent us from being in this loop in the first place.
-      if (analysis.pending == false) continue;
-
-      // If we're really pending, but we've visited this block more than max iteration times,
-      // then we should give up even though it produces incorrect answers.  Report the condition
-      // as an error so that the user knows something went wrong.
-      if (analysis.iterations >= MAX_LOOP) {
-        // Cory thinks that this should really be an error, but it's still too common to be
-        // considered a true error, and so he moved it to warning importance.
-        SWARN << "Maximum iterations (" << MAX_LOOP << ") exceeded for block "
-              << addr_str(baddr) << " in function " << fd->address_string() << LEND;
-        // Setting the block so that it is not pending should help prevent the error message
-        // from being generated repeatedly for the same block.
-        analysis.pending = false;
-        continue;
-      }
+      BlockAnalysis& analysis = blocks.at(bblock->get_address());
 
-      // We're processing the block now, so it's no longer pending (and we've interated once more).
-      analysis.pending = false;
-      analysis.iterations++;
+      if (!prepare_block(analysis)) continue;
 
       // Process a block with a resource limit, and if it changed our status, update our boolean.
       if (process_block_with_limit(vertex)) changed = true;
@@ -2168,18 +2321,65 @@ DUAnalysis::loop_over_cfg()
     } // foreach block in flow list...
 
     // Cory would like for this to become: func_limit.report("Func X took: "); ?
-    SDEBUG << "Flow equation loop #" << func_limit.get_counter() << " for " << fd->address_string()
-           << " took " << func_limit.get_relative_clock().count() << " seconds." << LEND;
+    SDEBUG << "Flow equation loop #" << func_limit.get_counter() << " for "
+           << current_function->address_string() << " took "
+           << func_limit.get_relative_clock().count() << " seconds." << LEND;
   }
 
-  if (GTRACE) {
-    for (auto& bpair : blocks) {
-      const BlockAnalysis& block = bpair.second;
-      GTRACE << " Basic block: " << block.address_string() << " in function " << fd->address_string()
-             << " took " << block.iterations << " iterations." << LEND;
+  return rstatus;
+}
+
+// The worklist scheduler.  Only blocks whose predecessors' output states changed are ever
+// dequeued, and they're dequeued in flow order.  See BlockWorklist for why the passes (and the
+// function limit counter) are exactly the same as in sweep_over_cfg().
+LimitCode
+DUAnalysis::worklist_over_cfg(const std::vector<CFGVertex>& flowlist)
+{
+  flow_rank.assign(num_vertices(cfg), BlockWorklist::npos);
+  for (size_t rank = 0; rank < flowlist.size(); ++rank) {
+    flow_rank[flowlist[rank]] = rank;
+  }
+
+  // Every reachable block starts out pending.
+  worklist.clear();
+  for (auto vertex : flowlist) {
+    SgAsmBlock *bblock = convert_vertex_to_bblock(cfg, vertex);
+    assert(bblock!=NULL);
+    if (blocks.at(bblock->get_address()).pending) schedule_block(vertex);
+  }
+
+  // The sweep scheduler always makes one final pass in which nothing changes, and counts it
+  // against the function limit.  We preserve that so that the limits behave identically.
+  bool changed = true;
+  LimitCode rstatus = func_limit.check();
+  while (changed && rstatus == LimitSuccess) {
+    changed = false;
+    func_limit.increment_counter();
+    flow_stats.passes++;
+
+    SDEBUG << "loop try #" << func_limit.get_counter() << LEND;
+    size_t rank;
+    while (worklist.pop(rank)) {
+      CFGVertex vertex = flowlist[rank];
+      SgAsmBlock *bblock = convert_vertex_to_bblock(cfg, vertex);
+      assert(bblock!=NULL);
+      BlockAnalysis& analysis = blocks.at(bblock->get_address());
+
+      if (!prepare_block(analysis)) continue;
+
+      if (process_block_with_limit(vertex)) changed = true;
+
+      rstatus = func_limit.check();
+      if (rstatus != LimitSuccess) break;
     }
+    worklist.next_pass();
+
+    SDEBUG << "Flow equation loop #" << func_limit.get_counter() << " for "
+           << current_function->address_string() << " took "
+           << func_limit.get_relative_clock().count() << " seconds." << LEND;
   }
 
+  worklist.clear();
   return rstatus;
 }
 
@@ -2191,7 +2391,7 @@ DUAnalysis::solve_flow_equation_iteratively()
   if (rstatus != LimitSuccess) return rstatus;
 
   // This limits the number of times we complain about discarded expressions.  It's a naughty
-  // global variable.   Go read about it in SymbolicValue::scopy().
+  // global variable.   Go read about it in SymbolicValue::discard_oversized_expression().
   discarded_expressions = 0;
 
   // This analysis requires the filtered version of the control flow graph because we don't
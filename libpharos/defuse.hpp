@@ -5,6 +5,7 @@
 
 #include <fstream>
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <boost/format.hpp>
@@ -112,8 +113,12 @@ class BlockAnalysis {
   // The condition
   SymbolicValuePtr exit_condition;
 
-  // A resource limit for this block that can be reused.  Not required here?
-  ResourceLimit limit;
+  // The locations at which the output state might have changed since it was last replaced,
+  // and the number of predecessors that had output states when this block was last processed.
+  // Together with the writes recorded in the output state, this allows the new output state to
+  // be compared with the previous one at only the locations that might have changed.
+  OutputChanges output_changes;
+  size_t merged_predecessors = 0;
 
   BlockAnalysis(DUAnalysis & du, const ControlFlowGraph& cfg, CFGVertex vertex, bool entry);
 
@@ -129,6 +134,73 @@ class BlockAnalysis {
 
 };
 
+// Counters describing the work done while solving the flow equation for a single function.
+// These exist so that the worklist scheduler can be compared with the legacy sweep scheduler.
+struct FlowSolverStats {
+  // The number of passes over the control flow graph (also reflected in the function limit
+  // counter).
+  size_t passes = 0;
+  // The number of blocks examined by the scheduler, including blocks that were skipped because
+  // they were bad, not pending, or had exceeded the maximum number of iterations.
+  size_t blocks_scanned = 0;
+  // The number of times that any block was emulated.
+  size_t blocks_processed = 0;
+  // The number of times that a block was emulated after its first visit.
+  size_t revisits = 0;
+  // The number of predecessor output states merged into block input states.
+  size_t merges = 0;
+  // The number of output state comparisons that visited the entire state, the number that
+  // visited only the locations that might have changed, and the locations visited by the
+  // latter.
+  size_t full_compares = 0;
+  size_t incremental_compares = 0;
+  size_t locations_compared = 0;
+};
+
+// A worklist of basic blocks, identified by their rank in the reverse post-order (flow order)
+// of the control flow graph.  Blocks are grouped into passes so that the visit order is exactly
+// the same as the historical algorithm that repeatedly swept the entire flow order list.  A
+// block scheduled with a rank after the block currently being processed is visited in the
+// current pass, while one at or before it (e.g. the target of a loop back edge) waits for the
+// next pass.  Clean blocks are never examined.
+class BlockWorklist {
+ public:
+  static constexpr size_t npos = size_t(-1);
+
+ private:
+  std::set<size_t> current;
+  std::set<size_t> next;
+  // The rank of the most recently dequeued block in this pass, or npos at the start of a pass.
+  size_t cursor = npos;
+
+ public:
+  void push(size_t rank) {
+    if (cursor == npos || rank > cursor) current.insert(rank);
+    else next.insert(rank);
+  }
+
+  // Remove the lowest ranked block in the current pass, returning false if the pass is done.
+  bool pop(size_t & rank) {
+    if (current.empty()) return false;
+    auto first = current.begin();
+    rank = *first;
+    current.erase(first);
+    cursor = rank;
+    return true;
+  }
+
+  // Begin the next pass, returning false if there's no remaining work.
+  bool next_pass() {
+    current.insert(next.begin(), next.end());
+    next.clear();
+    cursor = npos;
+    return !current.empty();
+  }
+
+  bool empty() const { return current.empty() && next.empty(); }
+  void clear() { current.clear(); next.clear(); cursor = npos; }
+};
+
 using DUChain = std::set<Definition>;
 using Addr2DUChainMap = std::map<rose_addr_t, DUChain>;
 
@@ -165,6 +237,15 @@ class DUAnalysis {
   // Are we propagating basic block conditions or discarding them?
   bool propagate_conditions;
 
+  // Are we comparing output states only at the locations that might have changed?  Disabled
+  // when propagating conditions, since the merged input states then depend on more than the
+  // values at each location.
+  bool incremental_compare;
+
+  // Are we using the legacy scheduler that sweeps the entire flow order list on each pass
+  // instead of the worklist?  Only useful for comparing the two.
+  bool legacy_scheduler;
+
   // ==================================================================================
   // Data produced during analysis
   // ==================================================================================
@@ -176,8 +257,12 @@ class DUAnalysis {
   // by I.
   Addr2DUChainMap dependents_of;
 
+  // The abstract accesses of each instruction are allocated from this arena, which is released
+  // all at once when the analysis is destroyed.  It must be declared before accesses.
+  Arena access_arena;
+
   // A history of GPRs, flags and memory read
-  AccessMap accesses;
+  AccessMap accesses = AccessMap(AccessMap::allocator_type(&access_arena));
 
   // The input state representing the machine state at the beginning of the function.
   SymbolicStatePtr input_state;
@@ -230,6 +315,14 @@ class DUAnalysis {
   // The control flow graph is pretty important to this analysis.
   ControlFlowGraph cfg;
 
+  // The rank of each CFG vertex in flow order (indexed by vertex), and the worklist of pending
+  // blocks (by rank) used by loop_over_cfg().
+  std::vector<size_t> flow_rank;
+  BlockWorklist worklist;
+
+  // Counters describing the work done by loop_over_cfg().
+  FlowSolverStats flow_stats;
+
   // sets of tree nodes needed for analysis
   std::map<TreeNode*, TreeNodePtr> memory_accesses_;
 
@@ -252,6 +345,11 @@ class DUAnalysis {
   // // add properties to the boost graph for edge path conditions
   // void add_edge_conditions();
   LimitCode loop_over_cfg();
+  LimitCode sweep_over_cfg(const std::vector<CFGVertex>& flowlist);
+  LimitCode worklist_over_cfg(const std::vector<CFGVertex>& flowlist);
+  // Returns false if the block should not be processed (bad, or too many iterations).
+  bool prepare_block(BlockAnalysis& analysis);
+  void schedule_block(CFGVertex vertex);
   bool process_block_with_limit(CFGVertex vertex);
   SymbolicStatePtr merge_predecessors(CFGVertex vertex);
   SymbolicStatePtr merge_predecessors_with_conditions(CFGVertex vertex);
@@ -304,6 +402,10 @@ class DUAnalysis {
   const SymbolicStatePtr get_output_state() const { return output_state; }
 
   bool get_all_returns() const { return all_returns; }
+
+  const FlowSolverStats & get_flow_stats() const { return flow_stats; }
+  // Did the analysis run to completion, or was it stopped by a resource limit?
+  LimitCode get_status() const { return status; }
   bool get_output_valid() const { return output_valid; }
 
   const X86InsnSet & getJmps2UnpackedCode() const { return branchesToPackedSections; }
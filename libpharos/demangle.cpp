@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <algorithm>
@@ -18,6 +19,71 @@
 namespace demangle {
 namespace detail {
 
+// The nodes of each demangled tree are allocated together from an arena with
+// std::allocate_shared, rather than one at a time from the heap, since a tree typically has
+// dozens of small nodes.  Memory is never returned to the arena.  Instead, each node's
+// allocator shares ownership of the arena, so the arena is freed once the last node allocated
+// from it is destroyed.  Since only the demangler allocates from the arena, a finished tree
+// can be shared and released by any number of threads.
+class NodeArena {
+  // The first block is part of the arena, so most trees need only one allocation.
+  static constexpr size_t initial_block_size = 2048;
+  static constexpr size_t max_block_size = 16384;
+
+  alignas(std::max_align_t) char initial_block[initial_block_size];
+  std::vector<std::unique_ptr<char[]>> blocks;
+  size_t block_size = initial_block_size;
+  char * next = initial_block;
+  char * end = initial_block + initial_block_size;
+
+ public:
+  NodeArena() = default;
+  NodeArena(const NodeArena &) = delete;
+  NodeArena & operator=(const NodeArena &) = delete;
+
+  void * allocate(size_t bytes, size_t alignment) {
+    size_t pad = (alignment - reinterpret_cast<uintptr_t>(next) % alignment) % alignment;
+    if (size_t(end - next) < pad + bytes) {
+      block_size = std::min(2 * block_size, max_block_size);
+      size_t size = std::max(block_size, bytes + alignment);
+      blocks.emplace_back(new char[size]);
+      next = blocks.back().get();
+      end = next + size;
+      pad = (alignment - reinterpret_cast<uintptr_t>(next) % alignment) % alignment;
+    }
+    void * p = next + pad;
+    next += pad + bytes;
+    return p;
+  }
+};
+
+constexpr size_t NodeArena::initial_block_size;
+constexpr size_t NodeArena::max_block_size;
+
+template <typename T>
+class NodeAllocator {
+  template <typename U> friend class NodeAllocator;
+
+  std::shared_ptr<NodeArena> arena;
+
+ public:
+  using value_type = T;
+
+  NodeAllocator(std::shared_ptr<NodeArena> a) : arena(std::move(a)) {}
+  template <typename U>
+  NodeAllocator(const NodeAllocator<U> & other) : arena(other.arena) {}
+
+  T * allocate(size_t n) {
+    return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *, size_t) {}
+
+  template <typename U>
+  bool operator==(const NodeAllocator<U> & other) const { return arena == other.arena; }
+  template <typename U>
+  bool operator!=(const NodeAllocator<U> & other) const { return arena != other.arena; }
+};
+
 // An alias to make it easier to construct namespace types.
 class Namespace : public DemangledType {
  public:
@@ -38,6 +104,14 @@ class VisualStudioDemangler
   ReferenceStack name_stack;
   ReferenceStack type_stack;
 
+  // Allocates the nodes of the tree being built from a new arena.
+  NodeAllocator<DemangledType> allocator;
+
+  template <typename T, typename... Args>
+  std::shared_ptr<T> make(Args &&... args) {
+    return std::allocate_shared<T>(allocator, std::forward<Args>(args)...);
+  }
+
   char get_next_char();
   char get_current_char();
   void advance_to_next_char();
@@ -98,12 +172,143 @@ class VisualStudioDemangler
 
 } // namespace detail
 
-DemangledTypePtr visual_studio_demangle(const std::string & mangled, bool debug)
+DemangledTypePtr visual_studio_demangle_uncached(const std::string & mangled, bool debug)
 {
   detail::VisualStudioDemangler demangler(mangled, debug);
   return demangler.analyze();
 }
 
+DemangledTypePtr visual_studio_demangle(const std::string & mangled, bool debug)
+{
+  // Debugging output is produced while demangling, so don't skip it.
+  if (debug) {
+    return visual_studio_demangle_uncached(mangled, debug);
+  }
+  return DemangleCache::global().demangle(mangled);
+}
+
+std::vector<DemangledTypePtr> visual_studio_demangle_batch(
+  const std::vector<std::string> & mangled)
+{
+  return DemangleCache::global().demangle_batch(mangled);
+}
+
+DemangleCache::DemangleCache(size_t max_entries_) : max_entries(max_entries_) {}
+
+DemangleCache & DemangleCache::global()
+{
+  static DemangleCache cache;
+  return cache;
+}
+
+DemangleCache::Entry DemangleCache::make_entry(const std::string & mangled)
+{
+  Entry entry;
+  try {
+    entry.type = visual_studio_demangle_uncached(mangled);
+  }
+  catch (const Error & e) {
+    entry.error = e.what();
+  }
+  return entry;
+}
+
+void DemangleCache::insert(const std::string & mangled, Entry entry)
+{
+  if (entries.size() >= max_entries) {
+    entries.clear();
+  }
+  // If another thread demangled the same name first, keep its result.
+  entries.emplace(mangled, std::move(entry));
+}
+
+DemangledTypePtr DemangleCache::demangle(const std::string & mangled)
+{
+  {
+    pharos::read_guard<decltype(mutex)> guard{mutex};
+    auto found = entries.find(mangled);
+    if (found != entries.end()) {
+      ++hits;
+      if (!found->second.error.empty()) {
+        throw Error(found->second.error);
+      }
+      return found->second.type;
+    }
+  }
+
+  // Demangle without holding the lock, so that other threads can use the cache meanwhile.
+  ++misses;
+  Entry entry = make_entry(mangled);
+  DemangledTypePtr result = entry.type;
+  std::string error = entry.error;
+  {
+    pharos::write_guard<decltype(mutex)> guard{mutex};
+    insert(mangled, std::move(entry));
+  }
+  if (!error.empty()) {
+    throw Error(error);
+  }
+  return result;
+}
+
+std::vector<DemangledTypePtr> DemangleCache::demangle_batch(
+  const std::vector<std::string> & mangled)
+{
+  std::vector<DemangledTypePtr> results(mangled.size());
+
+  // The positions of each name that wasn't in the cache.
+  std::unordered_map<std::string, std::vector<size_t>> missing;
+  {
+    pharos::read_guard<decltype(mutex)> guard{mutex};
+    for (size_t i = 0; i < mangled.size(); ++i) {
+      auto found = entries.find(mangled[i]);
+      if (found != entries.end()) {
+        ++hits;
+        results[i] = found->second.type;
+      }
+      else {
+        missing[mangled[i]].push_back(i);
+      }
+    }
+  }
+  if (missing.empty()) {
+    return results;
+  }
+
+  std::vector<std::pair<std::string const *, Entry>> added;
+  added.reserve(missing.size());
+  for (auto & miss : missing) {
+    ++misses;
+    Entry entry = make_entry(miss.first);
+    for (size_t i : miss.second) {
+      results[i] = entry.type;
+    }
+    added.emplace_back(&miss.first, std::move(entry));
+  }
+
+  pharos::write_guard<decltype(mutex)> guard{mutex};
+  for (auto & add : added) {
+    insert(*add.first, std::move(add.second));
+  }
+  return results;
+}
+
+void DemangleCache::clear()
+{
+  pharos::write_guard<decltype(mutex)> guard{mutex};
+  entries.clear();
+}
+
+DemangleCache::Stats DemangleCache::get_stats() const
+{
+  Stats stats;
+  stats.hits = hits;
+  stats.misses = misses;
+  pharos::read_guard<decltype(mutex)> guard{mutex};
+  stats.entries = entries.size();
+  return stats;
+}
+
 std::string quote_string(const std::string & input)
 {
   static auto special_chars = "\"\\\a\b\f\n\r\t\v";
@@ -632,7 +837,7 @@ std::string DemangledTemplateParameter::str(bool match) const {
 namespace detail {
 
 VisualStudioDemangler::VisualStudioDemangler(const std::string & m, bool d)
-  : mangled(m), debug(d), offset(0)
+  : mangled(m), debug(d), offset(0), allocator(std::make_shared<NodeArena>())
 {}
 
 char VisualStudioDemangler::get_next_char()
@@ -827,7 +1032,7 @@ VisualStudioDemangler::get_pointer_type(DemangledTypePtr & t, bool push)
 
   progress("pointer storage class");
   // Const and volatile for the thing being pointed to (or referenced).
-  t->inner_type = std::make_shared<DemangledType>();
+  t->inner_type = make<DemangledType>();
   get_storage_class(t->inner_type);
 
   if (t->inner_type->is_member && !t->inner_type->is_based) {
@@ -857,14 +1062,14 @@ VisualStudioDemangler::get_pointer_type(DemangledTypePtr & t, bool push)
   }
 
   if (handling_cli_array) {
-    auto at = std::make_shared<DemangledType>();
-    at->name.push_back(std::make_shared<Namespace>("array"));
-    at->name.push_back(std::make_shared<Namespace>("cli"));
+    auto at = make<DemangledType>();
+    at->name.push_back(make<Namespace>("array"));
+    at->name.push_back(make<Namespace>("cli"));
     at->template_parameters.push_back(
-      std::make_shared<DemangledTemplateParameter>(t->inner_type));
+      make<DemangledTemplateParameter>(t->inner_type));
     if (handling_cli_array > 1) {
       at->template_parameters.push_back(
-        std::make_shared<DemangledTemplateParameter>(handling_cli_array));
+        make<DemangledTemplateParameter>(handling_cli_array));
     }
     t->inner_type = at;
     t->is_gc = true;
@@ -876,7 +1081,7 @@ VisualStudioDemangler::get_pointer_type(DemangledTypePtr & t, bool push)
 DemangledTypePtr & VisualStudioDemangler::get_real_enum_type(DemangledTypePtr & t) {
   char c = get_current_char();
   progress("enum real type");
-  auto & rt = t->enum_real_type = std::make_shared<DemangledType>();
+  auto & rt = t->enum_real_type = make<DemangledType>();
   switch(c) {
    case '0': update_simple_type(rt, "signed char"); break;
    case '1': update_simple_type(rt, "unsigned char"); break;
@@ -909,7 +1114,7 @@ DemangledTypePtr VisualStudioDemangler::get_array_type(DemangledTypePtr & t, boo
 // stack or not.  The default is true (push the value onto
 DemangledTypePtr VisualStudioDemangler::get_type(DemangledTypePtr t, bool push) {
   if (!t) {
-    t = std::make_shared<DemangledType>();
+    t = make<DemangledType>();
   }
 
   char c = get_current_char();
@@ -1048,8 +1253,8 @@ DemangledTypePtr VisualStudioDemangler::get_type(DemangledTypePtr t, bool push)
         return get_type(t, push);
        case 'T':
         advance_to_next_char();
-        t->name.push_back(std::make_shared<Namespace>("nullptr_t"));
-        t->name.push_back(std::make_shared<Namespace>("std"));
+        t->name.push_back(make<Namespace>("nullptr_t"));
+        t->name.push_back(make<Namespace>("std"));
         return t;
        case 'V':
        case 'Z':
@@ -1262,7 +1467,7 @@ DemangledTypePtr & VisualStudioDemangler::get_string(DemangledTypePtr & t) {
   }
 
   t->symbol_type = SymbolType::String;
-  t->inner_type = std::make_shared<DemangledType>();
+  t->inner_type = make<DemangledType>();
   t->inner_type->simple_type = multibyte ? "char16_t" : "char";
   t->simple_type = "`string'";
   t->n1 = multibyte ? (real_len / 2) : real_len;
@@ -1669,7 +1874,7 @@ DemangledTypePtr VisualStudioDemangler::resolve_reference(
   }
 
   // Even if our position was invalid kludge something up for debugging.
-  return std::make_shared<Namespace>(boost::str(boost::format("ref#%d") % stack_offset));
+  return make<Namespace>(boost::str(boost::format("ref#%d") % stack_offset));
 }
 
 DemangledTypePtr & VisualStudioDemangler::get_templated_function_arg(DemangledTypePtr & t)
@@ -1735,7 +1940,7 @@ DemangledTypePtr & VisualStudioDemangler::get_templated_type(DemangledTypePtr &
   }
   else {
     templated_type->simple_type = get_literal();
-    name_stack.emplace_back(std::make_shared<Namespace>(templated_type->simple_type));
+    name_stack.emplace_back(make<Namespace>(templated_type->simple_type));
   }
 
   // We also need a new type stack for the template parameters.
@@ -1750,18 +1955,18 @@ DemangledTypePtr & VisualStudioDemangler::get_templated_type(DemangledTypePtr &
        case '0':
         advance_to_next_char();
         progress("constant template parameter");
-        parameter = std::make_shared<DemangledTemplateParameter>(get_number());
+        parameter = make<DemangledTemplateParameter>(get_number());
         break;
        case '1':
         advance_to_next_char();
         progress("constant pointer template parameter");
-        parameter = std::make_shared<DemangledTemplateParameter>(get_symbol());
+        parameter = make<DemangledTemplateParameter>(get_symbol());
         parameter->pointer = true;
         break;
        case 'H':
         advance_to_next_char();
         progress("constant function pointer template parameter");
-        parameter = std::make_shared<DemangledTemplateParameter>(get_symbol());
+        parameter = make<DemangledTemplateParameter>(get_symbol());
         parameter->pointer = true;
         parameter->constant_value = get_number();
         break;
@@ -1780,7 +1985,7 @@ DemangledTypePtr & VisualStudioDemangler::get_templated_type(DemangledTypePtr &
           }
           offset = pos - 2;
           if (auto type = get_type()) {
-            parameter = std::make_shared<DemangledTemplateParameter>(std::move(type));
+            parameter = make<DemangledTemplateParameter>(std::move(type));
           }
         }
         break;
@@ -1789,7 +1994,7 @@ DemangledTypePtr & VisualStudioDemangler::get_templated_type(DemangledTypePtr &
       }
     }
     else {
-      parameter = std::make_shared<DemangledTemplateParameter>(get_type());
+      parameter = make<DemangledTemplateParameter>(get_type());
     }
 
     templated_type->template_parameters.push_back(std::move(parameter));
@@ -1819,7 +2024,7 @@ DemangledTypePtr & VisualStudioDemangler::get_fully_qualified_name(
     if (c == '?') {
       c = get_next_char();
       if (c == '$') {
-        auto tt = std::make_shared<DemangledType>();
+        auto tt = make<DemangledType>();
         get_templated_type(tt);
         t->name.push_back(tt);
         if (pushing) {
@@ -1833,7 +2038,7 @@ DemangledTypePtr & VisualStudioDemangler::get_fully_qualified_name(
         // that the parsing of the first term is definitely a different routine than the
         // namespace terms in a fully qualified name...   Perhaps some code cleanup is needed?
         if (first || get_current_char() == '?') {
-          auto tt = std::make_shared<DemangledType>();
+          auto tt = make<DemangledType>();
           tt = get_special_name_code(tt);
           if (tt->symbol_type != t->symbol_type) {
             return t = std::move(tt);
@@ -1853,7 +2058,7 @@ DemangledTypePtr & VisualStudioDemangler::get_fully_qualified_name(
             std::string numbered_namespace = boost::str(boost::format("`%d'") % number);
             if (debug) std::cout << "Found numbered namespace: "
                                  << numbered_namespace << std::endl;
-            auto nns = std::make_shared<Namespace>(numbered_namespace);
+            auto nns = make<Namespace>(numbered_namespace);
             t->name.push_back(std::move(nns));
           }
         }
@@ -1865,7 +2070,7 @@ DemangledTypePtr & VisualStudioDemangler::get_fully_qualified_name(
       advance_to_next_char();
     }
     else {
-      auto ns = std::make_shared<Namespace>(get_literal());
+      auto ns = make<Namespace>(get_literal());
       t->name.push_back(ns);
       name_stack.push_back(std::move(ns));
       stack_debug(name_stack, name_stack.size()-1, "name");
@@ -1920,7 +2125,7 @@ DemangledTypePtr VisualStudioDemangler::get_anonymous_namespace() {
   // Advance past the '@' that terminated the literal.
   advance_to_next_char();
 
-  auto ans = std::make_shared<Namespace>(literal);
+  auto ans = make<Namespace>(literal);
   ans->is_anonymous = true;
   return ans;
 }
@@ -2024,7 +2229,7 @@ int64_t VisualStudioDemangler::get_number() {
 DemangledTypePtr & VisualStudioDemangler::get_function(DemangledTypePtr & t) {
   // Storage class for methods
   if (t->is_func && t->is_member) {
-    auto tmp = std::make_shared<DemangledType>();
+    auto tmp = make<DemangledType>();
     get_storage_class_modifiers(tmp);
     get_storage_class(tmp);
     t->is_const = tmp->is_const;
@@ -2036,7 +2241,7 @@ DemangledTypePtr & VisualStudioDemangler::get_function(DemangledTypePtr & t) {
   // And then the remaining codes are the same for functions and methods.
   process_calling_convention(t);
   // Return code.  It's annoying that the modifiers come first and require us to allocate it.
-  t->retval = std::make_shared<DemangledType>();
+  t->retval = make<DemangledType>();
   get_return_type(t->retval);
   if (debug) std::cout << "Return value was: " << t->retval->str() << std::endl;
 
@@ -2081,7 +2286,7 @@ DemangledTypePtr & VisualStudioDemangler::get_function(DemangledTypePtr & t) {
 DemangledTypePtr VisualStudioDemangler::get_symbol() {
   get_symbol_start();
 
-  auto t = std::make_shared<DemangledType>();
+  auto t = make<DemangledType>();
   get_fully_qualified_name(t, false);
   if (t->symbol_type == SymbolType::Unspecified) {
     get_symbol_type(t);
@@ -2095,7 +2300,7 @@ DemangledTypePtr VisualStudioDemangler::get_symbol() {
       process_method_storage_class(t);
       // The interface name is optional.
       while (get_current_char() != '@') {
-        auto n = std::make_shared<DemangledType>();
+        auto n = make<DemangledType>();
         t->com_interface.push_back(get_fully_qualified_name(n, false));
       }
     }
@@ -2159,7 +2364,7 @@ DemangledTypePtr VisualStudioDemangler::analyze() {
   else if (c == '.') {
     advance_to_next_char();
     // Why there's a return type for RTTI descriptor is a little unclear to me...
-    auto t = std::make_shared<DemangledType>();
+    auto t = make<DemangledType>();
     get_return_type(t);
     return t;
   }
@@ -3,11 +3,15 @@
 #ifndef Pharos_Demangle_H
 #define Pharos_Demangle_H
 
+#include <atomic>
 #include <string>
 #include <stdexcept>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include "threads.hpp"
+
 namespace demangle {
 
 // Thrown for errors encountered while demangling names.
@@ -241,9 +245,62 @@ class DemangledType {
   }
 };
 
-// Main entry point to demangler
+// Main entry point to demangler.  Unless debugging, the results are cached (see DemangleCache),
+// so the same result may be returned to many callers, and it must not be modified.
 DemangledTypePtr visual_studio_demangle(const std::string & mangled, bool debug = false);
 
+// Demangle without consulting or updating the cache.
+DemangledTypePtr visual_studio_demangle_uncached(const std::string & mangled,
+                                                 bool debug = false);
+
+// Demangle many names at once, using the cache.  The result for a name that can't be demangled
+// is null.
+std::vector<DemangledTypePtr> visual_studio_demangle_batch(
+  const std::vector<std::string> & mangled);
+
+// A thread safe cache of the results of the Visual Studio demangler, keyed by the mangled name.
+// Programs typically demangle the same import and RTTI names many times.  Failures are cached
+// too, and rethrown as the same Error.  The cache is emptied whenever it reaches its maximum
+// size, which bounds its memory without the bookkeeping of a real replacement policy.
+class DemangleCache {
+ public:
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t entries = 0;
+  };
+
+  explicit DemangleCache(size_t max_entries = 16384);
+
+  DemangledTypePtr demangle(const std::string & mangled);
+  // The same as visual_studio_demangle_batch(), but using this cache.  The cache is only
+  // locked once to find the names, and once to add the new results.
+  std::vector<DemangledTypePtr> demangle_batch(const std::vector<std::string> & mangled);
+
+  void clear();
+  Stats get_stats() const;
+
+  // The cache used by visual_studio_demangle().
+  static DemangleCache & global();
+
+ private:
+  struct Entry {
+    DemangledTypePtr type;
+    // The error message if the name couldn't be demangled.
+    std::string error;
+  };
+
+  size_t max_entries;
+  mutable pharos::shared_mutex mutex;
+  std::unordered_map<std::string, Entry> entries;
+  std::atomic<size_t> hits{0};
+  std::atomic<size_t> misses{0};
+
+  static Entry make_entry(const std::string & mangled);
+  // Requires the mutex to be held exclusively.
+  void insert(const std::string & mangled, Entry entry);
+};
+
 } // namespace demangle
 
 
@@ -312,15 +312,15 @@ DescriptorSet::DescriptorSet(
     GINFO << "Using the standard ROSE function partitioner." << LEND;
   }
   else if (boost::iequals(*pname, "superset")) {
-    engine = P2EnginePtr(new SupersetEngine());
+    engine = P2EnginePtr(new SupersetEngine(get_concurrency_level(vm)));
     GINFO << "Using the Pharos superset disassembly algorithm." << LEND;
   }
   else if (boost::iequals(*pname, "pharos")) {
-    engine = P2EnginePtr(new CERTEngine());
+    engine = P2EnginePtr(new CERTEngine(get_concurrency_level(vm)));
     GINFO << "Using the default Pharos function partitioner." << LEND;
   }
   else {
-    engine = P2EnginePtr(new CERTEngine());
+    engine = P2EnginePtr(new CERTEngine(get_concurrency_level(vm)));
     OERROR << "The partitioner '" << *pname << "' is not recognized, "
            << "using the Pharos function partitioner." << LEND;
   }
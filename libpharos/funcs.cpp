@@ -23,6 +23,9 @@
 #include "method.hpp"
 #include "masm.hpp"
 #include "badcode.hpp"
+#include "summary.hpp"
+#include "profile.hpp"
+#include "md5.hpp"
 
 #include <boost/graph/iteration_macros.hpp>
 
@@ -310,6 +313,114 @@ void FunctionDescriptor::set_api(const APIDefinition& fdata) {
   }
 }
 
+FunctionSummary FunctionDescriptor::get_summary() const {
+  FunctionSummary summary;
+  RegisterDictionaryPtr regdict = ds.get_regdict();
+  auto convert = [&regdict](const ParameterDefinition & pd) {
+    FunctionSummary::Parameter p;
+    if (pd.is_reg()) {
+      p.reg = unparseX86Register(pd.get_register(), regdict);
+    }
+    else {
+      p.stack_delta = pd.get_stack_delta();
+    }
+    p.name = pd.get_name();
+    p.type = pd.get_type();
+    p.direction = pd.get_direction();
+    return p;
+  };
+
+  read_guard<decltype(mutex)> guard{mutex};
+  summary.stack_delta = stack_delta;
+  summary.stack_parameters = stack_parameters;
+  summary.never_returns = never_returns;
+  summary.returns_this_pointer = returns_this_pointer;
+  for (const CallingConvention* cc : calling_conventions) {
+    summary.conventions.push_back(cc->get_name());
+  }
+  for (const ParameterDefinition & pd : parameters.get_params()) {
+    summary.parameters.push_back(convert(pd));
+  }
+  for (const ParameterDefinition & pd : parameters.get_returns()) {
+    summary.returns.push_back(convert(pd));
+  }
+  return summary;
+}
+
+// Much like set_api(), except that the values come from a previous analysis of this function.
+// Like the API database, the summary contains no symbolic values or instructions.
+void FunctionDescriptor::set_summary(const FunctionSummary & summary) {
+  {
+    write_guard<decltype(pdg_mutex)> pdg_guard{pdg_mutex};
+    // If we've already done the real analysis, there's nothing to restore.
+    if (pdg) return;
+    summarized = true;
+  }
+
+  RegisterDictionaryPtr regdict = ds.get_regdict();
+  {
+    write_guard<decltype(mutex)> guard{mutex};
+    stack_delta = summary.stack_delta;
+    if (stack_delta.confidence == ConfidenceMissing && !stack_delta_variable) {
+      stack_delta_variable = SymbolicExpr::makeIntegerVariable(
+        ds.get_arch_bits(), "", UNKNOWN_STACK_DELTA);
+    }
+    else if (stack_delta.confidence != ConfidenceMissing) {
+      stack_delta_variable = LeafNodePtr();
+    }
+    stack_parameters = summary.stack_parameters;
+    never_returns = summary.never_returns;
+    returns_this_pointer = summary.returns_this_pointer;
+
+    const CallingConventionMatcher& matcher = ds.get_calling_conventions();
+    size_t arch_bits = ds.get_arch_bits();
+    calling_conventions.clear();
+    for (const std::string & name : summary.conventions) {
+      const CallingConvention* cc = matcher.find(arch_bits, name);
+      if (cc) {
+        calling_conventions.push_back(cc);
+      }
+      else {
+        GWARN << "Unrecognized " << arch_bits << "-bit calling convention: " << name
+              << " in cached summary for function " << _address_string() << LEND;
+      }
+    }
+    parameters.set_calling_convention(
+      calling_conventions.empty() ? nullptr : *(calling_conventions.begin()));
+
+    for (const FunctionSummary::Parameter & p : summary.parameters) {
+      ParameterDefinition* pd;
+      if (p.reg.empty()) {
+        pd = parameters.create_stack_parameter(p.stack_delta);
+        if (pd == nullptr) continue;
+      }
+      else {
+        RegisterDescriptor rd = regdict->find(p.reg);
+        if (!rd.is_valid()) continue;
+        pd = &parameters.create_reg_parameter(
+          rd, SymbolicValuePtr(), nullptr, SymbolicValuePtr());
+      }
+      pd->set_parameter_description(
+        p.name, p.type, static_cast<ParameterDefinition::DirectionEnum>(p.direction));
+    }
+    for (const FunctionSummary::Parameter & p : summary.returns) {
+      RegisterDescriptor rd = regdict->find(p.reg);
+      if (!rd.is_valid()) continue;
+      ParameterDefinition & pd = parameters.create_return_reg(rd, SymbolicValuePtr());
+      pd.set_parameter_description(
+        p.name, p.type, static_cast<ParameterDefinition::DirectionEnum>(p.direction));
+    }
+  }
+
+  // Update the thunks that jump to us with our stack parameters, as update_stack_parameters()
+  // would have.
+  if (!is_thunk()) {
+    for (FunctionDescriptor *thunkfd : get_thunks()) {
+      thunkfd->set_stack_parameters(summary.stack_parameters);
+    }
+  }
+}
+
 void FunctionDescriptor::merge(const FunctionDescriptor *other) {
   if (this == other) return;
   write_guard<decltype(mutex)> guard{mutex};
@@ -944,11 +1055,23 @@ const PDG * FunctionDescriptor::_get_pdg() {
     return nullptr;
   }
 
+  // If the results were restored from a summary, discard them in favor of the real analysis.
+  if (summarized) {
+    write_guard<decltype(mutex)> guard{mutex};
+    calling_conventions.clear();
+    ParameterList empty;
+    parameters = empty;
+    summarized = false;
+  }
+
   // Set our stack delta analysis failures to zero, and reset the stack tracker.
   stack_analysis_failures = 0;
   GDEBUG << "Computing PDG for function " << _address_string() << LEND;
 
-  pdg = make_unique<PDG>(ds, *this);
+  {
+    ProfileTimer pdg_timer{address, ProfilePhase::PDG};
+    pdg = make_unique<PDG>(ds, *this);
+  }
   assert(pdg);
 
   // How many stack delta analysis failures did we have?
@@ -970,6 +1093,8 @@ const PDG * FunctionDescriptor::_get_pdg() {
     _propagate_thunk_info();
   }
   else {
+    ProfileTimer convention_timer{address, ProfilePhase::Convention};
+
     // Analyze our calling convention.  Must be AFTER we've marked the PDG as cached, because
     // analyzing the calling convention will attempt to recurse into get_pdg().
     register_usage.analyze(this);
@@ -1027,6 +1152,7 @@ std::string FunctionDescriptor::get_pdg_hash(unsigned int num_hash_funcs) {
   if (pdg_hash.size() != 0) return pdg_hash;
   const PDG* p = get_pdg();
   if (p == NULL) return "";
+  ProfileTimer hash_timer{get_address(), ProfilePhase::PDGHash};
   pdg_hash = p->getWeightedMaxHash(num_hash_funcs);
   return pdg_hash;
 }
@@ -1121,16 +1247,33 @@ void FunctionDescriptor::_compute_function_hashes(ExtraFunctionHashData *extra)
 
   std::vector< rose_addr_t > bbaddrs;
 
+  // The hashes of the basic blocks are computed together once all of the blocks have been
+  // visited (see MD5Batch), so just record where the bytes of each block are.  The PIC bytes
+  // of a block are a range of pic_bytes, and the CPIC bytes a range of cpic_bytes.
+  struct BlockHashInput {
+    SgAsmBlock *bb;
+    size_t pic_start, pic_end;
+    size_t cpic_start, cpic_end;
+    std::vector< std::string > mnemonics;
+    std::vector< std::string > mnemcats;
+  };
+  std::vector< BlockHashInput > bbinputs;
+  bbinputs.reserve(num_blocks_in_cfg);
+  std::string cpic_bytes; // CPIC bytes (no control flow insns) of every block
+
   // iterate over all basic blocks in the function:
   for (size_t x = 0; x < num_blocks_in_cfg; x++) {
     SgAsmBlock *bb = get(boost::vertex_name, cfg, cfgblocks[x]);
     P2::BasicBlock::Ptr block = ds.get_block(bb->get_address());
     assert(block != NULL);
 
-    std::string bbcpicbytes; // CPIC bytes (no control flow insns)
-    std::string bbpicbytes; // PIC bytes (control flow insns included)
-    std::vector< std::string > bbmnemonics;
-    std::vector< std::string > bbmnemcats;
+    bbinputs.emplace_back();
+    BlockHashInput & bbinput = bbinputs.back();
+    bbinput.bb = bb;
+    bbinput.pic_start = pic_bytes.size();
+    bbinput.cpic_start = cpic_bytes.size();
+    std::vector< std::string > & bbmnemonics = bbinput.mnemonics;
+    std::vector< std::string > & bbmnemcats = bbinput.mnemcats;
 
     dbg_disasm << "\t; --- bb start ---" << std::endl; // show start of basic block
     // Iterate over the instructions in the basic block:
@@ -1324,17 +1467,54 @@ void FunctionDescriptor::_compute_function_hashes(ExtraFunctionHashData *extra)
       // by the hashes of the basic blocks sorted & concatenated, then that value hashed.
       if (!insn_is_control_flow(insn))
       {
-        bbcpicbytes.insert(bbcpicbytes.end(),bytes.begin(), bytes.end());
+        cpic_bytes.insert(cpic_bytes.end(),bytes.begin(), bytes.end());
       }
-      bbpicbytes.insert(bbpicbytes.end(),bytes.begin(), bytes.end());
       //SDEBUG << dbg_disasm.str() << LEND;
       SINFO << dbg_disasm.str() << LEND;
       dbg_disasm.clear();
       dbg_disasm.str("");
     }
-    // bb insns done, calc (c)pic hash(es) for block
-    std::string bbcpic = get_string_md5(bbcpicbytes).str();
-    std::string bbpic = get_string_md5(bbpicbytes).str();
+    // bb insns done, the (c)pic hash(es) for the block are calculated below
+    bbinput.pic_end = pic_bytes.size();
+    bbinput.cpic_end = cpic_bytes.size();
+  }
+
+  // bbs all processed, hash every block and the function's bytes in one batch.  The byte
+  // strings aren't modified after this point, so the batch can refer to them directly.
+  MD5Batch batch;
+  size_t exact_index = batch.add(exact_bytes);
+  size_t pic_index = batch.add(pic_bytes);
+  std::vector< std::pair< size_t, size_t > > bbindexes;
+  bbindexes.reserve(bbinputs.size());
+  for (const BlockHashInput & bbinput : bbinputs) {
+    size_t bbpic_index = batch.add(pic_bytes.data() + bbinput.pic_start,
+                                   bbinput.pic_end - bbinput.pic_start);
+    size_t bbcpic_index = batch.add(cpic_bytes.data() + bbinput.cpic_start,
+                                    bbinput.cpic_end - bbinput.cpic_start);
+    bbindexes.emplace_back(bbpic_index, bbcpic_index);
+  }
+  std::string mnemonic_counts_str;
+  std::string mnemonic_category_counts_str;
+  size_t mnemonic_index = 0, mnemcat_index = 0, mnemonic_count_index = 0,
+         mnemcat_count_index = 0;
+  if (extra) {
+    for (auto const& mnemcount: extra->mnemonic_counts) {
+      mnemonic_counts_str += mnemcount.first + std::to_string(mnemcount.second);
+    }
+    for (auto const& mnemcatcount: extra->mnemonic_category_counts) {
+      mnemonic_category_counts_str += mnemcatcount.first + std::to_string(mnemcatcount.second);
+    }
+    mnemonic_index = batch.add(extra->mnemonics);
+    mnemcat_index = batch.add(extra->mnemcats);
+    mnemonic_count_index = batch.add(mnemonic_counts_str);
+    mnemcat_count_index = batch.add(mnemonic_category_counts_str);
+  }
+  batch.compute();
+
+  for (size_t x = 0; x < bbinputs.size(); x++) {
+    SgAsmBlock *bb = bbinputs[x].bb;
+    std::string bbpic = batch.result(bbindexes[x].first).str();
+    std::string bbcpic = batch.result(bbindexes[x].second).str();
     SDEBUG << "basic block @" << addr_str(bb->get_address()) << " has pic hash " << bbpic
            << " and (c)pic hash " << bbcpic << LEND;
     bbcpics.insert(bbcpic); // used to calc fn cpic later
@@ -1343,17 +1523,17 @@ void FunctionDescriptor::_compute_function_hashes(ExtraFunctionHashData *extra)
       ExtraFunctionHashData::BasicBlockHashData bbdat;
       bbdat.pic = bbpic;
       bbdat.cpic = bbcpic;
-      bbdat.mnemonics = bbmnemonics;
-      bbdat.mnemonic_categories = bbmnemcats;
+      bbdat.mnemonics = std::move(bbinputs[x].mnemonics);
+      bbdat.mnemonic_categories = std::move(bbinputs[x].mnemcats);
       // we only do this once per bb, so it's not in the map yet:
-      extra->basic_block_hash_data[bb->get_address()] = bbdat;
+      extra->basic_block_hash_data[bb->get_address()] = std::move(bbdat);
       //extra->basic_block_hash_data.insert(std::pair< rose_addr_t, ExtraFunctionHashData::BasicBlockHashData > (bb->get_address(),bbdat));
     }
   }
 
-  // bbs all processed, calc fn hashes
-  exact_hash = get_string_md5(exact_bytes).str();
-  pic_hash = get_string_md5(pic_bytes).str();
+  // calc fn hashes
+  exact_hash = batch.result(exact_index).str();
+  pic_hash = batch.result(pic_index).str();
   std::string bbcpicsconcat;
   for (auto const& bbcpic: bbcpics) {
     bbcpicsconcat += bbcpic;
@@ -1363,18 +1543,10 @@ void FunctionDescriptor::_compute_function_hashes(ExtraFunctionHashData *extra)
 
   if (extra) {
     GTRACE << "calculating 'extra' hashes" << LEND;
-    extra->mnemonic_hash = get_string_md5(extra->mnemonics).str();
-    extra->mnemonic_category_hash = get_string_md5(extra->mnemcats).str();
-    std::string mnemonic_counts_str;
-    for (auto const& mnemcount: extra->mnemonic_counts) {
-      mnemonic_counts_str += mnemcount.first + std::to_string(mnemcount.second);
-    }
-    extra->mnemonic_count_hash = get_string_md5(mnemonic_counts_str).str();
-    std::string mnemonic_category_counts_str;
-    for (auto const& mnemcatcount: extra->mnemonic_category_counts) {
-      mnemonic_category_counts_str += mnemcatcount.first + std::to_string(mnemcatcount.second);
-    }
-    extra->mnemonic_category_count_hash = get_string_md5(mnemonic_category_counts_str).str();
+    extra->mnemonic_hash = batch.result(mnemonic_index).str();
+    extra->mnemonic_category_hash = batch.result(mnemcat_index).str();
+    extra->mnemonic_count_hash = batch.result(mnemonic_count_index).str();
+    extra->mnemonic_category_count_hash = batch.result(mnemcat_count_index).str();
     // add bb stuff here too
     extra->basic_block_addrs = bbaddrs;
     // iterate over CFG to get edge data:
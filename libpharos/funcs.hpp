@@ -49,6 +49,8 @@ using CallDescriptorSet = std::set<CallDescriptor*, CallDescriptorCompare>;
 class ImportDescriptor;
 
 class PDG;
+// The summary of the function analysis stored in the function cache.
+struct FunctionSummary;
 
 } // namespace pharos
 
@@ -160,6 +162,9 @@ class FunctionDescriptor : private Immobile {
 
   std::unique_ptr<PDG> pdg;
 
+  // Were the results of the PDG analysis restored from a FunctionSummary rather than computed?
+  bool summarized = false;
+
   // How many failure occured during stack delta analysis?  This value is obtained from
   // recent_failures in the stack tracker on a per function basis.
   size_t stack_analysis_failures;
@@ -437,6 +442,21 @@ class FunctionDescriptor : private Immobile {
   // return the computed PDG for this function
   const PDG * get_pdg() const;
   void free_pdg();
+  // Has the PDG been computed (and not freed)?
+  bool has_pdg() const {
+    write_guard<decltype(pdg_mutex)> guard{pdg_mutex};
+    return bool(pdg);
+  }
+
+  // Get the results of the PDG analysis that are visible to other functions.
+  FunctionSummary get_summary() const;
+  // Restore the results of a previous PDG analysis instead of computing them.  If the PDG is
+  // requested later, it will be computed and the summarized results will be replaced.
+  void set_summary(const FunctionSummary & summary);
+  bool is_summarized() const {
+    write_guard<decltype(pdg_mutex)> guard{pdg_mutex};
+    return summarized;
+  }
 
   // Get the number of stack delta analysis failures.
   size_t get_stack_analysis_failures() const {
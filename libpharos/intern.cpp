@@ -0,0 +1,136 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <memory>
+
+#include "intern.hpp"
+#include "options.hpp"
+
+namespace pharos {
+
+// Are two expressions interchangeable?  Structural equivalence alone isn't sufficient, because
+// the comment and flags are part of how the rest of the system interprets an expression.
+static bool interchangeable(const TreeNodePtr & a, const TreeNodePtr & b) {
+  return (a->nBits() == b->nBits() && a->flags() == b->flags()
+          && a->comment() == b->comment() && a->isEquivalentTo(b));
+}
+
+TreeNodePtr ExpressionInterner::intern(const TreeNodePtr & expr) {
+  if (!expr) return expr;
+  // The data attached to an expression belongs to the analysis that attached it, so it can't
+  // be shared.
+  if (!expr->userData().empty()) return expr;
+
+  ++lookups;
+  uint64_t hash = expr->hash();
+  Shard & shard = shards[hash % num_shards];
+
+  write_guard<decltype(shard.mutex)> guard{shard.mutex};
+  auto range = shard.table.equal_range(hash);
+  for (auto i = range.first; i != range.second; ++i) {
+    const TreeNodePtr & existing = i->second;
+    if (existing == expr) {
+      ++hits;
+      return existing;
+    }
+    if (interchangeable(existing, expr)) {
+      ++hits;
+      nodes_saved += expr->nNodes();
+      return existing;
+    }
+  }
+
+  shard.table.emplace(hash, expr);
+  if (shard.table.size() >= shard.purge_size) {
+    purge(shard);
+    shard.purge_size = shard.table.size() + purge_growth;
+  }
+  return expr;
+}
+
+bool ExpressionInterner::contains(const TreeNodePtr & expr) const {
+  if (!expr) return false;
+
+  uint64_t hash = expr->hash();
+  const Shard & shard = shards[hash % num_shards];
+
+  write_guard<decltype(shard.mutex)> guard{shard.mutex};
+  auto range = shard.table.equal_range(hash);
+  for (auto i = range.first; i != range.second; ++i) {
+    if (i->second == expr) return true;
+  }
+  return false;
+}
+
+size_t ExpressionInterner::purge(Shard & shard) {
+  size_t count = 0;
+  for (auto i = shard.table.begin(); i != shard.table.end();) {
+    // If the table holds the only reference, nobody can be comparing against this expression.
+    if (ownershipCount(i->second) == 1) {
+      i = shard.table.erase(i);
+      ++count;
+    }
+    else {
+      ++i;
+    }
+  }
+  purged += count;
+  return count;
+}
+
+void ExpressionInterner::purge() {
+  for (Shard & shard : shards) {
+    write_guard<decltype(shard.mutex)> guard{shard.mutex};
+    purge(shard);
+    shard.purge_size = shard.table.size() + purge_growth;
+  }
+}
+
+ExpressionInterner::Stats ExpressionInterner::get_stats() const {
+  Stats stats;
+  stats.lookups = lookups;
+  stats.hits = hits;
+  stats.nodes_saved = nodes_saved;
+  stats.purged = purged;
+  for (const Shard & shard : shards) {
+    write_guard<decltype(shard.mutex)> guard{shard.mutex};
+    stats.entries += shard.table.size();
+  }
+  return stats;
+}
+
+namespace {
+std::unique_ptr<ExpressionInterner> global_interner;
+}
+
+void set_global_interner(const ProgOptVarMap& vm)
+{
+  if (vm.count("intern-expressions")) {
+    global_interner.reset(new ExpressionInterner());
+  }
+  else {
+    global_interner.reset();
+  }
+}
+
+ExpressionInterner * get_global_interner()
+{
+  return global_interner.get();
+}
+
+void report_interner_stats()
+{
+  if (!global_interner) return;
+  ExpressionInterner::Stats stats = global_interner->get_stats();
+  GINFO << "Expression interning: " << stats.lookups << " lookups, " << stats.hits
+        << " hits (" << (stats.hit_rate() * 100.0) << "%), " << stats.nodes_saved
+        << " duplicate tree nodes released, " << stats.entries << " entries held, "
+        << stats.purged << " entries purged." << LEND;
+}
+
+} // namespace pharos
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
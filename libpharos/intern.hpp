@@ -0,0 +1,125 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#ifndef Pharos_Intern_H
+#define Pharos_Intern_H
+
+// This header provides an optional hash-consing (interning) table for the symbolic expressions
+// created during emulation.  When the table is enabled, the SymbolicRiscOperators replace each
+// expression that they store in a register or memory cell with the one canonical instance of
+// that expression.  Equal expressions then share a single TreeNode, which allows the equality
+// and ordering tests used while comparing states (operator== on SymbolicValue, and
+// TreeNodePtrCompare) to succeed on a pointer comparison instead of walking both trees.
+//
+// Expressions are only ever shared when they are structurally equivalent and have the same
+// width, flags and comment, so interning never changes the value of an expression.  Interned
+// expressions are shared by every function and thread, so they must be treated as immutable.
+// In particular, nothing may attach userData() to them, since the data would leak into the
+// analysis of every other function using the expression, and writing it would race with the
+// other threads.  Expressions that already carry userData() are never interned, and
+// fetch_type_descriptor() doesn't attach type descriptors to interned expressions.  Type
+// analysis also identifies each value by its treenode, which interning would merge, so the
+// TypeSolver refuses to run when interning is enabled.
+//
+// The table is shared by every thread, and is divided into independently locked shards so
+// that the BottomUpAnalyzer worker threads rarely contend with each other.
+
+#include <array>
+#include <atomic>
+#include <unordered_map>
+
+#include "misc.hpp"
+#include "threads.hpp"
+
+namespace pharos {
+
+class ProgOptVarMap;
+
+class ExpressionInterner {
+ public:
+  // Counters describing how effective interning has been.
+  struct Stats {
+    // The number of expressions looked up in the table.
+    uint64_t lookups = 0;
+    // The number of lookups that found an existing equal expression.
+    uint64_t hits = 0;
+    // The number of tree nodes in the duplicate expressions that were replaced by existing
+    // expressions.  This is an upper bound on the nodes freed, since some of the subtrees of
+    // the duplicates might have been shared with other expressions.
+    uint64_t nodes_saved = 0;
+    // The number of expressions currently held by the table.
+    uint64_t entries = 0;
+    // The number of expressions dropped from the table because nothing else referenced them.
+    uint64_t purged = 0;
+
+    double hit_rate() const { return lookups ? double(hits) / double(lookups) : 0.0; }
+  };
+
+  ExpressionInterner() = default;
+  ExpressionInterner(const ExpressionInterner &) = delete;
+  ExpressionInterner & operator=(const ExpressionInterner &) = delete;
+
+  // Return the canonical instance of the expression, adding it to the table if there isn't
+  // one.  A null expression is returned unchanged.
+  TreeNodePtr intern(const TreeNodePtr & expr);
+
+  // Is this node (and not merely an equal expression) the canonical instance in the table?
+  bool contains(const TreeNodePtr & expr) const;
+
+  // Drop every expression that is referenced only by the table.
+  void purge();
+
+  Stats get_stats() const;
+
+ private:
+  static constexpr size_t num_shards = 64;
+  // A shard is purged whenever it has grown by this many entries since the last purge.
+  static constexpr size_t purge_growth = 1 << 16;
+
+  using Table = std::unordered_multimap<uint64_t, TreeNodePtr>;
+
+  struct Shard {
+    mutable std_mutex mutex;
+    Table table;
+    size_t purge_size = purge_growth;
+  };
+
+  // Remove unreferenced entries from a shard.  The shard must be locked.
+  size_t purge(Shard & shard);
+
+  std::array<Shard, num_shards> shards;
+
+  std::atomic<uint64_t> lookups{0};
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> nodes_saved{0};
+  std::atomic<uint64_t> purged{0};
+};
+
+// Create (or not, depending on --intern-expressions) the global expression interning table.
+void set_global_interner(const ProgOptVarMap& vm);
+
+// The global expression interning table, or null if interning is disabled.
+ExpressionInterner * get_global_interner();
+
+// Intern an expression in the global table if it is enabled.
+inline TreeNodePtr intern_expression(const TreeNodePtr & expr) {
+  ExpressionInterner * interner = get_global_interner();
+  return interner ? interner->intern(expr) : expr;
+}
+
+// Is the expression shared through the global interning table?
+inline bool is_interned_expression(const TreeNodePtr & expr) {
+  ExpressionInterner * interner = get_global_interner();
+  return interner && interner->contains(expr);
+}
+
+// Log the statistics for the global interning table (if enabled).
+void report_interner_stats();
+
+} // namespace pharos
+
+#endif
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
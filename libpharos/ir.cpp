@@ -5,6 +5,7 @@
 #include "masm.hpp"
 #include "descriptors.hpp"
 #include "graph.hpp"
+#include "profile.hpp"
 
 #include <Rose/BinaryAnalysis/Partitioner2/DataBlock.h>
 
@@ -20,6 +21,7 @@
 #include <boost/graph/copy.hpp>
 #include <boost/property_map/property_map.hpp>
 
+#include <chrono>
 #include <limits>
 
 using namespace pharos;
@@ -92,7 +94,7 @@ namespace pharos {
 namespace ir {
 
 std::set<Register> get_all_registers (const IR &ir) {
-  auto cfg = ir.get_cfg ();
+  const IRCFG & cfg = ir.get_cfg ();
   auto ir_map = boost::get (boost::vertex_ir_t (), cfg);
   std::set<Register> regs;
 
@@ -104,11 +106,8 @@ std::set<Register> get_all_registers (const IR &ir) {
   return regs;
 }
 
-IR init_stackpointer (const IR& ir_) {
-  IR ir = ir_;
-  IRCFG cfg = ir.get_cfg ();
+void init_stackpointer_in_place (IR& ir) {
   IRCFGVertex entry = ir.get_entry ();
-  auto stmts = boost::get (boost::vertex_ir_t (), cfg, entry);
   auto sp = ir.get_reg (ir.get_ds ()->get_arch_reg ("esp"));
 
   // Write a constant value to the stack pointer
@@ -128,10 +127,13 @@ IR init_stackpointer (const IR& ir_) {
   auto stmt = RegWriteStmt (sp, SymbolicExpr::makeIntegerConstant (sp->nBits (), constant));
 
   // Prepend stmt to the entry block
-  stmts->insert (stmts->begin (), stmt);
-
-  boost::put (boost::vertex_ir_t (), cfg, entry, stmts);
+  Stmts & stmts = ir.get_mutable_stmts (entry);
+  stmts.insert (stmts.begin (), stmt);
+}
 
+IR init_stackpointer (const IR& ir_) {
+  IR ir = ir_;
+  init_stackpointer_in_place (ir);
   return ir;
 }
 }
@@ -166,9 +168,8 @@ IRExprPtr rm_undefined_in_exp (const IRExprPtr &e) {
 
 namespace pharos {
 namespace ir {
-IR rm_undefined (const IR& ir_) {
-  IR ir = ir_;
-  IRCFG cfg = ir.get_cfg ();
+void rm_undefined_in_place (IR& ir) {
+  IRCFG & cfg = ir.get_mutable_cfg ();
   auto ir_map = boost::get (boost::vertex_ir_t (), cfg);
 
   struct StmtVisitor : public boost::static_visitor<Stmt> {
@@ -202,25 +203,37 @@ IR rm_undefined (const IR& ir_) {
     }
   };
 
+  // Statement lists that are shared by several vertices (e.g. in multiple inlined copies of a
+  // function) are only rewritten once, and remain shared.
+  std::map<const Stmts *, StmtsPtr> rewritten;
+
   BGL_FORALL_VERTICES (v, cfg, IRCFG) {
-    auto stmts = ir_map [v];
-    std::transform (stmts->begin (),
-                    stmts->end (),
-                    stmts->begin (),
+    const Stmts * orig = ir_map [v].get ();
+    auto done = rewritten.find (orig);
+    if (done != rewritten.end ()) {
+      ir_map [v] = done->second;
+      continue;
+    }
+    Stmts & stmts = ir.get_mutable_stmts (v);
+    std::transform (stmts.begin (),
+                    stmts.end (),
+                    stmts.begin (),
                     [] (Stmt &stmt) {
                       return boost::apply_visitor (StmtVisitor (), stmt);
                     });
+    rewritten.emplace (orig, ir_map [v]);
   }
+}
 
+IR rm_undefined (const IR& ir_) {
+  IR ir = ir_;
+  rm_undefined_in_place (ir);
   return ir;
-
 }
 
-IR add_datablocks (const IR& ir_) {
-  IR ir = ir_;
-  IRCFG cfg = ir.get_cfg ();
+void add_datablocks_in_place (IR& ir) {
+  const IRCFG & cfg = ir.get_cfg ();
   auto name_map = boost::get (boost::vertex_name_t (), cfg);
-  auto ir_map = boost::get (boost::vertex_ir_t (), cfg);
 
   std::set<BasicBlockPtr> basicblocks;
   std::set <DataBlockPtr> datablocks;
@@ -306,11 +319,14 @@ IR add_datablocks (const IR& ir_) {
     });
 
   // Prepend new statements to entry block
-  auto entryv = ir.get_entry ();
-  auto stmts = ir_map [entryv];
-  // Is this horribly inefficient?
-  stmts->insert (stmts->begin (), new_stmts.begin (), new_stmts.end ());
+  Stmts & stmts = ir.get_mutable_stmts (ir.get_entry ());
+  stmts.insert (stmts.begin (), std::make_move_iterator (new_stmts.begin ()),
+                std::make_move_iterator (new_stmts.end ()));
+}
 
+IR add_datablocks (const IR& ir_) {
+  IR ir = ir_;
+  add_datablocks_in_place (ir);
   return ir;
 }
 
@@ -1177,9 +1193,9 @@ Register IR::get_reg(RegisterDescriptor rd) const {
   return exp;
 }
 
-IR filter_backedges(const IR& ir) {
+void filter_backedges_in_place (IR& ir) {
 
-  IRCFG g = ir.get_cfg();
+  IRCFG & g = ir.get_mutable_cfg ();
 
   std::vector<IRCFGEdge> back_edges;
   depth_first_search (g,
@@ -1191,8 +1207,12 @@ IR filter_backedges(const IR& ir) {
   for (const IRCFGEdge &e : back_edges) {
     boost::remove_edge (e, g);
   }
+}
 
-  return IR(ir, g);
+IR filter_backedges(const IR& ir_) {
+  IR ir = ir_;
+  filter_backedges_in_place (ir);
+  return ir;
 }
 
 IR split_call_helper (const IR& ir, IRCFGVertex v) {
@@ -1268,8 +1288,8 @@ IR split_calls (const IR& ir_) {
   return ir;
 }
 
-IR split_edges(const IR& ir) {
-  IRCFG g = ir.get_cfg ();
+void split_edges_in_place (IR& ir) {
+  IRCFG & g = ir.get_mutable_cfg ();
   auto edgecond_map = boost::get (boost::edge_name_t (), g);
   auto ir_map = boost::get (boost::vertex_ir_t (), g);
 
@@ -1321,15 +1341,19 @@ IR split_edges(const IR& ir) {
     }
 
   }
+}
 
-  return IR(ir, g);
+IR split_edges(const IR& ir_) {
+  IR ir = ir_;
+  split_edges_in_place (ir);
+  return ir;
 }
 
-IR prune_unreachable (const IR& ir) {
+void prune_unreachable_in_place (IR& ir) {
 
-  auto cfg = ir.get_cfg ();
-  std::vector<int> d;
+  IRCFG & cfg = ir.get_mutable_cfg ();
   std::map<IRCFGVertex, int> m;
+  IRCFGVertex error = ir.get_error ();
 
   boost::dijkstra_shortest_paths (cfg,
                                   ir.get_entry (),
@@ -1339,7 +1363,7 @@ IR prune_unreachable (const IR& ir) {
   std::vector <boost::graph_traits<IRCFG>::vertex_descriptor> remove_these;
 
   BGL_FORALL_VERTICES (v, cfg, IRCFG) {
-    if (m[v] == std::numeric_limits<int>::max () && v != ir.get_error ()) {
+    if (m[v] == std::numeric_limits<int>::max () && v != error) {
       // unreachable
       remove_these.push_back (v);
     }
@@ -1355,13 +1379,16 @@ IR prune_unreachable (const IR& ir) {
     boost::clear_vertex (v, cfg);
     boost::remove_vertex (v, cfg);
   }
-
-  return IR(ir, cfg);
 }
 
-IR change_entry (const IR& ir_, rose_addr_t new_entry) {
+IR prune_unreachable (const IR& ir_) {
   IR ir = ir_;
-  IRCFG g = ir.get_cfg ();
+  prune_unreachable_in_place (ir);
+  return ir;
+}
+
+void change_entry_in_place (IR& ir, rose_addr_t new_entry) {
+  IRCFG & g = ir.get_mutable_cfg ();
   auto edgecond_map = boost::get (boost::edge_name_t (), g);
   auto ir_map = boost::get (boost::vertex_ir_t (), g);
   auto name_map = boost::get (boost::vertex_name_t (), g);
@@ -1369,7 +1396,7 @@ IR change_entry (const IR& ir_, rose_addr_t new_entry) {
   // First we find the new entry BB
   IRCFGVertex before_entry_v = ir.find_addr (new_entry);
   assert (before_entry_v != boost::graph_traits<IRCFG>::null_vertex ());
-  auto before_stmts = ir_map[before_entry_v];
+  const Stmts & entry_stmts = *ir_map[before_entry_v];
 
   // Now we split the entry BB into "before" and "after" BBs.  The
   // entry for the IR will go to the "after" BB.  But we still
@@ -1387,16 +1414,16 @@ IR change_entry (const IR& ir_, rose_addr_t new_entry) {
   // The entry for the function will then become the "after" BB.
 
   // Find the first statement corresponding to the "after" statements
-  auto it = boost::find_if (*before_stmts,
-                            [new_entry] (Stmt s) {
+  auto it = boost::find_if (entry_stmts,
+                            [new_entry] (const Stmt & s) {
                               auto addr = addrFromStmt (s);
                               return addr && *addr == new_entry;
                             });
-  assert (it != before_stmts->end ());
+  assert (it != entry_stmts.end ());
 
   IRCFGVertex after_entry_v;
 
-  if (it == before_stmts->begin ()) {
+  if (it == entry_stmts.begin ()) {
     // Hey, it's the first statement in the BB.  Great! We don't have to split anything.
     after_entry_v = before_entry_v;
   } else {
@@ -1404,13 +1431,14 @@ IR change_entry (const IR& ir_, rose_addr_t new_entry) {
     after_entry_v = boost::add_vertex (g);
     name_map[after_entry_v] = ir.get_ds ()->get_insn (new_entry);
 
-    // Make a copy of the after statements
-    StmtsPtr after_stmts (new Stmts (it,
-                                     before_stmts->end ()));
-    ir_map[after_entry_v] = after_stmts;
-
-    // And delete the after statements from before
-    before_stmts->erase (it, before_stmts->end ());
+    // Move the after statements out of the before statements (which are copied first if they
+    // are shared).
+    size_t split = it - entry_stmts.begin ();
+    Stmts & before_stmts = ir.get_mutable_stmts (before_entry_v);
+    auto after_begin = before_stmts.begin () + split;
+    ir_map[after_entry_v] = boost::make_shared<Stmts> (
+      std::make_move_iterator (after_begin), std::make_move_iterator (before_stmts.end ()));
+    before_stmts.erase (after_begin, before_stmts.end ());
 
     // Copy all of the outgoing edges from before_v to after_v
     auto out_edges = boost::out_edges (before_entry_v, g);
@@ -1445,14 +1473,40 @@ IR change_entry (const IR& ir_, rose_addr_t new_entry) {
   }
 
   // Set after_entry_v as the new entry node of the IR
-  ir = IR(ir, g, after_entry_v);
+  ir.set_entry (after_entry_v);
 
   // Finally, prune any unreachable nodes
-  ir = prune_unreachable (ir);
+  prune_unreachable_in_place (ir);
+}
 
+IR change_entry (const IR& ir_, rose_addr_t new_entry) {
+  IR ir = ir_;
+  change_entry_in_place (ir, new_entry);
   return ir;
 }
 
+IRPassManager & IRPassManager::add (std::string name, Pass pass) {
+  passes.push_back (std::move (pass));
+  times.emplace_back ();
+  times.back ().name = std::move (name);
+  return *this;
+}
+
+void IRPassManager::run (IR& ir) {
+  using clock = std::chrono::steady_clock;
+  for (size_t i = 0; i < passes.size (); ++i) {
+    PassTime & pt = times[i];
+    ProgramProfileTimer timer ("ir_" + pt.name);
+    auto start = clock::now ();
+    passes[i] (ir);
+    std::chrono::duration<double> wall = clock::now () - start;
+    pt.wall += wall.count ();
+    ++pt.runs;
+    GDEBUG << "IR pass " << pt.name << " took " << wall.count () << " seconds, leaving "
+           << boost::num_vertices (ir.get_cfg ()) << " vertices." << LEND;
+  }
+}
+
 
 // This is a helper function because it's also used in get_cg
 CGVertex findfd_cgg(const FunctionDescriptor* fd, const CGG& cgg) {
@@ -1603,17 +1657,17 @@ void cut1_cg(CG &cg, CGVertex srcv, UNUSED CGVertex dstv) {
 using SeenFuncs = ConstFunctionDescriptorSet;
 
 IR inline_cg (const CG& cg, const FunctionDescriptor* entryfd, SeenFuncs seen = {});
-IR inline_cg (const CG& cg, const CGVertex entryv, const IR& ir, SeenFuncs seen = {});
+void inline_cg_in_place (const CG& cg, const CGVertex entryv, IR& ir, SeenFuncs seen = {});
 
 
 // This function inlines all calls from the specific function
 // according to the provided call graph.
-IR inline_cg (const CG& cg, const CGVertex entryv, const IR& ir, SeenFuncs  seen) {
+void inline_cg_in_place (const CG& cg, const CGVertex entryv, IR& ir, SeenFuncs  seen) {
   const CGG& cgg = cg.get_graph ();
   CGVertex targetv;
 
   // Start from the entry node
-  IRCFG cfg = ir.get_cfg ();
+  IRCFG & cfg = ir.get_mutable_cfg ();
 
   auto ir_map = boost::get (boost::vertex_ir_t (), cfg);
   auto edgecond_map = boost::get (boost::edge_name_t (), cfg);
@@ -1625,10 +1679,12 @@ IR inline_cg (const CG& cg, const CGVertex entryv, const IR& ir, SeenFuncs  seen
   // there is, recurse on that function and then splice it in.
 
   BGL_FORALL_VERTICES (v, cfg, IRCFG) {
-    auto stmts = *ir_map [v];
+    // Hold a reference to the statements, since they're replaced when a call is removed.
+    StmtsPtr stmtsptr = ir_map [v];
+    const Stmts & stmts = *stmtsptr;
 
     boost::optional<rose_addr_t> last_addr;
-    for (Stmt stmt : stmts) {
+    for (const Stmt & stmt : stmts) {
       auto new_addr = addrFromStmt(stmt);
       if (new_addr) {
         last_addr = new_addr;
@@ -1656,9 +1712,7 @@ IR inline_cg (const CG& cg, const CGVertex entryv, const IR& ir, SeenFuncs  seen
 
         // Remove the Call Statement
         // Hopefully this is enough to not screw up iterating over stmts
-        Stmts new_stmts = stmts;
-        new_stmts.pop_back ();
-        ir_map [v] = boost::make_shared<Stmts> (new_stmts);
+        ir_map [v] = boost::make_shared<Stmts> (stmts.begin (), std::prev (stmts.end ()));
 
         boost::graph_traits<CGG>::out_edge_iterator cgobegin, cgoend;
         std::tie (cgobegin, cgoend) = boost::edge_range (entryv,
@@ -1724,7 +1778,7 @@ IR inline_cg (const CG& cg, const CGVertex entryv, const IR& ir, SeenFuncs  seen
 
           // Inline the callee
           const IR inlinee = inline_cg (cg, targetfd, seen);
-          const IRCFG inlinee_cfg = inlinee.get_cfg ();
+          const IRCFG & inlinee_cfg = inlinee.get_cfg ();
 
           boost::graph_traits<IRCFG>::vertex_iterator vi, viend;
           std::tie (vi, viend) = boost::vertices (inlinee_cfg);
@@ -1776,8 +1830,6 @@ IR inline_cg (const CG& cg, const CGVertex entryv, const IR& ir, SeenFuncs  seen
       }
     }
   }
-
-  return IR (ir, cfg);
 }
 
 // This is just a convenience wrapper for the main definition of inline_cg.
@@ -1785,7 +1837,8 @@ IR inline_cg (const CG& cg, const FunctionDescriptor* entryfd, SeenFuncs seen) {
   seen.insert (entryfd);
   CGVertex entryv = cg.findfd (entryfd);
   IR ir = IR::get_ir (entryfd);
-  return inline_cg (cg, entryv, ir, seen);
+  inline_cg_in_place (cg, entryv, ir, seen);
+  return ir;
 }
 
 IR get_inlined_cfg (const CG& cg_,
@@ -1803,11 +1856,12 @@ IR get_inlined_cfg (const CG& cg_,
   assert (tocgv != boost::graph_traits<CGG>::null_vertex ());
 
   IR fromir = IR::get_ir (fromfd);
-  fromir = change_entry (fromir, from);
+  change_entry_in_place (fromir, from);
 
   cutf (cg, fromcgv, tocgv);
 
-  return inline_cg (cg, fromcgv, fromir);
+  inline_cg_in_place (cg, fromcgv, fromir);
+  return fromir;
 }
 
 void CG::rebuild_indices (void) {
@@ -3,13 +3,16 @@
 #ifndef Pharos_Ir_H
 #define Pharos_Ir_H
 
+#include <functional>
 #include <map>
+#include <string>
 #include <vector>
 
 #include <boost/range/algorithm/copy.hpp>
 #include <boost/range/algorithm/find.hpp>
 #include <boost/range/algorithm/find_if.hpp>
 
+#include <boost/make_shared.hpp>
 #include <boost/optional.hpp>
 #include <boost/tuple/tuple_io.hpp>
 #include <boost/variant.hpp>
@@ -215,9 +218,7 @@ class IR {
  public:
 
   IR(IRCFG cfg_, const DescriptorSet* ds_, IRCFGVertex entry_, IRRegState rstate_, Register mem_, BaseSemantics::RiscOperatorsPtr rops_) :
-    ds(ds_), rstate(rstate_), mem(mem_), rops(rops_) {
-
-    cfg = cfg_;
+    cfg(std::move(cfg_)), ds(ds_), rstate(rstate_), mem(mem_), rops(rops_) {
 
     entry = *boost::get (boost::vertex_name_t (), cfg, entry_).get_insn ();
 
@@ -229,20 +230,45 @@ class IR {
 
   }
   // Update the CFG, and optionally the entry vertex
-  IR(const IR &ir, IRCFG cfg_, boost::optional<IRCFGVertex> new_entry_ = boost::none) : IR(ir) {
-    cfg = cfg_;
+  IR(const IR &ir, IRCFG cfg_, boost::optional<IRCFGVertex> new_entry_ = boost::none) :
+    cfg(std::move(cfg_)), ds(ir.ds), entry(ir.entry), rstate(ir.rstate), mem(ir.mem),
+    rops(ir.rops) {
     if (new_entry_) {
-      entry = *boost::get (boost::vertex_name_t (), cfg, *new_entry_).get_insn ();
+      set_entry (*new_entry_);
     }
   }
 
   // Return the IR for the specified function
   static IR get_ir (const FunctionDescriptor* fd);
 
-  IRCFG get_cfg(void) const {
+  const IRCFG & get_cfg(void) const {
     return cfg;
   }
 
+  // The CFG, for in-place transformations.  Copies of an IR share their statement lists, so
+  // statements should only be modified through get_mutable_stmts().
+  IRCFG & get_mutable_cfg(void) {
+    return cfg;
+  }
+
+  // The statements of a vertex, for in-place modification.  The statement list is copied
+  // first if it is shared with another vertex or another IR (copy-on-write).
+  Stmts & get_mutable_stmts(IRCFGVertex v) {
+    StmtsPtr & stmts = boost::get (boost::vertex_ir_t (), cfg)[v];
+    if (!stmts) {
+      stmts = boost::make_shared<Stmts> ();
+    }
+    else if (!stmts.unique ()) {
+      stmts = boost::make_shared<Stmts> (*stmts);
+    }
+    return *stmts;
+  }
+
+  // Change the entry vertex.
+  void set_entry(IRCFGVertex v) {
+    entry = *boost::get (boost::vertex_name_t (), cfg, v).get_insn ();
+  }
+
   IRCFGVertex get_entry(void) const {
     boost::graph_traits<IRCFG>::vertex_iterator vientry;
     auto rng = boost::vertices (cfg);
@@ -298,7 +324,7 @@ class IR {
 
   // Stream output
   friend std::ostream& operator<<(std::ostream &out, const IR &ir) {
-    auto tmpcfg = ir.get_cfg ();
+    const IRCFG & tmpcfg = ir.get_cfg ();
     boost::write_graphviz (out, tmpcfg,
                            boost::make_label_writer(boost::get(boost::vertex_ir_t(), tmpcfg)),
                            boost::make_label_writer(boost::get(boost::edge_name_t(), tmpcfg)));
@@ -347,6 +373,42 @@ IR rm_undefined (const IR& ir_);
 // memory at the IR entry point
 IR add_datablocks (const IR& ir_);
 
+// In-place versions of the transformations above.  The functions above copy the IR and then
+// call these.
+void filter_backedges_in_place (IR& ir);
+void split_edges_in_place (IR& ir);
+void prune_unreachable_in_place (IR& ir);
+void change_entry_in_place (IR& ir, rose_addr_t new_entry);
+void init_stackpointer_in_place (IR& ir);
+void rm_undefined_in_place (IR& ir);
+void add_datablocks_in_place (IR& ir);
+
+// Runs a pipeline of in-place transformations on an IR, recording the time taken by each pass
+// in the log (at debug level) and in the profile (with --profile).
+class IRPassManager {
+ public:
+  using Pass = std::function<void(IR& ir)>;
+
+  struct PassTime {
+    std::string name;
+    double wall = 0.0;
+    size_t runs = 0;
+  };
+
+  // Append a pass to the pipeline.
+  IRPassManager & add (std::string name, Pass pass);
+
+  // Run the pipeline on the IR.
+  void run (IR& ir);
+
+  // The total time taken by each pass, in pipeline order.
+  const std::vector<PassTime> & get_times () const { return times; }
+
+ private:
+  std::vector<Pass> passes;
+  std::vector<PassTime> times;
+};
+
 // This function returns a set of all registers used by the program.
 std::set<Register> get_all_registers (const IR& ir_);
 
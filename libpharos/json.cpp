@@ -48,6 +48,29 @@ NodeRef Simple::apply(Builder const & builder)
   return builder.null();
 }
 
+bool Simple::visit(Visitor & v) const
+{
+  switch(type) {
+   case INT:
+    return v.data_number(i);
+   case UINT:
+    return v.data_number(u);
+   case DOUBLE:
+    return v.data_number(d);
+   case BOOL:
+    return v.data_bool(b);
+   case NULLP:
+    return v.data_null();
+   case STRING:
+    return v.data_string(*s);
+   case CSTRING:
+    return c ? v.data_string(c) : v.data_null();
+   case STRINGRR:
+    return v.data_string(r);
+  }
+  return v.data_null();
+}
+
 namespace {
 // Return whether this is a valid utf-8 string.  If it is is, return 0.  If not, return -1.  If
 // it is valid, but truncated, return the number of bytes that need to be truncated to make the
@@ -236,13 +259,20 @@ class Writer : public Visitor {
     stream << ']';
     return true;
   }
-  bool data_value(Node const & n) override {
+  // Called around each element of an array or value of an object.
+  void begin_value() {
     if (!kv) {
       do_comma();
     }
-    auto rval = n.visit(*this);
+  }
+  void end_value() {
     kv = false;
     empty = false;
+  }
+  bool data_value(Node const & n) override {
+    begin_value();
+    auto rval = n.visit(*this);
+    end_value();
     return rval;
   }
   bool begin_object() override {
@@ -517,6 +547,84 @@ std::ostream & operator<<(std::ostream & stream, pretty const & p)
   return stream;
 }
 
+class StreamWriter::Impl {
+ public:
+  std::ostream & stream;
+  Writer writer;
+  bool pretty;
+  // The number of open containers.
+  unsigned depth = 0;
+
+  Impl(std::ostream & s) :
+    stream(s), writer(s, s.iword(indent_idx), s.iword(initial_indent_idx)),
+    pretty(s.iword(indent_idx)) {}
+
+  void begin_value() {
+    if (depth) {
+      writer.begin_value();
+    }
+  }
+  void end_value() {
+    if (depth) {
+      writer.end_value();
+    } else if (pretty) {
+      // Like operator<<, finish the document with a newline.
+      stream << '\n';
+    }
+  }
+};
+
+StreamWriter::StreamWriter(std::ostream & stream) : impl(make_unique<Impl>(stream)) {}
+
+StreamWriter::~StreamWriter() = default;
+
+void StreamWriter::begin_array()
+{
+  impl->begin_value();
+  impl->writer.begin_array();
+  ++impl->depth;
+}
+
+void StreamWriter::end_array()
+{
+  --impl->depth;
+  impl->writer.end_array();
+  impl->end_value();
+}
+
+void StreamWriter::begin_object()
+{
+  impl->begin_value();
+  impl->writer.begin_object();
+  ++impl->depth;
+}
+
+void StreamWriter::end_object()
+{
+  --impl->depth;
+  impl->writer.end_object();
+  impl->end_value();
+}
+
+void StreamWriter::key(std::string const & k)
+{
+  impl->writer.data_key(k);
+}
+
+void StreamWriter::value(Node const & n)
+{
+  impl->begin_value();
+  n.visit(impl->writer);
+  impl->end_value();
+}
+
+void StreamWriter::value(Simple && v)
+{
+  impl->begin_value();
+  v.visit(impl->writer);
+  impl->end_value();
+}
+
 BuilderRef simple_builder()
 {
   return make_unique<simple::Builder>();
@@ -109,6 +109,8 @@ class Simple {
   }
 
   NodeRef apply(Builder const & b);
+  // Visit the value directly, without making a node for it.
+  bool visit(Visitor & v) const;
 };
 
 // Workaround for g++ 5.4 bug
@@ -188,6 +190,41 @@ class pretty {
 };
 std::ostream & operator<<(std::ostream & stream, pretty const & p);
 
+// Writes JSON directly to a stream as the values are added, rather than building the entire
+// document as nodes and then writing it, so that the memory required to write a large document
+// doesn't grow with its size.  The output is formatted according to the json::pretty setting
+// of the stream when the StreamWriter is constructed, and is identical to the output of
+// operator<< for the same document, provided that the keys of each object are added in sorted
+// order (since Object sorts its keys).  A completed node can be written as a single value, so
+// the usual approach is to stream the outer containers of a document, and to build each of the
+// many small elements inside them as a node.
+class StreamWriter {
+ public:
+  explicit StreamWriter(std::ostream & stream);
+  StreamWriter(StreamWriter const &) = delete;
+  StreamWriter & operator=(StreamWriter const &) = delete;
+  ~StreamWriter();
+
+  void begin_array();
+  void end_array();
+  void begin_object();
+  void end_object();
+  // Set the key for the next value written in an object.
+  void key(std::string const & k);
+  void value(Node const & n);
+  void value(Simple && v);
+
+  template <typename T>
+  std::enable_if_t< !std::is_convertible<T, Node const &>::value>
+  value(T && x) {
+    value(Simple{std::forward<T>(x)});
+  }
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl;
+};
+
 BuilderRef simple_builder();
 
 } // namespace json
@@ -2,7 +2,10 @@
 
 #include <boost/format.hpp>
 
+#include <pthread.h>
+
 #include "limit.hpp"
+#include "memtrack.hpp"
 #include "misc.hpp"
 #include "descriptors.hpp"
 
@@ -40,6 +43,14 @@ inline void get_resource_usage(rusage& ru) {
   }
 }
 
+inline double cpu_clock_time(clockid_t clk) {
+  timespec ts;
+  if (clock_gettime(clk, &ts) != 0) {
+    return 0.0;
+  }
+  return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
 } // unnamed namespace
 
 // ResourceLimit class methods
@@ -56,6 +67,32 @@ ResourceLimit::ResourceLimit() {
     first_ts_set = true;
     first_ts = start_ts;
   }
+  // Use the clock of this thread (rather than CLOCK_THREAD_CPUTIME_ID) so that the limit
+  // measures the right thread even if it is checked from another one.
+  if (pthread_getcpuclockid(pthread_self(), &cpu_clock) != 0) {
+    cpu_clock = CLOCK_THREAD_CPUTIME_ID;
+  }
+  start_cpu = cpu_clock_time(cpu_clock);
+  track_allocations(AllocationTracker::current());
+}
+
+void ResourceLimit::track_allocations(const AllocationTracker * tracker_) {
+  tracker = AllocationTracker::is_enabled() ? tracker_ : nullptr;
+  start_bytes = tracker ? tracker->get_current_bytes() : 0;
+}
+
+double ResourceLimit::relative_cpu() const {
+  return cpu_clock_time(cpu_clock) - start_cpu;
+}
+
+double ResourceLimit::relative_memory(const rusage & now_ru) const {
+  if (tracker) {
+    size_t now_bytes = tracker->get_current_bytes();
+    return now_bytes > start_bytes ? (now_bytes - start_bytes) / (1024.0 * 1024.0) : 0.0;
+  }
+  long relative_memory_long = now_ru.ru_maxrss - start_ru.ru_maxrss;
+  // Convert from architecture dependent memory units to our API of mibibytes.
+  return relative_memory_long / MEM_FACTOR;
 }
 
 LimitCode ResourceLimit::check() {
@@ -97,9 +134,7 @@ LimitCode ResourceLimit::check() {
 
     // Check the relative memory limit if there is one.
     if (relative_memory_limit > 0) {
-      long relative_memory_long = now_ru.ru_maxrss - start_ru.ru_maxrss;
-      // Convert from architecture dependent memory units to our API of mibibytes.
-      double relative_memory_delta = relative_memory_long / MEM_FACTOR;
+      double relative_memory_delta = relative_memory(now_ru);
       if (relative_memory_delta >= relative_memory_limit) {
         msg = "relative memory exceeded";
         return LimitRelativeMemory;
@@ -118,9 +153,7 @@ LimitCode ResourceLimit::check() {
 
     // Check the relative CPU limit if there is one.
     if (relative_cpu_limit > 0) {
-      double total_now_cpu = total_cpu_time(now_ru);
-      double total_start_cpu = total_cpu_time(start_ru);
-      double relative_cpu_delta = total_now_cpu - total_start_cpu;
+      double relative_cpu_delta = relative_cpu();
       if (relative_cpu_delta >= relative_cpu_limit) {
         msg = "relative CPU time exceeded; adjust with --per-function-timeout";
         return LimitRelativeCPU;
@@ -147,19 +180,13 @@ ResourceLimit::duration ResourceLimit::get_relative_clock() const {
 }
 
 double ResourceLimit::get_relative_cpu() const {
-  rusage now_ru;
-  get_resource_usage(now_ru);
-  double total_now_cpu = total_cpu_time(now_ru);
-  double total_start_cpu = total_cpu_time(now_ru);
-  return (total_start_cpu - total_now_cpu);
+  return relative_cpu();
 }
 
 double ResourceLimit::get_relative_memory() const {
   rusage now_ru;
   get_resource_usage(now_ru);
-  long relative_memory_long = now_ru.ru_maxrss - start_ru.ru_maxrss;
-  // Convert from architecture dependent memory units to our API of mibibytes.
-  return (relative_memory_long / MEM_FACTOR);
+  return relative_memory(now_ru);
 }
 
 ResourceLimit::duration ResourceLimit::get_absolute_clock() const {
@@ -186,12 +213,8 @@ std::string ResourceLimit::get_relative_usage() const {
   get_resource_usage(now_ru);
 
   duration relative_clock_delta = now_ts - start_ts;
-  double total_now_cpu = total_cpu_time(now_ru);
-  double total_start_cpu = total_cpu_time(start_ru);
-  double relative_cpu_delta = total_start_cpu - total_now_cpu;
-  long relative_memory_long = now_ru.ru_maxrss - start_ru.ru_maxrss;
-  // Convert from architecture dependent memory units to our API of mibibytes.
-  double relative_memory_delta = relative_memory_long / MEM_FACTOR;
+  double relative_cpu_delta = relative_cpu();
+  double relative_memory_delta = relative_memory(now_ru);
 
   return boost::str(boost::format("%.2f secs CPU, %.2f MB memory, %.2f secs elapsed") %
                     relative_cpu_delta % relative_memory_delta % relative_clock_delta.count());
@@ -242,9 +265,10 @@ PharosLimits::PharosLimits(const ProgOptVarMap &vm)
   maxmem = vm.get<double>("maximum-memory", "pharos.maximum_memory");
   // The maxmimum memory allowed per function before moving on to the next function.
   relative_maxmem = vm.get<double>("per-function-maximum-memory", "pharos.per_function_maximum_memory");
-  if (DescriptorSet::get_concurrency_level(vm) > 1) {
-    // When running with threads, we really don't have a good way to calculate per-function
-    // memory usage
+  if (!AllocationTracker::is_enabled() && DescriptorSet::get_concurrency_level(vm) > 1) {
+    // Without allocation tracking, per-function memory usage is measured with the resident set
+    // size of the whole process, which is meaningless when several functions are analyzed at
+    // once.
     relative_maxmem = 0;
   }
 
@@ -331,6 +355,8 @@ std::unique_ptr<PharosLimits> global_limits;
 void set_global_limits(const ProgOptVarMap& vm)
 {
   global_limits.reset(new PharosLimits(vm));
+  // Checked whenever a symbolic value's expression is set, so it's cached in SymbolicValue.
+  SymbolicValue::set_node_limit(global_limits->node_condition_limit.value_or(0));
 }
 
 const PharosLimits& get_global_limits()
@@ -19,8 +19,16 @@
 // ObjDigger would be able to complete object analysis with whatever
 // functions had already been analyzed without triggering the second
 // limit.
+//
+// The relative (per-function) limits are measured for the thread that created the limit, so
+// that they still work when several functions are analyzed at once.  Relative CPU time is the
+// CPU time of that thread.  Relative memory is the growth in the bytes allocated by that thread
+// (see memtrack.hpp) when an AllocationTracker is attached to it and allocations are actually
+// being tracked, and otherwise the growth in the peak resident set size of the whole process.
+// The absolute limits are always for the whole process.
 
 #include <sys/resource.h> // For definition of rusage
+#include <time.h>         // For clockid_t
 
 #include <string>
 #include <chrono>
@@ -28,6 +36,8 @@
 
 namespace pharos {
 
+class AllocationTracker;
+
 enum LimitCode {
   LimitSuccess,
   LimitCounter,
@@ -51,6 +61,14 @@ class ResourceLimit {
   rusage start_ru;
   time_point start_ts;
 
+  // The CPU clock of the thread that created the limit, and its value at that time.
+  clockid_t cpu_clock;
+  double start_cpu;
+
+  // The allocation tracker used to measure relative memory, and its value at the start.
+  const AllocationTracker * tracker;
+  size_t start_bytes;
+
   size_t counter_limit;
   double relative_cpu_limit;
   double absolute_cpu_limit;
@@ -61,6 +79,9 @@ class ResourceLimit {
 
   std::string msg;
 
+  double relative_cpu() const;
+  double relative_memory(const rusage & now_ru) const;
+
  public:
 
   ResourceLimit();
@@ -91,6 +112,12 @@ class ResourceLimit {
     absolute_clock_limit = absolute;
   }
 
+  // Measure relative memory with the given allocation tracker (which must outlive its use by
+  // this limit) from now on.  By default, the limit uses the innermost tracker that was
+  // attached to the thread when the limit was constructed.  Passing null reverts to measuring
+  // the process resident set size.
+  void track_allocations(const AllocationTracker * tracker);
+
   LimitCode check();
 
   std::string get_message() { return msg; }
@@ -40,6 +40,11 @@
 #include <sstream>
 #include <iomanip>
 #include <stdexcept>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define READ_SIZE 1024
 
@@ -309,8 +314,252 @@ void MD5_Final(unsigned char *result, MD5_CTX *ctx)
 
 #endif
 
+namespace {
+
+// The multi-buffer implementation used by MD5Batch.  It's the same algorithm as above, but
+// each step is applied to several independent messages (lanes) at once.  The step constants,
+// the message word used by each step, and the rotation amounts, in step order.
+
+const std::uint32_t md5_t[64] = {
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+  0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+  0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+  0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+  0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+  0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+const int md5_w[64] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+  1, 6, 11, 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12,
+  5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2,
+  0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9
+};
+
+const int md5_s[4][4] = {
+  {7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21}
+};
+
+constexpr size_t md5_lanes = 4;
+
+#ifdef __SSE2__
+
+// Four lanes in an SSE2 register.
+struct Lanes {
+  __m128i v;
+
+  static Lanes load(std::uint32_t const * p) {
+    return {_mm_loadu_si128(reinterpret_cast<__m128i const *>(p))};
+  }
+  static Lanes splat(std::uint32_t x) {
+    return {_mm_set1_epi32(int(x))};
+  }
+  void store(std::uint32_t * p) const {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+  }
+};
+
+inline Lanes operator+(Lanes x, Lanes y) { return {_mm_add_epi32(x.v, y.v)}; }
+inline Lanes operator^(Lanes x, Lanes y) { return {_mm_xor_si128(x.v, y.v)}; }
+inline Lanes operator&(Lanes x, Lanes y) { return {_mm_and_si128(x.v, y.v)}; }
+inline Lanes operator|(Lanes x, Lanes y) { return {_mm_or_si128(x.v, y.v)}; }
+inline Lanes operator~(Lanes x) { return {_mm_xor_si128(x.v, _mm_set1_epi32(-1))}; }
+inline Lanes rotl(Lanes x, int s) {
+  return {_mm_or_si128(_mm_sll_epi32(x.v, _mm_cvtsi32_si128(s)),
+                       _mm_srl_epi32(x.v, _mm_cvtsi32_si128(32 - s)))};
+}
+
+#else
+
+// The portable version, which compilers can often vectorize anyway.
+struct Lanes {
+  std::uint32_t v[md5_lanes];
+
+  static Lanes load(std::uint32_t const * p) {
+    Lanes r;
+    std::memcpy(r.v, p, sizeof(r.v));
+    return r;
+  }
+  static Lanes splat(std::uint32_t x) {
+    Lanes r;
+    for (size_t l = 0; l < md5_lanes; ++l) r.v[l] = x;
+    return r;
+  }
+  void store(std::uint32_t * p) const {
+    std::memcpy(p, v, sizeof(v));
+  }
+};
+
+#define PHAROS_MD5_LANE_OP(op)                                  \
+  inline Lanes operator op(Lanes x, Lanes y) {                  \
+    for (size_t l = 0; l < md5_lanes; ++l) x.v[l] op##= y.v[l]; \
+    return x;                                                   \
+  }
+PHAROS_MD5_LANE_OP(+)
+PHAROS_MD5_LANE_OP(^)
+PHAROS_MD5_LANE_OP(&)
+PHAROS_MD5_LANE_OP(|)
+#undef PHAROS_MD5_LANE_OP
+
+inline Lanes operator~(Lanes x) {
+  for (size_t l = 0; l < md5_lanes; ++l) x.v[l] = ~x.v[l];
+  return x;
+}
+inline Lanes rotl(Lanes x, int s) {
+  for (size_t l = 0; l < md5_lanes; ++l) x.v[l] = (x.v[l] << s) | (x.v[l] >> (32 - s));
+  return x;
+}
+
+#endif
+
+// Process one 64-byte block in every lane.  The state is stored as state[register][lane],
+// and the message as words[word][lane].
+void md5_lanes_body(std::uint32_t state[4][md5_lanes],
+                    std::uint32_t const words[16][md5_lanes])
+{
+  Lanes a = Lanes::load(state[0]);
+  Lanes b = Lanes::load(state[1]);
+  Lanes c = Lanes::load(state[2]);
+  Lanes d = Lanes::load(state[3]);
+  Lanes const saved_a = a, saved_b = b, saved_c = c, saved_d = d;
+
+  for (int i = 0; i < 64; ++i) {
+    Lanes f;
+    switch (i / 16) {
+     case 0: f = d ^ (b & (c ^ d)); break;
+     case 1: f = c ^ (d & (b ^ c)); break;
+     case 2: f = b ^ c ^ d; break;
+     default: f = c ^ (b | ~d); break;
+    }
+    Lanes x = a + f + Lanes::load(words[md5_w[i]]) + Lanes::splat(md5_t[i]);
+    a = d;
+    d = c;
+    c = b;
+    b = b + rotl(x, md5_s[i / 16][i % 4]);
+  }
+
+  (a + saved_a).store(state[0]);
+  (b + saved_b).store(state[1]);
+  (c + saved_c).store(state[2]);
+  (d + saved_d).store(state[3]);
+}
+
+inline std::uint32_t load_le32(unsigned char const * p) {
+  return (std::uint32_t(p[0]) | (std::uint32_t(p[1]) << 8) | (std::uint32_t(p[2]) << 16)
+          | (std::uint32_t(p[3]) << 24));
+}
+
+inline void store_le32(unsigned char * p, std::uint32_t x) {
+  p[0] = (unsigned char)x;
+  p[1] = (unsigned char)(x >> 8);
+  p[2] = (unsigned char)(x >> 16);
+  p[3] = (unsigned char)(x >> 24);
+}
+
+// The message currently being hashed in a lane.  The full 64-byte blocks are read directly
+// from the caller's buffer, and the remaining bytes and the padding from the tail.
+struct MD5Lane {
+  bool active = false;
+  size_t input = 0;
+  unsigned char const * data = nullptr;
+  size_t full_blocks = 0;
+  size_t total_blocks = 0;
+  size_t block = 0;
+  unsigned char tail[128];
+
+  void start(size_t index, unsigned char const * d, size_t size) {
+    active = true;
+    input = index;
+    data = d;
+    full_blocks = size / 64;
+    block = 0;
+    size_t rem = size % 64;
+    size_t tail_size = (rem < 56) ? 64 : 128;
+    total_blocks = full_blocks + tail_size / 64;
+    if (rem) {
+      std::memcpy(tail, data + full_blocks * 64, rem);
+    }
+    tail[rem] = 0x80;
+    std::memset(tail + rem + 1, 0, tail_size - rem - 1 - 8);
+    std::uint64_t bits = std::uint64_t(size) << 3;
+    store_le32(tail + tail_size - 8, std::uint32_t(bits));
+    store_le32(tail + tail_size - 4, std::uint32_t(bits >> 32));
+  }
+
+  unsigned char const * current() const {
+    if (block < full_blocks) {
+      return data + block * 64;
+    }
+    return tail + (block - full_blocks) * 64;
+  }
+};
+
+} // unnamed namespace
+
 namespace pharos {
 
+void MD5Batch::compute()
+{
+  results.clear();
+  results.reserve(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    results.push_back(MD5Result());
+  }
+
+  static unsigned char const idle_block[64] = {0};
+  MD5Lane lanes[md5_lanes];
+  std::uint32_t state[4][md5_lanes];
+  std::uint32_t words[16][md5_lanes];
+  size_t next = 0;
+
+  while (true) {
+    // Start the next messages in any idle lanes.
+    size_t active = 0;
+    for (size_t l = 0; l < md5_lanes; ++l) {
+      MD5Lane & lane = lanes[l];
+      if (!lane.active && next < inputs.size()) {
+        lane.start(next, inputs[next].first, inputs[next].second);
+        ++next;
+        state[0][l] = 0x67452301;
+        state[1][l] = 0xefcdab89;
+        state[2][l] = 0x98badcfe;
+        state[3][l] = 0x10325476;
+      }
+      if (lane.active) {
+        ++active;
+      }
+    }
+    if (active == 0) {
+      break;
+    }
+
+    for (size_t l = 0; l < md5_lanes; ++l) {
+      unsigned char const * block = lanes[l].active ? lanes[l].current() : idle_block;
+      for (size_t w = 0; w < 16; ++w) {
+        words[w][l] = load_le32(block + w * 4);
+      }
+    }
+
+    md5_lanes_body(state, words);
+
+    for (size_t l = 0; l < md5_lanes; ++l) {
+      MD5Lane & lane = lanes[l];
+      if (lane.active && ++lane.block == lane.total_blocks) {
+        unsigned char * value = results[lane.input]._value;
+        for (size_t r = 0; r < 4; ++r) {
+          store_le32(value + r * 4, state[r][l]);
+        }
+        lane.active = false;
+      }
+    }
+  }
+}
+
 MD5::MD5()
 {
   MD5_Init(this);
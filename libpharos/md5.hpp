@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #ifdef HAVE_OPENSSL
@@ -46,6 +47,7 @@ class MD5Result {
   MD5Result() = default;
   unsigned char _value[16];
   friend class MD5;
+  friend class MD5Batch;
 };
 
 class MD5 : public MD5_CTX {
@@ -61,6 +63,45 @@ class MD5 : public MD5_CTX {
   static MD5Result from_file(std::string const & filename);
 };
 
+// Computes the MD5 digests of many buffers at once.  The buffers are hashed side by side in
+// several lanes (using SSE2 vector instructions where available), which is considerably
+// faster than hashing them one at a time when there are lots of small buffers, such as the
+// bytes of the basic blocks in a function.  The digests are identical to those produced by
+// MD5.
+class MD5Batch {
+ public:
+  // Add a buffer to the batch, and return the index of its result.  The buffer is not copied,
+  // so it must remain valid (and unchanged) until compute() is called.
+  size_t add(void const * data, size_t size) {
+    inputs.emplace_back(static_cast<unsigned char const *>(data), size);
+    return inputs.size() - 1;
+  }
+  size_t add(std::string const & str) {
+    return add(str.data(), str.size());
+  }
+
+  // Compute the digests of all of the buffers added so far.
+  void compute();
+
+  // The digest of the buffer with the given index.  Only valid after compute().
+  MD5Result const & result(size_t index) const {
+    return results.at(index);
+  }
+
+  size_t size() const {
+    return inputs.size();
+  }
+
+  void clear() {
+    inputs.clear();
+    results.clear();
+  }
+
+ private:
+  std::vector<std::pair<unsigned char const *, size_t>> inputs;
+  std::vector<MD5Result> results;
+};
+
 } // namespace pharos
 
 #endif // Pharos_Md5_H
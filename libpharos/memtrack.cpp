@@ -0,0 +1,216 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <cstdlib>
+#include <new>
+
+#include "memtrack.hpp"
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#  define PHAROS_TRACK_ALLOCATIONS 1
+#  include <malloc.h>
+#else
+#  define PHAROS_TRACK_ALLOCATIONS 0
+#endif
+
+namespace pharos {
+
+namespace {
+
+// The innermost tracker attached to each thread.
+thread_local AllocationTracker * current_tracker = nullptr;
+
+} // unnamed namespace
+
+AllocationTracker::AllocationTracker() : parent(current_tracker)
+{
+  current_tracker = this;
+}
+
+AllocationTracker::~AllocationTracker()
+{
+  current_tracker = parent;
+}
+
+size_t AllocationTracker::get_current_bytes() const
+{
+  int64_t bytes = live.load(std::memory_order_relaxed);
+  return bytes > 0 ? size_t(bytes) : 0;
+}
+
+size_t AllocationTracker::get_peak_bytes() const
+{
+  return size_t(peak.load(std::memory_order_relaxed));
+}
+
+size_t AllocationTracker::get_allocations() const
+{
+  return allocations.load(std::memory_order_relaxed);
+}
+
+const AllocationTracker * AllocationTracker::current()
+{
+  return current_tracker;
+}
+
+namespace {
+
+// Check that the replacement operator new below is the one that's actually called.  It lives in
+// the shared pharos library, and whether it's used depends on how the program was linked (a
+// statically linked C++ runtime, for example, binds its own operator new), so rather than
+// trusting the build, make an allocation under a temporary tracker and see whether it counted.
+// The operator is called directly because a new expression that's immediately deleted may be
+// elided by the compiler.
+bool allocations_are_tracked()
+{
+  if (!PHAROS_TRACK_ALLOCATIONS) {
+    return false;
+  }
+  AllocationTracker probe;
+  void * p = ::operator new(64);
+  bool tracked = probe.get_allocations() != 0;
+  ::operator delete(p);
+  return tracked;
+}
+
+} // unnamed namespace
+
+bool AllocationTracker::is_enabled()
+{
+  static const bool enabled = allocations_are_tracked();
+  return enabled;
+}
+
+// Only the owning thread modifies the counters, so they don't need atomic read-modify-write
+// operations, which would make every allocation noticeably more expensive.
+void AllocationTracker::note_allocation(size_t bytes)
+{
+  for (AllocationTracker * t = current_tracker; t; t = t->parent) {
+    int64_t now = t->live.load(std::memory_order_relaxed) + int64_t(bytes);
+    t->live.store(now, std::memory_order_relaxed);
+    if (now > t->peak.load(std::memory_order_relaxed)) {
+      t->peak.store(now, std::memory_order_relaxed);
+    }
+    t->allocations.store(t->allocations.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+  }
+}
+
+void AllocationTracker::note_deallocation(size_t bytes)
+{
+  for (AllocationTracker * t = current_tracker; t; t = t->parent) {
+    t->live.store(t->live.load(std::memory_order_relaxed) - int64_t(bytes),
+                  std::memory_order_relaxed);
+  }
+}
+
+} // namespace pharos
+
+#if PHAROS_TRACK_ALLOCATIONS
+
+// Replacements for the global allocation functions that charge the allocations to the trackers
+// attached to the calling thread.  The size of each allocation is taken from the allocator
+// (rather than the size requested) so that allocations and deallocations always balance.
+
+namespace {
+
+void * tracked_allocate(std::size_t size, bool nothrow)
+{
+  if (size == 0) {
+    size = 1;
+  }
+  while (true) {
+    void * p = std::malloc(size);
+    if (p) {
+      if (pharos::current_tracker) {
+        pharos::AllocationTracker::note_allocation(malloc_usable_size(p));
+      }
+      return p;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      if (nothrow) {
+        return nullptr;
+      }
+      throw std::bad_alloc();
+    }
+    if (nothrow) {
+      try {
+        handler();
+      }
+      catch (const std::bad_alloc &) {
+        return nullptr;
+      }
+    }
+    else {
+      handler();
+    }
+  }
+}
+
+void tracked_deallocate(void * p) noexcept
+{
+  if (p && pharos::current_tracker) {
+    pharos::AllocationTracker::note_deallocation(malloc_usable_size(p));
+  }
+  std::free(p);
+}
+
+} // unnamed namespace
+
+void * operator new(std::size_t size)
+{
+  return tracked_allocate(size, false);
+}
+
+void * operator new[](std::size_t size)
+{
+  return tracked_allocate(size, false);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+  return tracked_allocate(size, true);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+  return tracked_allocate(size, true);
+}
+
+void operator delete(void * p) noexcept
+{
+  tracked_deallocate(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+  tracked_deallocate(p);
+}
+
+void operator delete(void * p, const std::nothrow_t &) noexcept
+{
+  tracked_deallocate(p);
+}
+
+void operator delete[](void * p, const std::nothrow_t &) noexcept
+{
+  tracked_deallocate(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+  tracked_deallocate(p);
+}
+
+void operator delete[](void * p, std::size_t) noexcept
+{
+  tracked_deallocate(p);
+}
+
+#endif // PHAROS_TRACK_ALLOCATIONS
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
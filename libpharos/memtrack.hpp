@@ -0,0 +1,74 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#ifndef Pharos_Memtrack_H
+#define Pharos_Memtrack_H
+
+// This header provides per-thread accounting of heap allocations, so that the memory used by
+// the analysis of one function can be measured (and limited) even when several functions are
+// being analyzed at once on different threads.  An AllocationTracker is attached to the thread
+// that creates it for as long as it exists, and every allocation and deallocation made by that
+// thread through operator new and delete is charged to it.  Trackers nest, and an allocation
+// is charged to every tracker attached to the thread.
+//
+// The accounting is approximate.  Memory allocated while the tracker is attached but freed by
+// another thread (or after the tracker is gone) remains charged to it, and memory allocated
+// before the tracker was attached but freed while it is attached is credited to it.  Tracking
+// requires recovering the size of an allocation when it is freed, which is currently only
+// implemented for glibc.  Elsewhere (and in address sanitizer builds, which replace operator
+// new themselves), is_enabled() returns false and the trackers count nothing.  It also returns
+// false if the program doesn't actually call the replacement operator new, which is checked
+// the first time it's called.  Code that measures memory with the trackers (e.g.,
+// ResourceLimit) should fall back to another measure when is_enabled() is false.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace pharos {
+
+class AllocationTracker {
+ public:
+  AllocationTracker();
+  AllocationTracker(const AllocationTracker &) = delete;
+  AllocationTracker & operator=(const AllocationTracker &) = delete;
+  // Trackers must be destroyed by the thread that created them, in the reverse order of their
+  // creation.
+  ~AllocationTracker();
+
+  // The bytes allocated and not yet freed since the tracker was created.
+  size_t get_current_bytes() const;
+  // The most bytes that were allocated and not yet freed at any one time.
+  size_t get_peak_bytes() const;
+  // The number of allocations made.
+  size_t get_allocations() const;
+
+  // The innermost tracker attached to the calling thread, or null if there isn't one.
+  static const AllocationTracker * current();
+
+  // Are allocations actually being tracked by this program?
+  static bool is_enabled();
+
+  // Charge an allocation or deallocation of the given size to the trackers attached to the
+  // calling thread.  Called by operator new and delete.
+  static void note_allocation(size_t bytes);
+  static void note_deallocation(size_t bytes);
+
+ private:
+  AllocationTracker * parent;
+
+  // These are only modified by the thread that the tracker is attached to, but may be read by
+  // other threads (e.g., when reporting).
+  std::atomic<int64_t> live{0};
+  std::atomic<int64_t> peak{0};
+  std::atomic<size_t> allocations{0};
+};
+
+} // namespace pharos
+
+#endif // Pharos_Memtrack_H
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
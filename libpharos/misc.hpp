@@ -100,6 +100,10 @@ struct TreeNodePtrCompare {
     if (!a) {
       return true;
     }
+    // Shared (e.g. interned) expressions are trivially equal.
+    if (a == b) {
+      return false;
+    }
     return a->compareStructure(b) < 0;
   }
 };
@@ -2,6 +2,8 @@
 
 // This code represents the new Prolog based approach!
 
+#include <numeric>
+
 #include <boost/range/adaptor/map.hpp>
 
 #include "pdg.hpp"
@@ -336,29 +338,58 @@ void OOAnalyzer::finish() {
   GINFO << "Function analysis complete, analyzed " << processed_funcs
         << " functions in " << secs.count() << " seconds." << LEND;
 
+  unsigned int nthreads = ds.get_concurrency_level();
+
   // Alternate version of the find_heap_objects() routine, in transition...
-  find_heap_allocs();
+  time_point phase_ts = clock::now();
+  find_heap_allocs(nthreads);
+  secs = clock::now() - phase_ts;
+  GINFO << "Heap allocation analysis complete in " << secs.count() << " seconds." << LEND;
 
   // Analyze virtual function calls.  Dependent on the interprocedual PDGs for instruction
   // reads and writes for each function with a virtual call in it.
   // ds.update_vf_call_descriptors();
 
-  // Look for methods that pass their this-pointers to other methods.
+  // Look for methods that pass their this-pointers to other methods.  Each method only
+  // updates its own passed function offsets, so the methods can be processed concurrently.
+  phase_ts = clock::now();
+  std::vector<ThisCallMethod*> tcms;
+  tcms.reserve(methods.size());
   for (auto & tcm : boost::adaptors::values(methods)) {
-    tcm->find_passed_func_offsets(*this);
+    tcms.push_back(tcm.get());
   }
+  parallel_for_each(tcms, nthreads, [this](ThisCallMethod* tcm) {
+    tcm->find_passed_func_offsets(*this);
+  });
+  secs = clock::now() - phase_ts;
+  GINFO << "Passed this-pointer analysis of " << tcms.size() << " methods complete in "
+        << secs.count() << " seconds." << LEND;
 
   // Test virtual base tables and virtual function tables for overlaps.  This is the new Prolog
-  // compatible approach, and it may not actually modify function tables yet.
-  // For every virtual base table...
+  // compatible approach, and it may not actually modify function tables yet.  Each virtual
+  // base table only updates its own size, and the tables that bound it are determined before
+  // any sizes are changed, so the tables can be processed concurrently.
+  phase_ts = clock::now();
+  std::vector<rose_addr_t> vbtable_bounds;
+  std::vector<VirtualBaseTable*> vbts;
+  vbts.reserve(vbtables.size());
   for (auto & vbt : boost::adaptors::values(vbtables)) {
-    // Ask the virtual base table to compare itself with all other tables, and update its size.
-    vbt->analyze_overlaps(vftables, vbtables);
+    // Don't bound ourselves by other vbtables if we know that they are invalid.
+    if (vbt->size >= 2) vbtable_bounds.push_back(vbt->addr);
+    vbts.push_back(vbt.get());
   }
+  // For every virtual base table...
+  parallel_for_each(vbts, nthreads, [this, &vbtable_bounds](VirtualBaseTable* vbt) {
+    // Ask the virtual base table to compare itself with all other tables, and update its size.
+    vbt->analyze_overlaps(vftables, vbtable_bounds);
+  });
   // In the new way of doing things we should probably be doing this too...
   //for (const VirtualFunctionTable* vft : boost::adaptors::values(vftables)) {
   //  vft->analyze_overlaps(vftables, vbtables);
   //}
+  secs = clock::now() - phase_ts;
+  GINFO << "Overlap analysis of " << vbts.size() << " virtual base tables complete in "
+        << secs.count() << " seconds." << LEND;
 
   //analyze_vftables_in_all_fds();
 
@@ -373,30 +404,31 @@ OOAnalyzer::get_result_classes() {
   return ooclasses;
 }
 
-void OOAnalyzer::handle_heap_allocs(const rose_addr_t saddr) {
-  GDEBUG << "handle_heap_allocs inspecting addr " << addr_str(saddr) << LEND;
+OOAnalyzer::HeapAlloc OOAnalyzer::find_heap_alloc(const rose_addr_t saddr) {
+  HeapAlloc alloc;
+  GDEBUG << "find_heap_alloc inspecting addr " << addr_str(saddr) << LEND;
   const CallDescriptor* cd = ds.get_call(saddr);
   if (cd == NULL) {
     GINFO << "No call descriptor for call at " << addr_str(saddr) << LEND;
-    return;
+    return alloc;
   }
 
   SgAsmInstruction* insn = cd->get_insn();
   const FunctionDescriptor* cfd = ds.get_func_containing_address(cd->get_address());
   if (cfd == NULL) {
     GINFO << "No function for call at " << addr_str(saddr) << LEND;
-    return;
+    return alloc;
   }
 
   rose_addr_t faddr = cfd->get_address();
   ObjectUseMap::iterator oufinder = object_uses.find(faddr);
   if (oufinder == object_uses.end()) {
     GINFO << "No object use for " << cfd->address_string() << LEND;
-    return;
+    return alloc;
   }
 
   // Find the object use for the function the call is in.
-  ObjectUse& obj_use = object_uses.find(faddr)->second;
+  ObjectUse& obj_use = oufinder->second;
 
   // For backwards compatibility.  This is very duplicative of effort right now, but Cory
   // intends for this call to go away soon.
@@ -406,7 +438,7 @@ void OOAnalyzer::handle_heap_allocs(const rose_addr_t saddr) {
   SymbolicValuePtr rc = cd->get_return_value();
   if (!rc) {
     GERROR << "Missing return value from new() call at " << cd->address_string() << LEND;
-    return;
+    return alloc;
   }
   // Lookup the this-pointer in the references map.
   ThisPtrUsageMap::iterator finder = obj_use.references.find(rc->get_hash());
@@ -417,13 +449,12 @@ void OOAnalyzer::handle_heap_allocs(const rose_addr_t saddr) {
     // appears to happen primarily when the constructor is inlined or non-existent.
     GWARN << "Missing this-pointer usage for new() call at "
           << debug_instruction(insn) << LEND;
-    return;
+    return alloc;
   }
 
   // Record that we know which type of allocation the object has.
-  ThisPtrUsage& tpu = finder->second;
-  tpu.alloc_type = AllocHeap;
-  tpu.alloc_insn = insn;
+  alloc.tpu = &(finder->second);
+  alloc.insn = insn;
 
   // Get the parameters to the new() call.  Cory's had a few problems with the version of
   // this logic that accepts only a single parameter to new().  For now we'll switch to a
@@ -439,9 +470,9 @@ void OOAnalyzer::handle_heap_allocs(const rose_addr_t saddr) {
     {
       unsigned int size = *pd->get_value()->toUnsigned();
       if (size > 0 and size < 0xFFFFFFF) {
-        tpu.alloc_size = size;
+        alloc.size = size;
         GDEBUG << "The size parameter to new() at " << cd->address_string()
-               << " was: " << tpu.alloc_size << LEND;
+               << " was: " << alloc.size << LEND;
       }
       else {
         GWARN << "Bad size parameter " << size
@@ -452,36 +483,58 @@ void OOAnalyzer::handle_heap_allocs(const rose_addr_t saddr) {
   else {
     GWARN << "Unable to find parameter for new() call at " << cd->address_string() << LEND;
   }
+  return alloc;
 }
 
-void OOAnalyzer::find_heap_allocs() {
-  // Second pass - Having completed the object use analysis for all functions, make another
-  // pass over the functions looking for the ones we've identified as new() methods.  For each
-  // new() method, analyze all of it's callers and record that they are heap allocated objects.
-  const FunctionDescriptorMap& fdmap = ds.get_func_map();
-  for (const FunctionDescriptor& fd : boost::adaptors::values(fdmap)) {
-    if (is_new_method(fd.get_address())) {
-      // This is a pretty horrible way to get the callers.  Wes used the function call graph,
-      // and that had different problems, including skipping some calls to new, and adding some
-      // jumps to new.  At least this way we're using our CallDescriptor infrastructure, and
-      // if get_callers() was cleaned up some, then we'd be in pretty good shape.
-      for (const rose_addr_t saddr : fd.get_callers()) {
-        handle_heap_allocs(saddr);
-      }
+void OOAnalyzer::find_heap_allocs(unsigned int nthreads) {
+  // Second pass - Having completed the object use analysis for all functions, look up the
+  // functions we've identified as new() methods.  For each new() method, analyze all of it's
+  // callers and record that they are heap allocated objects.  The new() methods are found
+  // from the call_addrs index rather than by testing every function and import descriptor.
+  AddrSet new_funcs;
+  AddrSet new_imports;
+  for (auto & v : call_addrs) {
+    if (v.second != NEW) continue;
+    if (ds.get_func(v.first)) {
+      new_funcs.insert(v.first);
+    }
+    else if (ds.get_import(v.first)) {
+      new_imports.insert(v.first);
+    }
+  }
+
+  // This is a pretty horrible way to get the callers.  Wes used the function call graph, and
+  // that had different problems, including skipping some calls to new, and adding some jumps
+  // to new.  At least this way we're using our CallDescriptor infrastructure, and if
+  // get_callers() was cleaned up some, then we'd be in pretty good shape.
+  std::vector<rose_addr_t> callers;
+  for (rose_addr_t addr : new_funcs) {
+    for (const rose_addr_t saddr : ds.get_func(addr)->get_callers()) {
+      callers.push_back(saddr);
     }
   }
   // now have to iterate over import descriptors, because the func desc contained within them
   // are not in the global descriptor set func map...
-  const ImportDescriptorMap& idmap = ds.get_import_map();
-  for (const ImportDescriptor& id : boost::adaptors::values(idmap)) {
-    if (is_new_method(id.get_address())) {
-      // This is a pretty horrible way to get the callers.  Wes used the function call graph,
-      // and that had different problems, including skipping some calls to new, and adding some
-      // jumps to new.  At least this way we're using our CallDescriptor infrastructure, and
-      // if get_callers() was cleaned up some, then we'd be in pretty good shape.
-      for (const rose_addr_t saddr : id.get_callers()) {
-        handle_heap_allocs(saddr);
-      }
+  for (rose_addr_t addr : new_imports) {
+    for (const rose_addr_t saddr : ds.get_import(addr)->get_callers()) {
+      callers.push_back(saddr);
+    }
+  }
+
+  // Analyze the calls concurrently, and then record the allocations in the original order, so
+  // that the results are the same when more than one call refers to the same this-pointer.
+  std::vector<HeapAlloc> allocs(callers.size());
+  std::vector<size_t> indexes(callers.size());
+  std::iota(indexes.begin(), indexes.end(), 0);
+  parallel_for_each(indexes, nthreads, [this, &callers, &allocs](size_t i) {
+    allocs[i] = find_heap_alloc(callers[i]);
+  });
+  for (const HeapAlloc & alloc : allocs) {
+    if (!alloc.tpu) continue;
+    alloc.tpu->alloc_type = AllocHeap;
+    alloc.tpu->alloc_insn = alloc.insn;
+    if (alloc.size) {
+      alloc.tpu->alloc_size = alloc.size;
     }
   }
 }
@@ -71,10 +71,20 @@ class OOAnalyzer : public BottomUpAnalyzer {
   // Find possible virtual tables in a given function.
   void find_vtable_installations(FunctionDescriptor const & fd);
 
+  // A heap allocation of an object by a call to new().
+  struct HeapAlloc {
+    // The usage of the allocated this-pointer, or null if there wasn't one.
+    ThisPtrUsage* tpu = nullptr;
+    SgAsmInstruction* insn = nullptr;
+    // The size passed to new(), or zero if it wasn't known.
+    uint32_t size = 0;
+  };
+
   // Find heap allocations?
-  void find_heap_allocs();
-  // Handlethem by adding them to the previously global map?
-  void handle_heap_allocs(const rose_addr_t saddr);
+  void find_heap_allocs(unsigned int nthreads);
+  // Find the allocation made by the call to new() at an address.  This doesn't modify the
+  // object uses, so it can be called concurrently.
+  HeapAlloc find_heap_alloc(const rose_addr_t saddr);
 
   // Record this-pointers in a map more efficiently than in call descriptor states.
   void record_this_ptrs_for_calls(FunctionDescriptor* fd);
@@ -1,6 +1,8 @@
 // Copyright 2016-2022 Carnegie Mellon University.  See LICENSE file for terms.
 // Author: Cory Cohen
 
+#include <algorithm>
+
 #include <boost/range/adaptor/map.hpp>
 
 #include "oosolver.hpp"
@@ -196,12 +198,12 @@ OOSolver::add_facts(const OOAnalyzer& ooa) {
   if (!session) return false;
   try {
     if (!ignore_rtti) {
-      session->add_fact("rTTIEnabled");
+      session->buffer_fact("rTTIEnabled");
     }
     if (no_guessing) {
-      session->add_fact("guessingDisabled");
+      session->buffer_fact("guessingDisabled");
     }
-    session->add_fact("fileInfo", ds.get_filemd5(), ds.get_filename());
+    session->buffer_fact("fileInfo", ds.get_filemd5(), ds.get_filename());
     add_method_facts(ooa);
     add_vftable_facts(ooa);
     add_usage_facts(ooa);
@@ -210,14 +212,40 @@ OOSolver::add_facts(const OOAnalyzer& ooa) {
     add_thisptrdefinition_facts();
     add_function_facts(ooa);
     add_import_facts(ooa);
+    if (!session->flush_facts()) {
+      return false;
+    }
   }
   catch (const Error& error) {
     GFATAL << error.what() << LEND;
     return false;
   }
+  report_fact_stats();
   return true;
 }
 
+// Report how many facts of each kind were loaded, and how long it took, most expensive first.
+void
+OOSolver::report_fact_stats() const {
+  using Entry = std::pair<std::string, Session::FactLoadStats>;
+  std::vector<Entry> entries(session->get_fact_stats().begin(),
+                             session->get_fact_stats().end());
+  std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+    return a.second.seconds > b.second.seconds;
+  });
+  size_t total = 0;
+  double seconds = 0.0;
+  for (const Entry & e : entries) {
+    total += e.second.count;
+    seconds += e.second.seconds;
+  }
+  OINFO << "Loaded " << total << " Prolog facts in " << seconds << " seconds." << LEND;
+  for (const Entry & e : entries) {
+    OINFO << "  " << e.first << ": " << e.second.count << " facts in " << e.second.seconds
+          << " seconds." << LEND;
+  }
+}
+
 // The main analysis call.  It adds facts, invokes the anlaysis, and reports the results.
 bool
 OOSolver::analyze(const OOAnalyzer& ooa) {
@@ -268,34 +296,34 @@ OOSolver::add_method_facts(const OOAnalyzer& ooa)
     // fact, as this results in non-OO functions
     auto conventions = tcm->fd->get_calling_conventions();
     if (conventions.size() == 0) {
-      session->add_fact("callingConvention", tcm->get_address(), "invalid");
-      session->add_fact("funcParameter", tcm->get_address(), "ecx", thisptr_term);
+      session->buffer_fact("callingConvention", tcm->get_address(), "invalid");
+      session->buffer_fact("funcParameter", tcm->get_address(), "ecx", thisptr_term);
     }
 
     // These facts are getting closer to correct, but should still be reviewed once more.
     if (tcm->returns_self) {
-      session->add_fact("returnsSelf", tcm->get_address());
+      session->buffer_fact("returnsSelf", tcm->get_address());
     }
     if (tcm->no_calls_before) {
-      session->add_fact("noCallsBefore", tcm->get_address());
+      session->buffer_fact("noCallsBefore", tcm->get_address());
 
       // Uninitialized reads are only meaningful for methods that have no calls before.  This
       // helps cut down on the number of exported facts.
       if (tcm->uninitialized_reads) {
-        session->add_fact("uninitializedReads", tcm->get_address());
+        session->buffer_fact("uninitializedReads", tcm->get_address());
       }
     }
 
     if (tcm->no_calls_after) {
-      session->add_fact("noCallsAfter", tcm->get_address());
+      session->buffer_fact("noCallsAfter", tcm->get_address());
     }
 
     // We used to report funcOffsets here, but they're no longer needed.
 
     for (const Member& member : boost::adaptors::values(tcm->data_members)) {
       for (const SgAsmX86Instruction* insn : member.using_instructions) {
-        session->add_fact("methodMemberAccess", insn->get_address(),
-                          tcm->get_address(), member.offset, member.size);
+        session->buffer_fact("methodMemberAccess", insn->get_address(),
+                             tcm->get_address(), member.offset, member.size);
       }
     }
   }
@@ -322,8 +350,9 @@ OOSolver::add_vftable_facts(const OOAnalyzer& ooa)
 
     // Only export VTableWrites with non-negative offsets to reduce false positives?
     if (vti->offset >= 0) {
-      session->add_fact(fact_name, vti->insn->get_address(), vti->fd->get_address(),
-                        thisptr_term, vti->offset, expanded_thisptr_term, vti->table_address);
+      session->buffer_fact(fact_name, vti->insn->get_address(), vti->fd->get_address(),
+                           thisptr_term, vti->offset, expanded_thisptr_term,
+                           vti->table_address);
 
       // Add the ptr so we make a thisPtrDefinition
       expanded_thisptrs.insert(ExpandedTreeNodePtr{vti->expanded_ptr, vti->insn->get_address(), vti->fd->get_address()});
@@ -355,7 +384,7 @@ OOSolver::add_vftable_facts(const OOAnalyzer& ooa)
       // we've exported thunk facts to Prolog, we can sort that out correctly, and identify
       // that the single implementation is a shared implementation.
 
-      session->add_fact("initialMemory", eaddr, value);
+      session->buffer_fact("initialMemory", eaddr, value);
       e++;
     }
 
@@ -375,7 +404,7 @@ OOSolver::add_vftable_facts(const OOAnalyzer& ooa)
       if (finder != exported.end()) break;
       exported.insert(eaddr);
 
-      session->add_fact("initialMemory", eaddr, value);
+      session->buffer_fact("initialMemory", eaddr, value);
     }
   }
 }
@@ -392,9 +421,9 @@ OOSolver::add_rtti_facts(const VirtualFunctionTable* vft)
   if (rtti->class_desc.signature.value != 0) return;
 
   if (visited.find(vft->rtti_addr) == visited.end()) {
-    session->add_fact("rTTICompleteObjectLocator", vft->rtti_addr, rtti->address,
-                      rtti->pTypeDescriptor.value, rtti->pClassDescriptor.value,
-                      rtti->offset.value, rtti->cdOffset.value);
+    session->buffer_fact("rTTICompleteObjectLocator", vft->rtti_addr, rtti->address,
+                         rtti->pTypeDescriptor.value, rtti->pClassDescriptor.value,
+                         rtti->offset.value, rtti->cdOffset.value);
     visited.insert(vft->rtti_addr);
   }
 
@@ -411,9 +440,9 @@ OOSolver::add_rtti_facts(const VirtualFunctionTable* vft)
     if (demangled) {
       demangled_name = demangled->get_class_name();
     }
-    session->add_fact("rTTITypeDescriptor", rtti->pTypeDescriptor.value,
-                      rtti->type_desc.pVFTable.value, rtti->type_desc.name.value,
-                      demangled_name);
+    session->buffer_fact("rTTITypeDescriptor", rtti->pTypeDescriptor.value,
+                         rtti->type_desc.pVFTable.value, rtti->type_desc.name.value,
+                         demangled_name);
     visited.insert(rtti->pTypeDescriptor.value);
   }
 
@@ -433,11 +462,11 @@ OOSolver::add_rtti_chd_facts(const rose_addr_t addr)
     std::vector<uint32_t> base_addresses;
     for (const TypeRTTIBaseClassDescriptor& base : chd.base_classes) {
       if (visited.find(base.address) == visited.end()) {
-        session->add_fact("rTTIBaseClassDescriptor", base.address,
-                          base.pTypeDescriptor.value, base.numContainedBases.value,
-                          base.where_mdisp.value, base.where_pdisp.value,
-                          base.where_vdisp.value, base.attributes.value,
-                          base.pClassDescriptor.value);
+        session->buffer_fact("rTTIBaseClassDescriptor", base.address,
+                             base.pTypeDescriptor.value, base.numContainedBases.value,
+                             base.where_mdisp.value, base.where_pdisp.value,
+                             base.where_vdisp.value, base.attributes.value,
+                             base.pClassDescriptor.value);
         visited.insert(base.address);
 
         // This is where we read and export facts for the undocumented "sub-chd", but only if
@@ -462,17 +491,17 @@ OOSolver::add_rtti_chd_facts(const rose_addr_t addr)
         if (demangled) {
           demangled_name = demangled->get_class_name();
         }
-        session->add_fact("rTTITypeDescriptor", base.pTypeDescriptor.value,
-                          base.type_desc.pVFTable.value, base.type_desc.name.value,
-                          demangled_name);
+        session->buffer_fact("rTTITypeDescriptor", base.pTypeDescriptor.value,
+                             base.type_desc.pVFTable.value, base.type_desc.name.value,
+                             demangled_name);
         visited.insert(base.pTypeDescriptor.value);
       }
 
       base_addresses.push_back(base.address);
     }
 
-    session->add_fact("rTTIClassHierarchyDescriptor", addr,
-                      chd.attributes.value, base_addresses);
+    session->buffer_fact("rTTIClassHierarchyDescriptor", addr,
+                         chd.attributes.value, base_addresses);
   }
   catch (std::exception &e) {
     GERROR << "RTTI Class Hierarchy Descriptor was bad at " << addr_str(addr) << ": " << e.what () << LEND;
@@ -503,8 +532,8 @@ OOSolver::add_usage_facts(const OOAnalyzer& ooa)
       if (tpu.alloc_insn != NULL) {
         // Report the allocation fact now though.
         std::string thisptr_term = "sv_" + std::to_string(tpu.this_ptr->get_hash());
-        session->add_fact("thisPtrAllocation", tpu.alloc_insn->get_address(), func_addr,
-                          thisptr_term, "type_" + Enum2Str(tpu.alloc_type), tpu.alloc_size);
+        session->buffer_fact("thisPtrAllocation", tpu.alloc_insn->get_address(), func_addr,
+                             thisptr_term, "type_" + Enum2Str(tpu.alloc_type), tpu.alloc_size);
       }
     }
   }
@@ -535,7 +564,7 @@ OOSolver::add_call_facts(const OOAnalyzer& ooa)
         // If the callTarget is just for a thunk, don't export the callTarget fact.
       }
       else {
-        session->add_fact("callTarget", cd.get_address(), callfunc->get_address(), target);
+        session->buffer_fact("callTarget", cd.get_address(), callfunc->get_address(), target);
       }
 
       bool isdelete = ooa.is_candidate_delete_method(target);
@@ -549,8 +578,8 @@ OOSolver::add_call_facts(const OOAnalyzer& ooa)
           GTRACE << "Parameter to delete at " << cd.address_string() << " was: "
                  << thisptr_term << " tn=" << *(value->get_expression()) << LEND;
         }
-        session->add_fact("insnCallsDelete", cd.get_address(),
-                          callfunc->get_address(), thisptr_term);
+        session->buffer_fact("insnCallsDelete", cd.get_address(),
+                             callfunc->get_address(), thisptr_term);
       }
 
       bool isnew = ooa.is_new_method(target);
@@ -558,8 +587,8 @@ OOSolver::add_call_facts(const OOAnalyzer& ooa)
       if (isnew) {
         const SymbolicValuePtr& value = cd.get_return_value();
         if (value) thisptr_term = "sv_" + std::to_string(value->get_hash());
-        session->add_fact("insnCallsNew", cd.get_address(),
-                          callfunc->get_address(), thisptr_term);
+        session->buffer_fact("insnCallsNew", cd.get_address(),
+                             callfunc->get_address(), thisptr_term);
       }
     }
 
@@ -583,12 +612,12 @@ OOSolver::add_call_facts(const OOAnalyzer& ooa)
       std::string term = "sv_" + std::to_string(expr->hash());
       if (cpd.is_reg()) {
         std::string regname = unparseX86Register(cpd.get_register(), {});
-        session->add_fact("callParameter", cd.get_address(),
-                          callfunc->get_address(), regname, term);
+        session->buffer_fact("callParameter", cd.get_address(),
+                             callfunc->get_address(), regname, term);
       }
       else {
-        session->add_fact("callParameter", cd.get_address(),
-                          callfunc->get_address(), cpd.get_num(), term);
+        session->buffer_fact("callParameter", cd.get_address(),
+                             callfunc->get_address(), cpd.get_num(), term);
       }
     }
 
@@ -606,7 +635,8 @@ OOSolver::add_call_facts(const OOAnalyzer& ooa)
       std::string term = "sv_" + std::to_string(expr->hash());
       if (cpd.is_reg()) {
         std::string regname = unparseX86Register(cpd.get_register(), {});
-        session->add_fact("callReturn", cd.get_address(), callfunc->get_address(), regname, term);
+        session->buffer_fact("callReturn", cd.get_address(), callfunc->get_address(),
+                             regname, term);
       }
     }
 
@@ -627,9 +657,9 @@ OOSolver::add_call_facts(const OOAnalyzer& ooa)
 
       // Report the virtual call fact now.
       std::string thisptr_term = "sv_" + std::to_string(vci.obj_ptr->get_hash());
-      session->add_fact("possibleVirtualFunctionCall", cd.get_address(),
-                        callfunc->get_address(), thisptr_term,
-                        vci.vtable_offset, vci.vfunc_offset);
+      session->buffer_fact("possibleVirtualFunctionCall", cd.get_address(),
+                           callfunc->get_address(), thisptr_term,
+                           vci.vtable_offset, vci.vfunc_offset);
     }
   }
 }
@@ -646,7 +676,7 @@ OOSolver::add_thisptroffset_facts()
       std::string thisptr_term = "sv_" + std::to_string(thisptr->hash());
       const TreeNodePtr& varptr = ace.variable_portion();
       std::string variable_term = "sv_" + std::to_string(varptr->hash());
-      session->add_fact("thisPtrOffset", variable_term, constant, thisptr_term);
+      session->buffer_fact("thisPtrOffset", variable_term, constant, thisptr_term);
     }
   }
 }
@@ -657,7 +687,8 @@ OOSolver::add_thisptrdefinition_facts()
 {
   for (const ExpandedTreeNodePtr& thisptr : expanded_thisptrs) {
     std::string thisptr_term = "sv_" + std::to_string(thisptr.ptr->hash());
-    session->add_fact("thisPtrDefinition", thisptr_term, thisptr.ptr, thisptr.defaddr, thisptr.funcaddr);
+    session->buffer_fact("thisPtrDefinition", thisptr_term, thisptr.ptr, thisptr.defaddr,
+                         thisptr.funcaddr);
   }
 }
 
@@ -669,20 +700,20 @@ OOSolver::add_function_facts(const OOAnalyzer& ooa)
   for (const FunctionDescriptor& fd : boost::adaptors::values(fdmap)) {
     rose_addr_t fdaddr = fd.get_address();
     if (ooa.is_purecall_method(fdaddr)) {
-      session->add_fact("purecall", fdaddr);
+      session->buffer_fact("purecall", fdaddr);
     }
 
     // Turns out that we need to export thunk data to Prolog, because the presence or absence
     // of thunks can affect our logic.  For example, thunk1 and thunk2 can be assigned to
     // different classes, even if they jump to the same function.
     if (fd.is_thunk()) {
-      session->add_fact("thunk", fdaddr, fd.get_jmp_addr());
+      session->buffer_fact("thunk", fdaddr, fd.get_jmp_addr());
     }
 
     // Report all calling conventions for all functions.
     auto conventions = fd.get_calling_conventions();
     for (const CallingConvention* cc: conventions) {
-      session->add_fact("callingConvention", fdaddr, cc->get_name());
+      session->buffer_fact("callingConvention", fdaddr, cc->get_name());
     }
 
     // Report all parameters for every function (in the future we'll try using an OO subset)
@@ -701,10 +732,10 @@ OOSolver::add_function_facts(const OOAnalyzer& ooa)
       std::string term = "sv_" + std::to_string(expr->hash());
       if (fpd.is_reg()) {
         std::string regname = unparseX86Register(fpd.get_register(), {});
-        session->add_fact("funcParameter", fdaddr, regname, term);
+        session->buffer_fact("funcParameter", fdaddr, regname, term);
       }
       else {
-        session->add_fact("funcParameter", fdaddr, fpd.get_num(), term);
+        session->buffer_fact("funcParameter", fdaddr, fpd.get_num(), term);
       }
     }
 
@@ -722,7 +753,7 @@ OOSolver::add_function_facts(const OOAnalyzer& ooa)
       std::string term = "sv_" + std::to_string(expr->hash());
       if (fpd.is_reg()) {
         std::string regname = unparseX86Register(fpd.get_register(), {});
-        session->add_fact("funcReturn", fdaddr, regname, term);
+        session->buffer_fact("funcReturn", fdaddr, regname, term);
       }
     }
   }
@@ -757,7 +788,7 @@ OOSolver::add_import_facts(const OOAnalyzer& ooa)
         std::string clsname = dtype->get_class_name();
         std::string varname = dtype->str_name_qualifiers(dtype->instance_name, false);
 
-        session->add_fact("symbolGlobalObject", id.get_address(), clsname, varname);
+        session->buffer_fact("symbolGlobalObject", id.get_address(), clsname, varname);
 
         // And we're done with this import.
         continue;
@@ -772,19 +803,20 @@ OOSolver::add_import_facts(const OOAnalyzer& ooa)
       if (clsname.size() > 0) {
         assert(!dtype->name.empty());
 
-        session->add_fact("symbolClass", id.get_address(), id.get_name(), clsname, method_name);
+        session->buffer_fact("symbolClass", id.get_address(), id.get_name(), clsname,
+                             method_name);
 
         // Add calling convention for imported functions
         auto conventions = id.get_function_descriptor()->get_calling_conventions();
         for (const CallingConvention* cc: conventions) {
-          session->add_fact("callingConvention", id.get_address(), cc->get_name());
+          session->buffer_fact("callingConvention", id.get_address(), cc->get_name());
         }
         if (dtype->name.front()->is_ctor) {
-          session->add_fact("symbolProperty", id.get_address(), Constructor);
+          session->buffer_fact("symbolProperty", id.get_address(), Constructor);
         }
 
         if (dtype->name.front()->is_dtor) {
-          session->add_fact("symbolProperty", id.get_address(), RealDestructor);
+          session->buffer_fact("symbolProperty", id.get_address(), RealDestructor);
         }
 
         // Obviously would could do much better here, since we can identify a wide variety of
@@ -795,11 +827,11 @@ OOSolver::add_import_facts(const OOAnalyzer& ooa)
         if (method == "`vector deleting destructor'"
             || method == "`scalar deleting destructor'")
         {
-          session->add_fact("symbolProperty", id.get_address(), DeletingDestructor);
+          session->buffer_fact("symbolProperty", id.get_address(), DeletingDestructor);
         }
 
         if (dtype->method_property == demangle::MethodProperty::Virtual) {
-          session->add_fact("symbolProperty", id.get_address(), Virtual);
+          session->buffer_fact("symbolProperty", id.get_address(), Virtual);
         }
       }
     }
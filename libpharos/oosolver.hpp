@@ -216,6 +216,7 @@ class OOSolver {
   void add_thisptrdefinition_facts();
   void add_function_facts(const OOAnalyzer& ooa);
   void add_import_facts(const OOAnalyzer& ooa);
+  void report_fact_stats() const;
 
   // Private implementation of dump_facts() and dump_results().
   void dump_facts_private();
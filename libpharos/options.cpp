@@ -25,6 +25,8 @@
 #include "semantics.hpp"
 #include "path.hpp"
 #include "bua.hpp"
+#include "intern.hpp"
+#include "profile.hpp"
 
 // these next ones needed for global obj cleanup...
 #include "riscops.hpp"
@@ -200,6 +202,16 @@ ProgOptDesc cert_standard_options() {
      "limit the number of CFG iterations per function")
     ("maximum-nodes-per-condition", po::value<int>(),
      "limit the number of tree nodes per ITE condition")
+    ("intern-expressions",
+     "share a single instance of equal symbolic expressions between states")
+    ("function-cache", po::value<bf::path>(),
+     "directory which caches per-function analysis results between runs")
+    ("function-cache-clear",
+     "remove all existing entries from the function cache before analysis")
+    ("profile", po::value<bf::path>(),
+     "write a per-function analysis profile to a JSON (or .csv) file")
+    ("profile-top", po::value<size_t>(),
+     "number of slowest functions to summarize when profiling (default 10)")
 
     ("threads", po::value<int>()->implicit_value(1),
      ("Number of threads to use, if this program uses threads.  "
@@ -268,6 +280,10 @@ static ProgOptDesc cert_hidden_options()
      "the old maximum-iterations-per-function")
     ("propagate-conditions",
      "Flag to preserve and propagate conditions when analyzing basic blocks")
+    ("legacy-flow-scheduler",
+     "Sweep the entire CFG on each pass instead of using the worklist when solving the flow equation")
+    ("full-state-compare",
+     "Compare every location in block output states instead of only the changed locations")
     ;
   ;
   return certhiddenopt;
@@ -524,6 +540,8 @@ static ProgOptVarMap parse_cert_options_internal(
 
   // Set global limits
   set_global_limits(vm);
+  set_global_interner(vm);
+  set_global_profiler(vm);
 
   // Add the global logging facility to the known facilities.
   Sawyer::Message::mfacilities.insert(glog);
@@ -841,6 +859,9 @@ int pharos_main(std::string const & glog_name, main_func_ptr fn,
 
   rc = fn(argc, argv);
 
+  // Write the profile (if requested) once the tool is finished with the analysis.
+  report_global_profile();
+
   return rc;
 }
 
@@ -1,6 +1,8 @@
 // Copyright 2015-2024 Carnegie Mellon University.  See LICENSE file for terms.
 
 #include <stdarg.h>
+#include <algorithm>
+#include <numeric>
 #include <stdexcept>
 #include <fstream>
 #include <boost/iostreams/filtering_streambuf.hpp>
@@ -9,11 +11,14 @@
 #include <boost/archive/binary_iarchive.hpp>
 
 #include "partitioner.hpp"
+#include "superset.hpp"
 #include "masm.hpp"
 #include "util.hpp"
 #include "limit.hpp"
 #include "misc.hpp"
 #include "options.hpp"
+#include "profile.hpp"
+#include "threads.hpp"
 
 namespace pharos {
 
@@ -325,6 +330,7 @@ P2::PartitionerPtr create_partitioner(const ProgOptVarMap& vm, P2::Engine* engin
   //partitioner->memoryMap().dump(mlog[INFO]);
 
   // Run the partitioner
+  ProgramProfileTimer partition_timer{"partition"};
   if (vm.count("serialize")) {
     // Partitioner data is or will be serialized
 
@@ -889,6 +895,203 @@ class SpeculativeBasicBlock {
 
 };
 
+namespace {
+
+using ArchitectureConstPtr = Rose::BinaryAnalysis::Architecture::BaseConstPtr;
+
+// The number of gaps speculatively evaluated with each instruction decoder.
+constexpr size_t gap_batch_size = 64;
+
+// The number of consecutive instructions decoded at once while evaluating a gap.
+constexpr size_t gap_decode_run = 16;
+
+// The result of speculatively evaluating a gap for create_arbitrary_code().
+struct GapCandidate {
+  AddressInterval gap;
+  // The address of the first speculative block, after any padding at the start of the gap.
+  rose_addr_t start = 0;
+  // Is the first speculative block certainly not code?
+  bool rejected = false;
+};
+
+// The facts that gap evaluation needs about an instruction, so that the instruction itself can
+// be discarded immediately.
+struct GapInstruction {
+  // A known X86 instruction was decoded.
+  bool valid = false;
+  bool zero = false;
+  bool int3 = false;
+  // The instruction only falls through, and its successors are complete.
+  bool plain = false;
+  size_t size = 0;
+};
+
+GapInstruction
+summarize_gap_instruction(ArchitectureConstPtr const & arch, SgAsmInstruction *insn)
+{
+  GapInstruction result;
+  result.size = insn->get_size();
+  result.zero = check_zero_insn(insn);
+  SgAsmX86Instruction *xinsn = isSgAsmX86Instruction(insn);
+  if (xinsn && !arch->isUnknown(insn)) {
+    result.valid = true;
+    result.int3 = xinsn->get_kind() == x86_int3;
+    bool complete;
+    auto successors = arch->getSuccessors(insn, complete);
+    rose_addr_t fallthru = insn->get_address() + insn->get_size();
+    result.plain = complete && successors.size() == 1 && successors.exists(fallthru);
+  }
+  return result;
+}
+
+// Decodes the instructions in gaps for evaluate_gap().  Gaps are evaluated on several threads
+// at once, so the instructions are decoded a run of consecutive instructions at a time (see
+// InstructionBatch), and the summaries are kept so that the lookahead for zero and int3
+// instructions usually finds the next instruction already decoded.
+class GapDecoder {
+  ArchitectureConstPtr arch;
+  InstructionBatch batch;
+  std::map<rose_addr_t, GapInstruction> summaries;
+
+ public:
+  GapDecoder(ArchitectureConstPtr const & arch_, MemoryMap::Ptr const & map)
+    : arch(arch_), batch(arch_->newInstructionDecoder(), map) {}
+
+  // The summary of the instruction at addr.  The rest of the run following it is decoded at
+  // the same time, up to the end of the gap.
+  const GapInstruction & operator()(rose_addr_t addr, rose_addr_t greatest) {
+    auto found = summaries.find(addr);
+    if (found != summaries.end()) return found->second;
+    batch.decode_run(addr, gap_decode_run, greatest);
+    for (SgAsmInstruction *insn : batch.instructions()) {
+      summaries.emplace(insn->get_address(), summarize_gap_instruction(arch, insn));
+    }
+    // If nothing could be decoded at addr, the default summary isn't a valid instruction.
+    return summaries[addr];
+  }
+
+  // Forget the summaries, which are only useful within one gap.
+  void clear() { summaries.clear(); }
+
+  double get_lock_wait() const { return batch.get_lock_wait(); }
+};
+
+bool
+read_gap_byte(MemoryMap::Ptr const & map, rose_addr_t addr, uint8_t & byte) {
+  return 1 == map->at(addr).limit(1).require(MemoryMap::EXECUTABLE).read(&byte).size();
+}
+
+// Decide whether the first speculative block that create_arbitrary_code() would make in a gap
+// is certainly not code, using only the bytes of the gap and a private instruction decoder, so
+// that many gaps can be evaluated at once without touching the partitioner.  This mirrors the
+// padding detection of CERTEngine::try_making_padding_block() and the rejections made by
+// SpeculativeBasicBlock::analyze().  Anything that would depend on the address usage outside
+// of the gap, or on the successors of a control flow instruction, is left undecided for the
+// serial analysis.  Since nothing in the gap was in use when it was found, the result remains
+// correct for as long as the gap is still entirely unused.
+void
+evaluate_gap(GapDecoder & decoder, MemoryMap::Ptr const & map, size_t zero_threshold,
+             GapCandidate & candidate)
+{
+  rose_addr_t least = candidate.gap.least();
+  rose_addr_t greatest = candidate.gap.greatest();
+
+  // Skip the padding that will be made at the start of the gap.
+  candidate.start = least;
+  uint8_t pad;
+  if (read_gap_byte(map, least, pad) && (pad == 0xCC || pad == 0x90)) {
+    rose_addr_t last = least;
+    uint8_t byte;
+    while (read_gap_byte(map, last + 1, byte) && byte == pad) ++last;
+    candidate.start = last + 1;
+  }
+
+  decoder.clear();
+  auto decode = [&](rose_addr_t addr) {
+    return decoder(addr, greatest);
+  };
+
+  // The number of zero instructions in the block so far.
+  size_t zeros = 0;
+  rose_addr_t current = candidate.start;
+  if (current >= greatest) return;
+  while (current <= greatest) {
+    GapInstruction insn = decode(current);
+
+    // The same test as RefuseZeroCode::check_zeros(), which skips the instruction immediately
+    // after the first zero instruction.
+    if (insn.zero) {
+      size_t found = 1;
+      rose_addr_t next = current + 2;
+      bool zero = true;
+      while (zero && found < zero_threshold) {
+        next += 2;
+        zero = decode(next).zero;
+        found++;
+      }
+      if (found + zeros >= zero_threshold) {
+        candidate.rejected = true;
+        return;
+      }
+    }
+
+    if (!insn.valid) {
+      candidate.rejected = true;
+      return;
+    }
+    // Whether an instruction extending past the gap overlaps something depends on the
+    // address usage outside of the gap.
+    if (current + insn.size - 1 > greatest) return;
+
+    if (insn.int3) {
+      if (current + 1 > greatest) return;
+      GapInstruction next = decode(current + 1);
+      if (next.valid && next.int3) {
+        candidate.rejected = true;
+        return;
+      }
+    }
+
+    if (insn.zero) zeros++;
+    // The block ends here, and its validity depends on the successors.
+    if (!insn.plain) return;
+    current += insn.size;
+  }
+}
+
+} // unnamed namespace
+
+void
+CERTEngine::make_gap_data_block(P2::PartitionerPtr const & partitioner,
+                                rose_addr_t current, rose_addr_t greatest) {
+  P2::DataBlock::Ptr dblock = try_making_padding_block(partitioner, current);
+  if (dblock) return;
+
+  rose_addr_t end = current;
+  while (true) {
+    try {
+      if (read_byte(end) == 0xCC) break;
+      if (end == greatest) break;
+      ++end;
+    }
+    catch (const Monitor::ResourceException &e) {
+      // Make sure we keep propagating ResourceExceptions back up to the caller so we
+      // can terminate.
+      throw;
+    }
+    // ejs: Why is this here? What exceptions is it supposed to be catching?
+    catch (std::exception& e) {
+      break;
+    }
+  }
+  size_t len = end - current + 1;
+
+  P2::DataBlock::Ptr resized_dblock = P2::DataBlock::instanceBytes(current, len);
+  partitioner->attachDataBlock(resized_dblock);
+  //OINFO << "Data block at " << addr_str(dblock->address()) << " was "
+  //      << dblock->size() << " bytes long." << LEND;
+}
+
 bool
 CERTEngine::create_arbitrary_code(P2::PartitionerPtr const & partitioner) {
   // Have we changed anything?
@@ -902,28 +1105,69 @@ CERTEngine::create_arbitrary_code(P2::PartitionerPtr const & partitioner) {
       executableSpace.insert(node.key());
   }
 
+  size_t zero_threshold = RefuseZeroCode::instance()->get_threshold();
+
   while (true) {
     AddressIntervalSet unused = partitioner->aum().unusedExtent(executableSpace);
 
-    // For each unused interval.
+    // Find the gaps that we haven't already analyzed.
+    std::vector<GapCandidate> candidates;
     for (const AddressInterval &interval : unused.intervals()) {
-      rose_addr_t least = interval.least();
-      rose_addr_t greatest = interval.greatest();
-
       // If we've considered making code at this exact address once before, either we've already
       // made code or we've decided not to.  Nothing from subsequent analysis is going to change
       // that conclusion, so we're done.
-      if (not_code_gaps.exists(least)) {
-        GDEBUG << "Arbitrary code gap: " << addr_str(least) << " - " << addr_str(greatest)
-               << " -- previously analyzed." << LEND;
+      if (not_code_gaps.exists(interval.least())) {
+        GDEBUG << "Arbitrary code gap: " << addr_str(interval.least()) << " - "
+               << addr_str(interval.greatest()) << " -- previously analyzed." << LEND;
         continue;
       }
+      candidates.push_back(GapCandidate{interval});
+    }
+
+    // Most of the gaps in packed or poorly structured programs aren't code, and decoding them
+    // one at a time through the partitioner is slow.  So first evaluate all of the gaps in
+    // parallel, and identify the ones that certainly aren't code.
+    size_t speculated = 0;
+    if (nthreads > 1 && candidates.size() > 1) {
+      auto timer = make_timer();
+      std::vector<std::pair<size_t, size_t>> batches;
+      for (size_t b = 0; b < candidates.size(); b += gap_batch_size) {
+        batches.emplace_back(b, std::min(candidates.size(), b + gap_batch_size));
+      }
+      ArchitectureConstPtr arch = obtainArchitecture();
+      MemoryMap::Ptr map = partitioner->memoryMap();
+      // The time each batch spent waiting for the Sage pool lock.
+      std::vector<double> lock_waits(batches.size());
+      auto evaluate_batch = [&](const std::pair<size_t, size_t> & batch) {
+        GapDecoder decoder(arch, map);
+        for (size_t i = batch.first; i < batch.second; ++i) {
+          evaluate_gap(decoder, map, zero_threshold, candidates[i]);
+        }
+        lock_waits[&batch - batches.data()] = decoder.get_lock_wait();
+      };
+      parallel_for_each(batches, nthreads, evaluate_batch);
+      size_t rejected = std::count_if(candidates.begin(), candidates.end(),
+                                      [](const GapCandidate & c) { return c.rejected; });
+      double lock_wait = std::accumulate(lock_waits.begin(), lock_waits.end(), 0.0);
+      GDEBUG << "Speculatively rejected " << rejected << " of " << candidates.size()
+             << " arbitrary code gaps in " << timer.stop().count() << " seconds, waiting "
+             << lock_wait << " seconds in total for the Sage pool lock." << LEND;
+    }
+
+    // Then make code (or data) in each gap in address order.
+    for (const GapCandidate &candidate : candidates) {
+      rose_addr_t least = candidate.gap.least();
+      rose_addr_t greatest = candidate.gap.greatest();
 
       //OINFO << "Arbitrary code gap: " << addr_str(least) << " - " << addr_str(greatest) << LEND;
 
       // Mark this gap as having been analyzed already so that we don't try to analyze it again.
       not_code_gaps.insert(least);
 
+      // The speculative evaluation no longer holds if code made in an earlier gap has flowed
+      // into this one.
+      bool rejected = candidate.rejected && !partitioner->aum().anyExists(candidate.gap);
+
       // We're going to look at each address.
       rose_addr_t current = least;
 
@@ -936,6 +1180,13 @@ CERTEngine::create_arbitrary_code(P2::PartitionerPtr const & partitioner) {
         //OINFO << "Advancing to next address at " << addr_str(current) << LEND;
       }
 
+      // If the first block certainly isn't code, we're done with this gap.
+      if (rejected && current == candidate.start) {
+        make_gap_data_block(partitioner, current, greatest);
+        speculated++;
+        continue;
+      }
+
       // For each address in the block (or until we don't have a fallthru edge)...
       while (current < greatest) {
         SpeculativeBasicBlock sbb(partitioner, current, greatest + 1);
@@ -949,33 +1200,7 @@ CERTEngine::create_arbitrary_code(P2::PartitionerPtr const & partitioner) {
         // If it wasn't a valid block we're done with this gap.
         if (!valid) {
           //OINFO << "Block at " << addr_str(current) << " was not valid code." << LEND;
-
-          P2::DataBlock::Ptr dblock = try_making_padding_block(partitioner, current);
-          if (dblock) break;
-
-          rose_addr_t end = current;
-          while (true) {
-            try {
-              if (read_byte(end) == 0xCC) break;
-              if (end == greatest) break;
-              ++end;
-            }
-            catch (const Monitor::ResourceException &e) {
-              // Make sure we keep propagating ResourceExceptions back up to the caller so we
-              // can terminate.
-              throw;
-            }
-            // ejs: Why is this here? What exceptions is it supposed to be catching?
-            catch (std::exception& e) {
-              break;
-            }
-          }
-          size_t len = end - current + 1;
-
-          P2::DataBlock::Ptr resized_dblock = P2::DataBlock::instanceBytes(current, len);
-          partitioner->attachDataBlock(resized_dblock);
-          //OINFO << "Data block at " << addr_str(dblock->address()) << " was "
-          //      << dblock->size() << " bytes long." << LEND;
+          make_gap_data_block(partitioner, current, greatest);
           break;
         }
         // If there was already a block at this address, we're done with this gap.
@@ -1084,6 +1309,10 @@ CERTEngine::create_arbitrary_code(P2::PartitionerPtr const & partitioner) {
       //OINFO << "Reached end of gap: " << addr_str(least) << " - " << addr_str(greatest) << LEND;
     }
 
+    if (speculated) {
+      GDEBUG << "Made data in " << speculated << " speculatively rejected gaps." << LEND;
+    }
+
     if (!changed) break;
     changed = false;
   }
@@ -1343,6 +1572,67 @@ check_zero_insn(SgAsmInstruction *insn) {
   return true;
 }
 
+namespace {
+std_mutex sage_pool_mutex;
+} // unnamed namespace
+
+InstructionBatch::InstructionBatch(DecoderPtr const & decoder_, MemoryMap::Ptr const & map_)
+  : decoder(decoder_), map(map_) {}
+
+InstructionBatch::~InstructionBatch()
+{
+  write_guard<decltype(sage_pool_mutex)> guard{sage_pool_mutex};
+  release();
+}
+
+SgAsmInstruction*
+InstructionBatch::decode(rose_addr_t addr)
+{
+  try {
+    return decoder->disassembleOne(map, addr);
+  }
+  catch (const Rose::BinaryAnalysis::Disassembler::Exception &) {
+    return nullptr;
+  }
+}
+
+void
+InstructionBatch::release()
+{
+  for (SgAsmInstruction *insn : insns) {
+    if (insn) SageInterface::deleteAST(insn);
+  }
+  insns.clear();
+}
+
+void
+InstructionBatch::decode_range(rose_addr_t addr, size_t count)
+{
+  auto timer = make_timer();
+  write_guard<decltype(sage_pool_mutex)> guard{sage_pool_mutex};
+  lock_wait += timer.stop().count();
+  release();
+  for (size_t i = 0; i < count; ++i) {
+    insns.push_back(decode(addr + i));
+  }
+}
+
+void
+InstructionBatch::decode_run(rose_addr_t addr, size_t count, rose_addr_t limit)
+{
+  auto timer = make_timer();
+  write_guard<decltype(sage_pool_mutex)> guard{sage_pool_mutex};
+  lock_wait += timer.stop().count();
+  release();
+  while (insns.size() < count && map->at(addr).require(MemoryMap::EXECUTABLE).exists()) {
+    SgAsmInstruction *insn = decode(addr);
+    if (!insn) break;
+    insns.push_back(insn);
+    addr += insn->get_size();
+    if (addr > limit) break;
+  }
+}
+
 bool
 RefuseZeroCode::operator()(bool chain, const Args &args) {
   if (chain) {
@@ -1602,60 +1892,37 @@ CERTEngine::createTunedPartitioner() {
 
 // ==========================================================================================
 
-// For the Superset engine, the partioning algorithm is very simple.
+// For the Superset engine, the superset disassembly provides additional function entry points
+// to the standard partitioning algorithm.
 void
 SupersetEngine::runPartitioner(P2::PartitionerPtr const &partitioner) {
   OINFO << "Running the superset partitioning algorithm." << LEND;
 
-  Rose::BinaryAnalysis::InstructionProvider& ip = partitioner->instructionProvider();
-
-  auto mmap = partitioner->memoryMap();
-
-  // The minimum and maximum addresses that we visited.
-  rose_addr_t least = 0;  //
-  rose_addr_t greatest = 0;
-
-  // The memory map is IntervalMap, which maps Intervals to Buffers.  Each Interval and Buffer
-  // represents a contiguous, identically protected region of program memory.  The Interval
-  // itself is also iterable, and contains the addresses of the region.
-  for (Sawyer::Container::Interval<rose_addr_t> interval : mmap->intervals()) {
-
-    rose_addr_t l = interval.least();
-    rose_addr_t g = interval.greatest();
-    GINFO << "Disassembling segment " << addr_str(l) << " - " << addr_str(g) << LEND;
-    if (l < least || least == 0) least = l;
-    if (g > greatest) greatest = g;
-
-    for (rose_addr_t addr : interval) {
-      // Too verbose to be of much use.
-      //GDEBUG << "Disassembling " << addr_str(addr) << LEND;
-
-      // Disassemble the instruction, and store it in the instruction provider cache.
-      SgAsmInstruction* insn = ip[addr];
-
-      // If there's no instruction at that address, move on to the next one.
-      if (!insn || insn->architecture()->isUnknown(insn)) continue;
-
-      OINFO << boost::str(boost::format("%-60s") % debug_instruction(insn, 12)); // No LEND!
-
-      // Get the successor from the instruction.  This code can't be here permanently, because
-      // we need to create each instruction vertex in the graph before creating the edges, but
-      // it's a start.
-      bool complete;
-      auto successors = insn->architecture()->getSuccessors(insn, complete);
-      if (successors.size() > 0) {
-        for (rose_addr_t saddr : successors.values()) {
-          OINFO << addr_str(saddr) << " ";
-        }
-        OINFO << LEND;
-      }
-      else {
-        OINFO << "None" << LEND;
-      }
-    }
+  size_t threshold = RefuseZeroCode::instance()->get_threshold();
+  SupersetDisassembly superset(obtainArchitecture(), partitioner, nthreads, threshold);
+  const SupersetDisassembly::Stats & stats = superset.get_stats();
+  OINFO << "Superset disassembly decoded " << stats.decoded << " of " << stats.offsets
+        << " executable offsets in " << stats.decode_seconds << " seconds, and kept "
+        << stats.valid << " after pruning in " << stats.prune_seconds << " seconds." << LEND;
+  GDEBUG << "The superset decoding threads waited " << stats.lock_wait_seconds
+         << " seconds in total for the Sage pool lock." << LEND;
+  GDEBUG << "The superset control flow graph has " << stats.edges << " edges." << LEND;
+
+  runPartitionerInit(partitioner);
+
+  // Make a function at each call target that survived, and let the partitioner find the code
+  // reachable from them along with everything else.
+  size_t seeded = 0;
+  for (rose_addr_t target : superset.call_targets()) {
+    if (partitioner->functionExists(target)) continue;
+    partitioner->attachOrMergeFunction(
+      P2::Function::instance(target, SgAsmFunction::FUNC_CALL_TARGET));
+    ++seeded;
   }
+  OINFO << "Superset disassembly seeded " << seeded << " functions." << LEND;
 
-  GINFO << "Disassembled addresses " << addr_str(least) << " - " << addr_str(greatest) << LEND;
+  runPartitionerRecursive(partitioner);
+  runPartitionerFinal(partitioner);
 }
 
 // ==========================================================================================
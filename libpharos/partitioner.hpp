@@ -42,6 +42,8 @@ class RefuseZeroCode: public P2::BasicBlockCallback {
   // The official interface that allows us to function as a basic block callback.
   bool operator()(bool chain, const Args &args) override;
 
+  // The number of consecutive zero instructions that aren't code.
+  size_t get_threshold() const { return threshold; }
 
   // Returns true if the code referenced meets the threshold for being bad code.  If the
   // address does NOT point to a "zero instruction" (or other invalid instructions) this
@@ -77,6 +79,49 @@ class RefuseOverlappingCode: public P2::BasicBlockCallback {
 // Returns true if and only if the instruction is a zero instruction (two bytes of zeros).
 bool check_zero_insn(SgAsmInstruction* insn);
 
+// ROSE allocates Sage nodes from global per-class memory pools that aren't documented to be
+// thread safe, so code that decodes instructions on more than one thread at a time (the
+// superset disassembler and the parallel gap evaluation) must create and delete them through
+// an InstructionBatch, which holds one process-wide lock while it does.  Each call decodes a
+// whole batch of instructions, and deletes the previous batch, with a single acquisition of
+// the lock, so that the threads contend for it once per batch rather than twice per
+// instruction.  Examining the decoded instructions doesn't touch the pools, and is done
+// without the lock.
+class InstructionBatch {
+ public:
+  using DecoderPtr = Rose::BinaryAnalysis::Disassembler::BasePtr;
+
+  InstructionBatch(DecoderPtr const & decoder, MemoryMap::Ptr const & map);
+  InstructionBatch(const InstructionBatch &) = delete;
+  InstructionBatch & operator=(const InstructionBatch &) = delete;
+  ~InstructionBatch();
+
+  // Replace the batch with the instructions at each of the count consecutive addresses
+  // starting at addr.  The instruction at an address that can't be decoded is null.
+  void decode_range(rose_addr_t addr, size_t count);
+
+  // Replace the batch with up to count instructions that follow one another, starting at addr.
+  // The run stops at the first address that isn't executable or can't be decoded, or that is
+  // beyond limit.
+  void decode_run(rose_addr_t addr, size_t count, rose_addr_t limit);
+
+  const std::vector<SgAsmInstruction*> & instructions() const { return insns; }
+
+  // The total time spent waiting to acquire the lock, in seconds.
+  double get_lock_wait() const { return lock_wait; }
+
+ private:
+  DecoderPtr decoder;
+  MemoryMap::Ptr map;
+  std::vector<SgAsmInstruction*> insns;
+  double lock_wait = 0.0;
+
+  // Decode one instruction, returning null if it can't be decoded.  Requires the lock.
+  SgAsmInstruction* decode(rose_addr_t addr);
+  // Delete the instructions in the batch.  Requires the lock.
+  void release();
+};
+
 // Look for unconditional jumps to code that match a prologue pattern, and then make the jump a
 // thunk, and the target a separate function.  This is required to work-around an issue where
 // ROSE doesn't look at the target of the jump, resulting in inconsistent thunk-splitting
@@ -150,13 +195,18 @@ class NamePredicate :
   }
 };
 
+// An engine that disassembles every byte offset of the executable memory in parallel (see
+// superset.hpp), and then runs the standard partitioner seeded with the call targets that
+// survive pruning.  This finds code in obfuscated programs that the recursive partitioner
+// misses because it's only reachable through control flow that can't be followed statically.
 class SupersetEngine: public P2Engine {
  private:
+  unsigned int nthreads;
 
  public:
-  SupersetEngine() : P2Engine(P2::Engine::Settings{}) {}
+  SupersetEngine(unsigned int nthreads_ = 1)
+    : P2Engine(P2::Engine::Settings{}), nthreads(nthreads_) {}
 
-  // We're going to override this so that it hardly uses the real partitioner at all...
   virtual void runPartitioner(P2::PartitionerPtr const & partitioner) override;
 };
 
@@ -168,6 +218,8 @@ class SupersetEngine: public P2Engine {
 class CERTEngine: public P2Engine {
  private:
 
+  // The number of threads used to speculatively evaluate gaps in create_arbitrary_code().
+  unsigned int nthreads;
   MatchJmpToPrologue::Ptr jump_to_prologue_matcher;
   RefuseOverlappingCode::Ptr overlapping_code_detector;
   Rose::BinaryAnalysis::AddressSet not_pad_gaps;
@@ -184,13 +236,18 @@ class CERTEngine: public P2Engine {
   P2::DataBlock::Ptr try_making_padding_block(
     P2::PartitionerPtr const & partitioner, rose_addr_t addr, bool backwards = false);
 
+  // Make a data block for a gap (from current to greatest) that isn't code.
+  void make_gap_data_block(P2::PartitionerPtr const & partitioner,
+                           rose_addr_t current, rose_addr_t greatest);
+
   bool bad_code(P2::PartitionerConstPtr const & partitioner, const P2::BasicBlock::Ptr bb) const;
   bool consume_thunks(P2::PartitionerPtr const & partitioner, bool top, bool bottom);
   bool consume_padding(P2::PartitionerPtr const & partitioner, bool top, bool bottom);
   bool create_arbitrary_code(P2::PartitionerPtr const & partitioner);
 
  public:
-  CERTEngine() : P2Engine(P2::Engine::Settings{}) {}
+  CERTEngine(unsigned int nthreads_ = 1)
+    : P2Engine(P2::Engine::Settings{}), nthreads(nthreads_) {}
 
   // Add our extensions to the partitioner.
   virtual P2::PartitionerPtr createTunedPartitioner() override;
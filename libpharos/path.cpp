@@ -1,5 +1,7 @@
 // Copyright 2018-2024 Carnegie Mellon University.  See LICENSE file for terms.
 
+#include <chrono>
+
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/graph_utility.hpp>
 #include <boost/graph/graphviz.hpp>
@@ -1145,6 +1147,12 @@ PathFinder::find_path(rose_addr_t start_addr, rose_addr_t goal_addr) {
     return false;
   }
 
+  // Each incremental query has its own solution.
+  if (incremental_) {
+    path_found_ = false;
+    path_.clear();
+  }
+
   try {
     setup_path_problem(start_addr, goal_addr);
   } catch (FindPathError const & e) {
@@ -1232,6 +1240,33 @@ PathFinder::save_z3_output() {
   save_z3_output_ = true;
 }
 
+void
+PathFinder::set_incremental(bool incremental) {
+  if (incremental != incremental_) {
+    reset_problem();
+    incremental_ = incremental;
+  }
+}
+
+bool
+PathFinder::is_incremental() const {
+  return incremental_;
+}
+
+void
+PathFinder::report_statistics() const {
+  if (incremental_) {
+    OINFO << "Incremental path solving: " << incremental_stats_.queries << " queries, "
+          << "call trace constraints built " << incremental_stats_.base_builds << " times in "
+          << incremental_stats_.base_seconds << " seconds, an estimated "
+          << incremental_stats_.seconds_saved << " seconds saved by reusing them." << LEND;
+  }
+  const PharosZ3Solver::TranslationStats & ts = z3_->get_translation_stats();
+  OINFO << "Expression translation: " << ts.misses << " translated in " << ts.miss_seconds
+        << " seconds, " << ts.hits << " reused, an estimated " << ts.seconds_saved()
+        << " seconds saved." << LEND;
+}
+
 std::string
 PathFinder::get_z3_output() {
 
@@ -1304,6 +1339,52 @@ PathFinder::detect_recursion() {
   return false;
 }
 
+void
+PathFinder::setup_call_trace_problem(const FunctionDescriptor* start_fd)
+{
+  std::vector<rose_addr_t> trace_stack;
+
+  // JSG is trying to turn this into a graph problem. The first step
+  // is to "unwind" the call relationships in to a trace.
+
+  generate_call_trace(NULL_CTG_VERTEX, start_fd, nullptr, trace_stack);
+
+  generate_chc();
+
+  generate_value_constraints();
+
+  // Load all the conditions into
+  z3::solver* solver = z3_->z3Solver();
+
+  BGL_FORALL_VERTICES(vtx, call_trace_, CallTraceGraph) {
+
+    calltrace_value_t trc_info = boost::get(boost::vertex_calltrace, call_trace_, vtx);
+
+    z3::expr_vector cfg_conds = trc_info->get_cfg_conditions();
+    for (unsigned c=0; c<cfg_conds.size(); c++) solver->add(cfg_conds[c]);
+
+    auto edge_constraint = trc_info->get_edge_constraints();
+    boost::for_each(edge_constraint | boost::adaptors::map_values,
+                    [solver](z3::expr edge_expr) { solver->add(edge_expr); });
+
+    // TODO Remove this if the above loop works
+    // for (unsigned e=0; e<edge_constraint.size(); e++) solver->add(edge_constraint[e]);
+
+    z3::expr_vector val_const = trc_info->get_value_constraints();
+    for (unsigned v=0; v<val_const.size(); v++)  solver->add(val_const[v]);
+  }
+}
+
+void
+PathFinder::reset_problem()
+{
+  z3_->z3Solver()->reset();
+  query_scope_ = false;
+  base_function_ = INVALID_ADDRESS;
+  call_trace_.clear();
+  frame_index_ = 0;
+}
+
 void
 PathFinder::setup_path_problem(rose_addr_t source, rose_addr_t target)
 {
@@ -1317,29 +1398,46 @@ PathFinder::setup_path_problem(rose_addr_t source, rose_addr_t target)
   const FunctionDescriptor* start_fd = ds_.get_func_containing_address(start_address_);
   const FunctionDescriptor* goal_fd = ds_.get_func_containing_address(goal_address_);
 
-  if (start_fd && goal_fd) {
-
-    // if (detect_recursion()) {
-    //   GWARN << "Recursion not yet handled!" << LEND;
-    //   return false;
-    // }
-
-    std::vector<rose_addr_t> trace_stack;
-
-    // JSG is trying to turn this into a graph problem. The first step
-    // is to "unwind" the call relationships in to a trace.
+  if (!start_fd || !goal_fd) {
+    throw FindPathError("Could not find valid functions for start and/or goal");
+  }
 
-    generate_call_trace(NULL_CTG_VERTEX, start_fd, nullptr, trace_stack);
+  // if (detect_recursion()) {
+  //   GWARN << "Recursion not yet handled!" << LEND;
+  //   return false;
+  // }
 
-    generate_chc();
+  z3::solver* solver = z3_->z3Solver();
 
+  if (incremental_) {
+    // Discard the start and goal constraints from the previous query.
+    if (query_scope_) {
+      solver->pop();
+      query_scope_ = false;
+    }
+    ++incremental_stats_.queries;
+    if (base_function_ == start_fd->get_address()) {
+      incremental_stats_.seconds_saved += incremental_stats_.last_base_seconds;
+      GDEBUG << "Reusing the call trace constraints for "
+             << addr_str(base_function_) << LEND;
+    }
+    else {
+      reset_problem();
+      auto start = std::chrono::steady_clock::now();
+      setup_call_trace_problem(start_fd);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      base_function_ = start_fd->get_address();
+      ++incremental_stats_.base_builds;
+      incremental_stats_.base_seconds += elapsed.count();
+      incremental_stats_.last_base_seconds = elapsed.count();
+    }
+    solver->push();
+    query_scope_ = true;
   }
   else {
-    throw FindPathError("Could not find valid functions for start and/or goal");
+    setup_call_trace_problem(start_fd);
   }
 
-  generate_value_constraints();
-
   auto ctx = z3_->z3Context();
 
   z3::expr start_constraint(*ctx);
@@ -1350,27 +1448,6 @@ PathFinder::setup_path_problem(rose_addr_t source, rose_addr_t target)
     throw FindPathError("Could not establish start/goal!");
   }
 
-  // Load all the conditions into
-  z3::solver* solver = z3_->z3Solver();
-
-  BGL_FORALL_VERTICES(vtx, call_trace_, CallTraceGraph) {
-
-    calltrace_value_t trc_info = boost::get(boost::vertex_calltrace, call_trace_, vtx);
-
-    z3::expr_vector cfg_conds = trc_info->get_cfg_conditions();
-    for (unsigned c=0; c<cfg_conds.size(); c++) solver->add(cfg_conds[c]);
-
-    auto edge_constraint = trc_info->get_edge_constraints();
-    boost::for_each(edge_constraint | boost::adaptors::map_values,
-                    [solver](z3::expr edge_expr) { solver->add(edge_expr); });
-
-    // TODO Remove this if the above loop works
-    // for (unsigned e=0; e<edge_constraint.size(); e++) solver->add(edge_constraint[e]);
-
-    z3::expr_vector val_const = trc_info->get_value_constraints();
-    for (unsigned v=0; v<val_const.size(); v++)  solver->add(val_const[v]);
-  }
-
   solver->add(start_constraint);
   solver->add(goal_constraint);
 }
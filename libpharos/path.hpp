@@ -324,6 +324,31 @@ class PathFinder : public Z3PathAnalyzer {
 
   std::vector<std::string> z3_output_;
 
+  // In incremental mode, the constraints for the call trace from the start function are
+  // asserted once, and the start and goal constraints for each query are asserted in a
+  // push/pop scope, so that several goals can be checked without rebuilding the problem.
+  bool incremental_ = false;
+
+  // The start function whose call trace constraints are asserted, in incremental mode.
+  rose_addr_t base_function_ = INVALID_ADDRESS;
+
+  // Is there a scope for the current query that needs to be popped?
+  bool query_scope_ = false;
+
+  struct IncrementalStats {
+    // The number of queries.
+    size_t queries = 0;
+    // The number of times the call trace constraints were built and asserted.
+    size_t base_builds = 0;
+    // The time spent building and asserting the call trace constraints.
+    double base_seconds = 0.0;
+    // The time it took to build the current call trace constraints.
+    double last_base_seconds = 0.0;
+    // The time saved by reusing the call trace constraints.
+    double seconds_saved = 0.0;
+  };
+  IncrementalStats incremental_stats_;
+
   bool detect_recursion();
 
   TreeNodePtr evaluate_model_value(TreeNodePtr tn, const ExprMap& modelz3vals);
@@ -366,6 +391,12 @@ class PathFinder : public Z3PathAnalyzer {
 
   bool generate_value_constraints();
 
+  // Build the call trace from the start function, and assert the constraints for it.
+  void setup_call_trace_problem(const FunctionDescriptor* start_fd);
+
+  // Discard the call trace and all of the asserted constraints.
+  void reset_problem();
+
   // This must be done at a global level
   void assign_traversal_values(PathPtr trv, ExprMap& modelz3vals);
 
@@ -385,6 +416,12 @@ class PathFinder : public Z3PathAnalyzer {
   PathPtrList get_path() const;
   void save_z3_output();
   std::string get_z3_output();
+
+  // Enable incremental solving of several goals from the same start function.
+  void set_incremental(bool incremental);
+  bool is_incremental() const;
+  // Log the incremental solving and expression translation statistics.
+  void report_statistics() const;
   void save_call_trace(std::ostream& o);
   void print_call_trace();
 
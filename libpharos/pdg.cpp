@@ -367,6 +367,39 @@ struct ltAsmInsn {
   }
 };
 
+// The dependencies of an instruction, in the order that getSlice() visits them.  The
+// dependencies are ordered by address, and a data dependency hides a control dependency on the
+// same instruction.
+static std::vector<std::pair<SgAsmX86Instruction *, bool>> slice_dependencies(
+  SgAsmX86Instruction *insn, const Addr2DUChainMap& data_deps,
+  const Addr2InsnSetMap& control_deps)
+{
+  using InsnBoolPairSet = std::set<InsnBoolPair, ltAsmInsn>;
+  InsnBoolPairSet dependencies;
+  rose_addr_t iaddr = insn->get_address();
+
+  auto dfinder = data_deps.find(iaddr);
+  if (dfinder != data_deps.end()) {
+    for (const Definition& def : dfinder->second) {
+      if (def.definer && def.definer->get_address() != iaddr) {
+        dependencies.insert(InsnBoolPair(def.definer, true));
+      }
+    }
+  }
+
+  auto cfinder = control_deps.find(iaddr);
+  if (cfinder != control_deps.end()) {
+    for (SgAsmInstruction* i : cfinder->second) {
+      SgAsmX86Instruction *xi = isSgAsmX86Instruction(i);
+      if (xi && xi->get_address() != iaddr) {
+        dependencies.insert(InsnBoolPair(xi, false));
+      }
+    }
+  }
+
+  return std::vector<InsnBoolPair>(dependencies.begin(), dependencies.end());
+}
+
 std::string PDG::getSlice(SgAsmX86Instruction *insn, Slice &s) const {
   if (insn == NULL) return "";
 
@@ -392,32 +425,8 @@ std::string PDG::getSlice(SgAsmX86Instruction *insn, Slice &s) const {
   }
   s.insert(pn);
 
-  using InsnBoolPairSet = std::set<InsnBoolPair, ltAsmInsn>;
-
-  InsnBoolPairSet dependencies;
-
-  // Insert the data-dependencies of this instruction
-  if (data_deps.find(iaddr) != data_deps.end()) {
-    for (const Definition& def : data_deps.at(iaddr)) {
-      if (def.definer && def.definer->get_address() != iaddr) {
-        dependencies.insert(InsnBoolPair(def.definer, true));
-      }
-    }
-  }
-
-  // Insert the control dependencies of this block
-  if (control_deps.find(iaddr) != control_deps.end()) {
-    for (SgAsmInstruction* i : control_deps.at(iaddr)) {
-      if (isSgAsmX86Instruction(i)) {
-        if (i->get_address() != iaddr) {
-          dependencies.insert(InsnBoolPair(isSgAsmX86Instruction(i), false));
-        }
-      }
-    }
-  }
-
   // Build the dependency string and visit the instructions in address order
-  for (const InsnBoolPair &b : dependencies) {
+  for (const InsnBoolPair &b : slice_dependencies(insn, data_deps, control_deps)) {
     // Represent a data-dependency edge
     AddrVector constants2;
     if (b.second && b.first != NULL) {
@@ -478,39 +487,57 @@ std::string PDG::dumpOperands(SgAsmX86Instruction *insn, AddrVector& constants)
   return opstr;
 }
 
-size_t PDG::hashSlice(
-  SgAsmX86Instruction *insn, size_t nHashFunc, std::vector<unsigned int> & hashes) const
-{
-  Slice s;
-  std::string slice_str = getSlice(insn,s);
-  size_t count = s.size();
+// Return the index of the node for an instruction, adding a node (without its dependencies)
+// if there isn't one yet.
+size_t PDG::getSliceNode(SliceGraph &graph, SgAsmX86Instruction *insn) const {
+  auto inserted = graph.index.emplace(insn, graph.nodes.size());
+  if (inserted.second) {
+    AddrVector constants;
+    graph.nodes.push_back(SliceGraph::Node{insn, getInstructionString(insn, constants), {}});
+  }
+  return inserted.first->second;
+}
 
-  SDEBUG << "Slice string: " << slice_str << LEND;
+// Add a node for every instruction in the function, and every instruction that they depend on.
+void PDG::buildSliceGraph(SliceGraph &graph) const {
+  const Addr2DUChainMap& data_deps = du.get_dependencies();
+  for (SgAsmStatement* bs : fd->get_func()->get_statementList()) {
+    SgAsmBlock *bb = isSgAsmBlock(bs);
+    assert(bb);
+    for (SgAsmStatement* is : bb->get_statementList()) {
+      SgAsmX86Instruction *insn = isSgAsmX86Instruction(is);
+      if (insn) getSliceNode(graph, insn);
+    }
+  }
 
-  // The seed for each hash function is a hash function number concatenated
-  // to the mnem_str string
-  for (size_t x = 0; x < nHashFunc; x++ ) {
-    std::ostringstream convert;
-    convert << x;
-    std::string temp = slice_str + convert.str();
-    MD5 md5(temp);
-    std::vector<uint8_t> bytes = md5.finalize().bytes();
-
-    // Really?  Just the first four bytes of the hash?  Ick.  If we need to convert it to an
-    // int, we could have used a lighter weight hash than MD5 and the results migth have even
-    // been better.  To make matter even worse, the previous implementation was hardware
-    // architecture size and byte order dependent until we hardcoded the order of the bytes.
-
-    uint32_t b0 = (uint32_t)bytes[0];
-    uint32_t b1 = (uint32_t)bytes[1] << 8;
-    uint32_t b2 = (uint32_t)bytes[2] << 16;
-    uint32_t b3 = (uint32_t)bytes[3] << 24;
-
-    unsigned int first_dword = b0 + b1 + b2 + b3;
-    hashes.push_back(first_dword);
+  // The nodes vector grows as dependencies outside of the function are found.
+  for (size_t n = 0; n < graph.nodes.size(); n++) {
+    std::vector<std::pair<size_t, bool>> deps;
+    for (const InsnBoolPair& dep :
+           slice_dependencies(graph.nodes[n].insn, data_deps, control_deps)) {
+      deps.emplace_back(getSliceNode(graph, dep.first), dep.second);
+    }
+    graph.nodes[n].deps = std::move(deps);
   }
+}
 
-  return count;
+void PDG::appendSlice(const SliceGraph &graph, size_t node, std::vector<bool> &visited,
+                      size_t &count, std::string &slice_str) const
+{
+  if (visited[node]) return;
+  visited[node] = true;
+  ++count;
+
+  const SliceGraph::Node &n = graph.nodes[node];
+  slice_str += n.str;
+  for (const std::pair<size_t, bool>& dep : n.deps) {
+    // Represent a data or control dependency edge
+    slice_str += n.str;
+    slice_str += dep.second ? "-D->" : "-C->";
+    slice_str += graph.nodes[dep.first].str;
+    // Recurse!
+    appendSlice(graph, dep.first, visited, count, slice_str);
+  }
 }
 
 // Return the number of instructions in the entire function, by summing each basic block.
@@ -536,19 +563,56 @@ std::string PDG::getWeightedMaxHash(size_t nHashFunc) const {
   // Hash of the empty string.
   if (ninstr == 0) return std::string("D41D8CD98F00B204E9800998ECF8427E");
 
+  // Computing the slices independently with getSlice() is quadratic in the size of the slices
+  // (and rebuilds the instruction strings and dependency lists every time an instruction is
+  // visited), so share that work between all of the slices.
+  SliceGraph graph;
+  buildSliceGraph(graph);
+  std::vector<bool> visited;
+  std::string slice_str;
+
   for (SgAsmStatement* bs : fd->get_func()->get_statementList()) {
     SgAsmBlock *bb = isSgAsmBlock(bs);
     assert(bb);
 
     for (SgAsmStatement* is : bb->get_statementList()) {
       SgAsmX86Instruction *insn = isSgAsmX86Instruction(is);
+      if (insn == NULL) continue;
       UIntVector hashes;
 
       STRACE << "=============================================================" << LEND;
       STRACE << "Instruction: " << debug_instruction(insn) << LEND;
 
-      size_t count = hashSlice(insn,nHashFunc,hashes);
+      size_t count = 0;
+      visited.assign(graph.nodes.size(), false);
+      slice_str.clear();
+      appendSlice(graph, graph.index.at(insn), visited, count, slice_str);
+      SDEBUG << "Slice string: " << slice_str << LEND;
       if (count == 0) continue;
+
+      // The seed for each hash function is a hash function number concatenated to the slice
+      // string, so hash the slice string once and then add each seed to a copy of the state.
+      MD5 slice_md5(slice_str);
+      for (size_t x = 0; x < nHashFunc; x++ ) {
+        MD5 md5 = slice_md5;
+        std::string seed = std::to_string(x);
+        md5.update(seed.data(), seed.size());
+        std::vector<uint8_t> bytes = md5.finalize().bytes();
+
+        // Really?  Just the first four bytes of the hash?  Ick.  If we need to convert it to
+        // an int, we could have used a lighter weight hash than MD5 and the results migth have
+        // even been better.  To make matter even worse, the previous implementation was
+        // hardware architecture size and byte order dependent until we hardcoded the order of
+        // the bytes.
+        uint32_t b0 = (uint32_t)bytes[0];
+        uint32_t b1 = (uint32_t)bytes[1] << 8;
+        uint32_t b2 = (uint32_t)bytes[2] << 16;
+        uint32_t b3 = (uint32_t)bytes[3] << 24;
+
+        unsigned int first_dword = b0 + b1 + b2 + b3;
+        hashes.push_back(first_dword);
+      }
+
       float weight = (float)count/(float)ninstr;
       if (!(weight <= 1 && weight > 0)) {
         SERROR << "PDG hash weight is improperly bounded: " << weight << LEND;
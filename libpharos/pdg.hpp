@@ -3,6 +3,8 @@
 #ifndef Pharos_PDG_H
 #define Pharos_PDG_H
 #include <sstream>
+#include <unordered_map>
+#include <vector>
 
 // Forward declaration for circular include problems.
 namespace pharos {
@@ -68,9 +70,29 @@ class PDG {
   StringVector getPaths(size_t maxSubPathLen) const;
   std::string dumpOperand(SgAsmExpression *exp, AddrVector& constants) const;
   std::string dumpOperands(SgAsmX86Instruction *insn, AddrVector& constants) const;
-  size_t hashSlice(SgAsmX86Instruction *insn, size_t nHashFunc, std::vector<unsigned int> & hashes) const;
   size_t getNumInstr() const;
 
+  // The dependence graph used by getWeightedMaxHash() to compute the slice of every
+  // instruction in the function.  The instructions are numbered densely, and the instruction
+  // string and the dependencies of each instruction (in the order that getSlice() visits
+  // them) are computed only once, rather than once for every slice that they're part of.
+  struct SliceGraph {
+    struct Node {
+      SgAsmX86Instruction *insn;
+      std::string str;
+      // The index of each dependency, and whether it is a data (rather than control) dependency.
+      std::vector<std::pair<size_t, bool>> deps;
+    };
+    std::vector<Node> nodes;
+    std::unordered_map<SgAsmX86Instruction *, size_t> index;
+  };
+  size_t getSliceNode(SliceGraph &graph, SgAsmX86Instruction *insn) const;
+  void buildSliceGraph(SliceGraph &graph) const;
+  // Append the slice of a node to slice_str, exactly as getSlice() would.  Visited is the set
+  // of nodes already in the slice, and count the number of them.
+  void appendSlice(const SliceGraph &graph, size_t node, std::vector<bool> &visited,
+                   size_t &count, std::string &slice_str) const;
+
   // Get a chop? Not really a chop?
   X86InsnSet chop_insns(SgAsmX86Instruction *insn) const;
   AccessMap chop_full(SgAsmX86Instruction *insn) const;
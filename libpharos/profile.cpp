@@ -0,0 +1,287 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <time.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#include <boost/format.hpp>
+
+#include "profile.hpp"
+#include "json.hpp"
+#include "options.hpp"
+
+namespace bf = boost::filesystem;
+
+namespace pharos {
+
+namespace {
+
+std::unique_ptr<Profiler> global_profiler;
+
+double cpu_clock(clockid_t id) {
+  timespec ts;
+  if (clock_gettime(id, &ts) != 0) {
+    return 0.0;
+  }
+  return double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+}
+
+std::string address_string(rose_addr_t addr) {
+  return boost::str(boost::format("0x%08X") % addr);
+}
+
+} // unnamed namespace
+
+const char * profile_phase_name(ProfilePhase phase) {
+  switch (phase) {
+   case ProfilePhase::PDG: return "pdg";
+   case ProfilePhase::DefUse: return "defuse";
+   case ProfilePhase::Merge: return "merge";
+   case ProfilePhase::Convention: return "convention";
+   case ProfilePhase::PDGHash: return "pdg_hash";
+  }
+  return "unknown";
+}
+
+double thread_cpu_time() {
+  return cpu_clock(CLOCK_THREAD_CPUTIME_ID);
+}
+
+Profiler::Profiler(const ProgOptVarMap & vm)
+  : output(vm["profile"].as<bf::path>()), top(10)
+{
+  if (vm.count("profile-top")) {
+    top = vm["profile-top"].as<size_t>();
+  }
+}
+
+FunctionProfile & Profiler::get(rose_addr_t addr) {
+  FunctionProfile & profile = functions[addr];
+  profile.address = addr;
+  return profile;
+}
+
+void Profiler::add_phase(rose_addr_t addr, ProfilePhase phase, double wall, double cpu) {
+  write_guard<decltype(mutex)> guard{mutex};
+  get(addr).phases[size_t(phase)].add(wall, cpu);
+}
+
+void Profiler::add_program_phase(const std::string & name, double wall, double cpu) {
+  write_guard<decltype(mutex)> guard{mutex};
+  program_phases[name].add(wall, cpu);
+}
+
+void Profiler::add_iterations(rose_addr_t addr, size_t iterations, size_t blocks) {
+  write_guard<decltype(mutex)> guard{mutex};
+  FunctionProfile & profile = get(addr);
+  profile.iterations += iterations;
+  profile.blocks += blocks;
+}
+
+void Profiler::note_state_size(rose_addr_t addr, size_t size) {
+  write_guard<decltype(mutex)> guard{mutex};
+  FunctionProfile & profile = get(addr);
+  profile.peak_state_size = std::max(profile.peak_state_size, size);
+}
+
+void Profiler::note_accesses(rose_addr_t addr, size_t allocations, size_t peak_bytes,
+                             double rss) {
+  write_guard<decltype(mutex)> guard{mutex};
+  FunctionProfile & profile = get(addr);
+  profile.access_allocations += allocations;
+  profile.peak_access_bytes = std::max(profile.peak_access_bytes, peak_bytes);
+  profile.peak_rss = std::max(profile.peak_rss, rss);
+}
+
+void Profiler::note_allocations(rose_addr_t addr, size_t peak_bytes) {
+  write_guard<decltype(mutex)> guard{mutex};
+  FunctionProfile & profile = get(addr);
+  profile.peak_allocated_bytes = std::max(profile.peak_allocated_bytes, peak_bytes);
+}
+
+void Profiler::note_limit(rose_addr_t addr, const std::string & message) {
+  write_guard<decltype(mutex)> guard{mutex};
+  FunctionProfile & profile = get(addr);
+  ++profile.limit_hits;
+  profile.limit_message = message;
+}
+
+void Profiler::write_json(std::ostream & out) const {
+  auto builder = json::simple_builder();
+  auto phase_node = [&builder](const PhaseTime & pt) {
+    auto node = builder->object();
+    node->add("wall", pt.wall);
+    node->add("cpu", pt.cpu);
+    node->add("count", pt.count);
+    return node;
+  };
+
+  auto report = builder->object();
+  auto program = builder->object();
+  for (auto & np : program_phases) {
+    program->add(np.first, phase_node(np.second));
+  }
+  report->add("program", std::move(program));
+
+  auto funcs = builder->array();
+  for (auto & fp : functions) {
+    const FunctionProfile & profile = fp.second;
+    auto func = builder->object();
+    func->add("address", address_string(profile.address));
+    func->add("total_wall", profile.total_wall());
+    auto phases = builder->object();
+    for (size_t i = 0; i < num_profile_phases; ++i) {
+      if (profile.phases[i].count) {
+        phases->add(profile_phase_name(ProfilePhase(i)), phase_node(profile.phases[i]));
+      }
+    }
+    func->add("phases", std::move(phases));
+    func->add("iterations", profile.iterations);
+    func->add("blocks", profile.blocks);
+    func->add("peak_state_size", profile.peak_state_size);
+    func->add("access_allocations", profile.access_allocations);
+    func->add("peak_access_bytes", profile.peak_access_bytes);
+    func->add("peak_rss", profile.peak_rss);
+    func->add("peak_allocated_bytes", profile.peak_allocated_bytes);
+    func->add("limit_hits", profile.limit_hits);
+    if (profile.limit_hits) {
+      func->add("limit_message", profile.limit_message);
+    }
+    funcs->add(std::move(func));
+  }
+  report->add("functions", std::move(funcs));
+
+  out << json::pretty(2) << *report << '\n';
+}
+
+void Profiler::write_csv(std::ostream & out) const {
+  out << "address,total_wall";
+  for (size_t i = 0; i < num_profile_phases; ++i) {
+    const char * name = profile_phase_name(ProfilePhase(i));
+    out << ',' << name << "_wall," << name << "_cpu," << name << "_count";
+  }
+  out << ",iterations,blocks,peak_state_size,access_allocations,peak_access_bytes,peak_rss"
+      << ",peak_allocated_bytes,limit_hits\n";
+  for (auto & fp : functions) {
+    const FunctionProfile & profile = fp.second;
+    out << address_string(profile.address) << ',' << profile.total_wall();
+    for (const PhaseTime & pt : profile.phases) {
+      out << ',' << pt.wall << ',' << pt.cpu << ',' << pt.count;
+    }
+    out << ',' << profile.iterations << ',' << profile.blocks << ','
+        << profile.peak_state_size << ',' << profile.access_allocations << ','
+        << profile.peak_access_bytes << ',' << profile.peak_rss << ','
+        << profile.peak_allocated_bytes << ',' << profile.limit_hits << '\n';
+  }
+}
+
+void Profiler::report() const {
+  write_guard<decltype(mutex)> guard{mutex};
+
+  std::ofstream out(output.native());
+  if (!out) {
+    GERROR << "Unable to write profile to " << output << LEND;
+  }
+  else {
+    if (output.extension() == ".csv") {
+      write_csv(out);
+    }
+    else {
+      write_json(out);
+    }
+    OINFO << "Wrote profile of " << functions.size() << " functions to " << output << LEND;
+  }
+
+  std::vector<const FunctionProfile *> slowest;
+  for (auto & fp : functions) {
+    slowest.push_back(&fp.second);
+  }
+  size_t n = std::min(top, slowest.size());
+  std::partial_sort(slowest.begin(), slowest.begin() + n, slowest.end(),
+                    [](const FunctionProfile * a, const FunctionProfile * b) {
+                      return a->total_wall() > b->total_wall();
+                    });
+  if (n) {
+    OINFO << "The " << n << " slowest functions were:" << LEND;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    const FunctionProfile & profile = *slowest[i];
+    OINFO << "  " << address_string(profile.address) << ": " << profile.total_wall()
+          << " seconds (pdg=" << profile.phase(ProfilePhase::PDG).wall
+          << " defuse=" << profile.phase(ProfilePhase::DefUse).wall
+          << " merge=" << profile.phase(ProfilePhase::Merge).wall
+          << " convention=" << profile.phase(ProfilePhase::Convention).wall
+          << " pdg_hash=" << profile.phase(ProfilePhase::PDGHash).wall
+          << "), " << profile.iterations << " iterations, peak state size "
+          << profile.peak_state_size << ", " << profile.limit_hits << " limits reached."
+          << LEND;
+  }
+}
+
+void set_global_profiler(const ProgOptVarMap& vm)
+{
+  if (vm.count("profile")) {
+    global_profiler.reset(new Profiler(vm));
+  }
+  else {
+    global_profiler.reset();
+  }
+}
+
+Profiler * get_global_profiler()
+{
+  return global_profiler.get();
+}
+
+void report_global_profile()
+{
+  if (global_profiler) {
+    global_profiler->report();
+  }
+}
+
+ProfileTimer::ProfileTimer(rose_addr_t addr, ProfilePhase phase_)
+  : profiler(get_global_profiler()), address(addr), phase(phase_)
+{
+  if (profiler) {
+    start_wall = clock::now();
+    start_cpu = thread_cpu_time();
+  }
+}
+
+ProfileTimer::~ProfileTimer()
+{
+  if (profiler) {
+    std::chrono::duration<double> wall = clock::now() - start_wall;
+    profiler->add_phase(address, phase, wall.count(), thread_cpu_time() - start_cpu);
+  }
+}
+
+// The partitioner may use several threads, so program phases use the process CPU time.
+ProgramProfileTimer::ProgramProfileTimer(std::string name_)
+  : profiler(get_global_profiler()), name(std::move(name_))
+{
+  if (profiler) {
+    start_wall = clock::now();
+    start_cpu = cpu_clock(CLOCK_PROCESS_CPUTIME_ID);
+  }
+}
+
+ProgramProfileTimer::~ProgramProfileTimer()
+{
+  if (profiler) {
+    std::chrono::duration<double> wall = clock::now() - start_wall;
+    profiler->add_program_phase(name, wall.count(),
+                                cpu_clock(CLOCK_PROCESS_CPUTIME_ID) - start_cpu);
+  }
+}
+
+} // namespace pharos
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -0,0 +1,172 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#ifndef Pharos_Profile_H
+#define Pharos_Profile_H
+
+// This header provides the optional per-function profiling of the analysis, enabled with
+// --profile.  The analysis charges the wall clock and CPU time of each phase to the function
+// being analyzed (using ProfileTimer), and records a few other measures of the effort spent on
+// the function.  At the end of the run the profile is written to a JSON (or CSV) file, and the
+// slowest functions are summarized in the log.
+//
+// The phases nest: the def-use phase is part of the PDG phase, and the merge phase is part of
+// the def-use phase.  The convention and PDG hash phases are separate from the PDG phase, so
+// the total time for a function is the sum of the PDG, convention and PDG hash phases.
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "misc.hpp"
+#include "threads.hpp"
+
+namespace pharos {
+
+class ProgOptVarMap;
+
+enum class ProfilePhase {
+  PDG,         // Construction of the PDG, including the def-use analysis
+  DefUse,      // The def-use flow equation loop
+  Merge,       // Merging predecessor states in the def-use analysis
+  Convention,  // Register usage, calling convention and parameter analysis
+  PDGHash,     // Computing the weighted PDG hash
+};
+constexpr size_t num_profile_phases = 5;
+
+const char * profile_phase_name(ProfilePhase phase);
+
+struct PhaseTime {
+  double wall = 0.0;
+  double cpu = 0.0;
+  size_t count = 0;
+
+  void add(double w, double c) {
+    wall += w;
+    cpu += c;
+    ++count;
+  }
+};
+
+struct FunctionProfile {
+  rose_addr_t address = 0;
+  std::array<PhaseTime, num_profile_phases> phases;
+  // The number of passes of the def-use flow equation loop.
+  size_t iterations = 0;
+  // The number of basic block evaluations in the def-use analysis.
+  size_t blocks = 0;
+  // The number of register values and memory cells in the largest block output state.
+  size_t peak_state_size = 0;
+  // The number of abstract access allocations made by the def-use analysis, and the most bytes
+  // allocated for them at any one time.
+  size_t access_allocations = 0;
+  size_t peak_access_bytes = 0;
+  // The peak resident set size of the process (in MiB) when the def-use analysis completed.
+  // When analyzing functions in parallel, this includes the memory used by other functions.
+  double peak_rss = 0.0;
+  // The most bytes allocated (and not yet freed) by the thread analyzing the function at any
+  // one time during the def-use analysis.  Zero when allocation tracking isn't available.
+  size_t peak_allocated_bytes = 0;
+  // The number of resource limits reached, and the message from the last one.
+  size_t limit_hits = 0;
+  std::string limit_message;
+
+  const PhaseTime & phase(ProfilePhase p) const { return phases[size_t(p)]; }
+  // The wall clock time of the (non-overlapping) top level phases.
+  double total_wall() const {
+    return (phase(ProfilePhase::PDG).wall + phase(ProfilePhase::Convention).wall
+            + phase(ProfilePhase::PDGHash).wall);
+  }
+};
+
+class Profiler {
+ public:
+  Profiler(const ProgOptVarMap & vm);
+
+  void add_phase(rose_addr_t addr, ProfilePhase phase, double wall, double cpu);
+  // Phases that aren't specific to a function, e.g. function partitioning.
+  void add_program_phase(const std::string & name, double wall, double cpu);
+  void add_iterations(rose_addr_t addr, size_t iterations, size_t blocks);
+  void note_state_size(rose_addr_t addr, size_t size);
+  void note_accesses(rose_addr_t addr, size_t allocations, size_t peak_bytes, double rss);
+  void note_allocations(rose_addr_t addr, size_t peak_bytes);
+  void note_limit(rose_addr_t addr, const std::string & message);
+
+  // Write the profile file and log the slowest functions.
+  void report() const;
+
+ private:
+  boost::filesystem::path output;
+  size_t top;
+
+  mutable std_mutex mutex;
+  std::map<rose_addr_t, FunctionProfile> functions;
+  std::map<std::string, PhaseTime> program_phases;
+
+  // The profile for a function.  The mutex must be held.
+  FunctionProfile & get(rose_addr_t addr);
+
+  void write_json(std::ostream & out) const;
+  void write_csv(std::ostream & out) const;
+};
+
+// Create (or not, depending on --profile) the global profiler.
+void set_global_profiler(const ProgOptVarMap& vm);
+
+// The global profiler, or null if profiling is disabled.
+Profiler * get_global_profiler();
+
+// Write the global profile (if enabled).
+void report_global_profile();
+
+// The CPU time consumed by the calling thread, in seconds.
+double thread_cpu_time();
+
+// Charges the wall clock and thread CPU time between construction and destruction to a phase
+// of a function.  Does nothing when profiling is disabled.
+class ProfileTimer {
+ public:
+  ProfileTimer(rose_addr_t addr, ProfilePhase phase);
+  ProfileTimer(const ProfileTimer &) = delete;
+  ProfileTimer & operator=(const ProfileTimer &) = delete;
+  ~ProfileTimer();
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  Profiler * profiler;
+  rose_addr_t address;
+  ProfilePhase phase;
+  clock::time_point start_wall;
+  double start_cpu = 0.0;
+};
+
+// Like ProfileTimer, but for phases of the whole program.
+class ProgramProfileTimer {
+ public:
+  ProgramProfileTimer(std::string name);
+  ProgramProfileTimer(const ProgramProfileTimer &) = delete;
+  ProgramProfileTimer & operator=(const ProgramProfileTimer &) = delete;
+  ~ProgramProfileTimer();
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  Profiler * profiler;
+  std::string name;
+  clock::time_point start_wall;
+  double start_cpu = 0.0;
+};
+
+} // namespace pharos
+
+#endif // Pharos_Profile_H
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -75,6 +75,32 @@ class Session {
     return rv;
   }
 
+  // Buffer a fact to be asserted in bulk by flush_facts().
+  template <typename... T>
+  bool buffer_fact(T &&... t) {
+    bool rv = session->buffer_fact(std::forward<T>(t)...);
+    if (!rv) {
+      std::cerr << "Prolog could not assert facts!" << std::endl;
+    }
+    return rv;
+  }
+
+  bool flush_facts() {
+    bool rv = session->flush_facts();
+    if (!rv) {
+      std::cerr << "Prolog could not assert facts!" << std::endl;
+    }
+    return rv;
+  }
+
+  using FactLoadStats = impl::Session::FactLoadStats;
+  using FactLoadStatsMap = impl::Session::FactLoadStatsMap;
+
+  // The number of facts and the time spent loading them by flush_facts(), by predicate.
+  const FactLoadStatsMap & get_fact_stats() const {
+    return session->get_fact_stats();
+  }
+
   template <typename... T>
   static auto make_fact(T &&... t) {
     return detail::make_fact(std::forward<T>(t)...);
@@ -5,6 +5,7 @@
 #include "prologimpl.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <sstream>
 
 namespace pharos {
@@ -119,6 +120,37 @@ std::size_t Session::print_predicate(
   return n;
 }
 
+bool Session::assert_batch(std::string const & predicate, FactBatch & batch)
+{
+  if (batch.count == 0) {
+    return true;
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto cmd = functor(
+    "call", functor(":", prolog_default_module, functor("assert_all_uniquely", batch.facts)));
+  bool rv = command(cmd);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  FactLoadStats & stats = fact_stats[predicate];
+  stats.count += batch.count;
+  stats.seconds += elapsed.count();
+
+  batch.facts = List();
+  batch.count = 0;
+  return rv;
+}
+
+bool Session::flush_facts()
+{
+  bool rv = true;
+  for (auto & pb : pending_facts) {
+    if (!assert_batch(pb.first, pb.second)) {
+      rv = false;
+    }
+  }
+  pending_facts.clear();
+  return rv;
+}
 
 foreign_t Session::predicate_wrapper(pl_term args_, std::size_t arity_, void *)
 {
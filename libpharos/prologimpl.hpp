@@ -72,6 +72,7 @@
 #include <functional>
 #include <vector>
 #include <set>
+#include <map>
 #include <ostream>
 #include <utility>
 #include <type_traits>
@@ -179,6 +180,39 @@ class Session : public std::enable_shared_from_this<Session>
   using predspec_t = std::tuple<std::string, int>;
   std::set<predspec_t> saved_state;
 
+ public:
+  // The number of facts loaded for a predicate by flush_facts(), and the time spent doing so.
+  struct FactLoadStats {
+    std::size_t count = 0;
+    double seconds = 0.0;
+  };
+  using FactLoadStatsMap = std::map<std::string, FactLoadStats>;
+
+ private:
+  // Facts buffered by buffer_fact(), keyed by "name/arity".
+  struct FactBatch {
+    List facts;
+    std::size_t count = 0;
+  };
+  std::map<std::string, FactBatch> pending_facts;
+  FactLoadStatsMap fact_stats;
+
+  // A batch is asserted as soon as it reaches this size, which bounds the size of the list
+  // term that has to be constructed on the Prolog stack.
+  static constexpr std::size_t fact_batch_size = 4096;
+
+  bool assert_batch(std::string const & predicate, FactBatch & batch);
+
+  template <typename T>
+  bool buffer_term(std::string const & predicate, T && term) {
+    FactBatch & batch = pending_facts[predicate];
+    batch.facts.push_back(std::forward<T>(term));
+    if (++batch.count < fact_batch_size) {
+      return true;
+    }
+    return assert_batch(predicate, batch);
+  }
+
  public:
   // Session::get_session can only be called if a session is not already being used.  Otherwise
   // a SessionError will be thrown
@@ -210,6 +244,31 @@ class Session : public std::enable_shared_from_this<Session>
     return command(cmd);
   }
 
+  // Buffer a fact, grouped with other facts for the same predicate, to be asserted (uniquely,
+  // as with add_fact) by a later call to flush_facts().  Asserting a whole list of facts with
+  // a single query is much faster than asserting them one at a time.  Unlike add_fact(), the
+  // arguments are copied, since the fact outlives the call.
+  template <typename A, typename B, typename... T>
+  bool buffer_fact(A && name, B && arg, T &&... args) {
+    std::string predicate = std::string(name) + '/' + std::to_string(1 + sizeof...(T));
+    return buffer_term(predicate, functor(std::forward<A>(name),
+                                          std::decay_t<B>(std::forward<B>(arg)),
+                                          std::decay_t<T>(std::forward<T>(args))...));
+  }
+
+  // Buffer a fact with no arguments (an atom).
+  bool buffer_fact(std::string const & name) {
+    return buffer_term(name + "/0", name);
+  }
+
+  // Assert all of the buffered facts.  Returns false if any of them could not be asserted.
+  bool flush_facts();
+
+  // The facts loaded so far by flush_facts(), by predicate.
+  FactLoadStatsMap const & get_fact_stats() const {
+    return fact_stats;
+  }
+
   void consult(std::string const & filename) {
     return consult(functor("consult", filename));
   }
@@ -3,6 +3,7 @@
 #include "riscops.hpp"
 #include "masm.hpp"
 #include "descriptors.hpp"
+#include "intern.hpp"
 
 namespace pharos {
 
@@ -112,6 +113,12 @@ BaseSValuePtr SymbolicRiscOperators::readRegister(
 void SymbolicRiscOperators::writeRegister(RegisterDescriptor reg, const BaseSValuePtr &v) {
   STRACE << "RiscOps::writeRegister() reg=" << unparseX86Register(reg, {}) << " value=" << *v << LEND;
 
+  // If expression interning is enabled, store the canonical instance of the expression.
+  if (get_global_interner()) {
+    SymbolicValuePtr sv = SymbolicValue::promote(v);
+    sv->set_expression(intern_expression(sv->get_expression()));
+  }
+
   // Call the standard ROSE implementation of writeRegister().
   SymRiscOperators::writeRegister(reg, v);
 
@@ -286,6 +293,14 @@ void SymbolicRiscOperators::writeMemory(UNUSED RegisterDescriptor segreg,
     }
   }
 
+  // If expression interning is enabled, store the canonical instances of the expressions.
+  if (get_global_interner()) {
+    SymbolicValuePtr iaddr = SymbolicValue::promote(addr);
+    iaddr->set_expression(intern_expression(iaddr->get_expression()));
+    SymbolicValuePtr idata = SymbolicValue::promote(data);
+    idata->set_expression(intern_expression(idata->get_expression()));
+  }
+
   // This one line is the call to RiscOperators::writeMemory that we ought to be using...
   SymRiscOperators::writeMemory(segreg, addr, data, cond);
 
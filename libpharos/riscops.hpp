@@ -51,6 +51,12 @@ class SymbolicRiscOperators: public SymRiscOperators {
   // make these private as well.
   AbstractAccessVector insn_accesses;
 
+  // Allocate the abstract accesses in insn_accesses from an arena, or from the heap if the
+  // arena is null.  Discards the current accesses.
+  void set_access_arena(Arena * arena) {
+    insn_accesses = AbstractAccessVector(AbstractAccessVector::allocator_type(arena));
+  }
+
   // This map represents memory accesses
   std::map<TreeNode*, TreeNodePtr> memory_accesses;
 
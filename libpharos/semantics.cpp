@@ -1,5 +1,6 @@
 // Copyright 2015-2022 Carnegie Mellon University.  See LICENSE file for terms.
 
+#include <algorithm>
 #include <boost/format.hpp>
 
 #include "rose.hpp"
@@ -24,9 +25,11 @@ Sawyer::Message::Facility slog;
 using Rose::BinaryAnalysis::SymbolicExpression::OP_ITE;
 
 // A naughty global variable for controlling the number of times we spew about discarded
-// expressions.  Used in SymbolicValue::scopy().
+// expressions.  Used in SymbolicValue::discard_oversized_expression().
 unsigned int discarded_expressions = 0;
 
+size_t SymbolicValue::node_limit = 0;
+
 template<> char const* EnumStrings<MemoryType>::data[] = {
   "Stack Memory (Local Variables)",
   "Stack Memory (Return Address)",
@@ -131,33 +134,27 @@ SymbolicValuePtr SymbolicValue::scopy(size_t new_width) const {
   if (new_width != 0 && new_width != retval->get_width())
     retval->set_width(new_width);
 
-  // If the expression is too big, toss it.
-
-  // Cory says: Now that we're in NEWWAY, we should revisit moving this someplace else.
-
-  // Here's another horrible hackish workaround.  In certain cases, the symbolic expressions
-  // grow exponentially in size. This results in us pushing around huge unintelligible
-  // expressions that don't mean anything, and prevent us from running to completion in a
-  // reasonable time.  So what we're going to do is bail wherever the expression gets too
-  // big.  Right now this mostly seems to be happening on flag computations so it probably
-  // won't be the end of the world anyway.
-
-  // We're also trapped in a bad situation here.  This is the easiest and most logical place
-  // to conduct the test.  But if we log here we get lots of spew, and if don't log here at
-  // all we completely ignore a fairly critical and important error that we need to be
-  // tracking.  The doubly horrible hackish workaround is to use a global variables to track
-  // how many times we've recently logged this message. :-( Go look in solve_flow_equations()
-  // for where we reset this on each new function. We declate it exeternal at the top of this
-  // file, and declare the actual storage in semantics.cpp.
-  retval->discard_oversized_expression();
+  // Oversized expressions used to be discarded here, on every copy.  They're now discarded
+  // when the expression is set (see set_expression() and merge()), so the copy is already
+  // within the limit.
 
   //STRACE << "SymbolicValue::scopy() retval=" << *retval << LEND;
   return retval;
 }
 
+// Here's another horrible hackish workaround.  In certain cases, the symbolic expressions grow
+// exponentially in size. This results in us pushing around huge unintelligible expressions
+// that don't mean anything, and prevent us from running to completion in a reasonable time.
+// So what we're going to do is bail wherever the expression gets too big.  Right now this
+// mostly seems to be happening on flag computations so it probably won't be the end of the
+// world anyway.
+//
+// We're also trapped in a bad situation here.  If we log here we get lots of spew, and if
+// don't log here at all we completely ignore a fairly critical and important error that we
+// need to be tracking.  The doubly horrible hackish workaround is to use a global variables to
+// track how many times we've recently logged this message. :-( Go look in
+// solve_flow_equations() for where we reset this on each new function.
 void SymbolicValue::discard_oversized_expression() {
-  size_t nnodes = get_expression()->nNodes();
-
   // With real conditions in ITEs there may very well be >500 nodes. A better approach is to
   // make this configurable so that the limits reflect the type of analysis being
   // performed. Some types of analysis just require more conditions (i.e. symbolic path
@@ -174,33 +171,28 @@ void SymbolicValue::discard_oversized_expression() {
   //   nnodes = simple_tn->nNodes();
   // }
 
+  // Almost/all of the discarded expressions are a single bit.  Situtations where the value
+  // is larger than one bit might be worth investigating, but don't elevate the error past a
+  // warning, because ordinary users don't care about this.
+  if (get_width() != 1) {
+    GTRACE << "Discarding non-boolean expression of " << get_width() << " bits." << LEND;
+  }
+  // This is unwise now that the limit is much higher.
+  //SDEBUG << "Discarded expression was:" << *this << LEND;
 
-  if (get_global_limits().node_condition_limit
-      && nnodes > get_global_limits().node_condition_limit)
-  {
-    // Almost/all of the discarded expressions are a single bit.  Situtations where the value
-    // is larger than one bit might be worth investigating, but don't elevate the error past a
-    // warning, because ordinary users don't care about this.
-    if (get_width() != 1) {
-      GTRACE << "Discarding non-boolean expression of " << get_width() << " bits." << LEND;
-    }
-    // This is unwise now that the limit is much higher.
-    //SDEBUG << "Discarded expression was:" << *this << LEND;
-
-    // Here's the important bit...  Replace the value with a new incomplete variable.
-    size_t nbits = get_expression()->nBits();
-    TreeNodePtr tn = SymbolicExpr::makeIntegerVariable(
-      nbits, "", TreeNode::UNSPECIFIED | INCOMPLETE);
-    set_expression(tn);
-
-    // Only report this error once per function? :-(
-    if (discarded_expressions < 1) {
-      // Cory thinks that this should be an ERROR, but because it happens so frequently, he's
-      // moving it warning importance until we can investigate further.
-      SWARN << "Replaced excessively large expression with " << *get_expression() << LEND;
-    }
-    discarded_expressions++;
+  // Here's the important bit...  Replace the value with a new incomplete variable.
+  size_t nbits = get_expression()->nBits();
+  TreeNodePtr tn = SymbolicExpr::makeIntegerVariable(
+    nbits, "", TreeNode::UNSPECIFIED | INCOMPLETE);
+  set_expression(tn);
+
+  // Only report this error once per function? :-(
+  if (discarded_expressions < 1) {
+    // Cory thinks that this should be an ERROR, but because it happens so frequently, he's
+    // moving it warning importance until we can investigate further.
+    SWARN << "Replaced excessively large expression with " << *get_expression() << LEND;
   }
+  discarded_expressions++;
 }
 
 bool operator==(const SymbolicValue& a, const SymbolicValue& b) {
@@ -211,7 +203,11 @@ bool operator==(const SymbolicValue& a, const SymbolicValue& b) {
   // YicesSolver *solver = new YicesSolver;
   // solver->set_linkage(YicesSolver::LM_EXECUTABLE);
   // return solver.equals(a.get_expression(),b.get_expression());
-  return a.get_expression()->isEquivalentTo(b.get_expression());
+  // When expressions are interned (see intern.hpp) equal values usually share a TreeNode.
+  const TreeNodePtr & aexpr = a.get_expression();
+  const TreeNodePtr & bexpr = b.get_expression();
+  if (aexpr == bexpr) return true;
+  return aexpr->isEquivalentTo(bexpr);
 }
 
 // No longer used, but keeping in case we need this code in the future.  The correct
@@ -476,6 +472,22 @@ SymbolicValue::createOptionalMerge(const BaseSValuePtr& other,
   }
   return oretval;
 #else
+  // If merging the other value would leave this value unchanged (see the early return for
+  // equivalent expressions in merge() below), report that there's nothing to merge rather than
+  // returning a copy.  This keeps the state merge() methods from rewriting every unchanged
+  // register and memory cell each time predecessor states are merged.
+  if (other) {
+    const TreeNodePtr & my_expr = get_expression();
+    const TreeNodePtr & other_expr = sother->get_expression();
+    if (my_expr && other_expr && my_expr->isEquivalentTo(other_expr)) {
+      const auto & my_defs = get_defining_instructions();
+      const auto & other_defs = sother->get_defining_instructions();
+      if (std::includes(my_defs.begin(), my_defs.end(), other_defs.begin(), other_defs.end())) {
+        return Sawyer::Nothing();
+      }
+    }
+  }
+
   // Use our old symbolic merge approach.
   SymbolicValuePtr retval = scopy();
   retval->merge(sother, condition, cert_merger->inverted);
@@ -531,6 +543,8 @@ void SymbolicValue::merge(const SymbolicValuePtr& other,
   // The only(?) place where we want to set the expression to a value not literally in sync
   // with the value set?
   ParentSValue::set_expression(ite_expr);
+  // With --propagate-conditions, this is where expressions usually grow too large.
+  if (is_oversized(ite_expr)) discard_oversized_expression();
 }
 
 void SymbolicValue::print(std::ostream &o, RoseFormatter& fmt) const {
@@ -678,7 +692,7 @@ void AbstractAccess::debug(std::ostream &o) const {
 
 void AbstractAccess::set_latest_writers(DescriptorSet const & ds, SymbolicStatePtr& state) {
   // Set the modifiers based on inspecting the current abstract access and the passed state.
-  // We're converting from a Sawyer container of rose_addr_t to an InsnSet as well, because
+  // We're converting from a Sawyer container of rose_addr_t to a WriterSet as well, because
   // that's more convenient in our code.
 
   // Hackish workaround for list based memory.   What should we really be doing?
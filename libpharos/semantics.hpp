@@ -7,6 +7,7 @@
 // accesses (aka most of the project).  Please try not to add higher level dependencies to this
 // file if possible, since it is widely included, and would seriously aggravate include loops.
 
+#include <algorithm>
 #include <cstdio>
 #include <vector>
 #include <map>
@@ -17,10 +18,12 @@
 #include <Rose/BinaryAnalysis/InstructionSemantics/DispatcherX86.h>
 #include <Rose/BinaryAnalysis/Unparser/X86.h>
 
+#include <boost/container/small_vector.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/adaptor/type_erased.hpp>
 
 #include "misc.hpp"
+#include "arena.hpp"
 
 namespace pharos {
 
@@ -37,7 +40,8 @@ using ParentSValuePtr = Semantics2::SymbolicSemantics::SValuePtr;
 // A class for providing context while merging.
 using BaseMergerPtr = Semantics2::BaseSemantics::MergerPtr;
 
-// A naughty global variables for controlling spew.  Used in SymbolicValue::scopy().
+// A naughty global variables for controlling spew.  Used in
+// SymbolicValue::discard_oversized_expression().
 extern unsigned int discarded_expressions;
 
 enum MemoryType {
@@ -79,6 +83,9 @@ constexpr uint32_t LOADER_DEFINED      = UINT32_C(0x00040000);
 class SymbolicValue: public ParentSValue {
 
  private:
+  // The maximum number of nodes in an expression, or zero for no limit.  See set_expression().
+  static size_t node_limit;
+
   // These two used to be in OUR SValue (non-templated) class.  Cory notes that these should
   // all be private to ensure that we're not using them inappropriately.  Fortunately, at the
   // time of this comment, all constructor calls are wrapped in SymbolicValuePtr().
@@ -164,10 +171,20 @@ class SymbolicValue: public ParentSValue {
   // Non virtualized version returns a SymbolicValuePtr
   SymbolicValuePtr scopy(size_t new_width = 0) const;
 
-  // If the expression is "too large" discard it, and replace it with a single incomplete
-  // variable.  Currently this method is only called from scopy, but should probably be moved
-  // to merge() instead, which is why it's now a function of it's own.  Eventually, we'd like
-  // to eliminate it completely, since it's hiding a bug somewhere else in the architecture.
+  // Set the maximum number of nodes in an expression (--maximum-nodes-per-condition), or zero
+  // for no limit.  Called by set_global_limits().
+  static void set_node_limit(size_t limit) { node_limit = limit; }
+  static size_t get_node_limit() { return node_limit; }
+
+  // Does the expression have more nodes than the limit?  ROSE caches the node count in each
+  // node when it's constructed, so this is a constant time test.
+  static bool is_oversized(const TreeNodePtr& tn) {
+    return node_limit && tn && tn->nNodes() > node_limit;
+  }
+
+  // Replace the expression with a single incomplete variable because it's "too large".
+  // Eventually, we'd like to eliminate this completely, since it's hiding a bug somewhere else
+  // in the architecture.
   void discard_oversized_expression();
 
   // Cory says: This used to be needed and then was removed?
@@ -214,9 +231,14 @@ class SymbolicValue: public ParentSValue {
   // Convenience functions to improve readability.
   bool has_definers() const { return (get_defining_instructions().size() > 0); }
 
-  // Used to be  in a couple of places, no longer needed?
+  // The RiscOperators construct the result of every operation by setting the expression of a
+  // new value, so this is where oversized expressions are discarded.  Since every expression
+  // is checked when it's constructed, copying a value doesn't need to check it again, and
+  // the node counts (which ROSE sums over the children without regard to sharing) can't grow
+  // beyond a small multiple of the limit.
   void set_expression(const TreeNodePtr& new_expr) override {
     expr = new_expr;
+    if (is_oversized(expr)) discard_oversized_expression();
   }
 
   // Retrieve the hash from the TreeNode.
@@ -268,6 +290,47 @@ inline SymbolicValuePtr operator+(int64_t i, const SymbolicValuePtr & a) {
 class SymbolicState;
 using SymbolicStatePtr = boost::shared_ptr<class SymbolicState>;
 
+// A set of instructions ordered by address, like InsnSet, for the latest writers of an
+// abstract access.  Nearly every access has at most two latest writers, so they're stored
+// inline in a sorted vector, and no memory is allocated for them.
+class WriterSet {
+  using Storage = boost::container::small_vector<SgAsmInstruction*, 2>;
+  Storage insns;
+
+ public:
+  using value_type = SgAsmInstruction*;
+  using iterator = Storage::const_iterator;
+  using const_iterator = Storage::const_iterator;
+
+  const_iterator begin() const { return insns.begin(); }
+  const_iterator end() const { return insns.end(); }
+  size_t size() const { return insns.size(); }
+  bool empty() const { return insns.empty(); }
+
+  const_iterator find(const SgAsmInstruction* insn) const {
+    auto i = std::lower_bound(insns.begin(), insns.end(), insn, InsnCompare());
+    if (i != insns.end() && !InsnCompare()(insn, *i)) return i;
+    return insns.end();
+  }
+  size_t count(const SgAsmInstruction* insn) const { return find(insn) != end(); }
+
+  // Returns true if the instruction was inserted, and false if there was already an
+  // instruction at the same address.
+  bool insert(SgAsmInstruction* insn) {
+    auto i = std::lower_bound(insns.begin(), insns.end(), insn, InsnCompare());
+    if (i != insns.end() && !InsnCompare()(insn, *i)) return false;
+    insns.insert(i, insn);
+    return true;
+  }
+
+  void clear() { insns.clear(); }
+
+  InsnSet to_set() const { return InsnSet(insns.begin(), insns.end()); }
+
+  bool operator==(const WriterSet & other) const { return insns == other.insns; }
+  bool operator!=(const WriterSet & other) const { return insns != other.insns; }
+};
+
 // Class representing either a register location or a memory location This is currently a
 // horrible bastardization of an abstract location and a couple of Wes' [Mem|Reg]Access pairs.
 // I have no idea if it will work yet, but I'm trying...
@@ -297,7 +360,7 @@ class AbstractAccess {
 
   // A hybrid of definers and writers, tracking the latest definition of this symbolic value
   // including memory read instructions that initialized values.
-  InsnSet latest_writers;
+  WriterSet latest_writers;
 
   // Was this access a read or a write?
   bool isRead;
@@ -350,8 +413,11 @@ class AbstractAccess {
   }
 };
 
-using AbstractAccessVector = std::vector<AbstractAccess>;
-using AccessMap = std::map<rose_addr_t, AbstractAccessVector>;
+// The def-use analysis allocates these from an arena that it owns (see DUAnalysis), while
+// default constructed (and copied) vectors and maps allocate from the heap.
+using AbstractAccessVector = std::vector<AbstractAccess, ArenaAllocator<AbstractAccess>>;
+using AccessMap = std::map<rose_addr_t, AbstractAccessVector, std::less<rose_addr_t>,
+                           ArenaAllocator<std::pair<const rose_addr_t, AbstractAccessVector>>>;
 
 namespace access_filters {
 
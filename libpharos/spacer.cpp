@@ -59,7 +59,7 @@ SpacerAnalyzer::encode_cfg(const IR &ir,
                            boost::optional <z3::func_decl> exit_relation,
                            boost::optional <std::function<bool(const IRCFGVertex &)>> short_circuit,
                            ConvertCallFun convert_call) {
-  auto cfg = ir.get_cfg ();
+  const IRCFG & cfg = ir.get_cfg ();
   auto mem = ir.get_mem ();
   auto bb_map = boost::get (boost::vertex_name_t (), cfg);
   auto irmap = boost::get (boost::vertex_ir_t (), cfg);
@@ -395,17 +395,23 @@ SpacerAnalyzer::setup_path_problem(rose_addr_t srcaddr, rose_addr_t tgtaddr)
 
                  // ir = split_calls (ir);
 
+                 IRPassManager passes;
+
                  // Entry specific changes
                  if (cgv == fromcgv) {
-                   ir = change_entry (ir, srcaddr);
-                   ir = init_stackpointer (ir);
+                   passes.add ("change_entry", [srcaddr] (IR & ir_) {
+                     change_entry_in_place (ir_, srcaddr);
+                   });
+                   passes.add ("init_stackpointer", init_stackpointer_in_place);
                  }
 
                  // Remove undefined expressions
-                 ir = rm_undefined (ir);
+                 passes.add ("rm_undefined", rm_undefined_in_place);
 
                  // Add data blocks
-                 ir = add_datablocks (ir);
+                 passes.add ("add_datablocks", add_datablocks_in_place);
+
+                 passes.run (ir);
 
                  // In general we don't want to rewrite calls using rewrite_imported_calls.
                  // But it was easier for Ed to also put the logic for rewriting calls to
@@ -86,6 +86,49 @@ bool SymbolicRegisterState::equals(const SymbolicRegisterStatePtr & other) {
   return true;
 }
 
+// Compare the symbolic values of only the specified registers in two register states.  The
+// values are compared exactly as in equals() above.
+bool SymbolicRegisterState::equals(const SymbolicRegisterStatePtr & other,
+                                   const RegisterSet & regs) {
+  for (RegisterDescriptor rd : regs) {
+    SymbolicValuePtr value = read_register(rd);
+    SymbolicValuePtr ovalue = other->read_register(rd);
+
+    if (value->is_incomplete() && ovalue->is_incomplete()) continue;
+
+    if (value->is_incomplete() || ovalue->is_incomplete()) {
+      DSTREAM << "Register " << unparseX86Register(rd, {})
+              << " has differing correctness, iterating "
+              << *value << " != " << *ovalue << LEND;
+      return false;
+    }
+
+    if (!(*value == *ovalue)) {
+      DSTREAM << "Register " << unparseX86Register(rd, {}) << " changed: "
+              << *value << " != " << *ovalue << LEND;
+      return false;
+    }
+  }
+
+  DSTREAM << "Register state was unchanged (" << regs.size() << " registers compared)." << LEND;
+  return true;
+}
+
+void SymbolicRegisterState::writeRegister(RegisterDescriptor reg, const BaseSValuePtr &value,
+                                          BaseRiscOperators *ops) {
+  if (tracking_writes) written->insert(reg);
+  RegisterStateGeneric::writeRegister(reg, value, ops);
+}
+
+BaseSValuePtr SymbolicRegisterState::readRegister(RegisterDescriptor reg,
+                                                  const BaseSValuePtr &dflt,
+                                                  BaseRiscOperators *ops) {
+  // Reading a register that isn't stored exactly may create or reorganize the storage for the
+  // register, so it must be treated like a write.
+  if (tracking_writes && !isExactlyStored(reg)) written->insert(reg);
+  return RegisterStateGeneric::readRegister(reg, dflt, ops);
+}
+
 SymbolicValuePtr SymbolicRegisterState::inspect_register(RegisterDescriptor rd) {
   RegisterStateGeneric::AccessCreatesLocationsGuard(this, false);
   try {
@@ -338,6 +381,47 @@ bool SymbolicState::merge(const BaseStatePtr &other, BaseRiscOperators *ops,
 #endif
 }
 
+void SymbolicState::track_writes()
+{
+  if (!map_based) abort(); // Not implemented.
+  get_register_state()->track_writes();
+  SymbolicMemoryMapState::promote(memoryState())->track_writes();
+}
+
+void SymbolicState::stop_tracking_writes()
+{
+  if (!map_based) abort(); // Not implemented.
+  get_register_state()->stop_tracking_writes();
+  SymbolicMemoryMapState::promote(memoryState())->stop_tracking_writes();
+}
+
+StateWrites SymbolicState::get_writes() const
+{
+  StateWrites writes;
+  if (!map_based) return writes;
+  const auto & regs = get_register_state()->get_written();
+  const auto & cells = SymbolicMemoryMapState::promote(memoryState())->get_written();
+  if (!regs || !cells) return writes;
+  writes.clear();
+  writes.registers = *regs;
+  writes.cells = *cells;
+  return writes;
+}
+
+bool SymbolicState::equals(const SymbolicStatePtr& other, const StateWrites& locations)
+{
+  if (locations.all) return equals(other);
+  if (!(map_based && other->map_based)) abort(); // Not implemented
+
+  const SymbolicRegisterStatePtr& regs = SymbolicRegisterState::promote(registerState());
+  const SymbolicRegisterStatePtr& oregs = SymbolicRegisterState::promote(other->registerState());
+  if (!regs->equals(oregs, locations.registers)) return false;
+
+  const SymbolicMemoryMapStatePtr& mem = SymbolicMemoryMapState::promote(memoryState());
+  const SymbolicMemoryMapStatePtr& omem = SymbolicMemoryMapState::promote(other->memoryState());
+  return mem->equals(omem, locations.cells);
+}
+
 // =========================================================================================
 // The new more standardized approach!
 // =========================================================================================
@@ -423,6 +507,56 @@ bool SymbolicMemoryMapState::equals(const SymbolicMemoryMapStatePtr& other) {
   return true;
 }
 
+// Compare only the memory cells with the specified keys in two memory states.  This is the
+// same comparison as equals() above, in both directions, but restricted to the given cells.
+bool SymbolicMemoryMapState::equals(const SymbolicMemoryMapStatePtr& other,
+                                    const std::set<CellKey>& keys) {
+  for (CellKey key : keys) {
+    const MemoryCellPtr & cell = cells.getOrDefault(key);
+    const MemoryCellPtr & ocell = other->cells.getOrDefault(key);
+    if (cell && ocell) {
+      SymbolicValuePtr ma = SymbolicValue::promote(cell->address());
+      SymbolicValuePtr mv = SymbolicValue::promote(cell->value());
+      SymbolicValuePtr omv = SymbolicValue::promote(ocell->value());
+      if (!mem_compare(ma, mv, omv)) return false;
+    }
+    else if (cell || ocell) {
+      const MemoryCellPtr & found = cell ? cell : ocell;
+      SymbolicValuePtr ma = SymbolicValue::promote(found->address());
+      if (ma->is_incomplete()) {
+        DSTREAM << "Memory cell (incomplete) " << *ma << " was not found (ignoring)." << LEND;
+      }
+      else {
+        DSTREAM << "Memory cell (complete) " << *ma << " was not found." << LEND;
+        return false;
+      }
+    }
+  }
+
+  DSTREAM << "Memory state unchanged (" << keys.size() << " cells compared)." << LEND;
+  return true;
+}
+
+BaseSValuePtr SymbolicMemoryMapState::readMemory(const BaseSValuePtr &address,
+                                                 const BaseSValuePtr &dflt,
+                                                 BaseRiscOperators *addrOps,
+                                                 BaseRiscOperators *valOps) {
+  // Reading a cell that doesn't exist creates it, so it must be treated like a write.
+  if (tracking_writes) {
+    CellKey key = generateCellKey(address);
+    if (!cells.exists(key)) written->insert(key);
+  }
+  return BaseMemoryCellMap::readMemory(address, dflt, addrOps, valOps);
+}
+
+void SymbolicMemoryMapState::writeMemory(const BaseSValuePtr &address,
+                                         const BaseSValuePtr &value,
+                                         BaseRiscOperators *addrOps,
+                                         BaseRiscOperators *valOps) {
+  if (tracking_writes) written->insert(generateCellKey(address));
+  BaseMemoryCellMap::writeMemory(address, value, addrOps, valOps);
+}
+
 using InputOutputPropertySet = Semantics2::BaseSemantics::InputOutputPropertySet;
 
 bool SymbolicMemoryMapState::merge(const BaseMemoryAddressSpacePtr& other_,
@@ -3,6 +3,9 @@
 #ifndef Pharos_State_H
 #define Pharos_State_H
 
+#include <set>
+#include <boost/optional.hpp>
+
 #include "semantics.hpp"
 #include "misc.hpp"
 
@@ -43,6 +46,74 @@ using SymbolicStatePtr = boost::shared_ptr<class SymbolicState>;
 
 extern SymbolicRiscOperatorsPtr global_rops;
 
+// A record of the locations written to a state (or created in it by reads) while the state was
+// tracking writes.  This allows a block's output state to be compared with its previous output
+// state by visiting only the locations that could have changed, rather than every location.
+struct StateWrites {
+  using CellKey = BaseMemoryCellMap::CellKey;
+
+  // When true the record is unknown (e.g. the state wasn't tracking writes), and every location
+  // must be assumed to have been written.
+  bool all = true;
+  RegisterSet registers;
+  std::set<CellKey> cells;
+
+  void clear() {
+    all = false;
+    registers.clear();
+    cells.clear();
+  }
+
+  void insert(const StateWrites & other) {
+    if (all) return;
+    if (other.all) {
+      all = true;
+      registers.clear();
+      cells.clear();
+      return;
+    }
+    registers.insert(other.registers.begin(), other.registers.end());
+    cells.insert(other.cells.begin(), other.cells.end());
+  }
+
+  size_t size() const { return registers.size() + cells.size(); }
+};
+
+// The locations at which a block's next output state might differ from its stored output
+// state.  The stored state was computed from the input state of some earlier evaluation, and
+// each evaluation since then may have seen a different input and written different locations
+// (e.g., at symbolic memory addresses that depend on the input), so the locations must be
+// accumulated across every evaluation since the stored state was last replaced, and not just
+// since the previous evaluation.
+class OutputChanges {
+  // The input changes and the locations compared since the stored output state was replaced.
+  // Unknown until the first output state is stored.
+  StateWrites pending;
+
+ public:
+  // The output states of the predecessors changed at these locations.
+  void input_changed(const StateWrites & changes) { pending.insert(changes); }
+
+  // The locations to compare for an evaluation that wrote writes, when the stored output state
+  // was produced by an evaluation that wrote stored_writes.
+  StateWrites locations(StateWrites writes, const StateWrites & stored_writes) const {
+    writes.insert(pending);
+    writes.insert(stored_writes);
+    return writes;
+  }
+
+  // Record an evaluation that compared the given locations.  If its output state replaced the
+  // stored one, start afresh, and otherwise retain the locations for the next evaluation.
+  void evaluated(const StateWrites & compared, bool replaced) {
+    if (replaced) {
+      pending.clear();
+    }
+    else {
+      pending.insert(compared);
+    }
+  }
+};
+
 //==============================================================================================
 // SymbolicRegisterState
 //==============================================================================================
@@ -86,11 +157,16 @@ class SymbolicRegisterState: public RegisterStateGeneric {
   // Copy constructor should ensure a deep copy.
   // In general this doesn't happen at correct level if we don't implement it, but in this
   // case, we don't have any additional work to do calling the parent method is sufficient.
+  // The record of written registers is not copied.
   explicit SymbolicRegisterState(const SymbolicRegisterState& other):
     RegisterStateGeneric(other) {
     STRACE << "SymbolicRegisterState::SymbolicRegisterState(other)" << LEND;
   }
 
+  // Are we currently recording the registers written?  And which were written (if known)?
+  bool tracking_writes = false;
+  boost::optional<RegisterSet> written;
+
  public:
 
   // Instance() methods must take custom types to ensure promotion.
@@ -134,10 +210,29 @@ class SymbolicRegisterState: public RegisterStateGeneric {
   using Formatter = Semantics2::BaseSemantics::Formatter;
   virtual void print(std::ostream&, Formatter&) const override;
 
+  // Overridden to record written registers when tracking writes.
+  virtual void writeRegister(RegisterDescriptor reg, const BaseSValuePtr &value,
+                             BaseRiscOperators *ops) override;
+  // Overridden to record registers whose storage may be created or reorganized by the read.
+  virtual BaseSValuePtr readRegister(RegisterDescriptor reg, const BaseSValuePtr &dflt,
+                                     BaseRiscOperators *ops) override;
+
   // -----------------------------------------------------------------------------------------
   // Custom interface
   // -----------------------------------------------------------------------------------------
 
+  // Begin recording the registers written to this state, discarding any previous record.
+  void track_writes() {
+    tracking_writes = true;
+    written = RegisterSet();
+  }
+
+  // Stop recording written registers, but retain the record.
+  void stop_tracking_writes() { tracking_writes = false; }
+
+  // The registers written while tracking, or nothing if writes were never tracked.
+  const boost::optional<RegisterSet> & get_written() const { return written; }
+
   // CERT addition so we don't have to promote return value.
   SymbolicRegisterStatePtr sclone() {
     STRACE << "SymbolicRegisterState::sclone()" << LEND;
@@ -147,6 +242,18 @@ class SymbolicRegisterState: public RegisterStateGeneric {
   // This is the current state comparison, but it needs cleanup.
   bool equals(const SymbolicRegisterStatePtr& other);
 
+  // Compare only the specified registers with another state.
+  bool equals(const SymbolicRegisterStatePtr& other, const RegisterSet& regs);
+
+  // The number of register values stored in the state.
+  size_t size() const {
+    size_t count = 0;
+    for (const RegisterStateGeneric::RegPairs& rpl : registers_.values()) {
+      count += rpl.size();
+    }
+    return count;
+  }
+
   // Compare this state with another, and return a list of the changed registers.
   RegisterSet diff(const SymbolicRegisterStatePtr& other);
 
@@ -158,8 +265,7 @@ class SymbolicRegisterState: public RegisterStateGeneric {
   // on access" behaviors of the the standard readRegister() method.
   SymbolicValuePtr read_register(RegisterDescriptor rd) {
     BaseRiscOperators* ops = (BaseRiscOperators*)global_rops.get();
-    return SymbolicValue::promote(RegisterStateGeneric::readRegister(
-                                    rd, ops->undefined_(rd.get_nbits()), ops));
+    return SymbolicValue::promote(readRegister(rd, ops->undefined_(rd.get_nbits()), ops));
   }
 
   // This should probably be peekRegister() for ROSE compatability.
@@ -186,12 +292,16 @@ class SymbolicMemoryMapState: public BaseMemoryCellMap {
     merger(CERTMerger::instance());
   }
 
-  // Copy constructor should ensure a deep copy.
+  // Copy constructor should ensure a deep copy.  The record of written cells is not copied.
   explicit SymbolicMemoryMapState(const SymbolicMemoryMapState & other)
     : BaseMemoryCellMap(other) {
     // Our merger is copied by default?
   }
 
+  // Are we currently recording the cells written?  And which were written (if known)?
+  bool tracking_writes = false;
+  boost::optional<std::set<CellKey>> written;
+
  public:
 
   // Promote to our type.
@@ -259,6 +369,14 @@ class SymbolicMemoryMapState: public BaseMemoryCellMap {
                      BaseRiscOperators* addrOps,
                      BaseRiscOperators* valOps) override;
 
+  // Overridden to record cells created by reads when tracking writes.
+  virtual BaseSValuePtr readMemory(const BaseSValuePtr &address, const BaseSValuePtr &dflt,
+                                   BaseRiscOperators *addrOps,
+                                   BaseRiscOperators *valOps) override;
+  // Overridden to record written cells when tracking writes.
+  virtual void writeMemory(const BaseSValuePtr &address, const BaseSValuePtr &value,
+                           BaseRiscOperators *addrOps, BaseRiscOperators *valOps) override;
+
   using Formatter = Semantics2::BaseSemantics::Formatter;
   virtual void print(std::ostream&, Formatter&) const override;
 
@@ -266,8 +384,26 @@ class SymbolicMemoryMapState: public BaseMemoryCellMap {
   SymbolicValuePtr read_memory(const SymbolicValuePtr& address, const size_t nbits) const;
   void write_memory(const SymbolicValuePtr& address, const SymbolicValuePtr& value);
 
+  // Begin recording the cells written to this state, discarding any previous record.
+  void track_writes() {
+    tracking_writes = true;
+    written = std::set<CellKey>();
+  }
+
+  // Stop recording written cells, but retain the record.
+  void stop_tracking_writes() { tracking_writes = false; }
+
+  // The cells written while tracking, or nothing if writes were never tracked.
+  const boost::optional<std::set<CellKey>> & get_written() const { return written; }
+
   // CERT addition of new functionality.
   bool equals(const SymbolicMemoryMapStatePtr& other);
+
+  // Compare only the cells with the specified keys with another state.
+  bool equals(const SymbolicMemoryMapStatePtr& other, const std::set<CellKey>& keys);
+
+  // The number of memory cells in the state.
+  size_t size() const { return cells.size(); }
 };
 
 //==============================================================================================
@@ -346,6 +482,9 @@ class SymbolicMemoryListState: public BaseMemoryCellList {
     return BaseMemoryStatePtr(new SymbolicMemoryListState(*this));
   }
 
+  // The number of memory cells in the state.
+  size_t size() const { return cells.size(); }
+
   using Formatter = Semantics2::BaseSemantics::Formatter;
   virtual void print(std::ostream&, Formatter&) const override;
 
@@ -653,6 +792,31 @@ class SymbolicState: public BaseState {
   // Are we using the list-based or map-based memory model?
   bool is_map_based() const { return map_based; }
 
+  // Begin recording the locations written to this state, discarding any previous record.
+  void track_writes();
+
+  // Stop recording written locations, but retain the record.
+  void stop_tracking_writes();
+
+  // The locations written while tracking writes.  If writes were never tracked, all is true.
+  StateWrites get_writes() const;
+
+  // Compare only the specified locations with another state.  This is equivalent to the full
+  // comparison below whenever the states are known to be equal at every other location.
+  bool equals(const SymbolicStatePtr& other, const StateWrites& locations);
+
+  // The number of register values and memory cells in the state.
+  size_t size() const {
+    size_t count = SymbolicRegisterState::promote(registerState())->size();
+    if (map_based) {
+      count += SymbolicMemoryMapState::promote(memoryState())->size();
+    }
+    else {
+      count += SymbolicMemoryListState::promote(memoryState())->size();
+    }
+    return count;
+  }
+
   // CERT addition of new functionality.
   bool equals(const SymbolicStatePtr& other) {
     STRACE << "SymbolicState::equals()" << LEND;
@@ -0,0 +1,302 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include "summary.hpp"
+#include "descriptors.hpp"
+#include "imports.hpp"
+#include "md5.hpp"
+#include "options.hpp"
+#include "revision.hpp"
+
+namespace bf = boost::filesystem;
+
+namespace pharos {
+
+namespace {
+
+// The first line of every cache entry.  Change the version whenever the format of an entry or
+// the meaning of any of the summarized fields changes.
+const std::string entry_header = "pharos-function-summary 1";
+
+// Options that affect the results of the function analysis.  They're all added to the
+// fingerprint of the configuration.
+template <typename T>
+void add_option(std::ostream & o, const ProgOptVarMap & vm, const std::string & name) {
+  o << name << '=';
+  if (vm.count(name)) {
+    o << vm[name].as<T>();
+  }
+  o << '\n';
+}
+
+void add_flag(std::ostream & o, const ProgOptVarMap & vm, const std::string & name) {
+  o << name << '=' << vm.count(name) << '\n';
+}
+
+void write_parameter(std::ostream & o, const char * kind, const FunctionSummary::Parameter & p)
+{
+  o << kind << '\t' << p.reg << '\t' << p.stack_delta << '\t' << p.name << '\t' << p.type
+    << '\t' << p.direction << '\n';
+}
+
+} // unnamed namespace
+
+FunctionSummaryCache::FunctionSummaryCache(DescriptorSet & ds_, const ProgOptVarMap & vm)
+  : ds(ds_), directory(vm["function-cache"].as<bf::path>())
+{
+  std::ostringstream fp;
+  fp << "revision=" << REVISION << '\n'
+     << "rose=" << ROSE_PACKAGE_VERSION << '\n'
+     << "arch=" << ds.get_arch_bits() << '\n';
+  add_option<int>(fp, vm, "maximum-instructions-per-block");
+  add_option<int>(fp, vm, "maximum-iterations-per-function");
+  add_option<int>(fp, vm, "maximum-nodes-per-condition");
+  add_option<double>(fp, vm, "timeout");
+  add_option<double>(fp, vm, "per-function-timeout");
+  add_option<double>(fp, vm, "maximum-memory");
+  add_option<double>(fp, vm, "per-function-maximum-memory");
+  add_flag(fp, vm, "propagate-conditions");
+  if (vm.count("apidb")) {
+    for (const bf::path & db : vm["apidb"].as<std::vector<bf::path>>()) {
+      fp << "apidb=" << db.string() << '\n';
+    }
+  }
+  fp << vm.config() << '\n';
+  fingerprint = MD5(fp.str()).finalize().str();
+
+  boost::system::error_code ec;
+  bf::create_directories(directory, ec);
+  if (ec) {
+    GERROR << "Unable to create function cache directory " << directory << ": "
+           << ec.message() << LEND;
+  }
+
+  if (vm.count("function-cache-clear")) {
+    clear();
+  }
+
+  GINFO << "Using function cache " << directory << " with configuration fingerprint "
+        << fingerprint << "." << LEND;
+}
+
+bf::path FunctionSummaryCache::entry_path(const std::string & key) const {
+  // Spread the entries over subdirectories to keep the directories a reasonable size.
+  return directory / key.substr(0, 2) / key;
+}
+
+// The part of the key describing the target of a call or jump.
+std::string FunctionSummaryCache::target_key(rose_addr_t target) {
+  const ImportDescriptor* id = ds.get_import(target);
+  if (id) {
+    return "import:" + id->get_long_name();
+  }
+  const FunctionDescriptor* tfd = ds.get_func(target);
+  if (!tfd) {
+    return "unknown";
+  }
+  {
+    write_guard<decltype(mutex)> guard{mutex};
+    auto found = keys.find(target);
+    if (found != keys.end()) {
+      return "key:" + found->second;
+    }
+  }
+  // The target hasn't been keyed yet, which happens for recursive calls and functions that
+  // weren't selected for analysis.  Use the bytes of the function, but not its callees.
+  return "func:" + tfd->get_exact_hash();
+}
+
+std::string FunctionSummaryCache::key(const FunctionDescriptor & fd) {
+  rose_addr_t addr = fd.get_address();
+  {
+    write_guard<decltype(mutex)> guard{mutex};
+    auto found = keys.find(addr);
+    if (found != keys.end()) {
+      return found->second;
+    }
+  }
+
+  std::ostringstream k;
+  k << fingerprint << '\n' << fd.get_exact_hash() << '\n';
+  if (fd.is_thunk()) {
+    k << "jmp " << target_key(fd.get_jmp_addr()) << '\n';
+  }
+  // Outgoing calls are ordered by address, and so are their targets.
+  for (const CallDescriptor* cd : fd.get_outgoing_calls()) {
+    for (rose_addr_t target : cd->get_targets()) {
+      k << "call " << target_key(target) << '\n';
+    }
+  }
+  std::string result = MD5(k.str()).finalize().str();
+
+  write_guard<decltype(mutex)> guard{mutex};
+  keys.emplace(addr, result);
+  return result;
+}
+
+boost::optional<FunctionSummary> FunctionSummaryCache::read_entry(const std::string & key) {
+  bf::path path = entry_path(key);
+  std::ifstream in(path.native());
+  if (!in) return boost::none;
+
+  FunctionSummary summary;
+  std::string line;
+  bool valid = std::getline(in, line) && line == entry_header
+               && std::getline(in, line) && line == "key\t" + key;
+
+  while (valid && std::getline(in, line)) {
+    std::vector<std::string> fields;
+    boost::split(fields, line, boost::is_any_of("\t"));
+    const std::string & kind = fields[0];
+    try {
+      if ((kind == "stack_delta" || kind == "stack_parameters") && fields.size() == 3) {
+        StackDelta sd(std::stoi(fields[1]),
+                      static_cast<GenericConfidence>(std::stoi(fields[2])));
+        (kind == "stack_delta" ? summary.stack_delta : summary.stack_parameters) = sd;
+      }
+      else if (kind == "never_returns" && fields.size() == 2) {
+        summary.never_returns = (fields[1] == "1");
+      }
+      else if (kind == "returns_this_pointer" && fields.size() == 2) {
+        summary.returns_this_pointer = (fields[1] == "1");
+      }
+      else if (kind == "convention" && fields.size() == 2) {
+        summary.conventions.push_back(fields[1]);
+      }
+      else if ((kind == "parameter" || kind == "return") && fields.size() == 6) {
+        FunctionSummary::Parameter p;
+        p.reg = fields[1];
+        p.stack_delta = std::stoul(fields[2]);
+        p.name = fields[3];
+        p.type = fields[4];
+        p.direction = std::stoi(fields[5]);
+        (kind == "parameter" ? summary.parameters : summary.returns).push_back(std::move(p));
+      }
+      else {
+        valid = false;
+      }
+    }
+    catch (const std::logic_error &) {
+      // Thrown by std::stoi and friends.
+      valid = false;
+    }
+  }
+
+  if (!valid) {
+    GWARN << "Discarding invalid function cache entry " << path << LEND;
+    ++invalid;
+    in.close();
+    boost::system::error_code ec;
+    bf::remove(path, ec);
+    return boost::none;
+  }
+  return summary;
+}
+
+bool FunctionSummaryCache::restore(FunctionDescriptor & fd) {
+  std::string k = key(fd);
+  boost::optional<FunctionSummary> summary = read_entry(k);
+  if (!summary) {
+    ++misses;
+    return false;
+  }
+  fd.set_summary(*summary);
+  ++hits;
+  GDEBUG << "Restored cached summary for function " << fd.address_string() << LEND;
+  return true;
+}
+
+void FunctionSummaryCache::store(const FunctionDescriptor & fd) {
+  std::string k = key(fd);
+  FunctionSummary summary = fd.get_summary();
+
+  bf::path path = entry_path(k);
+  boost::system::error_code ec;
+  bf::create_directories(path.parent_path(), ec);
+
+  // Write to a temporary file and rename it, so that concurrent readers (including other
+  // processes sharing the cache) never see a partial entry.
+  std::ostringstream tmpname;
+  tmpname << k << ".tmp." << getpid() << '.' << std::this_thread::get_id();
+  bf::path tmp = path.parent_path() / tmpname.str();
+  {
+    std::ofstream out(tmp.native());
+    out << entry_header << '\n'
+        << "key\t" << k << '\n'
+        << "stack_delta\t" << summary.stack_delta.delta << '\t'
+        << int(summary.stack_delta.confidence) << '\n'
+        << "stack_parameters\t" << summary.stack_parameters.delta << '\t'
+        << int(summary.stack_parameters.confidence) << '\n'
+        << "never_returns\t" << summary.never_returns << '\n'
+        << "returns_this_pointer\t" << summary.returns_this_pointer << '\n';
+    for (const std::string & cc : summary.conventions) {
+      out << "convention\t" << cc << '\n';
+    }
+    for (const FunctionSummary::Parameter & p : summary.parameters) {
+      write_parameter(out, "parameter", p);
+    }
+    for (const FunctionSummary::Parameter & p : summary.returns) {
+      write_parameter(out, "return", p);
+    }
+    if (!out) {
+      GWARN << "Unable to write function cache entry " << tmp << LEND;
+      out.close();
+      bf::remove(tmp, ec);
+      return;
+    }
+  }
+  bf::rename(tmp, path, ec);
+  if (ec) {
+    GWARN << "Unable to write function cache entry " << path << ": " << ec.message() << LEND;
+    bf::remove(tmp, ec);
+    return;
+  }
+  ++stores;
+}
+
+void FunctionSummaryCache::clear() {
+  boost::system::error_code ec;
+  size_t removed = 0;
+  for (bf::directory_iterator i(directory, ec), end; !ec && i != end; i.increment(ec)) {
+    if (bf::is_directory(i->path())) {
+      removed += bf::remove_all(i->path(), ec);
+    }
+  }
+  write_guard<decltype(mutex)> guard{mutex};
+  keys.clear();
+  GINFO << "Cleared function cache " << directory << " (" << removed << " files removed)."
+        << LEND;
+}
+
+FunctionSummaryCache::Stats FunctionSummaryCache::get_stats() const {
+  Stats stats;
+  stats.hits = hits;
+  stats.misses = misses;
+  stats.stores = stores;
+  stats.invalid = invalid;
+  return stats;
+}
+
+void FunctionSummaryCache::report() const {
+  Stats stats = get_stats();
+  uint64_t lookups = stats.hits + stats.misses;
+  GINFO << "Function cache: " << stats.hits << " hits, " << stats.misses << " misses ("
+        << (lookups ? (100.0 * double(stats.hits) / double(lookups)) : 0.0) << "% hit rate), "
+        << stats.stores << " stored, " << stats.invalid << " invalid entries discarded."
+        << LEND;
+}
+
+} // namespace pharos
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
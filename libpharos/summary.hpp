@@ -0,0 +1,121 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#ifndef Pharos_Summary_H
+#define Pharos_Summary_H
+
+// This header provides a persistent, content-addressed cache of the per-function results of
+// the bottom-up analysis.  The results that other functions depend on (the stack delta, the
+// calling conventions, the parameters and return values, and so on) are recorded in a
+// FunctionSummary, which is written to a file named after a key derived from the exact hash of
+// the function, the keys of everything that the function calls, and a fingerprint of the
+// configuration that produced the results.  When the same function is encountered again (in
+// this or a later version of the program) the BottomUpAnalyzer restores the summary instead
+// of computing the function's PDG.  The cache is enabled with --function-cache.
+//
+// Because the PDG itself is not cached, anything that actually needs the PDG of a function
+// will still compute it on demand, and the restored summary will be replaced by the freshly
+// computed values.
+
+#include <map>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+
+#include "misc.hpp"
+#include "delta.hpp"
+#include "threads.hpp"
+
+namespace pharos {
+
+class DescriptorSet;
+class FunctionDescriptor;
+class ProgOptVarMap;
+
+// The results of analyzing a function that are visible to the rest of the program.
+struct FunctionSummary {
+  // One entry in the parameter list (or return values) of the function.
+  struct Parameter {
+    // The register name, or empty for stack parameters.
+    std::string reg;
+    // The stack delta for stack parameters.
+    size_t stack_delta = 0;
+    std::string name;
+    std::string type;
+    // A ParameterDefinition::DirectionEnum.
+    int direction = 0;
+  };
+
+  StackDelta stack_delta;
+  StackDelta stack_parameters;
+  bool never_returns = false;
+  bool returns_this_pointer = false;
+  // The names of the matching calling conventions, in order of preference.
+  std::vector<std::string> conventions;
+  std::vector<Parameter> parameters;
+  std::vector<Parameter> returns;
+};
+
+class FunctionSummaryCache {
+ public:
+  struct Stats {
+    // Functions whose summary was restored from the cache.
+    uint64_t hits = 0;
+    // Functions that were not found in the cache.
+    uint64_t misses = 0;
+    // Summaries written to the cache.
+    uint64_t stores = 0;
+    // Cache entries that were unreadable or did not match their key, and were discarded.
+    uint64_t invalid = 0;
+  };
+
+  // Open the cache in the directory named by --function-cache, creating it if needed.  The
+  // existing entries are removed if --function-cache-clear was specified.
+  FunctionSummaryCache(DescriptorSet & ds, const ProgOptVarMap & vm);
+
+  // The key under which the summary for the function is stored.  Keys for the callees of the
+  // function are incorporated, so the key should be requested in bottom-up order.
+  std::string key(const FunctionDescriptor & fd);
+
+  // Restore the cached summary for the function, returning whether there was one.
+  bool restore(FunctionDescriptor & fd);
+
+  // Record the summary for the function in the cache.
+  void store(const FunctionDescriptor & fd);
+
+  // Remove every entry from the cache directory.
+  void clear();
+
+  Stats get_stats() const;
+  void report() const;
+
+ private:
+  DescriptorSet & ds;
+  boost::filesystem::path directory;
+  // A hash of everything besides the function itself that affects the results of the analysis.
+  std::string fingerprint;
+
+  mutable std_mutex mutex;
+  std::map<rose_addr_t, std::string> keys;
+
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<uint64_t> stores{0};
+  std::atomic<uint64_t> invalid{0};
+
+  boost::filesystem::path entry_path(const std::string & key) const;
+  boost::optional<FunctionSummary> read_entry(const std::string & key);
+  std::string target_key(rose_addr_t target);
+};
+
+} // namespace pharos
+
+#endif // Pharos_Summary_H
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -0,0 +1,256 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "superset.hpp"
+#include "partitioner.hpp"
+#include "threads.hpp"
+#include "util.hpp"
+
+namespace pharos {
+
+namespace {
+
+// The number of byte offsets decoded by each parallel task.
+constexpr size_t superset_chunk_size = 64 * 1024;
+
+// The number of byte offsets decoded with each acquisition of the Sage pool lock.
+constexpr size_t decode_batch_size = 256;
+
+using Edge = std::pair<uint32_t, uint32_t>;
+
+// A range of consecutive offsets within one region, and the edges found in it.
+struct SupersetChunk {
+  size_t region;
+  size_t begin;
+  size_t end;
+  std::vector<Edge> edges;
+  // The time spent waiting for the Sage pool lock.
+  double lock_wait = 0.0;
+};
+
+} // unnamed namespace
+
+SupersetDisassembly::SupersetDisassembly(
+  ArchitecturePtr const & arch, P2::PartitionerConstPtr const & partitioner,
+  unsigned int nthreads, size_t zero_threshold)
+{
+  // The executable regions of the program.  Adjacent segments are merged into one region.
+  AddressIntervalSet executable;
+  for (const MemoryMap::Node &node : partitioner->memoryMap()->nodes()) {
+    if ((node.value().accessibility() & MemoryMap::EXECUTABLE) != 0) {
+      executable.insert(node.key());
+    }
+  }
+  size_t total = 0;
+  for (const AddressInterval & interval : executable.intervals()) {
+    regions.push_back(Region{interval.least(), total, interval.size()});
+    total += interval.size();
+  }
+  if (total > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Too much executable memory for superset disassembly");
+  }
+  table.resize(total);
+  stats.offsets = total;
+
+  auto decode_timer = make_timer();
+  decode(arch, partitioner->memoryMap(), nthreads);
+  stats.decode_seconds = decode_timer.stop().count();
+
+  auto prune_timer = make_timer();
+  prune(zero_threshold);
+  stats.prune_seconds = prune_timer.stop().count();
+}
+
+rose_addr_t SupersetDisassembly::address(size_t v) const {
+  auto region = std::upper_bound(regions.begin(), regions.end(), v,
+                                 [](size_t x, const Region & r) { return x < r.base; });
+  assert(region != regions.begin());
+  --region;
+  return region->address + (v - region->base);
+}
+
+boost::optional<size_t> SupersetDisassembly::vertex(rose_addr_t addr) const {
+  auto region = std::upper_bound(regions.begin(), regions.end(), addr,
+                                 [](rose_addr_t a, const Region & r) { return a < r.address; });
+  if (region == regions.begin()) return boost::none;
+  --region;
+  if (addr - region->address >= region->size) return boost::none;
+  return region->base + (addr - region->address);
+}
+
+boost::optional<size_t> SupersetDisassembly::fallthrough(size_t v) const {
+  size_t size = table[v].size;
+  if (size == 0 || v + size >= table.size()) return boost::none;
+  // The offsets are only consecutive addresses within a region.
+  if (address(v + size) != address(v) + size) return boost::none;
+  return v + size;
+}
+
+void SupersetDisassembly::decode(ArchitecturePtr const & arch, MemoryMap::Ptr const & map,
+                                 unsigned int nthreads)
+{
+  // Split the regions into chunks, which never cross a region boundary.
+  std::vector<SupersetChunk> chunks;
+  for (size_t r = 0; r < regions.size(); ++r) {
+    const Region & region = regions[r];
+    for (size_t begin = 0; begin < region.size; begin += superset_chunk_size) {
+      size_t end = std::min(region.size, begin + superset_chunk_size);
+      chunks.push_back(SupersetChunk{r, region.base + begin, region.base + end, {}, 0.0});
+    }
+  }
+
+  // Each chunk is decoded with its own instruction decoder, and writes only its own entries in
+  // the table.  The instructions are summarized and then discarded a batch at a time, since
+  // keeping an AST for every byte offset would be prohibitively expensive.  The batches are
+  // decoded under the Sage pool lock (see InstructionBatch), and summarized in parallel.
+  auto decode_chunk = [this, &arch, &map](SupersetChunk & chunk) {
+    const Region & region = regions[chunk.region];
+    InstructionBatch batch(arch->newInstructionDecoder(), map);
+    for (size_t begin = chunk.begin; begin < chunk.end; begin += decode_batch_size) {
+      size_t count = std::min(decode_batch_size, chunk.end - begin);
+      batch.decode_range(region.address + (begin - region.base), count);
+      for (size_t i = 0; i < count; ++i) {
+        SgAsmInstruction * insn = batch.instructions()[i];
+        if (!insn || arch->isUnknown(insn)) continue;
+        size_t v = begin + i;
+        rose_addr_t addr = insn->get_address();
+        Entry & entry = table[v];
+        entry.size = uint8_t(insn->get_size());
+        entry.flags = DECODED;
+        SgAsmX86Instruction * xinsn = isSgAsmX86Instruction(insn);
+        if (xinsn && insn_is_call(xinsn)) entry.flags |= CALL;
+        if (xinsn && xinsn->get_kind() == x86_int3) entry.flags |= INT3;
+        if (check_zero_insn(insn)) entry.flags |= ZERO;
+
+        rose_addr_t fallthru = addr + insn->get_size();
+        bool complete;
+        auto successors = arch->getSuccessors(insn, complete);
+        for (rose_addr_t saddr : successors.values()) {
+          auto s = vertex(saddr);
+          if (s) {
+            chunk.edges.emplace_back(uint32_t(v), uint32_t(*s));
+          }
+          else if (!(entry.flags & CALL) || saddr == fallthru) {
+            // Calls to addresses outside of executable memory (e.g., to imports) are
+            // expected, but other control flow there means that this isn't code.
+            entry.flags |= OUTSIDE;
+          }
+        }
+      }
+    }
+    chunk.lock_wait = batch.get_lock_wait();
+  };
+  parallel_for_each(chunks, nthreads, decode_chunk);
+
+  // The chunks are in vertex order, so the edges are sorted by source.
+  size_t nedges = 0;
+  for (const SupersetChunk & chunk : chunks) {
+    nedges += chunk.edges.size();
+  }
+  std::vector<Edge> edges;
+  edges.reserve(nedges);
+  for (SupersetChunk & chunk : chunks) {
+    edges.insert(edges.end(), chunk.edges.begin(), chunk.edges.end());
+    std::vector<Edge>().swap(chunk.edges);
+  }
+  forward = Graph(boost::edges_are_sorted, edges.begin(), edges.end(), table.size());
+  for (Edge & edge : edges) {
+    std::swap(edge.first, edge.second);
+  }
+  reverse = Graph(boost::edges_are_unsorted_multi_pass, edges.begin(), edges.end(),
+                  table.size());
+  stats.edges = nedges;
+
+  for (const Entry & entry : table) {
+    if (entry.flags & DECODED) ++stats.decoded;
+  }
+  for (const SupersetChunk & chunk : chunks) {
+    stats.lock_wait_seconds += chunk.lock_wait;
+  }
+}
+
+void SupersetDisassembly::prune(size_t zero_threshold)
+{
+  size_t n = table.size();
+
+  // The length of the run of zero instructions starting at each offset, computed backwards.  A
+  // run can't be longer than the number of offsets, which fits in 32 bits.
+  std::vector<uint32_t> zero_run(n, 0);
+  for (size_t i = n; i-- > 0;) {
+    if (table[i].flags & ZERO) {
+      auto next = fallthrough(i);
+      zero_run[i] = 1 + (next ? zero_run[*next] : 0);
+    }
+  }
+
+  // Find the offsets that aren't code on their own account.
+  std::vector<uint8_t> invalid(n, 0);
+  std::vector<size_t> worklist;
+  for (size_t v = 0; v < n; ++v) {
+    const Entry & entry = table[v];
+    bool bad = !(entry.flags & DECODED) || (entry.flags & OUTSIDE)
+               || (zero_threshold && zero_run[v] >= zero_threshold);
+    // Consecutive int3 instructions are padding, not code.
+    if (!bad && (entry.flags & INT3)) {
+      auto next = fallthrough(v);
+      bad = next && (table[*next].flags & INT3);
+    }
+    if (bad) {
+      invalid[v] = 1;
+      worklist.push_back(v);
+    }
+  }
+
+  // Then propagate backwards, since code that flows into something that isn't code isn't code
+  // either.  Calls are assumed to return, so only the fall through of a call matters.
+  while (!worklist.empty()) {
+    size_t w = worklist.back();
+    worklist.pop_back();
+    for (auto e : boost::make_iterator_range(boost::out_edges(uint32_t(w), reverse))) {
+      size_t p = boost::target(e, reverse);
+      if (invalid[p]) continue;
+      if (table[p].flags & CALL) {
+        auto next = fallthrough(p);
+        if (!next || *next != w) continue;
+      }
+      invalid[p] = 1;
+      worklist.push_back(p);
+    }
+  }
+
+  for (size_t v = 0; v < n; ++v) {
+    if (!invalid[v]) {
+      table[v].flags |= VALID;
+      ++stats.valid;
+    }
+  }
+}
+
+std::vector<rose_addr_t> SupersetDisassembly::call_targets() const
+{
+  std::vector<rose_addr_t> result;
+  for (size_t v = 0; v < table.size(); ++v) {
+    if ((table[v].flags & (CALL | VALID)) != (CALL | VALID)) continue;
+    auto next = fallthrough(v);
+    for (auto e : boost::make_iterator_range(boost::out_edges(uint32_t(v), forward))) {
+      size_t t = boost::target(e, forward);
+      if ((!next || t != *next) && is_valid(t)) {
+        result.push_back(address(t));
+      }
+    }
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+} // namespace pharos
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
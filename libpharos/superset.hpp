@@ -0,0 +1,127 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#ifndef Pharos_Superset_H
+#define Pharos_Superset_H
+
+// This header provides superset disassembly, which decodes an instruction at every byte
+// offset of the executable memory of a program, rather than only at the addresses reached by
+// following control flow from known code.  Every real instruction is therefore in the
+// superset, along with a great many spurious ones.  The spurious instructions are pruned using
+// the same heuristics that the Pharos partitioner uses to reject speculative code: runs of
+// zero instructions (see RefuseZeroCode), int3 padding, and control flow to addresses that
+// aren't valid code (see CERTEngine::bad_code).  The surviving call targets are candidate
+// function entry points, which the SupersetEngine uses to seed the standard partitioner, so
+// that code that is only reached through obfuscated control flow is still found.
+//
+// The decoded instructions aren't retained.  Each byte offset is summarized by a two byte
+// entry in a table, and the control flow between the offsets is kept in compressed sparse row
+// graphs.
+
+#include "rose.hpp"
+#include <Rose/BinaryAnalysis/Partitioner2/Partitioner.h>
+
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "misc.hpp"
+
+namespace pharos {
+
+class SupersetDisassembly {
+ public:
+  // The facts recorded for each byte offset.
+  enum Flags : uint8_t {
+    // An instruction was decoded at this offset.
+    DECODED = 0x01,
+    // The instruction survived pruning.
+    VALID = 0x02,
+    // The instruction is a call.  Its call targets don't affect its validity.
+    CALL = 0x04,
+    // The instruction is a zero instruction (two zero bytes).
+    ZERO = 0x08,
+    // The instruction is an int3.
+    INT3 = 0x10,
+    // The instruction has a successor outside of executable memory.
+    OUTSIDE = 0x20,
+  };
+
+  struct Entry {
+    uint8_t size = 0;
+    uint8_t flags = 0;
+  };
+
+  // The vertices of the graphs are the byte offsets, numbered consecutively across the
+  // executable regions in address order.
+  using Graph = boost::compressed_sparse_row_graph<
+    boost::directedS, boost::no_property, boost::no_property, boost::no_property,
+    uint32_t, uint32_t>;
+
+  struct Stats {
+    size_t offsets = 0;
+    size_t decoded = 0;
+    size_t valid = 0;
+    size_t edges = 0;
+    double decode_seconds = 0.0;
+    // The total time that the decoding threads spent waiting for the Sage pool lock.
+    double lock_wait_seconds = 0.0;
+    double prune_seconds = 0.0;
+  };
+
+  using ArchitecturePtr = Rose::BinaryAnalysis::Architecture::BaseConstPtr;
+
+  // Disassemble the executable memory of the partitioner's memory map using up to nthreads
+  // threads.  A run of zero_threshold or more zero instructions is not code.
+  SupersetDisassembly(ArchitecturePtr const & arch, P2::PartitionerConstPtr const & partitioner,
+                      unsigned int nthreads, size_t zero_threshold);
+
+  // The number of byte offsets (vertices).
+  size_t size() const { return table.size(); }
+
+  // Map between vertices and addresses.
+  rose_addr_t address(size_t v) const;
+  boost::optional<size_t> vertex(rose_addr_t addr) const;
+
+  const Entry & entry(size_t v) const { return table[v]; }
+  bool is_valid(size_t v) const { return table[v].flags & VALID; }
+
+  // The control flow successors and predecessors of each offset.
+  const Graph & successors() const { return forward; }
+  const Graph & predecessors() const { return reverse; }
+
+  // The sorted addresses that valid call instructions call, and that are valid themselves.
+  std::vector<rose_addr_t> call_targets() const;
+
+  const Stats & get_stats() const { return stats; }
+
+ private:
+  struct Region {
+    rose_addr_t address;
+    size_t base;
+    size_t size;
+  };
+
+  std::vector<Region> regions;
+  std::vector<Entry> table;
+  Graph forward;
+  Graph reverse;
+  Stats stats;
+
+  // The vertex that v falls through to, if there is one.
+  boost::optional<size_t> fallthrough(size_t v) const;
+
+  void decode(ArchitecturePtr const & arch, MemoryMap::Ptr const & map, unsigned int nthreads);
+  void prune(size_t zero_threshold);
+};
+
+} // namespace pharos
+
+#endif // Pharos_Superset_H
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
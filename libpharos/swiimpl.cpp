@@ -212,14 +212,18 @@ void init()
     "assertz((pharos:assert_uniquely(A) :- catch(A, _, false), !))";
   static constexpr auto assert_uniquely2 =
     "assertz((pharos:assert_uniquely(A) :- assertz(A)))";
+  static constexpr auto assert_all_uniquely =
+    "assertz((pharos:assert_all_uniquely(L) :- "
+    "forall(member(A, L), pharos:assert_uniquely(A))))";
   command(integers_as_hex1);
   command(integers_as_hex2);
   command(term_to_string);
   command(register_predicate);
   command(assert_uniquely1);
   command(assert_uniquely2);
+  command(assert_all_uniquely);
   command("pharos:compile_predicates([integers_as_hex/2, term_to_string/2, "
-          "register_predicate/4, assert_uniquely/1])");
+          "register_predicate/4, assert_uniquely/1, assert_all_uniquely/1])");
 }
 
 std::ostream & term_to_stream(std::ostream & stream, pl_term pt)
@@ -8,6 +8,10 @@
 #include <thread>
 #include <utility>
 #include <list>
+#include <vector>
+#include <atomic>
+#include <exception>
+#include <algorithm>
 #include <functional>
 #include <type_traits>
 
@@ -296,6 +300,60 @@ class ThreadPool {
   bool shutdown = false;
 };
 
+// Call fn(items[i]) for every element of a random access container, using up to nthreads
+// threads.  The elements are handed out in order, one at a time, so fn may take wildly
+// different amounts of time for different elements.  Any results that depend on the order of
+// the elements should be written to a per-element slot and combined afterwards.  If any call
+// throws, the remaining elements are skipped and the first exception is rethrown once all of
+// the threads have finished.
+template <typename Container, typename Fn>
+void parallel_for_each(Container & items, unsigned int nthreads, Fn fn)
+{
+  size_t n = items.size();
+#ifdef PHAROS_BROKEN_THREADS
+  nthreads = 1;
+#endif
+  if (nthreads <= 1 || n <= 1) {
+    for (size_t i = 0; i < n; ++i) {
+      fn(items[i]);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto work = [&]() {
+    size_t i;
+    while (!failed && (i = next++) < n) {
+      try {
+        fn(items[i]);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> guard(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  size_t count = std::min(size_t(nthreads), n);
+  for (size_t t = 1; t < count; ++t) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
 } // namespace pharos
 
 #endif // Pharos_Threads_H
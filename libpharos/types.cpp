@@ -8,6 +8,7 @@
 #include "defuse.hpp"
 #include "stkvar.hpp"
 #include "demangle.hpp"
+#include "intern.hpp"
 #include "ooanalyzer.hpp"
 
 // set up local logging
@@ -159,8 +160,13 @@ fetch_type_descriptor(TreeNodePtr tnp) {
   // Every types treenode has a bitwidth fact from the treenode itself
   td->bit_width(tnp->nBits());
 
-  boost::any ud = td;
-  tnp->userData(ud);
+  // Interned treenodes are shared by every function and thread (see intern.hpp), so they get
+  // a default type descriptor that isn't attached to them.  No types are ever inferred for them,
+  // since the TypeSolver refuses to run when expressions are interned.
+  if (!is_interned_expression(tnp)) {
+    boost::any ud = td;
+    tnp->userData(ud);
+  }
 
   return td;
 }
@@ -1669,6 +1675,15 @@ TypeSolver::generate_type_information(const std::map<TreeNode*,TreeNodePtr> &tre
     return false;
   }
 
+  // Type analysis identifies each value by its treenode, and records what it learns in the
+  // treenode's userData().  Interned treenodes are shared by every occurrence of an equal
+  // expression in every function, so the distinct values would be collapsed into one type
+  // variable, and the type descriptors couldn't be attached to them (see intern.hpp).
+  if (get_global_interner()) {
+    GERROR << "Type analysis can't be used with --intern-expressions." << LEND;
+    return false;
+  }
+
   MDEBUG << "Generating type facts" << LEND;
 
   time_point factgen_ts = clock::now();
@@ -584,6 +584,8 @@ class TypeSolver {
 
   ~TypeSolver();
 
+  // Returns false without generating anything if Prolog couldn't be started, or if expressions
+  // are being interned (see --intern-expressions).
   bool generate_type_information(const std::map<TreeNode*,TreeNodePtr> &treenodes,
                                  const std::map<TreeNode*,TreeNodePtr> &memory_accesses);
 
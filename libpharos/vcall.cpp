@@ -167,7 +167,7 @@ bool VirtualFunctionCallAnalyzer::analyze() {
   else {
     // Otherwise all of the latest writers are vftable instructions.
 
-    vftable_insns = vfunc_aa->latest_writers;
+    vftable_insns = vfunc_aa->latest_writers.to_set();
     // If there are no latest writers at all, fail.  This should be a very unusual case,
     // because _someone_ should have written a call destination into the register.
     // destination.  It appears that this is triggering more often than expected, probably
@@ -1,5 +1,7 @@
 // Copyright 2015-2019 Carnegie Mellon University.  See LICENSE file for terms.
 
+#include <algorithm>
+
 #include <boost/range/adaptor/map.hpp>
 
 #include "vftable.hpp"
@@ -69,40 +71,41 @@ bool VirtualBaseTable::analyze() {
   return valid();
 }
 
-void VirtualBaseTable::analyze_overlaps(const VFTableAddrMap& vftables, const VBTableAddrMap& vbtables) {
+void VirtualBaseTable::analyze_overlaps(const VFTableAddrMap& vftables,
+                                        const std::vector<rose_addr_t>& vbtable_bounds) {
   unsigned int limit;
   size_t arch_bytes = ds.get_arch_bytes();
-  for (auto const & vft : boost::adaptors::values(vftables)) {
-    if (vft->addr > addr) {
-      // Don't bound ourselves by other vftables if we know that they are invalid.
-      if (vft->best_size < 1) continue;
+  // Both kinds of tables are sorted by address, so only the tables following this one need to
+  // be considered, and only until they're too far away to limit the size any further.
+  for (auto i = vftables.upper_bound(addr); i != vftables.end(); ++i) {
+    auto const & vft = i->second;
+    if (vft->addr - addr >= 4 && ((vft->addr - 4) - addr) / arch_bytes >= size) break;
 
-      if (vft->rtti != NULL) {
-        limit = ((vft->addr - 4) - addr) / arch_bytes;
-      }
-      else {
-        limit = (vft->addr - addr) / arch_bytes;
-      }
+    // Don't bound ourselves by other vftables if we know that they are invalid.
+    if (vft->best_size < 1) continue;
 
-      if (limit < size) {
-        //GDEBUG << "Reducing size of vbtable " << addr_str(addr) << " to " << limit
-        //       << " because it overlaps with vftable " << addr_str(vft->addr) << LEND;
-        size = limit;
-      }
+    if (vft->rtti != NULL) {
+      limit = ((vft->addr - 4) - addr) / arch_bytes;
+    }
+    else {
+      limit = (vft->addr - addr) / arch_bytes;
     }
-  }
 
-  for (auto const & vbt : boost::adaptors::values(vbtables)) {
-    if (vbt->addr > addr) {
-      // Don't bound ourselves by other vbtables if we know that they are invalid.
-      if (vbt->size < 2) continue;
+    if (limit < size) {
+      //GDEBUG << "Reducing size of vbtable " << addr_str(addr) << " to " << limit
+      //       << " because it overlaps with vftable " << addr_str(vft->addr) << LEND;
+      size = limit;
+    }
+  }
 
-      limit = (vbt->addr - addr) / arch_bytes;
-      if (limit < size) {
-        //GDEBUG << "Reducing size of vbtable " << addr_str(addr) << " to " << limit
-        //       << " because it overlaps with vbtable " << addr_str(vbt->addr) << LEND;
-        size = limit;
-      }
+  // Only the nearest following vbtable can limit the size.
+  auto next = std::upper_bound(vbtable_bounds.begin(), vbtable_bounds.end(), addr);
+  if (next != vbtable_bounds.end()) {
+    limit = (*next - addr) / arch_bytes;
+    if (limit < size) {
+      //GDEBUG << "Reducing size of vbtable " << addr_str(addr) << " to " << limit
+      //       << " because it overlaps with vbtable " << addr_str(*next) << LEND;
+      size = limit;
     }
   }
 }
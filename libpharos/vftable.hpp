@@ -64,8 +64,11 @@ class VirtualBaseTable {
   // not.
   bool analyze();
 
-  // Limit sizes based on overlaps with other tables and data structures.
-  void analyze_overlaps(const VFTableAddrMap& vftables, const VBTableAddrMap& vbtables);
+  // Limit sizes based on overlaps with other tables and data structures.  The vbtable bounds
+  // are the sorted addresses of the virtual base tables that were valid before any of their
+  // sizes were limited, so that the tables can be analyzed in any order (or concurrently).
+  void analyze_overlaps(const VFTableAddrMap& vftables,
+                        const std::vector<rose_addr_t>& vbtable_bounds);
 
   // Read an entry from the table.
   signed int read_entry(unsigned int entry) const;
@@ -181,8 +181,8 @@ IRExprPtr wp_stmts(const Stmts& stmts, const IRExprPtr& post, const Register& me
 // specified.  If we do not do anything, the unspecified executions are 'true' in the WP
 // formula which is not what we want.  This function adds edges for those executions to the
 // error node.
-IR add_error_edges (const IR& ir) {
-  IRCFG cfg = ir.get_cfg ();
+void add_error_edges (IR& ir) {
+  IRCFG & cfg = ir.get_mutable_cfg ();
   auto edgecond_map = boost::get(boost::edge_name_t(), cfg);
 
   auto error = ir.get_error ();
@@ -209,7 +209,6 @@ IR add_error_edges (const IR& ir) {
     }
 
   }
-  return IR (ir, cfg);
 }
 }
 
@@ -218,7 +217,12 @@ namespace pharos {
 IRExprPtr wp_cfg(const IR& ir_, const IRExprPtr &post) {
   std::vector<IRCFGVertex> rtopo;
 
-  IR ir = add_error_edges (split_edges (filter_backedges (ir_)));
+  IR ir = ir_;
+  IRPassManager ()
+    .add ("filter_backedges", filter_backedges_in_place)
+    .add ("split_edges", split_edges_in_place)
+    .add ("add_error_edges", add_error_edges)
+    .run (ir);
 
   const IRCFG& cfg = ir.get_cfg();
   auto ir_map = boost::get(boost::vertex_ir_t(), cfg);
@@ -284,9 +288,10 @@ IRExprPtr wp_cfg(const IR& ir_, const IRExprPtr &post) {
 
 
 std::tuple<IR, IRExprPtr, std::set<IRCFGVertex>> add_reached_postcondition (
-  const IR& ir, const std::set<rose_addr_t> targets, boost::optional<Register> hit_var_)
+  const IR& ir_, const std::set<rose_addr_t> targets, boost::optional<Register> hit_var_)
 {
-  IRCFG cfg = ir.get_cfg ();
+  IR ir = ir_;
+  IRCFG & cfg = ir.get_mutable_cfg ();
 
   Register hit_var;
 
@@ -313,13 +318,12 @@ std::tuple<IR, IRExprPtr, std::set<IRCFGVertex>> add_reached_postcondition (
   // Check for NULL
 
   auto bb_map = boost::get (boost::vertex_name_t (), cfg);
-  auto ir_map = boost::get (boost::vertex_ir_t (), cfg);
 
   // Initialize the variable to false in the entry
   auto entry = ir.get_entry ();
-  auto irstmts = ir_map[entry];
+  Stmts & irstmts = ir.get_mutable_stmts (entry);
   auto newstmt = RegWriteStmt (hit_var, SymbolicExpr::makeBooleanConstant (false));
-  irstmts->insert (irstmts->begin (), newstmt);
+  irstmts.insert (irstmts.begin (), newstmt);
 
   // Loop over each BB.  If the BB matches one of the targets, adjust
   // the IR to insert writes at the proper places.
@@ -332,31 +336,31 @@ std::tuple<IR, IRExprPtr, std::set<IRCFGVertex>> add_reached_postcondition (
   BGL_FORALL_VERTICES(v, cfg, IRCFG) {
     auto insn_addr = bb_map[v].get_insn_addr ();
     if (insn_addr && targetbbs.count (*insn_addr)) {
-      auto stmts = ir_map[v];
-      auto firstaddrstmt = std::find_if (stmts->begin (),
-                                         stmts->end (),
-                                         [&] (Stmt s) {
+      Stmts & stmts = ir.get_mutable_stmts (v);
+      auto firstaddrstmt = std::find_if (stmts.begin (),
+                                         stmts.end (),
+                                         [&] (const Stmt & s) {
                                            auto addr = addrFromStmt (s);
                                            return addr && targets.count (*addr) == 1;
                                          });
-      assert (firstaddrstmt != stmts->end ());
+      assert (firstaddrstmt != stmts.end ());
 
-      stmts->erase (firstaddrstmt+1, stmts->end ());
+      stmts.erase (firstaddrstmt+1, stmts.end ());
       newstmt = RegWriteStmt (hit_var, SymbolicExpr::makeBooleanConstant (true));
-      stmts->push_back (newstmt);
+      stmts.push_back (newstmt);
       vset.insert (v);
 
       // Remove all outgoing edges
       boost::clear_out_edges (v, cfg);
     } else if (boost::out_degree (v, cfg) == 0) {
       // This is just an optimization to make WP simplify a little bit better
-      auto stmts = ir_map[v];
+      Stmts & stmts = ir.get_mutable_stmts (v);
       newstmt = RegWriteStmt (hit_var, SymbolicExpr::makeBooleanConstant (false));
-      stmts->push_back (newstmt);
+      stmts.push_back (newstmt);
     }
   }
 
-  return std::make_tuple (IR (ir, cfg), hit_var, vset);
+  return std::make_tuple (std::move (ir), hit_var, vset);
 }
 
 }
@@ -460,7 +464,7 @@ IR rewrite_imported_calls (IR &ir, const ImportRewriteSet& funcs) {
 
   GINFO << "Rewrote " << n << " imported calls." << LEND;
 
-  return IR(ir, cfg);
+  return IR(ir, std::move(cfg));
 }
 
 void WPPathAnalyzer::setup_path_problem(rose_addr_t source, rose_addr_t target) {
@@ -468,9 +472,12 @@ void WPPathAnalyzer::setup_path_problem(rose_addr_t source, rose_addr_t target)
 
   IR ir = get_inlined_cfg (CG::get_cg (ds), source, target);
   ir = rewrite_imported_calls (ir, imports);
-  ir = init_stackpointer (ir);
-  ir = rm_undefined (ir);
-  ir = add_datablocks (ir);
+
+  IRPassManager passes;
+  passes.add ("init_stackpointer", init_stackpointer_in_place)
+    .add ("rm_undefined", rm_undefined_in_place)
+    .add ("add_datablocks", add_datablocks_in_place)
+    .run (ir);
 
   IRExprPtr post;
   std::tie (ir, post, std::ignore) = add_reached_postcondition (ir, {target});
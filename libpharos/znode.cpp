@@ -1,5 +1,7 @@
 // Copyright 2018-2024 Carnegie Mellon University.  See LICENSE file for terms.
 
+#include <chrono>
+
 #include <boost/graph/iteration_macros.hpp>
 #include "znode.hpp"
 #include "options.hpp"
@@ -354,15 +356,44 @@ z3::expr
 PharosZ3Solver::treenode_to_z3(const TreeNodePtr tnp) {
   Rose::BinaryAnalysis::SmtlibSolver::insert(tnp);
 
+  // Discard the cached translations if the context has been replaced.
+  z3::context * ctx = z3Context();
+  if (ctx != translation_context) {
+    translations.clear();
+    translation_context = ctx;
+  }
+
+  uint64_t hash = tnp->hash();
+  auto range = translations.equal_range(hash);
+  for (auto i = range.first; i != range.second; ++i) {
+    const TreeNodePtr & cached = i->second.first;
+    if (cached == tnp || (cached->nBits() == tnp->nBits() && cached->isEquivalentTo(tnp))) {
+      ++translation_stats.hits;
+      return i->second.second;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
   VariableSet vs;
   findVariables(tnp, vs);
   ctxVariableDeclarations(vs);
   ctxCommonSubexpressions(tnp);
 
   Z3ExprTypePair z3pair = ctxExpression(&*tnp);
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  ++translation_stats.misses;
+  translation_stats.miss_seconds += elapsed.count();
+  translations.emplace(hash, translation_t(tnp, z3pair.first));
   return z3pair.first;
 }
 
+void
+PharosZ3Solver::clear_translations() {
+  translations.clear();
+}
+
 // The tactic ctx-solver-simplify is a much stronger, and more
 // expensive simplification scheme. It tends to fail on treenodes :(
 // Currently, the error is vague and when it occurs, just resort to
@@ -2,6 +2,8 @@
 #ifndef Pharos_Z3_H
 #define Pharos_Z3_H
 
+#include <unordered_map>
+
 #include <z3++.h>
 #include <boost/optional.hpp>
 #include <boost/variant.hpp>
@@ -31,6 +33,29 @@ class PharosZ3Solver : public Rose::BinaryAnalysis::Z3Solver {
   option_map_t options;
   friend class Fixedpoint;
 
+ public:
+  struct TranslationStats {
+    // Tree nodes whose translation was found in the cache.
+    uint64_t hits = 0;
+    // Tree nodes that had to be translated.
+    uint64_t misses = 0;
+    // The time spent translating the misses.
+    double miss_seconds = 0.0;
+
+    // An estimate of the translation time saved by the cache.
+    double seconds_saved() const {
+      return misses ? hits * (miss_seconds / double(misses)) : 0.0;
+    }
+  };
+
+ private:
+  // The z3 translations of the tree nodes passed to treenode_to_z3(), keyed by the hash of
+  // the tree node.  The translations are only valid in the context they were made in.
+  using translation_t = std::pair<TreeNodePtr, z3::expr>;
+  std::unordered_multimap<uint64_t, translation_t> translations;
+  z3::context * translation_context = nullptr;
+  TranslationStats translation_stats;
+
  protected:
   uint64_t get_id_from_string(const std::string & id_str );
 
@@ -95,8 +120,15 @@ class PharosZ3Solver : public Rose::BinaryAnalysis::Z3Solver {
 
   // Convert a z3 expression back to a treenode
   TreeNodePtr z3_to_treenode(const z3::expr& expr);
+  // Convert a treenode to a z3 expression.  The translations are cached, so converting an
+  // equivalent treenode again is cheap.
   z3::expr treenode_to_z3(const TreeNodePtr tnp);
 
+  const TranslationStats & get_translation_stats() const {
+    return translation_stats;
+  }
+  void clear_translations();
+
   z3::expr simplify(const z3::expr& e);
 
   z3::expr to_bool(z3::expr z3expr);
@@ -7,6 +7,8 @@
 #include <libpharos/apigraph.hpp>
 #include <libpharos/apisig.hpp>
 
+#include <chrono>
+
 #include <boost/filesystem.hpp>
 
 using namespace pharos;
@@ -23,11 +25,67 @@ ProgOptDesc apianalyzer_options() {
   ProgOptDesc apiopt(version_string.c_str());
 
   apiopt.add_options()
-    ("graphviz,G", po::value<bf::path>(), "specify the graphviz output file");
+    ("graphviz,G", po::value<bf::path>(), "specify the graphviz output file")
+    ("time-traversals",
+     "report the size of the component graphs and time traversals of them");
 
   return apiopt;
 }
 
+// Approximate the memory used by each form of the component graphs, and time a depth first
+// traversal of every component in each form.  The traversal is the core of the signature
+// search, so this shows what freezing the components buys the search.  Traversing from every
+// vertex is quadratic in the size of each component, so this is only done when requested with
+// --time-traversals.
+template <typename Graph>
+double time_traversals(const Graph & g, std::vector<boost::default_color_type> & colors) {
+  using clock = std::chrono::steady_clock;
+  auto start = clock::now();
+  size_t n = boost::num_vertices(g);
+  for (size_t v = 0; v < n; ++v) {
+    colors.assign(n, boost::white_color);
+    boost::depth_first_visit(
+      g, v, boost::default_dfs_visitor(),
+      boost::make_iterator_property_map(colors.begin(), boost::get(boost::vertex_index, g)));
+  }
+  return std::chrono::duration<double>(clock::now() - start).count();
+}
+
+void report_frozen_graphs(const ApiGraph & graph) {
+  // Each adjacency list vertex holds its properties and a std::set each of in and out edges,
+  // and each edge is a node in two of those sets.  Tree nodes hold three pointers and a color
+  // in addition to the stored edge.
+  constexpr size_t set_node_size = 4 * sizeof(void *) + sizeof(ApiCfgVertex);
+  size_t vertices = 0, edges = 0, frozen = 0;
+  size_t list_bytes = 0, csr_bytes = 0;
+  double list_secs = 0, csr_secs = 0;
+  std::vector<boost::default_color_type> colors;
+  for (const ApiCfgComponentMap::value_type & ci : graph.GetComponents()) {
+    const ApiCfgComponent & comp = *ci.second;
+    const ApiCfg & cfg = *comp.GetCfg();
+    size_t n = boost::num_vertices(cfg);
+    size_t m = boost::num_edges(cfg);
+    vertices += n;
+    edges += m;
+    list_bytes += n * (sizeof(ApiVertexInfo) + 2 * sizeof(std::set<ApiCfgVertex>))
+                  + m * 2 * set_node_size;
+    list_secs += time_traversals(cfg, colors);
+    const ApiCsrPtr & csr = comp.GetFrozenCfg();
+    if (csr) {
+      ++frozen;
+      csr_bytes += n * sizeof(ApiVertexInfo) + (n + 1) * sizeof(size_t) + m * sizeof(size_t);
+      csr_secs += time_traversals(*csr, colors);
+    }
+  }
+  OINFO << "Components: " << graph.GetComponents().size() << " (" << frozen << " frozen), "
+        << vertices << " vertices, " << edges << " edges, "
+        << graph.GetApiNames().size() << " distinct APIs" << LEND;
+  OINFO << "Adjacency list graphs: about " << list_bytes << " bytes, traversed from"
+        << " every vertex in " << list_secs << " seconds" << LEND;
+  OINFO << "Frozen (CSR) graphs: about " << csr_bytes << " bytes, traversed from"
+        << " every vertex in " << csr_secs << " seconds" << LEND;
+}
+
 // Need to swtich this to use pharos_main.  Or better, make this functionality
 // simply be a cmd line arg to apianalyzer instead of a separate exec.
 int apigraphgen_main(int argc, char* argv[]) {
@@ -59,6 +117,9 @@ int apigraphgen_main(int argc, char* argv[]) {
   size_t num_components = graph.Build();
 
   OINFO << "Completed API Graph generation with " << num_components << " components" << LEND;
+  if (vm.count("time-traversals")) {
+    report_frozen_graphs(graph);
+  }
   OINFO << "Writing graphviz to " << gv_file << LEND;
 
   std::ofstream graphviz_file(gv_file.c_str());
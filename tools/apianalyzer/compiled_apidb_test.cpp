@@ -0,0 +1,212 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <libpharos/util.hpp>
+#include <gtest/gtest.h>
+#include <libpharos/apidb.hpp>
+#include <libpharos/compiled_apidb.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+using namespace pharos;
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+// A small API database with definitions that exercise every kind of lookup: several DLLs, a
+// name defined by more than one DLL, ordinals, addresses, parameters, and definitions
+// without an export name.
+const char * const test_exports = R"json(
+[
+  {"dll": "kernel32.dll", "export_name": "CreateFileA", "ordinal": 10,
+   "relative_address": 4096, "convention": "stdcall", "type": "HANDLE",
+   "parameters": [{"name": "lpFileName", "type": "LPCSTR", "inout": "in"},
+                  {"name": "dwDesiredAccess", "type": "DWORD", "inout": "in"},
+                  {"name": "dwShareMode", "type": "DWORD", "inout": "in"},
+                  {"name": "lpSecurityAttributes", "type": "LPVOID", "inout": "in"},
+                  {"name": "dwCreationDisposition", "type": "DWORD", "inout": "in"},
+                  {"name": "dwFlagsAndAttributes", "type": "DWORD", "inout": "in"},
+                  {"name": "hTemplateFile", "type": "HANDLE", "inout": "in"}]},
+  {"dll": "kernel32.dll", "export_name": "CloseHandle", "ordinal": 11,
+   "relative_address": 8192, "convention": "stdcall", "type": "BOOL",
+   "parameters": [{"name": "hObject", "type": "HANDLE", "inout": "in"}]},
+  {"dll": "kernel32.dll", "export_name": "GetLastError", "ordinal": 12,
+   "convention": "stdcall", "type": "DWORD", "delta": 0},
+  {"dll": "KernelBase.dll", "export_name": "GetLastError", "ordinal": 3,
+   "convention": "stdcall", "type": "DWORD", "delta": 0},
+  {"dll": "user32.dll", "export_name": "MessageBoxA", "ordinal": 5,
+   "relative_address": 4096, "convention": "stdcall", "type": "int",
+   "parameters": [{"name": "hWnd", "type": "HWND", "inout": "in"},
+                  {"name": "lpText", "type": "LPCSTR", "inout": "in"},
+                  {"name": "lpCaption", "type": "LPCSTR", "inout": "in"},
+                  {"name": "uType", "type": "UINT", "inout": "in"}]},
+  {"dll": "user32.dll", "ordinal": 7, "relative_address": 12288, "delta": 8,
+   "convention": "stdcall"},
+  {"dll": "msvcrt.dll", "export_name": "??2@YAPAXI@Z", "convention": "cdecl",
+   "parameters": [{"name": "size", "type": "size_t", "inout": "in"}]}
+]
+)json";
+
+// Describe every field of a definition except its source, which is always the dictionary
+// that returned it.
+std::string describe(const APIDefinition & def) {
+  std::ostringstream os;
+  os << def.export_name << '|' << def.display_name << '|' << def.dll_name << '|'
+     << def.dll_version << '|' << def.dll_stamp << '|' << def.relative_address << '|'
+     << def.calling_convention << '|' << def.return_type << '|' << def.stackdelta << '|'
+     << def.ordinal;
+  for (const APIParam & param : def.parameters) {
+    os << '|' << param.name << ':' << param.type << ':' << param.direction;
+  }
+  return os.str();
+}
+
+// The descriptions of a list of definitions, in a canonical order.
+std::vector<std::string> describe(const APIDefinitionList & defs) {
+  std::vector<std::string> result;
+  for (const APIDefinitionPtr & def : defs) {
+    result.push_back(describe(*def));
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+} // unnamed namespace
+
+// This is the main test fixture.  The source dictionary is compiled to a temporary file,
+// which is then opened as a compiled dictionary.
+class CompiledApiTest : public testing::Test {
+
+ protected:
+
+  std::unique_ptr<JSONApiDictionary> source_;
+  std::unique_ptr<CompiledApiDictionary> compiled_;
+  bf::path path_;
+
+  virtual void SetUp() {
+    source_ = make_unique<JSONApiDictionary>(YAML::Load(test_exports));
+    path_ = bf::temp_directory_path() / bf::unique_path("compiled_apidb_test-%%%%-%%%%.db");
+
+    CompiledApiWriter writer;
+    writer.add(*source_);
+    writer.write(path_.string());
+    compiled_ = make_unique<CompiledApiDictionary>(path_.string());
+  }
+
+  virtual void TearDown() {
+    compiled_ = nullptr;
+    boost::system::error_code ec;
+    bf::remove(path_, ec);
+  }
+
+  // Write a copy of the compiled database with the bytes at offset replaced.
+  bf::path write_modified(size_t offset, const std::string & bytes) {
+    std::ifstream in(path_.string(), std::ios::binary);
+    std::string contents{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    contents.replace(offset, bytes.size(), bytes);
+    bf::path modified = path_.string() + ".modified";
+    std::ofstream out(modified.string(), std::ios::binary);
+    out << contents;
+    return modified;
+  }
+
+};
+
+TEST_F(CompiledApiTest, TEST_MAGIC) {
+  std::ifstream in(path_.string(), std::ios::binary);
+  char magic[CompiledApiDictionary::magic_size];
+  in.read(magic, sizeof(magic));
+  EXPECT_TRUE(CompiledApiDictionary::has_magic(magic, sizeof(magic)));
+  EXPECT_FALSE(CompiledApiDictionary::has_magic("{\"config", 8));
+}
+
+TEST_F(CompiledApiTest, TEST_ALL_DEFINITIONS) {
+  auto expected = describe(source_->get_all_definitions());
+  EXPECT_EQ(expected.size(), 7u);
+  EXPECT_EQ(describe(compiled_->get_all_definitions()), expected);
+}
+
+TEST_F(CompiledApiTest, TEST_LOOKUPS) {
+  for (const APIDefinitionPtr & def : source_->get_all_definitions()) {
+    const std::string & name = def->get_name();
+    SCOPED_TRACE(def->dll_name + "!" + name);
+    EXPECT_EQ(describe(compiled_->get_api_definition(def->dll_name, name)),
+              describe(source_->get_api_definition(def->dll_name, name)));
+    EXPECT_EQ(describe(compiled_->get_api_definition(def->dll_name + ".DLL", name)),
+              describe(source_->get_api_definition(def->dll_name + ".DLL", name)));
+    EXPECT_EQ(describe(compiled_->get_api_definition(name)),
+              describe(source_->get_api_definition(name)));
+    EXPECT_EQ(describe(compiled_->get_api_definition(def->dll_name, def->ordinal)),
+              describe(source_->get_api_definition(def->dll_name, def->ordinal)));
+    EXPECT_EQ(describe(compiled_->get_api_definition(def->relative_address)),
+              describe(source_->get_api_definition(def->relative_address)));
+    EXPECT_TRUE(compiled_->handles_dll(def->dll_name));
+  }
+
+  // A name defined by more than one DLL.
+  EXPECT_EQ(compiled_->get_api_definition("GetLastError").size(), 2u);
+  // An address defined by more than one DLL.
+  EXPECT_EQ(describe(compiled_->get_api_definition(rose_addr_t(4096))),
+            describe(source_->get_api_definition(rose_addr_t(4096))));
+  EXPECT_EQ(compiled_->get_api_definition(rose_addr_t(4096)).size(), 2u);
+}
+
+TEST_F(CompiledApiTest, TEST_REGEX) {
+  for (const char * pattern : {"^Create", "Handle$", "Error", "^\\?\\?2", "^Zzz"}) {
+    SCOPED_TRACE(pattern);
+    regex re(pattern);
+    EXPECT_EQ(describe(compiled_->get_api_definition(re)),
+              describe(source_->get_api_definition(re)));
+  }
+}
+
+TEST_F(CompiledApiTest, TEST_MISSING) {
+  EXPECT_TRUE(compiled_->get_api_definition("kernel32", "NoSuchFunction").empty());
+  EXPECT_TRUE(compiled_->get_api_definition("nosuch", "CreateFileA").empty());
+  EXPECT_TRUE(compiled_->get_api_definition("kernel32", size_t(999)).empty());
+  EXPECT_TRUE(compiled_->get_api_definition("NoSuchFunction").empty());
+  EXPECT_TRUE(compiled_->get_api_definition(rose_addr_t(0xdead)).empty());
+  EXPECT_FALSE(compiled_->handles_dll("nosuch.dll"));
+  EXPECT_FALSE(source_->handles_dll("nosuch.dll"));
+}
+
+TEST_F(CompiledApiTest, TEST_SAME_DEFINITION) {
+  // Callers always get the same definition for a function.
+  auto first = compiled_->get_api_definition("kernel32", "CreateFileA");
+  auto second = compiled_->get_api_definition("kernel32", size_t(10));
+  ASSERT_EQ(first.size(), 1u);
+  ASSERT_EQ(second.size(), 1u);
+  EXPECT_EQ(first[0], second[0]);
+  EXPECT_EQ(&first[0]->source, compiled_.get());
+}
+
+TEST_F(CompiledApiTest, TEST_INVALID_FILES) {
+  EXPECT_THROW(CompiledApiDictionary{path_.string() + ".missing"}, std::runtime_error);
+
+  // The magic number, byte order mark and version are at the start of the file.
+  for (size_t offset : {size_t(0), CompiledApiDictionary::magic_size,
+                        CompiledApiDictionary::magic_size + 4})
+  {
+    SCOPED_TRACE(offset);
+    bf::path modified = write_modified(offset, std::string(4, '\xff'));
+    EXPECT_THROW(CompiledApiDictionary{modified.string()}, std::runtime_error);
+    bf::remove(modified);
+  }
+}
+
+int main(int argc, char **argv) {
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
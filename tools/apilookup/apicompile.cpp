@@ -0,0 +1,65 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <libpharos/apidb.hpp>
+#include <libpharos/compiled_apidb.hpp>
+#include <libpharos/options.hpp>
+
+#include <boost/filesystem.hpp>
+
+using namespace pharos;
+
+namespace bf = boost::filesystem;
+
+namespace {
+
+ProgOptDesc options() {
+  namespace po = boost::program_options;
+  ProgOptDesc opts("APICompile Options");
+  opts.add_options()
+    ("output,o", po::value<bf::path>()->value_name("FILENAME"),
+     "The compiled API database to write");
+  return opts;
+}
+
+int apicompile_main(int argc, char **argv) {
+  // Handle options
+  auto popt = options();
+  popt.add(cert_standard_options());
+  ProgPosOptDesc posopt;
+  posopt.add("output", 1);
+  auto vm = parse_cert_options(argc, argv, popt, "Compile the API Database", posopt);
+  if (!vm.count("output")) {
+    std::cout << "Usage: " << argv[0] << " [--apidb=DATABASE]... OUTPUT\n"
+              << '\n' << popt << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Compile the databases exactly as they are configured, so that the compiled database
+  // answers lookups the same way.
+  auto apidb = APIDictionary::create_standard(vm, APIDictionary::THROW);
+  CompiledApiWriter writer;
+  writer.add(*apidb);
+  if (writer.size() == 0) {
+    std::cerr << "No API definitions were found in the configured API databases" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto output = vm["output"].as<bf::path>();
+  writer.write(output.native());
+  std::cout << "Wrote " << writer.size() << " definitions to " << output.native() << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+  return pharos_main("APIC", apicompile_main, argc, argv, STDERR_FILENO);
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
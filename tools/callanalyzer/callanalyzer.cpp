@@ -102,11 +102,14 @@ class TextOutputter : public Outputter {
   printable_t output_param(const std::string & name, const typedb::Value & value, bool wide);
 };
 
+// The calls are written as they're found, so that the memory required doesn't grow with the
+// number of calls.  The keys of the top-level object are written in sorted order, as they would
+// be by json::Object.
 class JsonOutputter : public Outputter {
   json::BuilderRef builder;
-  json::ArrayRef calls;
-  json::ObjectRef main;
-  std::ostream & out;
+  json::NodeRef invocation;
+  json::NodeRef analyzed_file;
+  std::unique_ptr<json::StreamWriter> writer;
 
  public:
   JsonOutputter(ProgOptVarMap const &vm, std::ostream & stream);
@@ -336,36 +339,43 @@ void TextOutputter::operator()(
 }
 
 JsonOutputter::JsonOutputter(ProgOptVarMap const & vm, std::ostream & stream)
-  : Outputter(vm), out(stream)
+  : Outputter(vm)
 {
   builder = json::simple_builder();
-  main = builder->object();
-  main->add("tool", "callanalyzer");
   auto args = builder->array();
   for (auto & arg : vm.args()) {
     args->add(arg);
   }
-  main->add("invocation", std::move(args));
+  invocation = std::move(args);
   auto specs = vm["file"].as<Specimens>().specimens();
   if (specs.size() == 1) {
-    main->add("analyzed_file", specs.front());
+    analyzed_file = builder->simple(specs.front());
   } else {
     auto bspecs = builder->array();
     for (auto & spec : specs) {
       bspecs->add(spec);
     }
-    main->add("analyzed_file", std::move(bspecs));
+    analyzed_file = std::move(bspecs);
   }
-  calls = builder->array();
   if (vm.count("pretty-json")) {
-    out << json::pretty(vm["pretty-json"].as<unsigned>());
+    stream << json::pretty(vm["pretty-json"].as<unsigned>());
   }
+  writer = make_unique<json::StreamWriter>(stream);
+  writer->begin_object();
+  writer->key("analysis");
+  writer->begin_array();
 }
 
 JsonOutputter::~JsonOutputter()
 {
-  main->add("analysis", std::move(calls));
-  out << *main;
+  writer->end_array();
+  writer->key("analyzed_file");
+  writer->value(*analyzed_file);
+  writer->key("invocation");
+  writer->value(*invocation);
+  writer->key("tool");
+  writer->value("callanalyzer");
+  writer->end_object();
 }
 
 void JsonOutputter::operator()(
@@ -401,7 +411,7 @@ void JsonOutputter::operator()(
   }
   jsoncall->add("params", std::move(params));
   if (output || allow_unknown) {
-    calls->add(std::move(jsoncall));
+    writer->value(*jsoncall);
   }
 }
 
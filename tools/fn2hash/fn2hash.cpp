@@ -46,8 +46,11 @@ class HashAnalyzer : public BottomUpAnalyzer {
   size_t min_instructions;
   bool basic_blocks;
   json::BuilderRef builder;
-  json::ObjectRef main;
-  json::ArrayRef analysis;
+  // The hashes for each function are written as they're computed, and the other keys of the
+  // top-level object are written (in sorted order) at the end.
+  std::unique_ptr<json::StreamWriter> writer;
+  json::NodeRef invocation;
+  json::NodeRef analyzed_file;
   std::unique_ptr<std::ofstream> fout;
   std::ostream *out = nullptr;
 
@@ -65,27 +68,28 @@ class HashAnalyzer : public BottomUpAnalyzer {
         out = fout.get();
       }
       builder = json::simple_builder();
-      main = builder->object();
-      main->add("tool", "fn2hash");
       auto args = builder->array();
       for (auto arg : vm_.args()) {
         args->add(arg);
       }
-      main->add("invocation", std::move(args));
+      invocation = std::move(args);
       auto specs = vm["file"].as<Specimens>().specimens();
       if (specs.size() == 1) {
-        main->add("analyzed_file", specs.front());
+        analyzed_file = builder->simple(specs.front());
       } else {
         auto bspecs = builder->array();
         for (auto & spec : specs) {
           bspecs->add(spec);
         }
-        main->add("analyzed_file", std::move(bspecs));
+        analyzed_file = std::move(bspecs);
       }
-      analysis = builder->array();
       if (vm.count("pretty-json")) {
         *out << json::pretty(vm["pretty-json"].as<unsigned>());
       }
+      writer = make_unique<json::StreamWriter>(*out);
+      writer->begin_object();
+      writer->key("analysis");
+      writer->begin_array();
     }
   }
   void visit(FunctionDescriptor* fd) override {
@@ -275,14 +279,20 @@ class HashAnalyzer : public BottomUpAnalyzer {
         }
         hashes->add("opt_bb_cfg", std::move(edges));
       }
-      analysis->add(std::move(hashes));
+      writer->value(*hashes);
     }
   }
 
   void finish() override {
     if (builder) {
-      main->add("analysis", std::move(analysis));
-      (*out) << *main;
+      writer->end_array();
+      writer->key("analyzed_file");
+      writer->value(*analyzed_file);
+      writer->key("invocation");
+      writer->value(*invocation);
+      writer->key("tool");
+      writer->value("fn2hash");
+      writer->end_object();
     }
   }
 };
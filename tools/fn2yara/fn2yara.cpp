@@ -10,9 +10,12 @@
 #include <libpharos/pdg.hpp>
 #include <libpharos/masm.hpp>
 #include <libpharos/bua.hpp>
+#include <libpharos/threads.hpp>
 
 #include <boost/filesystem.hpp>
 
+#include <deque>
+
 #define DEFAULT_MIN_INSTRUCTIONS 5
 #define DEFAULT_MAX_BYTES 10000
 
@@ -56,6 +59,90 @@ ProgOptDesc fn2yara_options() {
   return fn2yaraopt;
 }
 
+// Writes the generated text to the output stream, on a background thread when threaded is
+// true, so that writing the rule for one function overlaps the analysis of the next.  Text is
+// written in the order it was submitted.  At most max_pending bytes are queued at a time, and
+// write() blocks when the writer falls that far behind, so the memory held for the output stays
+// bounded no matter how many rules are generated.
+class RuleWriter {
+ public:
+  static constexpr size_t max_pending = 16 * 1024 * 1024;
+
+  RuleWriter(std::ostream & out_, bool threaded) : out(out_) {
+    if (threaded) {
+      thread = std::thread([this] { run(); });
+    }
+  }
+
+  ~RuleWriter() {
+    close();
+  }
+
+  void write(std::string text) {
+    if (!thread.joinable()) {
+      out << text;
+      return;
+    }
+    std::unique_lock<decltype(mutex)> lock{mutex};
+    drained.wait(lock, [this] { return pending < max_pending; });
+    pending += text.size();
+    queue.push_back(std::move(text));
+    lock.unlock();
+    ready.notify_one();
+  }
+
+  // Write everything that is still queued and stop the thread.  Returns false if writing to
+  // the output stream failed.
+  bool close() {
+    if (thread.joinable()) {
+      {
+        write_guard<decltype(mutex)> guard{mutex};
+        closing = true;
+      }
+      ready.notify_one();
+      thread.join();
+    }
+    out.flush();
+    return !out.fail();
+  }
+
+ private:
+  std::ostream & out;
+  std_mutex mutex;
+  // Signalled when text is queued or the writer is closing.
+  std::condition_variable_any ready;
+  // Signalled when queued text has been written.
+  std::condition_variable_any drained;
+  std::deque<std::string> queue;
+  size_t pending = 0;
+  bool closing = false;
+  std::thread thread;
+
+  void run() {
+    std::unique_lock<decltype(mutex)> lock{mutex};
+    while (true) {
+      ready.wait(lock, [this] { return !queue.empty() || closing; });
+      if (queue.empty()) {
+        return;
+      }
+      // Write everything that is queued without holding the lock, and release the text as
+      // soon as it has been written.
+      std::deque<std::string> batch;
+      batch.swap(queue);
+      lock.unlock();
+      size_t written = 0;
+      for (std::string & text : batch) {
+        out << text;
+        written += text.size();
+        std::string().swap(text);
+      }
+      lock.lock();
+      pending -= written;
+      drained.notify_one();
+    }
+  }
+};
+
 class FnToYaraAnalyzer : public BottomUpAnalyzer {
  private:
   typedef SgUnsignedCharList::const_iterator iter_t;
@@ -81,6 +168,9 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
   // Output file
   std::ofstream *outfile = nullptr;
 
+  // Writes the rules to out as they are generated
+  std::unique_ptr<RuleWriter> writer;
+
   // Function count;
   size_t func_count = 0;
 
@@ -204,15 +294,15 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
     }
   };
 
-  int output_strings(const std::vector<RuleString> &matches,
+  int output_strings(std::ostream & os, const std::vector<RuleString> &matches,
                      const std::string & prefix_str)
   {
     int count = 0;
     for (const RuleString &match : matches) {
       if (match.count >= minimum_instr || match.byte_count > maximum_str_bytes) {
-        *out << "    // string $" << prefix_str << "_" << match.addr << " contains "
-             << match.byte_count << " bytes and " << match.count << " instructions\n";
-        *out << "    $" << prefix_str << "_" << match.addr << " = " << match.match << '\n';
+        os << "    // string $" << prefix_str << "_" << match.addr << " contains "
+           << match.byte_count << " bytes and " << match.count << " instructions\n";
+        os << "    $" << prefix_str << "_" << match.addr << " = " << match.match << '\n';
         ++string_count;
         ++count;
       } else {
@@ -221,9 +311,9 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
         OWARN << "rule for addr " << match.addr << " string too big ("
               << match.byte_count << ") or min instr not met (" << match.count
               << "), skipping rule string generation\n";
-        *out << "    // $" << prefix_str << "_" << match.addr
-             << " elided due to too few instructions ("
-             << match.count << ") or too many bytes (" << match.byte_count << ")\n";
+        os << "    // $" << prefix_str << "_" << match.addr
+           << " elided due to too few instructions ("
+           << match.count << ") or too many bytes (" << match.byte_count << ")\n";
       }
     }
     return count;
@@ -255,44 +345,46 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
       return false;
     }
 
+    std::ostringstream text;
     if (address_only) {
-      *out << boost::str(boost::format("0x%08X") % fd->get_address())
-           << LEND;
+      text << boost::str(boost::format("0x%08X") % fd->get_address()) << '\n';
+      writer->write(text.str());
       return true;
     }
 
     std::string name = boost::str(boost::format("Func_%s_%08X") % prefix
                                   % fd->get_address());
     // header
-    *out << "rule " << name << "\n"
+    text << "rule " << name << "\n"
          << "{\n"
          << "  strings:\n";
 
     // origin information
     boost::gregorian::date d(boost::gregorian::day_clock::local_day());
-    *out << "    // File " << basename << " @ " << fd->address_string()
+    text << "    // File " << basename << " @ " << fd->address_string()
          << boost::str(boost::format(" (%d-%02d-%02d)\n") % d.year() % d.month() % d.day());
 
     // strings
-    int count = output_strings(matches, prefix);
+    int count = output_strings(text, matches, prefix);
 
     // condition
-    *out << "  condition:\n"
+    text << "  condition:\n"
          << "    ";
     if (match_threshold < 100.0) {
       auto number = int(count * match_threshold / 100.0);
       if (number < 1) {
         number = 1;
       }
-      *out << number;
+      text << number;
     } else {
-      *out << "all";
+      text << "all";
     }
-    *out << " of them\n";
+    text << " of them\n";
 
     // footer
-    *out << '}' << std::endl;
+    text << "}\n";
 
+    writer->write(text.str());
     return true;
   }
 
@@ -300,6 +392,11 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
   FnToYaraAnalyzer(DescriptorSet& ds_, ProgOptVarMap& vm_)
     : BottomUpAnalyzer(ds_, vm_), program(ds_), dupe_count(0)
   {
+    // The rules are generated from the instructions alone, so there's no reason to compute
+    // (and hold on to) the PDG of every function before visiting them.  Visiting the functions
+    // in a single thread also keeps the order of the rules deterministic.
+    set_mode(SINGLE_THREADED);
+
     include_thunks = vm_["include-thunks"].as<bool>();
     address_only = vm_["address-only"].as<bool>();
     oldway = vm_["oldway"].as<bool>();
@@ -346,6 +443,7 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
   }
 
   ~FnToYaraAnalyzer() {
+    writer.reset();
     delete outfile;
   }
 
@@ -356,6 +454,7 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
       outfile = new std::ofstream(outname);
       out = outfile;
     }
+    writer = make_unique<RuleWriter>(*out, ds.get_concurrency_level() > 1);
     if (compare_mode && !address_only) {
       std::string name(basename);
       std::transform(name.begin(), name.end(), name.begin(),
@@ -363,28 +462,38 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
       if (std::isdigit(name[0])) {
         name = "FILE_" + name;
       }
-      *out << "rule " << prefix << '_' << (int)match_threshold
-           << "_percent\n{\n  strings:" << std::endl;
+      writer->write("rule " + prefix + '_' + std::to_string(int(match_threshold))
+                    + "_percent\n{\n  strings:\n");
     }
   }
 
   void finish() override {
+    std::ostringstream text;
     if (address_only) {
-      //*out << "Considered " << rule_count << " functions" << LEND;
-      *out << "Considered " << func_count << " functions" << LEND;
+      text << "Considered " << func_count << " functions\n";
     } else if (compare_mode) {
-      *out << "\n  condition:\n    ";
+      text << "\n  condition:\n    ";
       if (match_threshold < 100.0) {
         auto number = int(string_count * match_threshold / 100.0);
         if (number < 1) {
           number = 1;
         }
-        *out << number;
+        text << number;
       } else {
-        *out << "all";
+        text << "all";
       }
 
-      *out << " of them\n}" << std::endl;
+      text << " of them\n}\n";
+    }
+    writer->write(text.str());
+    if (!writer->close()) {
+      OERROR << "Unable to write the rules to " << (address_only ? "stdout" : outname)
+             << LEND;
+    }
+
+    if (address_only) {
+      // The output went to stdout, so there's nothing to report.
+    } else if (compare_mode) {
       OINFO << "Examined " << func_count << " functions" << LEND;
       OINFO << "Wrote " << string_count << " strings to " << outname << LEND;
     } else {
@@ -626,7 +735,9 @@ class FnToYaraAnalyzer : public BottomUpAnalyzer {
     matches.push_back(RuleString(cblock->get_addr(), match.str(), instr_count, byte_count));
 
     if (compare_mode) {
-      output_strings(matches, "Match");
+      std::ostringstream text;
+      output_strings(text, matches, "Match");
+      writer->write(text.str());
     } else {
       // Output the rule
       if (output_rule(fd, matches)) {
@@ -0,0 +1,191 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <libpharos/semantics.hpp>
+#include <gtest/gtest.h>
+#include <libpharos/arena.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace pharos;
+
+namespace {
+
+bool is_aligned(const void * p) {
+  return reinterpret_cast<std::uintptr_t>(p) % Arena::alignment == 0;
+}
+
+} // unnamed namespace
+
+TEST(ArenaTest, TEST_ALIGNMENT) {
+  Arena arena;
+  std::vector<std::pair<void *, size_t>> blocks;
+  for (size_t bytes : {size_t(0), size_t(1), size_t(3), Arena::alignment - 1, Arena::alignment,
+                       Arena::alignment + 1, size_t(100), Arena::max_pooled_size,
+                       Arena::max_pooled_size + 1})
+  {
+    void * p = arena.allocate(bytes);
+    EXPECT_TRUE(is_aligned(p)) << bytes << " bytes";
+    blocks.emplace_back(p, bytes);
+  }
+  for (auto & block : blocks) {
+    arena.deallocate(block.first, block.second);
+  }
+}
+
+TEST(ArenaTest, TEST_REUSE) {
+  Arena arena;
+  void * a = arena.allocate(24);
+  void * b = arena.allocate(24);
+  EXPECT_NE(a, b);
+  arena.deallocate(a, 24);
+  arena.deallocate(b, 24);
+
+  // Freed blocks are reused, most recently freed first, for allocations of the same size
+  // class.
+  EXPECT_EQ(arena.allocate(24), b);
+  EXPECT_EQ(arena.allocate(Arena::alignment * 2 - 1), a);
+  EXPECT_EQ(arena.get_stats().reused, 2u);
+
+  // But not for allocations of a different size class.
+  void * c = arena.allocate(8);
+  arena.deallocate(c, 8);
+  void * d = arena.allocate(Arena::alignment * 4);
+  EXPECT_NE(d, c);
+  EXPECT_EQ(arena.get_stats().reused, 2u);
+  EXPECT_EQ(arena.allocate(8), c);
+  EXPECT_EQ(arena.get_stats().reused, 3u);
+}
+
+TEST(ArenaTest, TEST_STATS) {
+  Arena arena(Arena::max_pooled_size);
+  const ArenaStats & stats = arena.get_stats();
+  EXPECT_EQ(stats.allocations, 0u);
+  EXPECT_EQ(stats.reserved_bytes, 0u);
+
+  // Allocations are rounded up to a multiple of the alignment.
+  void * a = arena.allocate(1);
+  EXPECT_EQ(stats.allocations, 1u);
+  EXPECT_EQ(stats.live_bytes, Arena::alignment);
+  EXPECT_EQ(stats.reserved_bytes, Arena::max_pooled_size);
+
+  // Allocations too large for the arena go to the heap.
+  void * large = arena.allocate(Arena::max_pooled_size * 2);
+  EXPECT_EQ(stats.large, 1u);
+  EXPECT_EQ(stats.live_bytes, Arena::alignment + Arena::max_pooled_size * 2);
+  EXPECT_EQ(stats.reserved_bytes, Arena::max_pooled_size);
+  arena.deallocate(large, Arena::max_pooled_size * 2);
+  EXPECT_EQ(stats.live_bytes, Arena::alignment);
+  EXPECT_EQ(stats.peak_bytes, Arena::alignment + Arena::max_pooled_size * 2);
+
+  // A block that doesn't fit in the rest of the current block starts a new one.
+  void * b = arena.allocate(Arena::max_pooled_size);
+  EXPECT_EQ(stats.reserved_bytes, 2 * Arena::max_pooled_size);
+  arena.deallocate(b, Arena::max_pooled_size);
+  arena.deallocate(a, 1);
+  EXPECT_EQ(stats.live_bytes, 0u);
+  EXPECT_EQ(stats.allocations, 3u);
+  EXPECT_EQ(stats.reused, 0u);
+}
+
+TEST(ArenaTest, TEST_ALLOCATOR) {
+  Arena arena;
+  using Vector = std::vector<int, ArenaAllocator<int>>;
+  Vector v{ArenaAllocator<int>(&arena)};
+  for (int i = 0; i < 100; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_GT(arena.get_stats().allocations, 0u);
+
+  // Copies are allocated from the heap, so that they can outlive the arena.
+  Vector copy(v);
+  EXPECT_EQ(copy.get_allocator().get_arena(), nullptr);
+  EXPECT_EQ(copy, v);
+
+  // Moves keep the arena.
+  Vector moved(std::move(v));
+  EXPECT_EQ(moved.get_allocator().get_arena(), &arena);
+  EXPECT_EQ(moved, copy);
+
+  // Memory released by a container is reused by the next one.
+  size_t reused = arena.get_stats().reused;
+  moved = Vector(ArenaAllocator<int>(&arena));
+  Vector again{ArenaAllocator<int>(&arena)};
+  again.reserve(16);
+  EXPECT_GT(arena.get_stats().reused, reused);
+}
+
+class WriterSetTest : public testing::Test {
+ protected:
+  std::vector<SgAsmX86Instruction *> insns_;
+
+  virtual void SetUp() {
+    for (rose_addr_t addr : {0x1010, 0x1000, 0x1030, 0x1020}) {
+      SgAsmX86Instruction * insn = Rose::SageBuilderAsm::buildX86Instruction(x86_nop);
+      insn->set_address(addr);
+      insns_.push_back(insn);
+    }
+  }
+
+  virtual void TearDown() {
+    for (SgAsmX86Instruction * insn : insns_) {
+      SageInterface::deleteAST(insn);
+    }
+  }
+};
+
+TEST_F(WriterSetTest, TEST_ORDER) {
+  WriterSet writers;
+  for (SgAsmX86Instruction * insn : insns_) {
+    EXPECT_TRUE(writers.insert(insn));
+  }
+  EXPECT_EQ(writers.size(), insns_.size());
+
+  // The writers are kept in address order, like an InsnSet.
+  InsnSet expected(insns_.begin(), insns_.end());
+  EXPECT_TRUE(std::equal(writers.begin(), writers.end(), expected.begin(), expected.end()));
+  EXPECT_EQ(writers.to_set(), expected);
+
+  // An instruction at an address that's already present isn't inserted.
+  SgAsmX86Instruction * duplicate = Rose::SageBuilderAsm::buildX86Instruction(x86_nop);
+  duplicate->set_address(0x1020);
+  EXPECT_FALSE(writers.insert(duplicate));
+  EXPECT_EQ(writers.count(duplicate), 1u);
+  EXPECT_EQ(*writers.find(duplicate), insns_[3]);
+  SageInterface::deleteAST(duplicate);
+}
+
+TEST_F(WriterSetTest, TEST_REUSE_AFTER_CLEAR) {
+  WriterSet writers;
+  writers.insert(insns_[0]);
+  writers.insert(insns_[1]);
+  writers.insert(insns_[2]);
+  writers.clear();
+  EXPECT_TRUE(writers.empty());
+  EXPECT_EQ(writers.find(insns_[0]), writers.end());
+
+  WriterSet other;
+  other.insert(insns_[3]);
+  EXPECT_NE(writers, other);
+  EXPECT_TRUE(writers.insert(insns_[3]));
+  EXPECT_EQ(writers, other);
+  EXPECT_EQ(writers.count(insns_[0]), 0u);
+}
+
+// Driver for the program
+static int arena_test_main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
+
+int main(int argc, char **argv) {
+
+  return pharos_main("AREN", arena_test_main, argc, argv, STDERR_FILENO);
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -0,0 +1,168 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+// A benchmark for the Visual Studio demangler and its cache.  It reads the mangled names from
+// symbol files like the ones that accompany the test programs (tab separated, with the name in
+// the third column), or from files with one name per line.  It then times demangling all of
+// the names repeatedly without the cache, through a cache one name at a time (using several
+// threads if requested), and through a cache in batches.  Finally, it checks that the cached
+// results are the same as the uncached ones.
+//
+// Usage: demangle_bench [--iterations N] [--threads N] FILE...
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <libpharos/demangle.hpp>
+#include <libpharos/threads.hpp>
+
+using namespace demangle;
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// Read the names that look like they were mangled by Visual Studio.
+void read_names(const char * path, std::vector<std::string> & names)
+{
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error(std::string("Could not open for reading: ") + path);
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    std::string name = line;
+    auto tab = line.find('\t');
+    if (tab != std::string::npos) {
+      auto start = line.find('\t', tab + 1);
+      if (start == std::string::npos) continue;
+      ++start;
+      name = line.substr(start, line.find('\t', start) - start);
+    }
+    if (!name.empty() && (name.front() == '?' || name.front() == '.')) {
+      names.push_back(std::move(name));
+    }
+  }
+}
+
+// The text of a result, for comparing results.
+std::string describe(const DemangledTypePtr & type, const std::string & error)
+{
+  return type ? type->str() : "error: " + error;
+}
+
+template <typename Fn>
+double time_iterations(const char * label, size_t iterations, size_t count, Fn fn)
+{
+  auto start = clock_type::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    fn();
+  }
+  std::chrono::duration<double> secs = clock_type::now() - start;
+  double rate = secs.count() > 0 ? double(iterations * count) / secs.count() : 0;
+  std::cout << label << ": " << secs.count() << " seconds (" << size_t(rate)
+            << " names per second)" << std::endl;
+  return secs.count();
+}
+
+} // unnamed namespace
+
+int main(int argc, char **argv)
+{
+  size_t iterations = 10;
+  unsigned int nthreads = 1;
+  std::vector<std::string> names;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+        iterations = std::stoul(argv[++i]);
+      }
+      else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        nthreads = unsigned(std::stoul(argv[++i]));
+      }
+      else {
+        read_names(argv[i], names);
+      }
+    }
+  }
+  catch (const std::exception & e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (names.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [--iterations N] [--threads N] FILE..." << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Demangling " << names.size() << " names " << iterations << " times."
+            << std::endl;
+
+  time_iterations("Uncached", iterations, names.size(), [&names]() {
+    for (const std::string & name : names) {
+      try {
+        visual_studio_demangle_uncached(name);
+      }
+      catch (const Error &) {
+      }
+    }
+  });
+
+  DemangleCache cache;
+  time_iterations("Cached", iterations, names.size(), [&cache, &names, nthreads]() {
+    auto fn = [&cache](std::string & name) {
+      try {
+        cache.demangle(name);
+      }
+      catch (const Error &) {
+      }
+    };
+    pharos::parallel_for_each(names, nthreads, fn);
+  });
+  DemangleCache::Stats stats = cache.get_stats();
+  std::cout << "  " << stats.entries << " entries, " << stats.hits << " hits, "
+            << stats.misses << " misses" << std::endl;
+
+  DemangleCache batch_cache;
+  time_iterations("Batch", iterations, names.size(), [&batch_cache, &names]() {
+    batch_cache.demangle_batch(names);
+  });
+
+  // The cached results must be the same as the uncached ones.
+  size_t mismatches = 0;
+  std::vector<DemangledTypePtr> batch = batch_cache.demangle_batch(names);
+  for (size_t i = 0; i < names.size(); ++i) {
+    DemangledTypePtr expected, cached;
+    std::string expected_error, cached_error;
+    try {
+      expected = visual_studio_demangle_uncached(names[i]);
+    }
+    catch (const Error & e) {
+      expected_error = e.what();
+    }
+    try {
+      cached = cache.demangle(names[i]);
+    }
+    catch (const Error & e) {
+      cached_error = e.what();
+    }
+    std::string want = describe(expected, expected_error);
+    if (describe(cached, cached_error) != want
+        || (batch[i] ? batch[i]->str() : std::string()) != (expected ? want : std::string()))
+    {
+      std::cerr << "Mismatch for " << names[i] << std::endl;
+      ++mismatches;
+    }
+  }
+
+  return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -0,0 +1,155 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <gtest/gtest.h>
+#include <libpharos/demangle.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace demangle;
+
+namespace {
+
+// A few names of the kinds that programs typically import or contain in their RTTI.
+const std::vector<std::string> good_names = {
+  "?AfxThrowMemoryException@@YGXXZ",
+  "??0exception@std@@QAE@ABV01@@Z",
+  "??1type_info@@UAE@XZ",
+  "?what@exception@std@@UBEPBDXZ",
+  "??_7type_info@@6B@",
+  ".?AVbad_alloc@std@@",
+  "??2@YAPAXI@Z",
+  "?_Xlength_error@std@@YAXPBD@Z",
+};
+
+const std::vector<std::string> bad_names = {
+  "not_mangled",
+  "?",
+  "??@",
+};
+
+// The text of a result of the uncached demangler, or the empty string for a failure.
+std::string uncached_str(const std::string & mangled)
+{
+  try {
+    return visual_studio_demangle_uncached(mangled)->str();
+  }
+  catch (const Error &) {
+    return std::string();
+  }
+}
+
+} // unnamed namespace
+
+TEST(DemangleCacheTest, TEST_SAME_RESULTS) {
+  DemangleCache cache;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (const std::string & name : good_names) {
+      SCOPED_TRACE(name);
+      std::string expected = uncached_str(name);
+      ASSERT_FALSE(expected.empty());
+      EXPECT_EQ(cache.demangle(name)->str(), expected);
+    }
+  }
+  auto stats = cache.get_stats();
+  EXPECT_EQ(stats.misses, good_names.size());
+  EXPECT_EQ(stats.hits, good_names.size());
+  EXPECT_EQ(stats.entries, good_names.size());
+
+  // The cache returns the same result each time.
+  EXPECT_EQ(cache.demangle(good_names[0]), cache.demangle(good_names[0]));
+}
+
+TEST(DemangleCacheTest, TEST_CACHED_ERRORS) {
+  DemangleCache cache;
+  for (const std::string & name : bad_names) {
+    SCOPED_TRACE(name);
+    ASSERT_TRUE(uncached_str(name).empty());
+    std::string message;
+    try {
+      cache.demangle(name);
+      ADD_FAILURE() << "no error on the first attempt";
+    }
+    catch (const Error & e) {
+      message = e.what();
+    }
+    // The second attempt finds the failure in the cache, and rethrows the same error.
+    try {
+      cache.demangle(name);
+      ADD_FAILURE() << "no error on the second attempt";
+    }
+    catch (const Error & e) {
+      EXPECT_EQ(e.what(), message);
+    }
+  }
+  auto stats = cache.get_stats();
+  EXPECT_EQ(stats.misses, bad_names.size());
+  EXPECT_EQ(stats.hits, bad_names.size());
+  EXPECT_EQ(stats.entries, bad_names.size());
+}
+
+TEST(DemangleCacheTest, TEST_MAX_ENTRIES) {
+  const size_t max_entries = 3;
+  DemangleCache cache(max_entries);
+  for (size_t i = 0; i < max_entries; ++i) {
+    cache.demangle(good_names[i]);
+    EXPECT_EQ(cache.get_stats().entries, i + 1);
+  }
+
+  // The cache is emptied when it's full, before the next name is added.
+  cache.demangle(good_names[max_entries]);
+  EXPECT_EQ(cache.get_stats().entries, 1u);
+  cache.demangle(good_names[max_entries]);
+  EXPECT_EQ(cache.get_stats().hits, 1u);
+  cache.demangle(good_names[0]);
+  EXPECT_EQ(cache.get_stats().misses, max_entries + 2);
+  EXPECT_EQ(cache.get_stats().entries, 2u);
+
+  cache.clear();
+  EXPECT_EQ(cache.get_stats().entries, 0u);
+}
+
+TEST(DemangleCacheTest, TEST_BATCH) {
+  DemangleCache cache;
+  // Interleave the good and bad names, with some of each repeated, and some already cached.
+  cache.demangle(good_names[1]);
+  std::vector<std::string> names;
+  for (size_t i = 0; i < good_names.size(); ++i) {
+    names.push_back(good_names[i]);
+    names.push_back(bad_names[i % bad_names.size()]);
+  }
+  names.push_back(good_names[0]);
+
+  for (int pass = 0; pass < 2; ++pass) {
+    auto results = cache.demangle_batch(names);
+    ASSERT_EQ(results.size(), names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+      SCOPED_TRACE(names[i]);
+      std::string expected = uncached_str(names[i]);
+      if (expected.empty()) {
+        EXPECT_FALSE(results[i]);
+      }
+      else {
+        ASSERT_TRUE(results[i]);
+        EXPECT_EQ(results[i]->str(), expected);
+      }
+    }
+  }
+  EXPECT_EQ(cache.get_stats().entries, good_names.size() + bad_names.size());
+
+  // Failures found by a batch are still rethrown by demangle().
+  EXPECT_THROW(cache.demangle(bad_names[0]), Error);
+}
+
+int main(int argc, char **argv) {
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -0,0 +1,182 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <gtest/gtest.h>
+#include <libpharos/json.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+
+using namespace pharos;
+
+namespace {
+
+// Write a node with operator<<, formatted with the given indent (zero for compact output).
+std::string write_node(const json::Node & node, unsigned indent, unsigned initial_indent = 0)
+{
+  std::ostringstream os;
+  if (indent) {
+    os << json::pretty(indent, initial_indent);
+  }
+  os << node;
+  return os.str();
+}
+
+// Stream a node with a StreamWriter, by visiting it.  The containers are streamed, and their
+// simple values are written as they are visited.
+class StreamingVisitor : public json::Visitor {
+  json::StreamWriter & writer;
+ public:
+  StreamingVisitor(json::StreamWriter & w) : writer(w) {}
+  bool data_number(double d) override { writer.value(d); return true; }
+  bool data_number(json::Simple::integer i) override { writer.value(i); return true; }
+  bool data_number(json::Simple::uinteger u) override { writer.value(u); return true; }
+  bool data_bool(bool b) override { writer.value(b); return true; }
+  bool data_null() override { writer.value(nullptr); return true; }
+  bool data_string(std::string const & s) override { writer.value(s); return true; }
+  bool begin_array() override { writer.begin_array(); return true; }
+  bool end_array() override { writer.end_array(); return true; }
+  bool begin_object() override { writer.begin_object(); return true; }
+  bool end_object() override { writer.end_object(); return true; }
+  bool data_key(std::string const & k) override { writer.key(k); return true; }
+};
+
+std::string stream_node(const json::Node & node, unsigned indent, unsigned initial_indent = 0)
+{
+  std::ostringstream os;
+  if (indent) {
+    os << json::pretty(indent, initial_indent);
+  }
+  json::StreamWriter writer(os);
+  StreamingVisitor visitor(writer);
+  node.visit(visitor);
+  return os.str();
+}
+
+// A nested document with every kind of value, and empty and nested containers.  The keys are
+// added out of order, since Object sorts them.
+json::ObjectRef make_document(const json::Builder & builder)
+{
+  auto doc = builder.object();
+  auto values = builder.array();
+  values->add(1);
+  values->add(-2);
+  values->add(3.5);
+  values->add(std::numeric_limits<std::uintmax_t>::max());
+  values->add(true);
+  values->add(false);
+  values->add(builder.null());
+  values->add("quoted \"string\"\n\twith escapes");
+  doc->add("values", std::move(values));
+  doc->add("empty_array", builder.array());
+  doc->add("empty_object", builder.object());
+
+  auto functions = builder.array();
+  for (int i = 0; i < 3; ++i) {
+    auto function = builder.object();
+    function->add("address", 0x401000 + i * 0x10);
+    auto calls = builder.array();
+    for (int j = 0; j < i; ++j) {
+      auto call = builder.object();
+      call->add("target", "func" + std::to_string(j));
+      call->add("args", builder.array());
+      calls->add(std::move(call));
+    }
+    function->add("calls", std::move(calls));
+    auto nested = builder.array();
+    auto inner = builder.array();
+    inner->add(i);
+    nested->add(std::move(inner));
+    nested->add(builder.array());
+    function->add("nested", std::move(nested));
+    functions->add(std::move(function));
+  }
+  doc->add("functions", std::move(functions));
+  doc->add("name", "test");
+  return doc;
+}
+
+} // unnamed namespace
+
+class StreamWriterTest : public testing::TestWithParam<unsigned> {
+ protected:
+  json::BuilderRef builder_ = json::simple_builder();
+};
+
+// Streaming the whole document, one value at a time, matches operator<<.
+TEST_P(StreamWriterTest, TEST_VISITED_DOCUMENT) {
+  auto doc = make_document(*builder_);
+  std::string streamed = stream_node(*doc, GetParam());
+  EXPECT_EQ(streamed, write_node(*doc, GetParam()));
+  // Only pretty output has newlines, since the newline in the string is escaped.
+  EXPECT_EQ(streamed.find('\n') != std::string::npos, GetParam() != 0);
+  EXPECT_EQ(stream_node(*doc, GetParam(), 2), write_node(*doc, GetParam(), 2));
+}
+
+// The usual approach: the outer containers are streamed, and each of the elements inside them
+// is built as a node and written as a single value.
+TEST_P(StreamWriterTest, TEST_STREAMED_CONTAINERS) {
+  unsigned indent = GetParam();
+  auto doc = builder_->object();
+  auto functions = builder_->array();
+
+  std::ostringstream os;
+  if (indent) {
+    os << json::pretty(indent);
+  }
+  {
+    json::StreamWriter writer(os);
+    writer.begin_object();
+    writer.key("config");
+    auto config = builder_->object();
+    config->add("threads", 4);
+    config->add("verbose", false);
+    writer.value(*config);
+    doc->add("config", std::move(config));
+
+    writer.key("functions");
+    writer.begin_array();
+    for (int i = 0; i < 4; ++i) {
+      auto function = builder_->object();
+      function->add("address", 0x401000 + i);
+      function->add("name", "func" + std::to_string(i));
+      writer.value(*function);
+      functions->add(std::move(function));
+    }
+    writer.end_array();
+    doc->add("functions", std::move(functions));
+
+    writer.key("total");
+    writer.value(4);
+    doc->add("total", 4);
+    writer.end_object();
+  }
+  EXPECT_EQ(os.str(), write_node(*doc, indent));
+}
+
+TEST_P(StreamWriterTest, TEST_TOP_LEVEL_VALUES) {
+  unsigned indent = GetParam();
+  EXPECT_EQ(stream_node(*builder_->array(), indent), write_node(*builder_->array(), indent));
+  EXPECT_EQ(stream_node(*builder_->object(), indent), write_node(*builder_->object(), indent));
+  auto str = builder_->simple("top");
+  EXPECT_EQ(stream_node(*str, indent), write_node(*str, indent));
+  auto num = builder_->simple(json::Simple::integer(-7));
+  EXPECT_EQ(stream_node(*num, indent), write_node(*num, indent));
+}
+
+// Compact output, and pretty output with a couple of indents.
+INSTANTIATE_TEST_CASE_P(Formats, StreamWriterTest, testing::Values(0u, 2u, 4u));
+
+int main(int argc, char **argv) {
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
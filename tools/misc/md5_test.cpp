@@ -0,0 +1,120 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <gtest/gtest.h>
+#include <libpharos/md5.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace pharos;
+
+namespace {
+
+// A buffer of the given size with contents that depend on the size and a seed.
+std::string make_buffer(size_t size, unsigned seed) {
+  std::string buffer(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    buffer[i] = char((i * 131 + size * 7 + seed * 17) & 0xff);
+  }
+  return buffer;
+}
+
+// Compute the digests of the buffers with MD5Batch, and compare them with MD5.
+void check_batch(const std::vector<std::string> & buffers) {
+  MD5Batch batch;
+  for (const std::string & buffer : buffers) {
+    batch.add(buffer);
+  }
+  ASSERT_EQ(batch.size(), buffers.size());
+  batch.compute();
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    EXPECT_EQ(batch.result(i).str(), MD5(buffers[i]).finalize().str())
+      << "buffer " << i << " of " << buffers.size() << " (" << buffers[i].size() << " bytes)";
+  }
+}
+
+} // unnamed namespace
+
+TEST(MD5BatchTest, KnownDigests) {
+  // The batch doesn't copy the buffers, so they must outlive compute().
+  std::string empty, abc = "abc", fox = "The quick brown fox jumps over the lazy dog";
+  MD5Batch batch;
+  batch.add(empty);
+  batch.add(abc);
+  batch.add(fox);
+  batch.compute();
+  EXPECT_EQ(batch.result(0).str(), "D41D8CD98F00B204E9800998ECF8427E");
+  EXPECT_EQ(batch.result(1).str(), "900150983CD24FB0D6963F7D28E17F72");
+  EXPECT_EQ(batch.result(2).str(), "9E107D9D372BB6826BD81D3542A419D6");
+}
+
+// The lengths around the padding boundaries: a 55 byte message fits in one block with its
+// padding and length, while a 56 byte one needs a second block.
+TEST(MD5BatchTest, PaddingBoundaries) {
+  std::vector<std::string> buffers;
+  for (size_t size : {0, 1, 55, 56, 57, 63, 64, 65, 119, 120, 127, 128, 129}) {
+    buffers.push_back(make_buffer(size, 0));
+  }
+  check_batch(buffers);
+}
+
+// Every buffer count from one to a few more than twice the lane count, so that the number of
+// buffers is often not a multiple of the number of lanes, with the lengths varying so that
+// the lanes finish at different times.
+TEST(MD5BatchTest, PartialLanes) {
+  for (size_t count = 1; count <= 11; ++count) {
+    std::vector<std::string> buffers;
+    for (size_t i = 0; i < count; ++i) {
+      buffers.push_back(make_buffer((i * 37) % 200, unsigned(count)));
+    }
+    check_batch(buffers);
+  }
+}
+
+TEST(MD5BatchTest, VariedLengths) {
+  std::vector<std::string> buffers;
+  for (size_t size = 0; size < 300; ++size) {
+    buffers.push_back(make_buffer(size, 1));
+  }
+  // A long buffer among short ones keeps one lane busy while the others are refilled.
+  buffers.push_back(make_buffer(10000, 2));
+  for (size_t size = 0; size < 10; ++size) {
+    buffers.push_back(make_buffer(size * 64, 3));
+  }
+  check_batch(buffers);
+}
+
+TEST(MD5BatchTest, ClearAndReuse) {
+  MD5Batch batch;
+  std::string first = make_buffer(100, 4);
+  batch.add(first);
+  batch.compute();
+  EXPECT_EQ(batch.result(0).str(), MD5(first).finalize().str());
+
+  batch.clear();
+  EXPECT_EQ(batch.size(), 0u);
+  std::string second = make_buffer(56, 5);
+  batch.add(second);
+  batch.compute();
+  EXPECT_EQ(batch.result(0).str(), MD5(second).finalize().str());
+  EXPECT_THROW(batch.result(1), std::out_of_range);
+}
+
+TEST(MD5BatchTest, EmptyBatch) {
+  MD5Batch batch;
+  batch.compute();
+  EXPECT_EQ(batch.size(), 0u);
+}
+
+int main(int argc, char **argv) {
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -0,0 +1,132 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <gtest/gtest.h>
+#include <libpharos/memtrack.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace pharos;
+
+namespace {
+
+// Allocation sizes are rounded up by the allocator, so the tests only check lower bounds on
+// the bytes that were charged to a tracker.
+const size_t block_size = 1 << 16;
+
+// The operators are called directly because the compiler may elide a new expression whose
+// result is only deleted.
+void * allocate()
+{
+  return ::operator new(block_size);
+}
+
+void release(void * p)
+{
+  ::operator delete(p);
+}
+
+} // unnamed namespace
+
+// The allocation functions in libpharos are the ones called by this program, so allocations
+// should be tracked wherever tracking is supported.
+TEST(MemtrackTest, TEST_ENABLED) {
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+  EXPECT_TRUE(AllocationTracker::is_enabled());
+#else
+  EXPECT_FALSE(AllocationTracker::is_enabled());
+#endif
+}
+
+TEST(MemtrackTest, TEST_CURRENT) {
+  const AllocationTracker * outside = AllocationTracker::current();
+  {
+    AllocationTracker outer;
+    EXPECT_EQ(AllocationTracker::current(), &outer);
+    {
+      AllocationTracker inner;
+      EXPECT_EQ(AllocationTracker::current(), &inner);
+    }
+    EXPECT_EQ(AllocationTracker::current(), &outer);
+  }
+  EXPECT_EQ(AllocationTracker::current(), outside);
+}
+
+// An allocation is charged to every tracker attached to the thread, but only while it's
+// attached.
+TEST(MemtrackTest, TEST_NESTED) {
+  if (!AllocationTracker::is_enabled()) return;
+  AllocationTracker outer;
+  void * before = allocate();
+  size_t outer_before = outer.get_current_bytes();
+  EXPECT_GE(outer_before, block_size);
+  {
+    AllocationTracker inner;
+    void * during = allocate();
+    EXPECT_GE(inner.get_current_bytes(), block_size);
+    EXPECT_LT(inner.get_current_bytes(), 2 * block_size);
+    EXPECT_GE(outer.get_current_bytes(), outer_before + block_size);
+    EXPECT_GE(inner.get_allocations(), 1u);
+    release(during);
+    EXPECT_EQ(inner.get_current_bytes(), 0u);
+  }
+  EXPECT_EQ(outer.get_current_bytes(), outer_before);
+  release(before);
+  EXPECT_EQ(outer.get_current_bytes(), 0u);
+}
+
+// The peak is kept after the memory is freed.
+TEST(MemtrackTest, TEST_PEAK_AFTER_FREE) {
+  if (!AllocationTracker::is_enabled()) return;
+  AllocationTracker tracker;
+  std::vector<void *> blocks;
+  blocks.reserve(4);
+  for (int i = 0; i < 4; ++i) {
+    blocks.push_back(allocate());
+  }
+  for (void * p : blocks) {
+    release(p);
+  }
+  size_t vector_bytes = tracker.get_current_bytes();
+  blocks = std::vector<void *>();
+  EXPECT_LT(vector_bytes, block_size);
+  EXPECT_EQ(tracker.get_current_bytes(), 0u);
+  EXPECT_GE(tracker.get_peak_bytes(), 4 * block_size);
+  EXPECT_GE(tracker.get_allocations(), 4u);
+
+  // A smaller allocation afterwards doesn't lower the peak.
+  size_t peak = tracker.get_peak_bytes();
+  void * small = allocate();
+  EXPECT_EQ(tracker.get_peak_bytes(), peak);
+  release(small);
+}
+
+// Allocations by other threads aren't charged to this thread's trackers, and memory allocated
+// before a tracker was attached doesn't make it go negative when it's freed.
+TEST(MemtrackTest, TEST_OTHER_THREADS) {
+  if (!AllocationTracker::is_enabled()) return;
+  void * before = allocate();
+  AllocationTracker tracker;
+  std::thread other([]() {
+    EXPECT_EQ(AllocationTracker::current(), nullptr);
+    release(allocate());
+  });
+  other.join();
+  size_t after_thread = tracker.get_current_bytes();
+  EXPECT_LT(after_thread, block_size);
+  release(before);
+  EXPECT_EQ(tracker.get_current_bytes(), 0u);
+}
+
+int main(int argc, char **argv) {
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -0,0 +1,170 @@
+// Copyright 2024 Carnegie Mellon University.  See LICENSE file for terms.
+
+#include <libpharos/state.hpp>
+#include <gtest/gtest.h>
+
+#include <map>
+#include <vector>
+
+using namespace pharos;
+
+namespace {
+
+// A model of the states of a block, which are just the values of a few registers.  Each
+// evaluation of the block writes some of the registers, and copies the others from its input,
+// just as evaluating a real block does.
+using State = std::map<RegisterDescriptor, int>;
+
+const std::vector<RegisterDescriptor> regs = {
+  RegisterDescriptor(x86_regclass_gpr, x86_gpr_ax, 0, 32),
+  RegisterDescriptor(x86_regclass_gpr, x86_gpr_bx, 0, 32),
+  RegisterDescriptor(x86_regclass_gpr, x86_gpr_cx, 0, 32),
+  RegisterDescriptor(x86_regclass_gpr, x86_gpr_dx, 0, 32),
+};
+
+StateWrites changed_locations(const State & a, const State & b) {
+  StateWrites result;
+  result.clear();
+  for (const RegisterDescriptor & reg : regs) {
+    if (a.at(reg) != b.at(reg)) result.registers.insert(reg);
+  }
+  return result;
+}
+
+bool equal_at(const State & a, const State & b, const StateWrites & locations) {
+  if (locations.all) return a == b;
+  for (const RegisterDescriptor & reg : locations.registers) {
+    if (a.at(reg) != b.at(reg)) return false;
+  }
+  return true;
+}
+
+// The part of DUAnalysis::process_block_with_limit() that decides whether the output state of a
+// block changed, with the states replaced by the model.
+class ModelBlock {
+  OutputChanges changes;
+  bool has_output = false;
+  State output;
+  StateWrites output_writes;
+  State last_input;
+
+ public:
+  // Evaluate the block on input, writing the given values.  Returns whether the output state
+  // was replaced, and checks that it's replaced whenever it actually changed.
+  bool evaluate(const State & input, const State & written) {
+    if (has_output) {
+      changes.input_changed(changed_locations(last_input, input));
+    }
+    last_input = input;
+
+    State result = input;
+    StateWrites writes;
+    writes.clear();
+    for (auto & value : written) {
+      result[value.first] = value.second;
+      writes.registers.insert(value.first);
+    }
+
+    StateWrites locations = writes;
+    if (has_output) {
+      locations = changes.locations(writes, output_writes);
+    }
+    else {
+      locations.all = true;
+    }
+    bool replaced = !(has_output && equal_at(result, output, locations));
+    EXPECT_EQ(replaced, !has_output || result != output);
+    changes.evaluated(locations, replaced);
+    if (replaced) {
+      has_output = true;
+      output = result;
+      output_writes = writes;
+    }
+    return replaced;
+  }
+
+  const State & get_output() const { return output; }
+};
+
+State make_state(int a, int b, int c, int d) {
+  return State{{regs[0], a}, {regs[1], b}, {regs[2], c}, {regs[3], d}};
+}
+
+} // unnamed namespace
+
+// The write set differs between evaluations.  The second evaluation writes the register whose
+// input changed, so its output equals the stored one.  The third doesn't write that register,
+// so the changed input flows through to the output, even though neither the third evaluation
+// nor the one that produced the stored output wrote it, and its input didn't change again.
+// The output differs from the stored one only at that register.
+TEST(OutputChangesTest, TEST_PATH_DEPENDENT_WRITES) {
+  ModelBlock block;
+  EXPECT_TRUE(block.evaluate(make_state(5, 0, 0, 0), {{regs[1], 1}}));
+  EXPECT_FALSE(block.evaluate(make_state(7, 0, 0, 0), {{regs[0], 5}, {regs[1], 1}}));
+  EXPECT_TRUE(block.evaluate(make_state(7, 0, 0, 2), {{regs[1], 1}, {regs[3], 0}}));
+  EXPECT_EQ(block.get_output(), make_state(7, 1, 0, 0));
+}
+
+// Once the stored output is replaced, the earlier changes are no longer needed.
+TEST(OutputChangesTest, TEST_REPLACED) {
+  OutputChanges changes;
+  StateWrites none;
+  none.clear();
+  changes.evaluated(none, true);
+
+  StateWrites ax = none;
+  ax.registers.insert(regs[0]);
+  StateWrites bx = none;
+  bx.registers.insert(regs[1]);
+
+  changes.input_changed(ax);
+  StateWrites locations = changes.locations(none, bx);
+  EXPECT_FALSE(locations.all);
+  EXPECT_EQ(locations.size(), 2u);
+
+  // Not replaced, so the locations are carried forward.
+  changes.evaluated(locations, false);
+  EXPECT_EQ(changes.locations(none, none).size(), 2u);
+
+  changes.evaluated(locations, true);
+  EXPECT_EQ(changes.locations(none, none).size(), 0u);
+
+  // A full comparison that didn't replace the output leaves every location unknown.
+  StateWrites all;
+  changes.evaluated(all, false);
+  EXPECT_TRUE(changes.locations(none, none).all);
+}
+
+// Many evaluations with inputs and write sets that vary from one evaluation to the next, as
+// they do with writes to symbolic addresses.  ModelBlock::evaluate() checks every one.
+TEST(OutputChangesTest, TEST_VARYING_WRITES) {
+  ModelBlock block;
+  unsigned seed = 1;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+  };
+  size_t replaced = 0;
+  for (int i = 0; i < 1000; ++i) {
+    State input = make_state(next() % 3, next() % 3, next() % 3, next() % 3);
+    State written;
+    for (const RegisterDescriptor & reg : regs) {
+      if (next() % 2) written[reg] = next() % 3;
+    }
+    if (block.evaluate(input, written)) ++replaced;
+  }
+  EXPECT_GT(replaced, 1u);
+}
+
+int main(int argc, char **argv) {
+
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
+
+/* Local Variables:   */
+/* mode: c++          */
+/* fill-column:    95 */
+/* comment-column: 0  */
+/* End:               */
@@ -114,7 +114,8 @@ class PathAnalyzer : public BottomUpAnalyzer {
  private:
   std::string exe_file_name_, dot_output_dir_, z3_file_;
   bool save_graphviz_, save_z3_;
-  rose_addr_t goal_address_, start_address_;
+  rose_addr_t start_address_;
+  std::vector<rose_addr_t> goal_addresses_;
   PathFinder path_finder_;
 
   // Generate the proper DOT files in the output directory
@@ -283,11 +284,19 @@ class PathAnalyzer : public BottomUpAnalyzer {
     }
 
     if (vm.count("goal")) {
+      for (const std::string & goal : opts["goal"].as<std::vector<std::string>>()) {
+        rose_addr_t goal_address;
+        std::stringstream goal_ss;
+        goal_ss << std::hex << goal;
+        goal_ss >> goal_address;
+        goal_addresses_.push_back(goal_address);
+      }
+    }
 
-      std::stringstream goal_ss;
-      goal_ss << std::hex << opts["goal"].as<std::string>();
-      goal_ss >> goal_address_;
-
+    // Most of the constraints are shared between goals, so when there's more than one goal
+    // they're asserted once, and only the goal constraints change between queries.
+    if (goal_addresses_.size() > 1) {
+      path_finder_.set_incremental(true);
     }
   }
 
@@ -300,11 +309,27 @@ class PathAnalyzer : public BottomUpAnalyzer {
   // This is where path finding really happens
   void finish() {
 
-    path_finder_.find_path(start_address_, goal_address_);
+    if (goal_addresses_.empty()) {
+      OERROR << "No goal address was specified." << LEND;
+      return;
+    }
+    for (rose_addr_t goal_address : goal_addresses_) {
+      find_path(goal_address);
+    }
+    path_finder_.report_statistics();
+
+    if (save_z3_) {
+      generate_z3_file();
+    }
+  }
+
+  void find_path(rose_addr_t goal_address) {
+
+    path_finder_.find_path(start_address_, goal_address);
 
     if (path_finder_.path_found())  {
       OINFO << "There is a path from " << addr_str(start_address_)
-            << " to " << addr_str(goal_address_) << ". Well done!"
+            << " to " << addr_str(goal_address) << ". Well done!"
             << LEND;
 
       if (save_graphviz_) {
@@ -314,12 +339,9 @@ class PathAnalyzer : public BottomUpAnalyzer {
     else {
       OERROR << "There is no feasible path from "
              << addr_str(start_address_) << " to "
-             << addr_str(goal_address_) << ". Better luck next time!"
+             << addr_str(goal_address) << ". Better luck next time!"
              << LEND;
     }
-    if (save_z3_) {
-      generate_z3_file();
-    }
 
     std::cout << std::setfill('=') << std::setw(80) << "\n"
               << to_string() << "\n"
@@ -334,7 +356,8 @@ ProgOptDesc pathanalyzer_options() {
   pathopt.add_options()
     ("dot,d", po::value<bf::path>(),   "The directory to write DOT file(s)")
     ("z3,z", po::value<bf::path>(),    "Save z3 output file (for troubleshooting)")
-    ("goal,g", po::value<std::string>(),  "The goal address")
+    ("goal,g", po::value<std::vector<std::string>>()->composing(),
+     "The goal address (may be repeated)")
     ("start,s", po::value<std::string>(), "The starting address");
 
   return pathopt;